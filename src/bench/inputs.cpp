@@ -0,0 +1,175 @@
+#include "inputs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+
+#include "constants.h"
+#include "scenes.h"
+#include "targets.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const Vector3 BENCH_CAMERA_ORIGIN    (0.0f, 0.0f, -1.0f);
+static const Vector3 BENCH_PROJECTION_CENTER(0.0f, 0.0f,  0.0f);
+
+constexpr float BENCH_PROJECTION_HEIGHT = 2.0f;
+
+// Distance moved by spheres of the motion blur scene along each segment of their paths, several times their radii
+constexpr float BENCH_MOTION_BLUR_SEGMENT_LENGTH = 0.4f;
+
+//
+// Service
+//
+
+/**
+ * @brief Uniform value in [min, max] derived from the generator's output directly, as distributions are implementation-defined.
+ */
+static inline float GetBenchRandomValue(std::mt19937 & generator, const float min, const float max);
+
+static Vector3 GetBenchRandomDirection(std::mt19937 & generator);
+
+//
+// Utilities
+//
+
+std::vector<Ray> CreateBenchRays(const Vector3 & sphereCenter, const float sphereRadius, const std::uint32_t seed)
+{
+    std::mt19937 generator(seed);
+
+    std::vector<Ray> rays(BENCH_INPUT_COUNT);
+    for (Ray & ray : rays)
+    {
+        const Vector3 origin = BENCH_CAMERA_ORIGIN + 0.1f*GetBenchRandomDirection(generator);
+
+        // Targets within twice the radius, so that about a quarter of the rays hit, some of them at grazing angles
+        const Vector3 target = sphereCenter + 2.0f*sphereRadius*GetBenchRandomValue(generator, 0.0f, 1.0f)*GetBenchRandomDirection(generator);
+
+        ray = Ray(origin, (target - origin).normalized());
+    }
+
+    return rays;
+}
+
+std::vector<SurfaceHit> CreateBenchSurfaceHits(const std::uint32_t seed)
+{
+    std::mt19937 generator(seed);
+
+    std::vector<SurfaceHit> surfaceHits(BENCH_INPUT_COUNT);
+    for (SurfaceHit & surfaceHit : surfaceHits)
+    {
+        const Vector3 normal = GetBenchRandomDirection(generator);
+
+        Vector3 direction = GetBenchRandomDirection(generator);
+        if (direction.dot(normal) > 0.0f)
+            direction = -direction;
+
+        // Outward normals, as targets return them, with the ray arriving from outside
+        surfaceHit.IncomingRay = Ray(normal - direction, direction);
+        surfaceHit.Hit = RayHit{1.0f, normal, normal};
+    }
+
+    return surfaceHits;
+}
+
+std::vector<Body> CreateBenchMotionBlurSceneBodies(const int sphereCount, const std::uint32_t seed)
+{
+    std::vector<Body> bodies = CreateManySpheresSceneBodies(sphereCount, seed);
+
+    std::mt19937 generator(seed);
+
+    for (Body & body : bodies)
+    {
+        const SphereRayTarget * const pSphere = dynamic_cast<const SphereRayTarget *>(body.RayTarget.get());
+        if (pSphere == nullptr)
+            continue;
+
+        const Vector3 & startCenter  = pSphere->GetCenter();
+        const Vector3   middleCenter = startCenter  + BENCH_MOTION_BLUR_SEGMENT_LENGTH*GetBenchRandomDirection(generator);
+        const Vector3   endCenter    = middleCenter + BENCH_MOTION_BLUR_SEGMENT_LENGTH*GetBenchRandomDirection(generator);
+
+        body.RayTarget = std::make_shared<MovingSphereRayTarget>(
+            std::vector<Vector3>{startCenter, middleCenter, endCenter},
+            pSphere->GetRadius()
+        );
+    }
+
+    return bodies;
+}
+
+Camera CreateBenchCamera(const int imageWidth, const int imageHeight, const CameraLens & lens)
+{
+    const float aspectRatio = static_cast<float>(imageWidth)/static_cast<float>(imageHeight);
+
+    return Camera(
+        BENCH_CAMERA_ORIGIN,
+        BENCH_PROJECTION_CENTER,
+        Vector3(0.0f, 1.0f, 0.0f),
+        BENCH_PROJECTION_HEIGHT*aspectRatio,
+        BENCH_PROJECTION_HEIGHT,
+        lens
+    );
+}
+
+CameraRaySamples CreateBenchCameraRaySamples(const int tileSize, const std::uint32_t seed)
+{
+    std::mt19937 generator(seed);
+
+    CameraRaySamples samples;
+    samples.Resize(static_cast<size_t>(tileSize)*tileSize);
+
+    for (int y = 0; y < tileSize; y++)
+    {
+        for (int x = 0; x < tileSize; x++)
+        {
+            const size_t i = static_cast<size_t>(y)*tileSize + x;
+
+            samples.ImageXs[i]     = static_cast<float>(x) + GetBenchRandomValue(generator, -0.5f, 0.5f);
+            samples.ImageYs[i]     = static_cast<float>(y) + GetBenchRandomValue(generator, -0.5f, 0.5f);
+            samples.LensValuesX[i] = GetBenchRandomValue(generator, 0.0f, 1.0f);
+            samples.LensValuesY[i] = GetBenchRandomValue(generator, 0.0f, 1.0f);
+            samples.Times[i]       = 0.0f;
+        }
+    }
+
+    return samples;
+}
+
+RayMissFunction CreateBenchRayMissFunction()
+{
+    static const Color BACKGROUND_TOP_COLOR   (0.7f, 0.7f, 0.95f);
+    static const Color BACKGROUND_BOTTOM_COLOR(0.9f, 0.9f, 0.9f);
+
+    return std::bind(
+        GetVerticalGradientColor,
+        std::placeholders::_1,
+        BACKGROUND_BOTTOM_COLOR,
+        BACKGROUND_TOP_COLOR
+    );
+}
+
+//
+// Service
+//
+
+static inline float GetBenchRandomValue(std::mt19937 & generator, const float min, const float max)
+{
+    return min + (max - min)*static_cast<float>(generator())/static_cast<float>(std::mt19937::max());
+}
+
+static Vector3 GetBenchRandomDirection(std::mt19937 & generator)
+{
+    const float z   = GetBenchRandomValue(generator, -1.0f, 1.0f);
+    const float phi = GetBenchRandomValue(generator, 0.0f, 2.0f*PI);
+    const float r   = std::sqrt(std::max(0.0f, 1.0f - z*z));
+
+    return Vector3(r*std::cos(phi), r*std::sin(phi), z);
+}
+
+} // namespace rtwe
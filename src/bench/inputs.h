@@ -0,0 +1,76 @@
+#ifndef RTWE_BENCH_INPUTS_H
+#define RTWE_BENCH_INPUTS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "Ray.h"
+#include "Camera.h"
+#include "tracing.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+// Benchmarks cycle through this many precomputed inputs, so that branches can't be predicted from one repeated input
+constexpr size_t BENCH_INPUT_COUNT = 1024; // Must be a power of 2
+
+// All inputs and scenes are generated from fixed seeds, so that results are comparable between commits
+constexpr std::uint32_t BENCH_SEED = 20240101;
+
+// Size of the image whose pixels rendering benchmarks trace, with the same camera as the application
+constexpr int BENCH_IMAGE_WIDTH  = 160;
+constexpr int BENCH_IMAGE_HEIGHT = 120;
+
+//
+// Interface types
+//
+
+struct SurfaceHit final
+{
+    Ray    IncomingRay;
+    RayHit Hit;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Rays from around the application's camera position towards a sphere, with about half of them missing it.
+ */
+std::vector<Ray> CreateBenchRays(const Vector3 & sphereCenter, const float sphereRadius, const std::uint32_t seed);
+
+/**
+ * @brief Hits of rays coming from random directions on random points of a unit sphere around the origin.
+ */
+std::vector<SurfaceHit> CreateBenchSurfaceHits(const std::uint32_t seed);
+
+/**
+ * @brief Bodies of the many spheres scene, with every sphere moving a long way compared to its size over the shutter interval,
+ *        along a path of two linear segments in random directions.
+ */
+std::vector<Body> CreateBenchMotionBlurSceneBodies(const int sphereCount, const std::uint32_t seed);
+
+/**
+ * @brief Same view as the application's initial one.
+ */
+Camera CreateBenchCamera(const int imageWidth, const int imageHeight, const CameraLens & lens = PINHOLE_CAMERA_LENS);
+
+/**
+ * @brief One jittered sample per pixel of a square tile at the top left of the image, at random positions on the lens.
+ */
+CameraRaySamples CreateBenchCameraRaySamples(const int tileSize, const std::uint32_t seed);
+
+/**
+ * @brief Same background as the application's.
+ */
+RayMissFunction CreateBenchRayMissFunction();
+
+} // namespace rtwe
+
+#endif // RTWE_BENCH_INPUTS_H
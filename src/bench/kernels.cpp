@@ -0,0 +1,317 @@
+#include <benchmark/benchmark.h>
+
+#include "inputs.h"
+#include "math_utils.h"
+#include "sampling.h"
+#include "tracing.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const Vector3 BENCH_SPHERE_CENTER(0.0f, 0.0f, 1.0f);
+
+constexpr float BENCH_SPHERE_RADIUS = 0.5f;
+
+// Same tile size as the renderer's, whose samples the wavefront integrator creates camera rays for in one batch
+constexpr int BENCH_CAMERA_TILE_SIZE = 64;
+
+// Focused on the sphere at the center of the view
+constexpr CameraLens BENCH_CAMERA_LENS{0.05f, 2.0f};
+
+static const Vector3 BENCH_PLANE_POINT (0.0f, -0.5f, 0.0f);
+static const Vector3 BENCH_PLANE_NORMAL(0.0f,  1.0f, 0.0f);
+
+static const Material BENCH_MATTE_MATERIAL   {Color(0.35f, 0.7f, 0.35f), 0.0f,   1.0f,   0.0f,   1.0f};
+static const Material BENCH_METALLIC_MATERIAL{Color(0.8f, 0.4f, 0.6f),   0.75f,  0.85f,  0.0f,   1.0f};
+static const Material BENCH_GLASS_MATERIAL   {Color(0.75f, 0.75f, 0.75f), 0.975f, 0.975f, 0.975f, 1.5f};
+
+//
+// Service
+//
+
+/**
+ * @brief Benchmarks a scatter function with the given material over precomputed surface hits.
+ */
+template <typename ScatterFunction>
+static void BenchmarkScatter(benchmark::State & state, const ScatterFunction & scatter, const Material & material);
+
+/**
+ * @brief Benchmarks a packet scatter function with the given material over packets of precomputed surface hits.
+ */
+template <typename ScatterPacketFunction>
+static void BenchmarkScatterPacket(benchmark::State & state, const ScatterPacketFunction & scatterPacket, const Material & material);
+
+//
+// Intersection
+//
+
+static void BenchmarkTryRayHitSphere(benchmark::State & state)
+{
+    const std::vector<Ray> rays = CreateBenchRays(BENCH_SPHERE_CENTER, BENCH_SPHERE_RADIUS, BENCH_SEED);
+
+    size_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TryRayHitSphere(rays[i++ & (BENCH_INPUT_COUNT - 1)], BENCH_SPHERE_CENTER, BENCH_SPHERE_RADIUS));
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkTryRayHitPlane(benchmark::State & state)
+{
+    // Rays aimed at a point on the plane, so that some rays hit it from either side and some run away from it
+    const std::vector<Ray> rays = CreateBenchRays(BENCH_PLANE_POINT + Vector3(0.0f, 0.0f, 1.0f), 1.0f, BENCH_SEED);
+
+    size_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TryRayHitPlane(rays[i++ & (BENCH_INPUT_COUNT - 1)], BENCH_PLANE_POINT, BENCH_PLANE_NORMAL));
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkSolveQuadraticEquation(benchmark::State & state)
+{
+    // Coefficients of the sphere intersection equation, which has real roots for about a quarter of the rays
+    const std::vector<Ray> rays = CreateBenchRays(BENCH_SPHERE_CENTER, BENCH_SPHERE_RADIUS, BENCH_SEED);
+
+    std::vector<Vector3> coefficients(BENCH_INPUT_COUNT);
+    for (size_t i = 0; i < BENCH_INPUT_COUNT; i++)
+    {
+        const Vector3 centerToOrigin = rays[i].Origin - BENCH_SPHERE_CENTER;
+
+        coefficients[i] = Vector3(
+            rays[i].Direction.squaredNorm(),
+            -2.0f*rays[i].Direction.dot(centerToOrigin),
+            centerToOrigin.squaredNorm() - BENCH_SPHERE_RADIUS*BENCH_SPHERE_RADIUS
+        );
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const Vector3 & abc = coefficients[i++ & (BENCH_INPUT_COUNT - 1)];
+
+        benchmark::DoNotOptimize(solveQuadraticEquation(abc.x(), abc.y(), abc.z()));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+//
+// Sampling and camera
+//
+
+static void BenchmarkGetRandomValue(benchmark::State & state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GetRandomValue());
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkSamplerGetValue(benchmark::State & state)
+{
+    const std::unique_ptr<ISampler> pSampler = CreateSampler(static_cast<SamplerType>(state.range(0)), CreateSamplerSeed(true));
+
+    // Some samplers build their tables on first use, which shouldn't count as one of the iterations
+    benchmark::DoNotOptimize(pSampler->GetValue(0, 0, 0, 0));
+
+    std::uint32_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(pSampler->GetValue(static_cast<int>(i & 63), static_cast<int>((i >> 6) & 63), i >> 12, 0));
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkCameraCreateRay(benchmark::State & state)
+{
+    const Camera camera = CreateBenchCamera(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT);
+
+    int x = 0;
+    int y = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            camera.CreateRay(
+                (static_cast<float>(x) + 0.5f)/BENCH_IMAGE_WIDTH,
+                1.0f - (static_cast<float>(y) + 0.5f)/BENCH_IMAGE_HEIGHT
+            )
+        );
+
+        if (++x == BENCH_IMAGE_WIDTH)
+        {
+            x = 0;
+            y = (y + 1) % BENCH_IMAGE_HEIGHT;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkCameraCreateLensRay(benchmark::State & state)
+{
+    const Camera           camera  = CreateBenchCamera(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, BENCH_CAMERA_LENS);
+    const CameraRaySamples samples = CreateBenchCameraRaySamples(BENCH_CAMERA_TILE_SIZE, BENCH_SEED);
+
+    // Lens values are the ones varying, as the concentric mapping branches on them
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const size_t sampleIndex = i++ % samples.GetCount();
+
+        benchmark::DoNotOptimize(
+            camera.CreateLensRay(
+                samples.ImageXs[sampleIndex]/BENCH_IMAGE_WIDTH,
+                1.0f - samples.ImageYs[sampleIndex]/BENCH_IMAGE_HEIGHT,
+                0.0f,
+                samples.LensValuesX[sampleIndex],
+                samples.LensValuesY[sampleIndex]
+            )
+        );
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BenchmarkCameraCreateImageRays(benchmark::State & state)
+{
+    const bool             hasAperture = state.range(0) != 0;
+    const Camera           camera      = CreateBenchCamera(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, hasAperture ? BENCH_CAMERA_LENS : PINHOLE_CAMERA_LENS);
+    const CameraRaySamples samples     = CreateBenchCameraRaySamples(BENCH_CAMERA_TILE_SIZE, BENCH_SEED);
+
+    std::vector<Ray> rays;
+    for (auto _ : state)
+    {
+        camera.CreateImageRays(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT, samples, rays);
+
+        benchmark::DoNotOptimize(rays.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations()*static_cast<std::int64_t>(samples.GetCount()));
+}
+
+//
+// Scattering
+//
+
+static void BenchmarkTryScatterLambertian(benchmark::State & state)
+{
+    BenchmarkScatter(state, TryScatterLambertian, BENCH_MATTE_MATERIAL);
+}
+
+static void BenchmarkTryScatterMetallic(benchmark::State & state)
+{
+    BenchmarkScatter(state, TryScatterMetallic, BENCH_METALLIC_MATERIAL);
+}
+
+static void BenchmarkTryScatterRefractive(benchmark::State & state)
+{
+    BenchmarkScatter(state, TryScatterRefractive, BENCH_GLASS_MATERIAL);
+}
+
+static void BenchmarkTryScatterLambertianPacket(benchmark::State & state)
+{
+    BenchmarkScatterPacket(state, TryScatterLambertianPacket, BENCH_MATTE_MATERIAL);
+}
+
+static void BenchmarkTryScatterMetallicPacket(benchmark::State & state)
+{
+    BenchmarkScatterPacket(state, TryScatterMetallicPacket, BENCH_METALLIC_MATERIAL);
+}
+
+//
+// Registration
+//
+
+BENCHMARK(BenchmarkTryRayHitSphere);
+BENCHMARK(BenchmarkTryRayHitPlane);
+BENCHMARK(BenchmarkSolveQuadraticEquation);
+
+BENCHMARK(BenchmarkGetRandomValue);
+BENCHMARK(BenchmarkSamplerGetValue)
+    ->ArgName("sampler")
+    ->Arg(static_cast<int>(SamplerType::Random))
+    ->Arg(static_cast<int>(SamplerType::Halton))
+    ->Arg(static_cast<int>(SamplerType::Sobol))
+    ->Arg(static_cast<int>(SamplerType::BlueNoise));
+BENCHMARK(BenchmarkCameraCreateRay);
+BENCHMARK(BenchmarkCameraCreateLensRay);
+BENCHMARK(BenchmarkCameraCreateImageRays)
+    ->ArgName("aperture")
+    ->Arg(0)
+    ->Arg(1);
+
+BENCHMARK(BenchmarkTryScatterLambertian);
+BENCHMARK(BenchmarkTryScatterMetallic);
+BENCHMARK(BenchmarkTryScatterRefractive);
+BENCHMARK(BenchmarkTryScatterLambertianPacket);
+BENCHMARK(BenchmarkTryScatterMetallicPacket);
+
+//
+// Service
+//
+
+template <typename ScatterFunction>
+static void BenchmarkScatter(benchmark::State & state, const ScatterFunction & scatter, const Material & material)
+{
+    const std::vector<SurfaceHit> surfaceHits = CreateBenchSurfaceHits(BENCH_SEED);
+    const SobolSampler            sampler;
+
+    std::uint32_t i = 0;
+    for (auto _ : state)
+    {
+        const SurfaceHit & surfaceHit = surfaceHits[i & (BENCH_INPUT_COUNT - 1)];
+
+        SampleStream samples(sampler, 0, 0, i++);
+
+        benchmark::DoNotOptimize(scatter(surfaceHit.IncomingRay, surfaceHit.Hit, material, samples));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename ScatterPacketFunction>
+static void BenchmarkScatterPacket(benchmark::State & state, const ScatterPacketFunction & scatterPacket, const Material & material)
+{
+    const std::vector<SurfaceHit> surfaceHits = CreateBenchSurfaceHits(BENCH_SEED);
+    const SobolSampler            sampler;
+
+    std::array<const Ray *, RAY_PACKET_SIZE>      rays;
+    std::array<const RayHit *, RAY_PACKET_SIZE>   rayHits;
+    std::array<const Material *, RAY_PACKET_SIZE> materials;
+    std::array<SampleStream, RAY_PACKET_SIZE>     sampleStreams;
+    std::array<SampleStream *, RAY_PACKET_SIZE>   samples;
+
+    for (int j = 0; j < RAY_PACKET_SIZE; j++)
+    {
+        materials[j] = &material;
+        samples[j]   = &sampleStreams[j];
+    }
+
+    std::uint32_t i = 0;
+    for (auto _ : state)
+    {
+        for (int j = 0; j < RAY_PACKET_SIZE; j++)
+        {
+            const SurfaceHit & surfaceHit = surfaceHits[(i*RAY_PACKET_SIZE + j) & (BENCH_INPUT_COUNT - 1)];
+
+            rays[j]          = &surfaceHit.IncomingRay;
+            rayHits[j]       = &surfaceHit.Hit;
+            sampleStreams[j] = SampleStream(sampler, j, 0, i);
+        }
+
+        benchmark::DoNotOptimize(scatterPacket(rays, rayHits, materials, samples));
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations()*RAY_PACKET_SIZE);
+}
+
+} // namespace rtwe
@@ -0,0 +1,24 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "inputs.h"
+#include "stats.h"
+
+// Microbenchmarks of rendering kernels. Results can be written as JSON for tracking them over commits, e.g.:
+//     rtwe_bench --benchmark_out=bench.json --benchmark_out_format=json --benchmark_repetitions=5
+int main(int argc, char ** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    // Recorded along with results, as both affect what gets measured
+    benchmark::AddCustomContext("rtwe_stats", rtwe::ARE_STATS_ENABLED ? "enabled" : "disabled");
+    benchmark::AddCustomContext("rtwe_bench_seed", std::to_string(rtwe::BENCH_SEED));
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
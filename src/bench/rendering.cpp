@@ -0,0 +1,192 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "inputs.h"
+#include "resolve.h"
+#include "sampling.h"
+#include "scenes.h"
+#include "tracing.h"
+#include "Scene.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr int BENCH_RESOLVE_PIXEL_COUNT = 1024;
+
+//
+// Service
+//
+
+/**
+ * @brief Traces one path per iteration through each pixel of the benchmark image in turn, with a new sample per image.
+ */
+static void BenchmarkTraceRayInScene(benchmark::State & state, const Scene & scene);
+
+static std::vector<Vector3> CreateBenchAccumulatedRgbs(const float sampleCount);
+
+//
+// Tracing
+//
+
+static void BenchmarkTraceRayDefaultScene(benchmark::State & state)
+{
+    const Scene scene(CreateDefaultSceneBodies());
+
+    BenchmarkTraceRayInScene(state, scene);
+}
+
+static void BenchmarkTraceRayManySpheresScene(benchmark::State & state)
+{
+    const Scene scene(CreateManySpheresSceneBodies(static_cast<int>(state.range(0)), BENCH_SEED));
+
+    BenchmarkTraceRayInScene(state, scene);
+}
+
+static void BenchmarkTraceRayMotionBlurScene(benchmark::State & state)
+{
+    // Without interpolation, nodes bound whole paths of the spheres, as a BVH unaware of motion would
+    const bool interpolateMotionBounds = state.range(1) != 0;
+
+    const Scene scene(CreateBenchMotionBlurSceneBodies(static_cast<int>(state.range(0)), BENCH_SEED), interpolateMotionBounds);
+
+    BenchmarkTraceRayInScene(state, scene);
+}
+
+//
+// Resolve
+//
+
+static void BenchmarkResolvePixelRow(benchmark::State & state)
+{
+    const ToneMappingOperator toneMapping = static_cast<ToneMappingOperator>(state.range(0));
+
+    const float                sampleCount     = 16.0f;
+    const std::vector<Vector3> accumulatedRgbs = CreateBenchAccumulatedRgbs(sampleCount);
+
+    std::vector<Uint32> argbs(BENCH_RESOLVE_PIXEL_COUNT);
+
+    for (auto _ : state)
+    {
+        ResolvePixelRow(accumulatedRgbs.data(), BENCH_RESOLVE_PIXEL_COUNT, 1.0f/sampleCount, toneMapping, argbs.data());
+
+        benchmark::DoNotOptimize(argbs.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations()*BENCH_RESOLVE_PIXEL_COUNT);
+}
+
+static void BenchmarkResolvePixelRowWithSampleCounts(benchmark::State & state)
+{
+    const ToneMappingOperator toneMapping = static_cast<ToneMappingOperator>(state.range(0));
+
+    const float                sampleCount     = 16.0f;
+    const std::vector<Vector3> accumulatedRgbs = CreateBenchAccumulatedRgbs(sampleCount);
+
+    // As after a camera change with reprojection: some pixels have lost their history, and some have none yet
+    std::vector<float> sampleCounts(BENCH_RESOLVE_PIXEL_COUNT, sampleCount);
+    for (int i = 0; i < BENCH_RESOLVE_PIXEL_COUNT; i += 7)
+        sampleCounts[i] = (i % 2 == 0) ? 0.0f : 1.0f;
+
+    std::vector<Uint32> argbs(BENCH_RESOLVE_PIXEL_COUNT);
+
+    for (auto _ : state)
+    {
+        ResolvePixelRow(accumulatedRgbs.data(), sampleCounts.data(), BENCH_RESOLVE_PIXEL_COUNT, toneMapping, argbs.data());
+
+        benchmark::DoNotOptimize(argbs.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations()*BENCH_RESOLVE_PIXEL_COUNT);
+}
+
+//
+// Registration
+//
+
+BENCHMARK(BenchmarkTraceRayDefaultScene);
+BENCHMARK(BenchmarkTraceRayManySpheresScene)
+    ->ArgName("spheres")
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
+BENCHMARK(BenchmarkTraceRayMotionBlurScene)
+    ->ArgNames({"spheres", "interpolated"})
+    ->Args({1000, 0})
+    ->Args({1000, 1})
+    ->Args({10000, 0})
+    ->Args({10000, 1});
+
+BENCHMARK(BenchmarkResolvePixelRow)
+    ->ArgName("tone_mapping")
+    ->Arg(static_cast<int>(ToneMappingOperator::None))
+    ->Arg(static_cast<int>(ToneMappingOperator::Reinhard))
+    ->Arg(static_cast<int>(ToneMappingOperator::Aces));
+BENCHMARK(BenchmarkResolvePixelRowWithSampleCounts)
+    ->ArgName("tone_mapping")
+    ->Arg(static_cast<int>(ToneMappingOperator::None))
+    ->Arg(static_cast<int>(ToneMappingOperator::Reinhard))
+    ->Arg(static_cast<int>(ToneMappingOperator::Aces));
+
+//
+// Service
+//
+
+static void BenchmarkTraceRayInScene(benchmark::State & state, const Scene & scene)
+{
+    const Camera          camera          = CreateBenchCamera(BENCH_IMAGE_WIDTH, BENCH_IMAGE_HEIGHT);
+    const RayMissFunction rayMissFunction = CreateBenchRayMissFunction();
+    const SobolSampler    sampler;
+
+    int           x           = 0;
+    int           y           = 0;
+    std::uint32_t sampleIndex = 0;
+    for (auto _ : state)
+    {
+        SampleStream samples(sampler, x, y, sampleIndex);
+
+        const Ray ray = camera.CreateImageRay(
+            BENCH_IMAGE_WIDTH,
+            BENCH_IMAGE_HEIGHT,
+            SampleCameraRay(camera, x, y, scene.HasMotion(), samples)
+        );
+
+        benchmark::DoNotOptimize(TraceRay(scene, ray, rayMissFunction, samples));
+
+        if (++x < BENCH_IMAGE_WIDTH)
+            continue;
+
+        x = 0;
+        if (++y < BENCH_IMAGE_HEIGHT)
+            continue;
+
+        y = 0;
+        sampleIndex++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static std::vector<Vector3> CreateBenchAccumulatedRgbs(const float sampleCount)
+{
+    // Mostly displayable values, with some overexposed ones for tone mapping to compress
+    std::mt19937 generator(BENCH_SEED);
+
+    std::vector<Vector3> accumulatedRgbs(BENCH_RESOLVE_PIXEL_COUNT);
+    for (Vector3 & accumulatedRgb : accumulatedRgbs)
+    {
+        for (int i = 0; i < 3; i++)
+            accumulatedRgb[i] = sampleCount*1.5f*static_cast<float>(generator())/static_cast<float>(std::mt19937::max());
+    }
+
+    return accumulatedRgbs;
+}
+
+} // namespace rtwe
@@ -1,8 +1,27 @@
+#include <iostream>
+#include <stdexcept>
+
 #include "rtwe/Application.h"
 
-int main(int /*argc*/, char ** /*argv*/)
+int main(int argc, char ** argv)
 {
-    rtwe::Application app;
+    rtwe::Settings settings;
+    try
+    {
+        settings = rtwe::Settings::FromCommandLine(argc, argv);
+    }
+    catch (const std::invalid_argument & exception)
+    {
+        std::cerr << "Error: " << exception.what() << "\n\n" << rtwe::Settings::GetUsage();
+        return 1;
+    }
+
+    if (settings.ShowHelp)
+    {
+        std::cout << rtwe::Settings::GetUsage();
+        return 0;
+    }
+
+    rtwe::Application app(std::move(settings));
     return app.run();
 }
-
@@ -0,0 +1,128 @@
+#include "AccumulationBuffer.h"
+
+#include <algorithm>
+#include <new>
+#include <numeric>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+const size_t AccumulationBuffer::CACHE_LINE_SIZE = 64;
+
+constexpr std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr std::uint64_t FNV_PRIME        = 1099511628211ull;
+
+//
+// Construction
+//
+
+AccumulationBuffer::AccumulationBuffer(const int width, const int height):
+    m_Width    (width),
+    m_Height   (height),
+    m_RowStride(getRowStride(width)),
+    m_PixelRgbs(
+        static_cast<Vector3 *>(
+            ::operator new[](m_RowStride*height*sizeof(Vector3), std::align_val_t(CACHE_LINE_SIZE))
+        )
+    ),
+    m_SampleCounts(
+        static_cast<float *>(
+            ::operator new[](m_RowStride*height*sizeof(float), std::align_val_t(CACHE_LINE_SIZE))
+        )
+    )
+{
+    assert(width > 0 && height > 0);
+
+    Clear();
+}
+
+//
+// Interface
+//
+
+void AccumulationBuffer::Clear()
+{
+    // Vector3 is trivially destructible, so its storage can simply be (re)filled
+    std::uninitialized_fill_n(m_PixelRgbs.get(),    m_RowStride*m_Height, Vector3::Zero());
+    std::uninitialized_fill_n(m_SampleCounts.get(), m_RowStride*m_Height, 0.0f);
+}
+
+void AccumulationBuffer::CountSamples(const ImageRect & rect)
+{
+    assert(rect.X >= 0 && rect.X + rect.Width <= m_Width);
+
+    for (int y = rect.Y; y < rect.Y + rect.Height; y++)
+    {
+        float * const rowSampleCounts = GetSampleCountRow(y);
+
+        for (int x = rect.X; x < rect.X + rect.Width; x++)
+            rowSampleCounts[x] += 1.0f;
+    }
+}
+
+void AccumulationBuffer::CopyTo(std::vector<Vector3> & pixelRgbs, std::vector<float> & sampleCounts) const
+{
+    pixelRgbs.resize(static_cast<size_t>(m_Width)*m_Height);
+    sampleCounts.resize(pixelRgbs.size());
+
+    for (int y = 0; y < m_Height; y++)
+    {
+        std::copy_n(GetRow(y),            m_Width, pixelRgbs.begin()    + static_cast<size_t>(y)*m_Width);
+        std::copy_n(GetSampleCountRow(y), m_Width, sampleCounts.begin() + static_cast<size_t>(y)*m_Width);
+    }
+}
+
+void AccumulationBuffer::CopyFrom(const std::vector<Vector3> & pixelRgbs, const std::vector<float> & sampleCounts)
+{
+    assert(pixelRgbs.size() == static_cast<size_t>(m_Width)*m_Height && sampleCounts.size() == pixelRgbs.size());
+
+    for (int y = 0; y < m_Height; y++)
+    {
+        std::copy_n(pixelRgbs.begin()    + static_cast<size_t>(y)*m_Width, m_Width, GetRow(y));
+        std::copy_n(sampleCounts.begin() + static_cast<size_t>(y)*m_Width, m_Width, GetSampleCountRow(y));
+    }
+}
+
+std::uint64_t AccumulationBuffer::GetHash() const
+{
+    // 64-bit FNV-1a, over rows of sums followed by rows of sample counts
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+
+    const auto hashBytes = [&hash](const void * const pData, const size_t byteCount) {
+        const unsigned char * const bytes = static_cast<const unsigned char *>(pData);
+
+        for (size_t i = 0; i < byteCount; i++)
+            hash = (hash ^ bytes[i])*FNV_PRIME;
+    };
+
+    for (int y = 0; y < m_Height; y++)
+        hashBytes(GetRow(y), m_Width*sizeof(Vector3));
+
+    for (int y = 0; y < m_Height; y++)
+        hashBytes(GetSampleCountRow(y), m_Width*sizeof(float));
+
+    return hash;
+}
+
+//
+// Service
+//
+
+void AccumulationBuffer::AlignedDeleter::operator()(void * const pData) const
+{
+    ::operator delete[](pData, std::align_val_t(CACHE_LINE_SIZE));
+}
+
+size_t AccumulationBuffer::getRowStride(const int width)
+{
+    // Smallest number of pixels which both fills whole cache lines and is enough for a row
+    const size_t pixelsPerCacheLineMultiple = CACHE_LINE_SIZE/std::gcd(CACHE_LINE_SIZE, sizeof(Vector3));
+
+    return (static_cast<size_t>(width) + pixelsPerCacheLineMultiple - 1)/pixelsPerCacheLineMultiple*pixelsPerCacheLineMultiple;
+}
+
+} // namespace rtwe
@@ -0,0 +1,162 @@
+#ifndef RTWE_ACCUMULATION_BUFFER_H
+#define RTWE_ACCUMULATION_BUFFER_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "types.h"
+#include "ImageRect.h"
+
+namespace rtwe
+{
+
+/**
+ * @brief Heap-allocated per-pixel RGB sums and sample counts for an image of arbitrary size.
+ *
+ * Sample counts are kept per pixel, as pixels may end up with different ones, e.g. after reprojection.
+ * Each row starts on a cache line boundary, which rows are padded to, so that
+ * threads working on neighboring tiles never write to the same cache line
+ * at a row's start or end.
+ */
+class AccumulationBuffer final
+{
+public: // Constants
+
+    static const size_t CACHE_LINE_SIZE;
+
+public: // Construction
+
+    /**
+     * @brief Allocates a buffer with all sums set to zero.
+     */
+    AccumulationBuffer(const int width, const int height);
+
+public: // Deleted
+
+    AccumulationBuffer(const AccumulationBuffer&) = delete;
+    AccumulationBuffer(AccumulationBuffer&&)      = delete;
+
+    AccumulationBuffer& operator=(const AccumulationBuffer&) = delete;
+    AccumulationBuffer& operator=(AccumulationBuffer&&)      = delete;
+
+public: // Interface
+
+    void Clear();
+
+    inline int GetWidth() const;
+
+    inline int GetHeight() const;
+
+    /**
+     * @brief Distance between the starts of consecutive rows, in pixels.
+     */
+    inline size_t GetRowStride() const;
+
+    inline size_t GetByteSize() const;
+
+    inline Vector3 * GetRow(const int y);
+
+    inline const Vector3 * GetRow(const int y) const;
+
+    inline float * GetSampleCountRow(const int y);
+
+    inline const float * GetSampleCountRow(const int y) const;
+
+    /**
+     * @brief Counts one more sample for each pixel in the given region, after an integrator accumulated them.
+     */
+    void CountSamples(const ImageRect & rect);
+
+    /**
+     * @brief Copies all sums and sample counts, row by row without padding, e.g. to save them.
+     */
+    void CopyTo(std::vector<Vector3> & pixelRgbs, std::vector<float> & sampleCounts) const;
+
+    /**
+     * @brief Replaces all sums and sample counts with ones copied by CopyTo() from a buffer of the same size.
+     */
+    void CopyFrom(const std::vector<Vector3> & pixelRgbs, const std::vector<float> & sampleCounts);
+
+    /**
+     * @brief Hash of the bits of all sums and sample counts, excluding row padding, to tell whether two renders are identical.
+     */
+    std::uint64_t GetHash() const;
+
+private: // Service types
+
+    struct AlignedDeleter final
+    {
+        void operator()(void * const pData) const;
+    };
+
+private: // Service
+
+    static size_t getRowStride(const int width);
+
+private: // Members
+
+    const int    m_Width;
+    const int    m_Height;
+    const size_t m_RowStride;
+
+    const std::unique_ptr<Vector3[], AlignedDeleter> m_PixelRgbs;
+    const std::unique_ptr<float[], AlignedDeleter>   m_SampleCounts;
+};
+
+//
+// Interface
+//
+
+inline int AccumulationBuffer::GetWidth() const
+{
+    return m_Width;
+}
+
+inline int AccumulationBuffer::GetHeight() const
+{
+    return m_Height;
+}
+
+inline size_t AccumulationBuffer::GetRowStride() const
+{
+    return m_RowStride;
+}
+
+inline size_t AccumulationBuffer::GetByteSize() const
+{
+    return m_RowStride*m_Height*(sizeof(Vector3) + sizeof(float));
+}
+
+inline Vector3 * AccumulationBuffer::GetRow(const int y)
+{
+    assert(y >= 0 && y < m_Height);
+
+    return m_PixelRgbs.get() + y*m_RowStride;
+}
+
+inline const Vector3 * AccumulationBuffer::GetRow(const int y) const
+{
+    assert(y >= 0 && y < m_Height);
+
+    return m_PixelRgbs.get() + y*m_RowStride;
+}
+
+inline float * AccumulationBuffer::GetSampleCountRow(const int y)
+{
+    assert(y >= 0 && y < m_Height);
+
+    return m_SampleCounts.get() + y*m_RowStride;
+}
+
+inline const float * AccumulationBuffer::GetSampleCountRow(const int y) const
+{
+    assert(y >= 0 && y < m_Height);
+
+    return m_SampleCounts.get() + y*m_RowStride;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_ACCUMULATION_BUFFER_H
@@ -1,16 +1,44 @@
 #include "Application.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <thread>
 #include <boost/log/trivial.hpp>
 
+#include <SDL_image.h>
+
 #include <sdl2utils/event_utils.h>
 #include <sdl2utils/guards.h>
 
 #include "constants.h"
 #include "math_utils.h"
 #include "tracing.h"
-#include "targets.h"
+#include "Scene.h"
 #include "Camera.h"
+#include "CameraController.h"
+#include "animation.h"
+#include "checkpoint.h"
+#include "farm.h"
+#include "integrators.h"
+#include "heatmap.h"
+#include "partials.h"
+#include "render_service.h"
+#include "resolve.h"
+#include "image_comparison.h"
+#include "sampling.h"
+#include "scenes.h"
+#include "stats.h"
+#include "timeline.h"
+#include "PipelineStage.h"
+#include "ProgressiveRenderer.h"
 
 namespace rtwe
 {
@@ -19,23 +47,61 @@ namespace rtwe
 // Constants
 //
 
-const int Application::WINDOW_WIDTH  = 800;
-const int Application::WINDOW_HEIGHT = 600;
-
-const float Application::WINDOW_ASPECT_RATIO =
-    static_cast<float>(Application::WINDOW_WIDTH)/static_cast<float>(Application::WINDOW_HEIGHT);
-
 const char * const Application::WINDOW_TITLE = "Ray Tracing Weekend";
 
 const int    Application::SDL_INIT_FLAGS          = SDL_INIT_EVERYTHING;
+const int    Application::SDL_HEADLESS_INIT_FLAGS = SDL_INIT_TIMER;
 const Uint32 Application::SDL_TEXTURE_PIXELFORMAT = SDL_PIXELFORMAT_ARGB8888;
 
+const Uint32 Application::PRESENT_INTERVAL_MS       = 16;
+const Uint32 Application::PRESENT_STATS_INTERVAL_MS = 5000;
+const Uint32 Application::TITLE_STATS_INTERVAL_MS   = 1000;
+
+// Costs are traced ray by ray in a pass of their own, so a few samples are enough to average out jitter
+const int Application::HEATMAP_SAMPLE_COUNT = 4;
+
+// Small enough for all scenes to take seconds, yet with enough samples for noise to stay well below visible differences
+const int Application::SCENE_BENCHMARK_IMAGE_WIDTH  = 320;
+const int Application::SCENE_BENCHMARK_IMAGE_HEIGHT = 240;
+const int Application::SCENE_BENCHMARK_SAMPLE_COUNT = 64;
+
+// Noise of SCENE_BENCHMARK_SAMPLE_COUNT samples against 1024 sample references is 0.004-0.008 RMSE depending on the sampler,
+// with mean bias below 0.0002; bias of half a displayed level (0.002) is already a sign of a wrong result
+const double Application::SCENE_BENCHMARK_MAX_RMSE      = 0.012;
+const double Application::SCENE_BENCHMARK_MAX_MEAN_BIAS = 0.002;
+
+// Several tiles, so that threads take them in varying order, while all combinations together take seconds
+const int Application::DETERMINISM_CHECK_IMAGE_WIDTH  = 160;
+const int Application::DETERMINISM_CHECK_IMAGE_HEIGHT = 120;
+const int Application::DETERMINISM_CHECK_SAMPLE_COUNT = 4;
+
+// Even with fewer hardware threads or --threads, so that some tiles are always rendered concurrently
+const size_t Application::DETERMINISM_CHECK_MIN_THREAD_COUNT = 4;
+
+// Wide enough to blur the scene's foreground noticeably, and focused on its spheres
+const CameraLens Application::DETERMINISM_CHECK_LENS{0.05f, 1.0f};
+
+// Of the animation's loop, long enough for its moving spheres to cross several pixels
+const float Application::DETERMINISM_CHECK_SHUTTER_DURATION = 0.05f;
+
+// Vertical extent of the projection plane, at unit distance from the camera
+const float Application::CAMERA_PROJECTION_HEIGHT = 2.0f;
+
 //
 // Construction
 //
 
-Application::Application():
-    m_ScopedSDLCore(SDL_INIT_FLAGS)
+Application::Application(Settings settings):
+    m_ScopedSDLCore(
+        settings.IsHeadless || !settings.BenchmarkReferencePath.empty() || settings.CheckDeterminism
+            ? SDL_HEADLESS_INIT_FLAGS
+            : SDL_INIT_FLAGS
+    ),
+    m_Settings     (std::move(settings)),
+    m_Integrator   (CreateIntegrator(m_Settings.Integrator, m_Settings.IntegrationOptions)),
+    m_SamplerSeed  (createSamplerSeed(m_Settings)),
+    m_Sampler      (CreateSampler(m_Settings.Sampler, m_SamplerSeed)),
+    m_ThreadPool   (m_Settings.ThreadCount > 0 ? m_Settings.ThreadCount - 1 : ThreadPool::GetDefaultWorkerCount())
 {
     // Empty
 }
@@ -46,107 +112,1234 @@ Application::Application():
 
 static inline Color RawNormalToColor(const Vector3 & rawNormal);
 
-static inline Vector3 SamplePixelRgb(
-    const std::vector<Body> & scene,
-    const Camera &            camera,
-    const RayMissFunction     rayMissFunc,
-    const int                 imageWidth,
-    const int                 imageHeight,
-    const int                 pixelX,
-    const int                 pixelY
-);
+/**
+ * @brief Inserts the suffix before the .png extension of the path, adding the extension if it's missing.
+ */
+static std::string AddImagePathSuffix(const std::string & imagePath, const std::string & suffix);
+
+/**
+ * @brief Path of the heatmap saved next to the image at the given path, e.g. rtwe-heatmap.png for rtwe.png.
+ */
+static std::string GetHeatmapImagePath(const std::string & imagePath);
+
+/**
+ * @brief Path of a frame of an animation saved as the given path, e.g. rtwe-0042.png for frame 42 of rtwe.png.
+ */
+static std::string GetFrameImagePath(const std::string & imagePath, const long frameIndex);
+
+static void LogHeatmap(const Heatmap & heatmap, const HeatmapMetric metric);
+
+static std::string FormatHash(const std::uint64_t hash);
 
 int Application::run()
 {
-    const sdl2utils::SDL_WindowPtr window = createWindow();
+    const bool isRecordingTimeline = !m_Settings.TimelinePath.empty();
+
+    NameTimelineThread("main");
+
+    if (isRecordingTimeline)
+        StartTimelineCapture();
+
+    int result = 0;
+    if (!m_Settings.FarmCoordinatorAddress.empty())
+        result = renderFarmJobs();
+    else if (!m_Settings.MergePath.empty())
+        result = mergePartialRenders();
+    else if (!m_Settings.ServePath.empty())
+        result = serveRenderJobs();
+    else if (m_Settings.AnimationFrameCount > 0)
+        result = renderAnimation();
+    else if (!m_Settings.BenchmarkReferencePath.empty())
+        result = benchmarkScenes();
+    else if (m_Settings.CheckDeterminism)
+        result = checkDeterminism();
+    else
+        result = renderScene();
+
+    // Rendering has stopped by now, so no events are being recorded
+    if (isRecordingTimeline)
+    {
+        StopTimelineCapture();
+
+        if (SaveTimeline(m_Settings.TimelinePath))
+            BOOST_LOG_TRIVIAL(info) << "Saved timeline to " << m_Settings.TimelinePath;
+        else
+            BOOST_LOG_TRIVIAL(error) << "Failed to save timeline to " << m_Settings.TimelinePath;
+    }
+
+    return result;
+}
+
+//
+// Service
+//
+
+int Application::renderScene()
+{
+    const Scene raytracingScene(CreateSceneBodies(m_Settings.Scene));
+
+    CameraController cameraController = createCameraController(m_Settings.ImageWidth, m_Settings.ImageHeight, createCameraLens(m_Settings));
+
+    ProgressiveRenderer progressiveRenderer(
+        raytracingScene,
+        cameraController.CreateCamera(),
+        *m_Sampler,
+        createRayMissFunction(),
+        *m_Integrator,
+        m_ThreadPool,
+        m_Settings.ImageWidth,
+        m_Settings.ImageHeight,
+        RenderOptions{m_Settings.ToneMapping, m_Settings.RenderPreviews, m_Settings.ReprojectHistory}
+    );
+
+    if (m_Settings.FarmWorkerCount > 0)
+        return renderFarm(progressiveRenderer);
+
+    if (!m_Settings.PartialPath.empty())
+        return renderPartial(progressiveRenderer);
+
+    return m_Settings.IsHeadless
+        ? renderHeadless(progressiveRenderer)
+        : renderInteractively(progressiveRenderer, cameraController);
+}
+
+int Application::renderInteractively(ProgressiveRenderer & renderer, CameraController & cameraController)
+{
+    const int imageWidth  = renderer.GetImageWidth();
+    const int imageHeight = renderer.GetImageHeight();
+
+    const sdl2utils::SDL_WindowPtr window = createWindow(m_Settings.WindowWidth, m_Settings.WindowHeight);
     assert(window);
 
-    const sdl2utils::SDL_RendererPtr renderer = createRenderer(window.get());
-    assert(renderer);
+    const sdl2utils::SDL_RendererPtr sdlRenderer = createRenderer(window.get(), imageWidth, imageHeight);
+    assert(sdlRenderer);
 
-    const sdl2utils::SDL_TexturePtr streamingTexture = createStreamingTexture(renderer.get());
+    const sdl2utils::SDL_TexturePtr streamingTexture = createStreamingTexture(sdlRenderer.get(), imageWidth, imageHeight);
     assert(streamingTexture);
 
-    const std::vector<Body> raytracingScene = createRaytracingScene();
+    // Rendering runs on the thread pool, while this thread only handles input and presents whatever is ready
 
-    static const float PROJECTION_HEIGHT = 2.0f;
-    static const float PROJECTION_WIDTH  = PROJECTION_HEIGHT * WINDOW_ASPECT_RATIO;
+    std::vector<Uint32>    presentedImage(static_cast<size_t>(imageWidth)*imageHeight, 0u);
+    std::vector<ImageRect> updatedTiles;
 
-    static const Color BACKGROUND_TOP_COLOR   (0.7f, 0.7f, 0.95f);
-    static const Color BACKGROUND_BOTTOM_COLOR(0.9f, 0.9f, 0.9f);
+    // While a heatmap is shown, the image keeps accumulating in the background, and is uploaded whole when it's shown again
+    HeatmapMetric          shownHeatmapMetric   = m_Settings.Heatmap;
+    std::vector<PixelCost> pixelCosts;
+    bool                   arePixelCostsValid   = false;
+    bool                   isShownImageChanged  = shownHeatmapMetric != HeatmapMetric::None;
+    bool                   wasHeatmapKeyPressed = false;
 
-    // The following code uses a left-handed coordinate system:
-    // x points right, y points up, z points into the screen.
+    renderer.Start();
 
-    static const Vector3 CAMERA_ORIGIN    (0.0f, 0.0f, -1.0f);
-    static const Vector3 CAMERA_UP        (0.0f, 1.0f, 0.0f);
-    static const Vector3 PROJECTION_CENTER(0.0f, 0.0f, 0.0f);
+    Uint32 statsStartTicks        = SDL_GetTicks();
+    long   statsStartPassCount    = 0;
+    long   statsPresentCount      = 0;
+    size_t statsUploadedByteCount = 0;
+    Uint64 statsUploadCounts      = 0;
+    Uint64 maxUploadCounts        = 0;
+    Uint32 maxInputPollInterval   = 0;
+    Uint32 lastInputPollTicks     = statsStartTicks;
 
-    const Camera camera(
-        CAMERA_ORIGIN,
-        PROJECTION_CENTER,
-        CAMERA_UP,
-        PROJECTION_WIDTH,
-        PROJECTION_HEIGHT
+    StatsSnapshot statsStartSnapshot = TakeStatsSnapshot();
+
+    // Window title shows ray throughput over a shorter interval than logs, when statistics are enabled
+    Uint32        titleStatsStartTicks     = statsStartTicks;
+    long          titleStatsStartPassCount = 0;
+    StatsSnapshot titleStatsStartSnapshot  = statsStartSnapshot;
+
+    while (!sdl2utils::escOrCrossPressed())
+    {
+        const Uint32 presentStartTicks = SDL_GetTicks();
+
+        // Input is polled once per iteration, so the time between polls bounds input latency
+        const Uint32 inputPollInterval = presentStartTicks - lastInputPollTicks;
+
+        maxInputPollInterval = std::max(maxInputPollInterval, inputPollInterval);
+        lastInputPollTicks   = presentStartTicks;
+
+        // The renderer reprojects or discards what it has accumulated so far, and starts on the new view right away
+        if (cameraController.Update(static_cast<float>(inputPollInterval)/1000.0f))
+        {
+            renderer.SetCamera(cameraController.CreateCamera());
+
+            arePixelCostsValid  = false;
+            isShownImageChanged = shownHeatmapMetric != HeatmapMetric::None;
+        }
+
+        const bool isHeatmapKeyPressed = SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_H] != 0;
+        if (isHeatmapKeyPressed && !wasHeatmapKeyPressed)
+        {
+            shownHeatmapMetric  = GetNextHeatmapMetric(shownHeatmapMetric);
+            isShownImageChanged = true;
+        }
+
+        wasHeatmapKeyPressed = isHeatmapKeyPressed;
+
+        // Costs are traced by the thread pool, which the render thread must not be using meanwhile
+        if (isShownImageChanged && shownHeatmapMetric != HeatmapMetric::None && !arePixelCostsValid)
+        {
+            renderer.Stop();
+            pixelCosts = renderer.RenderPixelCosts(HEATMAP_SAMPLE_COUNT);
+            renderer.Start();
+
+            arePixelCostsValid = true;
+        }
+
+        {
+            const ScopedTimelineEvent presentEvent("present");
+
+            // Only tiles which received new samples get uploaded, so upload cost follows rendering progress
+            const Uint64 uploadStartCounter = SDL_GetPerformanceCounter();
+
+            renderer.TakeUpdatedTiles(presentedImage, updatedTiles);
+
+            if (isShownImageChanged)
+            {
+                Heatmap heatmap{};
+                if (shownHeatmapMetric != HeatmapMetric::None)
+                {
+                    heatmap = CreateHeatmap(pixelCosts, shownHeatmapMetric, HEATMAP_SAMPLE_COUNT);
+                    LogHeatmap(heatmap, shownHeatmapMetric);
+                }
+
+                const std::vector<Uint32> & shownImage = shownHeatmapMetric != HeatmapMetric::None ? heatmap.Image : presentedImage;
+
+                const int updateResult = SDL_UpdateTexture(streamingTexture.get(), nullptr, shownImage.data(), imageWidth*sizeof(Uint32));
+                assert(updateResult == 0 && "SDL_UpdateTexture() must succeed");
+
+                statsUploadedByteCount += shownImage.size()*sizeof(Uint32);
+                isShownImageChanged     = false;
+
+                updatedTiles.clear();
+            }
+            else if (shownHeatmapMetric != HeatmapMetric::None)
+            {
+                // Updated tiles stay hidden behind the heatmap, and get uploaded along with the whole image once it's shown again
+                updatedTiles.clear();
+            }
+
+            for (const ImageRect & tile : updatedTiles)
+            {
+                const SDL_Rect tileRect{tile.X, tile.Y, tile.Width, tile.Height};
+
+                const int updateResult = SDL_UpdateTexture(
+                    streamingTexture.get(),
+                    &tileRect,
+                    presentedImage.data() + static_cast<size_t>(tile.Y)*imageWidth + tile.X,
+                    imageWidth*sizeof(Uint32)
+                );
+                assert(updateResult == 0 && "SDL_UpdateTexture() must succeed");
+
+                statsUploadedByteCount += tile.Width*tile.Height*sizeof(Uint32);
+            }
+
+            const Uint64 uploadCounts = SDL_GetPerformanceCounter() - uploadStartCounter;
+            statsUploadCounts += uploadCounts;
+            maxUploadCounts    = std::max(maxUploadCounts, uploadCounts);
+
+            SDL_RenderClear(sdlRenderer.get());
+            SDL_RenderCopy(sdlRenderer.get(), streamingTexture.get(), nullptr, nullptr);
+            SDL_RenderPresent(sdlRenderer.get());
+        }
+
+        statsPresentCount++;
+
+        const Uint32 presentEndTicks = SDL_GetTicks();
+
+        if (ARE_STATS_ENABLED && presentEndTicks - titleStatsStartTicks >= TITLE_STATS_INTERVAL_MS)
+        {
+            const float         titleStatsSeconds = static_cast<float>(presentEndTicks - titleStatsStartTicks)/1000.0f;
+            const long          passCount         = renderer.GetCompletedPassCount();
+            const StatsSnapshot statsSnapshot     = TakeStatsSnapshot();
+
+            std::ostringstream title;
+            title.precision(3);
+            title
+                << WINDOW_TITLE
+                << " - " << GetMraysPerSecond(SubtractStats(statsSnapshot, titleStatsStartSnapshot), titleStatsSeconds) << " Mrays/s"
+                << ", " << (passCount - titleStatsStartPassCount)/titleStatsSeconds << " passes/s";
+
+            SDL_SetWindowTitle(window.get(), title.str().c_str());
+
+            titleStatsStartTicks     = presentEndTicks;
+            titleStatsStartPassCount = passCount;
+            titleStatsStartSnapshot  = statsSnapshot;
+        }
+
+        if (presentEndTicks - statsStartTicks >= PRESENT_STATS_INTERVAL_MS)
+        {
+            const float statsSeconds = static_cast<float>(presentEndTicks - statsStartTicks)/1000.0f;
+            const long  passCount    = renderer.GetCompletedPassCount();
+            const float countsPerMs  = static_cast<float>(SDL_GetPerformanceFrequency())/1000.0f;
+
+            BOOST_LOG_TRIVIAL(info)
+                << "Presented " << statsPresentCount/statsSeconds << " frames/s"
+                << ", uploading " << statsUploadedByteCount/1024/statsPresentCount << " KiB per frame"
+                << " in " << statsUploadCounts/countsPerMs/statsPresentCount << " ms on average"
+                << " (" << maxUploadCounts/countsPerMs << " ms max)"
+                << ", max input poll interval " << maxInputPollInterval << " ms"
+                << ", rendered " << (passCount - statsStartPassCount)/statsSeconds << " passes/s"
+                << " (" << passCount << " in total)";
+
+            if constexpr (ARE_STATS_ENABLED)
+            {
+                const StatsSnapshot statsSnapshot = TakeStatsSnapshot();
+
+                BOOST_LOG_TRIVIAL(info) << DescribeStats(SubtractStats(statsSnapshot, statsStartSnapshot), statsSeconds);
+
+                statsStartSnapshot = statsSnapshot;
+            }
+
+            statsStartTicks        = presentEndTicks;
+            statsStartPassCount    = passCount;
+            statsPresentCount      = 0;
+            statsUploadedByteCount = 0;
+            statsUploadCounts      = 0;
+            maxUploadCounts        = 0;
+            maxInputPollInterval   = 0;
+        }
+
+        const Uint32 presentTicks = presentEndTicks - presentStartTicks;
+        if (presentTicks < PRESENT_INTERVAL_MS)
+            SDL_Delay(PRESENT_INTERVAL_MS - presentTicks);
+    }
+
+    renderer.Stop();
+
+    return 0;
+}
+
+int Application::renderHeadless(ProgressiveRenderer & renderer)
+{
+    const int imageWidth  = renderer.GetImageWidth();
+    const int imageHeight = renderer.GetImageHeight();
+
+    const size_t imageByteSize = static_cast<size_t>(imageWidth)*imageHeight*sizeof(Uint32);
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendering " << imageWidth << "x" << imageHeight << " with " << m_Settings.HeadlessSampleCount << " samples per pixel"
+        << " using " << m_ThreadPool.GetThreadCount() << " threads"
+        << ", accumulation buffer takes " << renderer.GetAccumulationBuffer().GetByteSize()/(1024*1024) << " MiB"
+        << ", each ARGB image " << imageByteSize/(1024*1024) << " MiB";
+
+    if (m_Settings.ResumeFromCheckpoint && !resumeFromCheckpoint(renderer))
+        return 1;
+
+    const long passCount = std::max(m_Settings.HeadlessSampleCount - renderer.GetCompletedPassCount(), 0l);
+
+    // Checkpoints are written on a thread of their own, while rendering goes on with the next pass
+    const std::unique_ptr<CheckpointWriter> pCheckpointWriter = !m_Settings.CheckpointPath.empty()
+        ? std::make_unique<CheckpointWriter>(m_Settings.CheckpointPath)
+        : nullptr;
+
+    const Uint32 checkpointIntervalMs = static_cast<Uint32>(m_Settings.CheckpointIntervalSeconds*1000);
+    Uint32       lastCheckpointTicks  = SDL_GetTicks();
+
+    const Uint64        renderStartCounter  = SDL_GetPerformanceCounter();
+    const StatsSnapshot renderStartSnapshot = TakeStatsSnapshot();
+
+    // Passes are rendered one at a time, so that checkpoints can be taken in between
+    for (long i = 0; i < passCount; i++)
+    {
+        renderer.RenderPasses(1);
+
+        if (pCheckpointWriter && SDL_GetTicks() - lastCheckpointTicks >= checkpointIntervalMs)
+        {
+            pCheckpointWriter->Write(createCheckpoint(renderer));
+            lastCheckpointTicks = SDL_GetTicks();
+        }
+    }
+
+    const float renderSeconds =
+        static_cast<float>(SDL_GetPerformanceCounter() - renderStartCounter)/static_cast<float>(SDL_GetPerformanceFrequency());
+    const float sampleCount = static_cast<float>(imageWidth)*imageHeight*passCount;
+
+    // The final checkpoint lets a later run with more samples per pixel refine the image further
+    if (pCheckpointWriter && passCount > 0)
+        pCheckpointWriter->Write(createCheckpoint(renderer));
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendered in " << renderSeconds << " s"
+        << " (" << sampleCount/renderSeconds/1.0e6f << " million samples/s)";
+
+    if constexpr (ARE_STATS_ENABLED)
+        BOOST_LOG_TRIVIAL(info) << DescribeStats(SubtractStats(TakeStatsSnapshot(), renderStartSnapshot), renderSeconds);
+
+    return saveRenderedImages(renderer, m_Settings);
+}
+
+int Application::renderFarm(ProgressiveRenderer & renderer)
+{
+    const int imageWidth  = renderer.GetImageWidth();
+    const int imageHeight = renderer.GetImageHeight();
+
+    // Local workers share this machine's hardware threads, as remote workers each have their own machine's
+    const long localWorkerThreadCount = m_Settings.ThreadCount > 0
+        ? m_Settings.ThreadCount
+        : std::max(static_cast<long>(std::thread::hardware_concurrency())/m_Settings.FarmWorkerCount, 1l);
+
+    std::unique_ptr<FarmCoordinator> pCoordinator;
+    try
+    {
+        pCoordinator = std::make_unique<FarmCoordinator>(
+            FarmConfig{
+                imageWidth,
+                imageHeight,
+                m_Settings.Scene,
+                m_Settings.Sampler,
+                m_SamplerSeed,
+                m_Settings.Integrator,
+                m_Settings.IntegrationOptions,
+                createCameraLens(m_Settings)
+            },
+            m_Settings.HeadlessSampleCount,
+            m_Settings.FarmPort,
+            m_Settings.FarmJobTimeoutSeconds
+        );
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to listen for farm workers: " << exception.what();
+        return 1;
+    }
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendering " << imageWidth << "x" << imageHeight << " with " << m_Settings.HeadlessSampleCount << " samples per pixel"
+        << " on " << m_Settings.FarmWorkerCount << " local workers of " << localWorkerThreadCount << " threads each"
+        << (m_Settings.FarmPort != 0 ? ", and remote workers connecting to port " + std::to_string(m_Settings.FarmPort) : "");
+
+    const std::vector<std::string> localWorkerArguments{
+        "--farm-worker", "127.0.0.1:" + std::to_string(pCoordinator->GetPort()),
+        "--threads",     std::to_string(localWorkerThreadCount)
+    };
+
+    if (!pCoordinator->Run(m_Settings.FarmWorkerCount, localWorkerArguments))
+        return 1;
+
+    BOOST_LOG_TRIVIAL(info) << DescribeFarmReport(pCoordinator->GetReport());
+
+    renderer.RestoreAccumulation(pCoordinator->GetPixelRgbs(), pCoordinator->GetSampleCounts(), m_Settings.HeadlessSampleCount);
+
+    return saveRenderedImages(renderer, m_Settings);
+}
+
+int Application::renderFarmJobs()
+{
+    std::optional<FarmWorkerConnection> connection = FarmWorkerConnection::Connect(m_Settings.FarmCoordinatorAddress);
+    if (!connection.has_value())
+        return 1;
+
+    const std::optional<FarmConfig> config = connection->ReceiveConfig();
+    if (!config.has_value())
+        return 1;
+
+    const int imageWidth  = config->ImageWidth;
+    const int imageHeight = config->ImageHeight;
+
+    const Scene                        scene(CreateSceneBodies(config->Scene));
+    const std::unique_ptr<IIntegrator> integrator = CreateIntegrator(config->Integrator, config->IntegrationOptions);
+    const std::unique_ptr<ISampler>    sampler    = CreateSampler(config->Sampler, config->SamplerSeed);
+
+    ProgressiveRenderer renderer(
+        scene,
+        createCameraController(imageWidth, imageHeight, config->Lens).CreateCamera(),
+        *sampler,
+        createRayMissFunction(),
+        *integrator,
+        m_ThreadPool,
+        imageWidth,
+        imageHeight,
+        RenderOptions{ToneMappingOperator::None, false, false}
     );
 
-    const RayMissFunction rayMissFunc = std::bind(
-        GetVerticalGradientColor,
-        std::placeholders::_1,
-        BACKGROUND_BOTTOM_COLOR,
-        BACKGROUND_TOP_COLOR
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendering jobs of " << m_Settings.FarmCoordinatorAddress << ": " << imageWidth << "x" << imageHeight
+        << " of scene " << GetSceneName(config->Scene) << " using " << m_ThreadPool.GetThreadCount() << " threads";
+
+    const size_t               pixelCount = static_cast<size_t>(imageWidth)*imageHeight;
+    const std::vector<Vector3> zeroPixelRgbs(pixelCount, Vector3::Zero());
+
+    while (true)
+    {
+        const std::optional<FarmJob> job = connection->ReceiveJob();
+        if (!job.has_value())
+            return 1;
+
+        if (job->PassCount == 0)
+            return 0;
+
+        // Each pixel's sample count is where its sample sequence continues, so the job's samples get accumulated from zero
+        // on top of counts of the passes before it, which are then taken out of the result
+        const float firstPassSampleCount = static_cast<float>(job->FirstPassIndex);
+
+        renderer.RestoreAccumulation(zeroPixelRgbs, std::vector<float>(pixelCount, firstPassSampleCount), job->FirstPassIndex);
+
+        const Uint64 renderStartCounter = SDL_GetPerformanceCounter();
+
+        renderer.RenderPasses(job->PassCount);
+
+        FarmJobResult result{
+            job->Index,
+            static_cast<double>(SDL_GetPerformanceCounter() - renderStartCounter)/static_cast<double>(SDL_GetPerformanceFrequency()),
+            {},
+            {}
+        };
+
+        renderer.GetAccumulationBuffer().CopyTo(result.PixelRgbs, result.SampleCounts);
+
+        for (float & sampleCount : result.SampleCounts)
+            sampleCount -= firstPassSampleCount;
+
+        if (!connection->SendResult(result))
+            return 1;
+    }
+}
+
+int Application::renderPartial(ProgressiveRenderer & renderer)
+{
+    const int imageWidth  = renderer.GetImageWidth();
+    const int imageHeight = renderer.GetImageHeight();
+
+    const long firstSampleIndex = m_Settings.FirstSampleIndex;
+    const long passCount        = m_Settings.HeadlessSampleCount;
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendering samples " << firstSampleIndex << " to " << firstSampleIndex + passCount - 1 << " of each pixel"
+        << " of " << imageWidth << "x" << imageHeight << " as a partial render with sampler seed " << m_SamplerSeed
+        << " using " << m_ThreadPool.GetThreadCount() << " threads";
+
+    // Like a farm job's, the partial's samples get accumulated from zero on top of counts of the samples before them
+    const size_t pixelCount       = static_cast<size_t>(imageWidth)*imageHeight;
+    const float  firstSampleCount = static_cast<float>(firstSampleIndex);
+
+    renderer.RestoreAccumulation(
+        std::vector<Vector3>(pixelCount, Vector3::Zero()),
+        std::vector<float>(pixelCount, firstSampleCount),
+        firstSampleIndex
     );
 
-    std::array<Vector3, WINDOW_WIDTH*WINDOW_HEIGHT> accumulatedPixelRgbs;
-    accumulatedPixelRgbs.fill(Vector3::Zero());
+    std::optional<LuminanceSquareAccumulator> luminanceSquareAccumulator;
+    if (m_Settings.RecordVariance)
+        luminanceSquareAccumulator.emplace(imageWidth, imageHeight);
 
-    long frames = 0;
-    while (!sdl2utils::escOrCrossPressed())
+    const Uint64 renderStartCounter = SDL_GetPerformanceCounter();
+
+    // Passes are rendered one at a time, so that squares of each pass's samples can be taken
+    for (long i = 0; i < passCount; i++)
     {
-        frames++;
+        renderer.RenderPasses(1);
+
+        if (luminanceSquareAccumulator.has_value())
+            luminanceSquareAccumulator->AddPass(renderer.GetAccumulationBuffer(), m_ThreadPool);
+    }
+
+    const float renderSeconds =
+        static_cast<float>(SDL_GetPerformanceCounter() - renderStartCounter)/static_cast<float>(SDL_GetPerformanceFrequency());
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendered in " << renderSeconds << " s"
+        << " (" << static_cast<float>(pixelCount)*passCount/renderSeconds/1.0e6f << " million samples/s)";
+
+    PartialRender partial{
+        PartialRenderHeader{
+            imageWidth,
+            imageHeight,
+            m_Settings.Scene,
+            m_Settings.Sampler,
+            m_SamplerSeed,
+            createCameraLens(m_Settings),
+            firstSampleIndex,
+            passCount,
+            1,
+            m_Settings.RecordVariance
+        },
+        {},
+        {},
+        luminanceSquareAccumulator.has_value() ? luminanceSquareAccumulator->GetLuminanceSquareSums() : std::vector<float>()
+    };
+
+    renderer.GetAccumulationBuffer().CopyTo(partial.PixelRgbs, partial.SampleCounts);
+
+    for (float & sampleCount : partial.SampleCounts)
+        sampleCount -= firstSampleCount;
 
-        void * pixels = nullptr;
-        int    pitch  = -1;
+    if (!SavePartialRender(partial, m_Settings.PartialPath))
+        return 1;
 
-        const int lockResult = SDL_LockTexture(streamingTexture.get(), nullptr, &pixels, &pitch);
-        assert(lockResult == 0 && "SDL_LockTexture() must succeed");
+    // The image is of the partial's samples alone, like the one a merge of the partial by itself would give
+    renderer.RestoreAccumulation(partial.PixelRgbs, partial.SampleCounts, passCount);
 
-        for (int y = 0; y < WINDOW_HEIGHT; y++)
+    return saveRenderedImages(renderer, m_Settings);
+}
+
+int Application::mergePartialRenders()
+{
+    const std::string & directoryPath = m_Settings.MergePath;
+
+    std::error_code                     error;
+    std::filesystem::directory_iterator directory(directoryPath, error);
+
+    if (error)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to list " << directoryPath << ": " << error.message();
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    std::uintmax_t           totalByteSize = 0;
+
+    for (const std::filesystem::directory_entry & entry : directory)
+    {
+        if (!entry.is_regular_file() || entry.path().extension() != PARTIAL_RENDER_FILE_EXTENSION)
+            continue;
+
+        // A merged partial saved into the same directory by an earlier merge would count its partials twice
+        if (!m_Settings.PartialPath.empty() && std::filesystem::equivalent(entry.path(), m_Settings.PartialPath, error))
+            continue;
+
+        paths.push_back(entry.path().string());
+        totalByteSize += entry.file_size();
+    }
+
+    if (paths.empty())
+    {
+        BOOST_LOG_TRIVIAL(error) << "No partial renders (*" << PARTIAL_RENDER_FILE_EXTENSION << ") in " << directoryPath;
+        return 1;
+    }
+
+    // Sorted, so that merging the same partials sums them up in the same order
+    std::sort(paths.begin(), paths.end());
+
+    const std::optional<PartialRenderHeader> firstHeader = LoadPartialRenderHeader(paths.front());
+    if (!firstHeader.has_value())
+        return 1;
+
+    const int imageWidth  = firstHeader->ImageWidth;
+    const int imageHeight = firstHeader->ImageHeight;
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Merging " << paths.size() << " partial renders of " << imageWidth << "x" << imageHeight
+        << ", " << totalByteSize/(1024*1024) << " MiB in total, from " << directoryPath;
+
+    std::vector<Uint32> image(static_cast<size_t>(imageWidth)*imageHeight, 0u);
+    double              standardErrorSum = 0.0;
+
+    const Uint64 mergeStartCounter = SDL_GetPerformanceCounter();
+
+    const std::optional<PartialRenderHeader> mergedHeader = MergePartialRenders(
+        paths,
+        m_Settings.PartialPath,
+        [&](const MergedPartialRows & rows) {
+            const int    pixelCount      = rows.RowCount*imageWidth;
+            const size_t firstPixelIndex = static_cast<size_t>(rows.FirstRowIndex)*imageWidth;
+
+            ResolvePixelRow(rows.PixelRgbs, rows.SampleCounts, pixelCount, m_Settings.ToneMapping, image.data() + firstPixelIndex);
+
+            if (rows.LuminanceSquareSums == nullptr)
+                return;
+
+            for (int i = 0; i < pixelCount; i++)
+                standardErrorSum += GetLuminanceStandardError(rows.PixelRgbs[i], rows.SampleCounts[i], rows.LuminanceSquareSums[i]);
+        }
+    );
+
+    if (!mergedHeader.has_value())
+        return 1;
+
+    const float mergeSeconds =
+        static_cast<float>(SDL_GetPerformanceCounter() - mergeStartCounter)/static_cast<float>(SDL_GetPerformanceFrequency());
+
+    std::ostringstream report;
+    report
+        << "Merged " << mergedHeader->MergedPartialCount << " partial renders into " << mergedHeader->SamplesPerPixel
+        << " samples per pixel in " << mergeSeconds << " s"
+        << " (" << static_cast<float>(totalByteSize)/(1024*1024)/mergeSeconds << " MiB/s)";
+
+    // Noise left in the image, which halves with each fourfold increase in samples
+    if (mergedHeader->HasVariance)
+        report << ", mean standard error of pixel luminance " << standardErrorSum/(static_cast<double>(imageWidth)*imageHeight);
+
+    BOOST_LOG_TRIVIAL(info) << report.str();
+
+    return saveImage(image, imageWidth, imageHeight, m_Settings.OutputImagePath) ? 0 : 1;
+}
+
+int Application::serveRenderJobs()
+{
+    const std::string & jobDirectoryPath = m_Settings.ServePath;
+
+    if (!std::filesystem::is_directory(jobDirectoryPath))
+    {
+        BOOST_LOG_TRIVIAL(error) << "Job directory " << jobDirectoryPath << " doesn't exist";
+        return 1;
+    }
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Serving render jobs (*" << RENDER_JOB_FILE_EXTENSION << ") from " << jobDirectoryPath
+        << " using " << m_ThreadPool.GetThreadCount() << " threads"
+        << (m_Settings.ExitWhenIdle ? ", until none are left" : "");
+
+    SceneCache      sceneCache;
+    RenderJobLoader jobLoader(jobDirectoryPath, sceneCache);
+
+    // Throughput is measured over each run of jobs, from the first job's loading to the last job's end, leaving out idle time
+    Uint64 batchStartCounter            = 0;
+    long   batchJobCount                = 0;
+    long   batchFailedJobCount          = 0;
+    double batchRenderSeconds           = 0.0;
+    double batchLoadSeconds             = 0.0;
+    long   batchStartSceneCacheHitCount = 0;
+    long   batchStartSceneCacheUseCount = 0;
+
+    const double counterFrequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+    while (true)
+    {
+        const std::optional<RenderJob> job = jobLoader.TakeJob();
+
+        if (!job.has_value())
         {
-            for (int x = 0; x < WINDOW_WIDTH; x++)
+            if (batchJobCount > 0)
             {
-                const size_t   pixelIndex  = y*WINDOW_WIDTH + x;
-                const int      pixelOffset = y*pitch + x*sizeof(Uint32);
-                Uint32 * const pixel       = reinterpret_cast<Uint32 *>(reinterpret_cast<Uint8 *>(pixels) + pixelOffset);
-
-                accumulatedPixelRgbs[pixelIndex] += SamplePixelRgb(
-                    raytracingScene,
-                    camera,
-                    rayMissFunc,
-                    WINDOW_WIDTH,
-                    WINDOW_HEIGHT,
-                    x,
-                    y
-                );
+                const double batchSeconds = static_cast<double>(SDL_GetPerformanceCounter() - batchStartCounter)/counterFrequency;
+                const long   hitCount     = sceneCache.GetHitCount();
+                const long   useCount     = hitCount + sceneCache.GetMissCount();
 
-                Vector3 averageRgb = accumulatedPixelRgbs[pixelIndex]/static_cast<float>(frames);
+                // Loading of all jobs but the first overlaps rendering, where a process per job would add it to each job,
+                // along with starting up
+                BOOST_LOG_TRIVIAL(info)
+                    << "No jobs left: rendered " << batchJobCount << " jobs (" << batchFailedJobCount << " failed)"
+                    << " in " << batchSeconds << " s, " << batchJobCount*3600.0/batchSeconds << " jobs/hour"
+                    << "; per job, rendering took " << batchRenderSeconds/batchJobCount << " s"
+                    << " and loading " << batchLoadSeconds/batchJobCount << " s, overlapping the job before"
+                    << "; scenes came from the cache for " << hitCount - batchStartSceneCacheHitCount
+                    << " of " << useCount - batchStartSceneCacheUseCount << " jobs";
 
-                *pixel = Color(std::move(averageRgb)).ToArgb();
+                batchJobCount                = 0;
+                batchFailedJobCount          = 0;
+                batchRenderSeconds           = 0.0;
+                batchLoadSeconds             = 0.0;
+                batchStartSceneCacheHitCount = hitCount;
+                batchStartSceneCacheUseCount = useCount;
             }
+
+            if (m_Settings.ExitWhenIdle)
+                return 0;
+
+            continue;
         }
 
-        SDL_UnlockTexture(streamingTexture.get());
+        if (batchJobCount == 0)
+            batchStartCounter = SDL_GetPerformanceCounter() - static_cast<Uint64>(job->LoadSeconds*counterFrequency);
+
+        BOOST_LOG_TRIVIAL(info)
+            << "Rendering job " << job->Name << ": " << job->JobSettings.ImageWidth << "x" << job->JobSettings.ImageHeight
+            << " of scene " << GetSceneName(job->JobSettings.Scene) << " with " << job->JobSettings.HeadlessSampleCount
+            << " samples per pixel, loaded in " << job->LoadSeconds << " s";
+
+        const Uint64 renderStartCounter = SDL_GetPerformanceCounter();
+        const bool   isSucceeded        = renderJob(*job) == 0;
 
-        SDL_RenderCopy(renderer.get(), streamingTexture.get(), nullptr, nullptr);
-        SDL_RenderPresent(renderer.get());
+        batchRenderSeconds += static_cast<double>(SDL_GetPerformanceCounter() - renderStartCounter)/counterFrequency;
+        batchLoadSeconds   += job->LoadSeconds;
+
+        batchJobCount++;
+        if (!isSucceeded)
+            batchFailedJobCount++;
+
+        FinishRenderJob(*job, isSucceeded);
     }
+}
 
-    return 0;
+int Application::renderJob(const RenderJob & job)
+{
+    const Settings & jobSettings = job.JobSettings;
+
+    ProgressiveRenderer renderer(
+        *job.JobScene,
+        createCameraController(jobSettings.ImageWidth, jobSettings.ImageHeight, createCameraLens(jobSettings)).CreateCamera(),
+        *job.Sampler,
+        createRayMissFunction(),
+        *job.Integrator,
+        m_ThreadPool,
+        jobSettings.ImageWidth,
+        jobSettings.ImageHeight,
+        RenderOptions{jobSettings.ToneMapping, false, false}
+    );
+
+    renderer.RenderPasses(jobSettings.HeadlessSampleCount);
+
+    return saveRenderedImages(renderer, jobSettings);
 }
 
-//
-// Service
-//
+int Application::renderAnimation()
+{
+    const int  imageWidth  = m_Settings.ImageWidth;
+    const int  imageHeight = m_Settings.ImageHeight;
+    const long frameCount  = m_Settings.AnimationFrameCount;
+    const bool isPipelined = m_Settings.PipelineFrames;
+
+    // Animation times run from 0 to 1 over the whole loop of frames
+    const bool  isMotionBlurred = m_Settings.ShutterFraction > 0.0f;
+    const float shutterDuration = m_Settings.ShutterFraction/static_cast<float>(frameCount);
+
+    const Animation animation = CreateSceneAnimation(m_Settings.Scene, CreateSceneBodies(m_Settings.Scene));
+
+    // Each copy gets bodies of its own, as targets are shared by pointer and get moved
+    const auto createFrameScene = [this, &animation, isMotionBlurred]() {
+        std::vector<Body> bodies = CreateSceneBodies(m_Settings.Scene);
+        if (isMotionBlurred)
+            MakeAnimatedSpheresMoving(animation, bodies);
+
+        return std::make_unique<Scene>(std::move(bodies));
+    };
+
+    // Frames alternate between two copies of the scene, so that one can be updated for the next frame while the other is traced
+    const std::array<std::unique_ptr<Scene>, 2> scenes{
+        createFrameScene(),
+        createFrameScene()
+    };
+
+    std::array<std::unique_ptr<ProgressiveRenderer>, 2> renderers;
+    for (size_t i = 0; i < renderers.size(); i++)
+    {
+        renderers[i] = std::make_unique<ProgressiveRenderer>(
+            *scenes[i],
+            createAnimatedCamera(animation, 0.0f, imageWidth, imageHeight, createCameraLens(m_Settings)),
+            *m_Sampler,
+            createRayMissFunction(),
+            *m_Integrator,
+            m_ThreadPool,
+            imageWidth,
+            imageHeight,
+            RenderOptions{m_Settings.ToneMapping, false, false}
+        );
+    }
+
+    std::array<std::vector<Uint32>, 2> images;
+    for (std::vector<Uint32> & image : images)
+        image.resize(static_cast<size_t>(imageWidth)*imageHeight, 0u);
+
+    // Refits run on the updating thread alone, as the shared thread pool is busy tracing meanwhile
+    ThreadPool updateThreadPool(0);
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendering " << frameCount << " frames of the animation of scene " << GetSceneName(m_Settings.Scene)
+        << " at " << imageWidth << "x" << imageHeight << " with " << m_Settings.HeadlessSampleCount << " samples per pixel"
+        << " using " << m_ThreadPool.GetThreadCount() << " threads"
+        << (isPipelined ? ", updating and writing frames while tracing others" : ", one frame after another")
+        << (isMotionBlurred ? ", with motion blur" : "");
+
+    // Each stage's time is only added to by one frame at a time, as a stage waits for its previous frame before starting
+    double updateSeconds    = 0.0;
+    double traceSeconds     = 0.0;
+    double writeSeconds     = 0.0;
+    long   failedFrameCount = 0;
+
+    const auto getSecondsSince = [](const std::chrono::steady_clock::time_point startTime) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    const auto updateFrame = [&](const long frameIndex) {
+        const auto  startTime = std::chrono::steady_clock::now();
+        const float time      = static_cast<float>(frameIndex)/static_cast<float>(frameCount);
+
+        AnimateScene(animation, time, shutterDuration, *scenes[frameIndex % 2], updateThreadPool);
+        renderers[frameIndex % 2]->SetCamera(createAnimatedCamera(animation, time, imageWidth, imageHeight, createCameraLens(m_Settings)));
+
+        updateSeconds += getSecondsSince(startTime);
+    };
+
+    const auto writeFrame = [&](const long frameIndex) {
+        const auto startTime = std::chrono::steady_clock::now();
+
+        if (!saveImage(images[frameIndex % 2], imageWidth, imageHeight, GetFrameImagePath(m_Settings.OutputImagePath, frameIndex)))
+            failedFrameCount++;
+
+        writeSeconds += getSecondsSince(startTime);
+    };
+
+    // Without pipelining, stages run on this thread as frames are handed to them, one stage at a time
+    PipelineStage updateStage(updateFrame, isPipelined ? "frame update" : nullptr);
+    PipelineStage writeStage(writeFrame, isPipelined ? "frame write" : nullptr);
+
+    const auto sequenceStartTime = std::chrono::steady_clock::now();
+
+    updateFrame(0);
+
+    for (long i = 0; i < frameCount; i++)
+    {
+        if (i + 1 < frameCount)
+            updateStage.Start(i + 1);
+
+        const auto traceStartTime = std::chrono::steady_clock::now();
+
+        ProgressiveRenderer & renderer = *renderers[i % 2];
+        renderer.RenderPasses(m_Settings.HeadlessSampleCount);
+
+        std::vector<ImageRect> updatedTiles;
+        renderer.TakeUpdatedTiles(images[i % 2], updatedTiles);
+
+        traceSeconds += getSecondsSince(traceStartTime);
+
+        // Frames are written one at a time, in order, so starting this one waits for the previous one,
+        // and the image buffer of this one was last written two frames ago
+        writeStage.Start(i);
+
+        updateStage.Wait();
+    }
+
+    writeStage.Wait();
+
+    const double sequenceSeconds = getSecondsSince(sequenceStartTime);
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Rendered " << frameCount << " frames in " << sequenceSeconds << " s, " << frameCount*60.0/sequenceSeconds << " frames/minute"
+        << "; per frame, updating the scene took " << updateSeconds/frameCount << " s"
+        << ", tracing " << traceSeconds/frameCount << " s and writing " << writeSeconds/frameCount << " s";
+
+    if (failedFrameCount > 0)
+        BOOST_LOG_TRIVIAL(error) << failedFrameCount << " of " << frameCount << " frames couldn't be saved";
+
+    return failedFrameCount > 0 ? 1 : 0;
+}
+
+int Application::saveRenderedImages(ProgressiveRenderer & renderer, const Settings & settings)
+{
+    const int imageWidth  = renderer.GetImageWidth();
+    const int imageHeight = renderer.GetImageHeight();
+
+    if (settings.IsDeterministic)
+        BOOST_LOG_TRIVIAL(info) << "Accumulated samples hash to " << FormatHash(renderer.GetAccumulationBuffer().GetHash());
+
+    std::vector<Uint32>    image(static_cast<size_t>(imageWidth)*imageHeight, 0u);
+    std::vector<ImageRect> updatedTiles;
+
+    renderer.TakeUpdatedTiles(image, updatedTiles);
+
+    if (!saveImage(image, imageWidth, imageHeight, settings.OutputImagePath))
+        return 1;
+
+    if (settings.Heatmap == HeatmapMetric::None)
+        return 0;
+
+    Heatmap heatmap = CreateHeatmap(renderer.RenderPixelCosts(HEATMAP_SAMPLE_COUNT), settings.Heatmap, HEATMAP_SAMPLE_COUNT);
+    LogHeatmap(heatmap, settings.Heatmap);
+
+    return saveImage(heatmap.Image, imageWidth, imageHeight, GetHeatmapImagePath(settings.OutputImagePath)) ? 0 : 1;
+}
+
+bool Application::resumeFromCheckpoint(ProgressiveRenderer & renderer) const
+{
+    const std::string & checkpointPath = m_Settings.CheckpointPath;
+
+    // Lets the same command line start a render and resume it after it's been killed
+    if (!std::filesystem::exists(checkpointPath))
+    {
+        BOOST_LOG_TRIVIAL(info) << "No checkpoint at " << checkpointPath << " yet, starting from scratch";
+        return true;
+    }
+
+    const std::optional<Checkpoint> checkpoint = LoadCheckpoint(checkpointPath);
+    if (!checkpoint.has_value())
+        return false;
+
+    const CheckpointHeader & header = checkpoint->Header;
+
+    if (header.ImageWidth != renderer.GetImageWidth() || header.ImageHeight != renderer.GetImageHeight()
+        || header.Scene != m_Settings.Scene || header.Sampler != m_Settings.Sampler || header.SamplerSeed != m_SamplerSeed)
+    {
+        BOOST_LOG_TRIVIAL(error)
+            << "Checkpoint " << checkpointPath << " was rendered at " << header.ImageWidth << "x" << header.ImageHeight
+            << " of scene " << GetSceneName(header.Scene) << ", or with another sampler; these settings must stay the same";
+        return false;
+    }
+
+    // Samples focused differently would blur the image the checkpoint's samples are of
+    const CameraLens lens = createCameraLens(m_Settings);
+
+    if (header.Lens.ApertureRadius != lens.ApertureRadius || header.Lens.FocusDistance != lens.FocusDistance)
+    {
+        BOOST_LOG_TRIVIAL(error)
+            << "Checkpoint " << checkpointPath << " was rendered with aperture " << header.Lens.ApertureRadius
+            << " and focus distance " << header.Lens.FocusDistance << "; these settings must stay the same";
+        return false;
+    }
+
+    // Integrators and their options trace paths differently, so they'd mix samples of different estimates into the same sums
+    const IntegratorOptions & options = m_Settings.IntegrationOptions;
+
+    if (header.Integrator != m_Settings.Integrator || header.IntegrationOptions.UsePrimaryRayPackets != options.UsePrimaryRayPackets
+        || header.IntegrationOptions.SortSecondaryRays != options.SortSecondaryRays)
+    {
+        BOOST_LOG_TRIVIAL(error)
+            << "Checkpoint " << checkpointPath << " was rendered with the " << GetIntegratorName(header.Integrator)
+            << " integrator, or with other integrator options; these settings must stay the same";
+        return false;
+    }
+
+    renderer.RestoreAccumulation(checkpoint->PixelRgbs, checkpoint->SampleCounts, header.CompletedPassCount);
+
+    BOOST_LOG_TRIVIAL(info) << "Resumed from " << checkpointPath << " with " << header.CompletedPassCount << " passes done";
+
+    return true;
+}
+
+Checkpoint Application::createCheckpoint(const ProgressiveRenderer & renderer) const
+{
+    const ScopedTimelineEvent event("checkpoint copy");
+
+    Checkpoint checkpoint{
+        CheckpointHeader{
+            renderer.GetImageWidth(),
+            renderer.GetImageHeight(),
+            m_Settings.Scene,
+            m_Settings.Sampler,
+            m_SamplerSeed,
+            createCameraLens(m_Settings),
+            m_Settings.Integrator,
+            m_Settings.IntegrationOptions,
+            renderer.GetCompletedPassCount()
+        },
+        {},
+        {}
+    };
+
+    renderer.GetAccumulationBuffer().CopyTo(checkpoint.PixelRgbs, checkpoint.SampleCounts);
+
+    return checkpoint;
+}
+
+int Application::benchmarkScenes()
+{
+    const int imageWidth  = SCENE_BENCHMARK_IMAGE_WIDTH;
+    const int imageHeight = SCENE_BENCHMARK_IMAGE_HEIGHT;
+
+    const Camera          camera          = createCameraController(imageWidth, imageHeight, PINHOLE_CAMERA_LENS).CreateCamera();
+    const RayMissFunction rayMissFunction = createRayMissFunction();
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Benchmarking " << SCENE_TYPE_COUNT << " scenes at " << imageWidth << "x" << imageHeight
+        << " with " << SCENE_BENCHMARK_SAMPLE_COUNT << " samples per pixel"
+        << " using " << m_ThreadPool.GetThreadCount() << " threads"
+        << (m_Settings.UpdateBenchmarkReferences ? ", saving references to " : ", comparing to references in ")
+        << m_Settings.BenchmarkReferencePath;
+
+    int failedSceneCount = 0;
+
+    for (int i = 0; i < SCENE_TYPE_COUNT; i++)
+    {
+        const SceneType   sceneType     = static_cast<SceneType>(i);
+        const std::string sceneName     = GetSceneName(sceneType);
+        const std::string referencePath = m_Settings.BenchmarkReferencePath + "/" + sceneName + ".png";
+
+        const Scene scene(CreateSceneBodies(sceneType));
+
+        // Only the integrator and sampler are up to the settings, as other options change the image or the work done
+        ProgressiveRenderer renderer(
+            scene,
+            camera,
+            *m_Sampler,
+            rayMissFunction,
+            *m_Integrator,
+            m_ThreadPool,
+            imageWidth,
+            imageHeight,
+            RenderOptions{ToneMappingOperator::None, false, false}
+        );
+
+        const Uint64        renderStartCounter  = SDL_GetPerformanceCounter();
+        const StatsSnapshot renderStartSnapshot = TakeStatsSnapshot();
+
+        renderer.RenderPasses(SCENE_BENCHMARK_SAMPLE_COUNT);
+
+        const float renderSeconds =
+            static_cast<float>(SDL_GetPerformanceCounter() - renderStartCounter)/static_cast<float>(SDL_GetPerformanceFrequency());
+        const float sampleCount = static_cast<float>(imageWidth)*imageHeight*SCENE_BENCHMARK_SAMPLE_COUNT;
+
+        std::ostringstream report;
+        report.precision(3);
+        report
+            << "Scene " << sceneName << ": rendered in " << renderSeconds << " s"
+            << " (" << sampleCount/renderSeconds/1.0e6f << " million samples/s";
+
+        if constexpr (ARE_STATS_ENABLED)
+            report << ", " << GetMraysPerSecond(SubtractStats(TakeStatsSnapshot(), renderStartSnapshot), renderSeconds) << " Mrays/s";
+
+        // Peak of the whole process so far, so it only grows from one scene to the next
+        report << "), peak memory use " << GetPeakResidentSetBytes()/(1024*1024) << " MiB";
+
+        if (m_Settings.IsDeterministic)
+            report << ", accumulated samples hash to " << FormatHash(renderer.GetAccumulationBuffer().GetHash());
+
+        BOOST_LOG_TRIVIAL(info) << report.str();
+
+        std::vector<Uint32>    image(static_cast<size_t>(imageWidth)*imageHeight, 0u);
+        std::vector<ImageRect> updatedTiles;
+
+        renderer.TakeUpdatedTiles(image, updatedTiles);
+
+        if (m_Settings.UpdateBenchmarkReferences)
+        {
+            if (!saveImage(image, imageWidth, imageHeight, referencePath))
+                failedSceneCount++;
+
+            continue;
+        }
+
+        std::vector<Uint32> referenceImage;
+        if (!loadImage(referencePath, imageWidth, imageHeight, referenceImage))
+        {
+            failedSceneCount++;
+            continue;
+        }
+
+        // Noise alone leaves the mean difference near zero, while bias shifts it, and raises RMSE above noise level
+        const ImageDifference difference = CompareImages(image, referenceImage);
+
+        if (difference.Rmse <= SCENE_BENCHMARK_MAX_RMSE && std::abs(difference.MeanBias) <= SCENE_BENCHMARK_MAX_MEAN_BIAS)
+        {
+            BOOST_LOG_TRIVIAL(info)
+                << "Scene " << sceneName << " matches its reference: RMSE " << difference.Rmse
+                << ", mean bias " << difference.MeanBias;
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Scene " << sceneName << " differs from its reference: RMSE " << difference.Rmse
+                << " (at most " << SCENE_BENCHMARK_MAX_RMSE << " expected)"
+                << ", mean bias " << difference.MeanBias
+                << " (at most " << SCENE_BENCHMARK_MAX_MEAN_BIAS << " either way expected)";
+
+            failedSceneCount++;
+        }
+    }
+
+    if (failedSceneCount > 0)
+        BOOST_LOG_TRIVIAL(error) << failedSceneCount << " of " << SCENE_TYPE_COUNT << " scenes failed";
+
+    return failedSceneCount > 0 ? 1 : 0;
+}
+
+int Application::checkDeterminism()
+{
+    const int imageWidth  = DETERMINISM_CHECK_IMAGE_WIDTH;
+    const int imageHeight = DETERMINISM_CHECK_IMAGE_HEIGHT;
+
+    const Camera          camera          = createCameraController(imageWidth, imageHeight, PINHOLE_CAMERA_LENS).CreateCamera();
+    const Camera          lensCamera      = createCameraController(imageWidth, imageHeight, DETERMINISM_CHECK_LENS).CreateCamera();
+    const RayMissFunction rayMissFunction = createRayMissFunction();
+
+    ThreadPool singleThreadPool(0);
+    ThreadPool multiThreadPool(std::max(m_ThreadPool.GetThreadCount(), DETERMINISM_CHECK_MIN_THREAD_COUNT) - 1);
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Checking " << SCENE_TYPE_COUNT << " scenes with " << SAMPLER_TYPE_COUNT << " samplers and "
+        << INTEGRATOR_TYPE_COUNT << " integrators, then a lens and motion blur, at " << imageWidth << "x" << imageHeight
+        << " with " << DETERMINISM_CHECK_SAMPLE_COUNT << " samples per pixel"
+        << " on 1 and " << multiThreadPool.GetThreadCount() << " threads";
+
+    int checkCount       = 0;
+    int failedCheckCount = 0;
+
+    const auto checkCombination = [&](
+        const std::string & combination,
+        const Scene &       scene,
+        const Camera &      combinationCamera,
+        const ISampler &    sampler,
+        const IIntegrator & integrator
+    ) {
+        const auto renderHash = [&](ThreadPool & threadPool) {
+            ProgressiveRenderer renderer(
+                scene,
+                combinationCamera,
+                sampler,
+                rayMissFunction,
+                integrator,
+                threadPool,
+                imageWidth,
+                imageHeight,
+                RenderOptions{ToneMappingOperator::None, false, false}
+            );
+
+            renderer.RenderPasses(DETERMINISM_CHECK_SAMPLE_COUNT);
+
+            return renderer.GetAccumulationBuffer().GetHash();
+        };
+
+        const std::uint64_t singleThreadHash = renderHash(singleThreadPool);
+        const std::uint64_t multiThreadHash  = renderHash(multiThreadPool);
+
+        checkCount++;
+
+        if (singleThreadHash == multiThreadHash)
+        {
+            BOOST_LOG_TRIVIAL(info) << combination << " hashes to " << FormatHash(singleThreadHash) << " on both thread counts";
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << combination << " hashes to " << FormatHash(singleThreadHash) << " on 1 thread,"
+                << " but to " << FormatHash(multiThreadHash) << " on " << multiThreadPool.GetThreadCount();
+
+            failedCheckCount++;
+        }
+    };
+
+    for (int i = 0; i < SCENE_TYPE_COUNT; i++)
+    {
+        const SceneType sceneType = static_cast<SceneType>(i);
+        const Scene     scene(CreateSceneBodies(sceneType));
+
+        for (int j = 0; j < SAMPLER_TYPE_COUNT; j++)
+        {
+            const SamplerType               samplerType = static_cast<SamplerType>(j);
+            const std::unique_ptr<ISampler> sampler     = CreateSampler(samplerType, CreateSamplerSeed(true));
+
+            for (int k = 0; k < INTEGRATOR_TYPE_COUNT; k++)
+            {
+                const IntegratorType               integratorType = static_cast<IntegratorType>(k);
+                const std::unique_ptr<IIntegrator> integrator     = CreateIntegrator(integratorType, m_Settings.IntegrationOptions);
+
+                std::ostringstream combination;
+                combination
+                    << "Scene " << GetSceneName(sceneType) << " with the " << GetSamplerName(samplerType) << " sampler"
+                    << " and the " << GetIntegratorName(integratorType) << " integrator";
+
+                checkCombination(combination.str(), scene, camera, *sampler, *integrator);
+            }
+        }
+    }
+
+    // A lens and motion blur each take sampler dimensions of their own, so they're checked on top, with one scene and sampler
+    const SceneType                 sceneType = SceneType::Default;
+    const std::unique_ptr<ISampler> sampler   = CreateSampler(SamplerType::Random, CreateSamplerSeed(true));
+
+    std::vector<Body> movingBodies = CreateSceneBodies(sceneType);
+    const Animation   animation    = CreateSceneAnimation(sceneType, movingBodies);
+    MakeAnimatedSpheresMoving(animation, movingBodies);
+
+    const Scene staticScene(CreateSceneBodies(sceneType));
+    Scene       movingScene(std::move(movingBodies));
+    AnimateScene(animation, 0.0f, DETERMINISM_CHECK_SHUTTER_DURATION, movingScene, singleThreadPool);
+
+    for (int k = 0; k < INTEGRATOR_TYPE_COUNT; k++)
+    {
+        const IntegratorType               integratorType = static_cast<IntegratorType>(k);
+        const std::unique_ptr<IIntegrator> integrator     = CreateIntegrator(integratorType, m_Settings.IntegrationOptions);
+
+        const std::string combination = std::string("Scene ") + GetSceneName(sceneType) + " with the random sampler"
+            + " and the " + GetIntegratorName(integratorType) + " integrator";
+
+        checkCombination(combination + ", through a lens,", staticScene, lensCamera, *sampler, *integrator);
+        checkCombination(combination + ", with motion blur,", movingScene, camera, *sampler, *integrator);
+    }
+
+    if (failedCheckCount > 0)
+        BOOST_LOG_TRIVIAL(error) << failedCheckCount << " of " << checkCount << " combinations depend on the number of threads";
+
+    return failedCheckCount > 0 ? 1 : 0;
+}
 
 static inline Color RawNormalToColor(const Vector3 & rawNormal)
 {
@@ -156,34 +1349,116 @@ static inline Color RawNormalToColor(const Vector3 & rawNormal)
     return Color(nonNegativeNormal);
 }
 
-static inline Vector3 SamplePixelRgb(
-    const std::vector<Body> & scene,
-    const Camera &            camera,
-    const RayMissFunction     rayMissFunc,
-    const int                 imageWidth,
-    const int                 imageHeight,
-    const int                 pixelX,
-    const int                 pixelY
-)
+static std::string AddImagePathSuffix(const std::string & imagePath, const std::string & suffix)
 {
-    const float sampleX = (static_cast<float>(pixelX) + GetRandomValue() - 0.5f);
-    const float sampleY = (static_cast<float>(pixelY) + GetRandomValue() - 0.5f);
+    static const std::string PNG_EXTENSION = ".png";
+
+    const bool hasPngExtension = imagePath.size() >= PNG_EXTENSION.size()
+        && imagePath.compare(imagePath.size() - PNG_EXTENSION.size(), PNG_EXTENSION.size(), PNG_EXTENSION) == 0;
 
-    const float normalizedSampleX = sampleX/static_cast<float>(imageWidth);
-    const float normalizedSampleY = 1.0f - sampleY/static_cast<float>(imageHeight);
+    return hasPngExtension
+        ? imagePath.substr(0, imagePath.size() - PNG_EXTENSION.size()) + suffix + PNG_EXTENSION
+        : imagePath + suffix + PNG_EXTENSION;
+}
 
-    const Ray ray = camera.CreateRay(normalizedSampleX, normalizedSampleY);
+static std::string GetHeatmapImagePath(const std::string & imagePath)
+{
+    static const std::string HEATMAP_SUFFIX = "-heatmap";
 
-    const Color rayColor = TraceRay(
-        scene,
-        ray,
-        rayMissFunc
+    return AddImagePathSuffix(imagePath, HEATMAP_SUFFIX);
+}
+
+static std::string GetFrameImagePath(const std::string & imagePath, const long frameIndex)
+{
+    std::ostringstream frameSuffix;
+    frameSuffix << "-" << std::setfill('0') << std::setw(4) << frameIndex;
+
+    return AddImagePathSuffix(imagePath, frameSuffix.str());
+}
+
+static void LogHeatmap(const Heatmap & heatmap, const HeatmapMetric metric)
+{
+    BOOST_LOG_TRIVIAL(info)
+        << "Heatmap of " << DescribeHeatmapMetric(metric)
+        << " goes from blue for none to red for " << heatmap.MaxValue << " or more";
+}
+
+static std::string FormatHash(const std::uint64_t hash)
+{
+    std::ostringstream formattedHash;
+    formattedHash << std::hex << std::setfill('0') << std::setw(16) << hash;
+
+    return formattedHash.str();
+}
+
+std::uint32_t Application::createSamplerSeed(const Settings & settings)
+{
+    if (settings.ResumeFromCheckpoint && std::filesystem::exists(settings.CheckpointPath))
+    {
+        const std::optional<CheckpointHeader> header = LoadCheckpointHeader(settings.CheckpointPath);
+        if (header.has_value())
+            return header->SamplerSeed;
+    }
+
+    if (settings.SamplerSeed.has_value())
+        return *settings.SamplerSeed;
+
+    return CreateSamplerSeed(settings.IsDeterministic);
+}
+
+CameraController Application::createCameraController(const int imageWidth, const int imageHeight, const CameraLens & lens)
+{
+    const float aspectRatio = static_cast<float>(imageWidth)/static_cast<float>(imageHeight);
+
+    const float projectionWidth = CAMERA_PROJECTION_HEIGHT * aspectRatio;
+
+    // The following code uses a left-handed coordinate system:
+    // x points right, y points up, z points into the screen.
+
+    static const Vector3 CAMERA_ORIGIN    (0.0f, 0.0f, -1.0f);
+    static const Vector3 PROJECTION_CENTER(0.0f, 0.0f, 0.0f);
+
+    return CameraController(
+        CAMERA_ORIGIN,
+        PROJECTION_CENTER - CAMERA_ORIGIN,
+        projectionWidth,
+        CAMERA_PROJECTION_HEIGHT,
+        lens
     );
+}
+
+Camera Application::createAnimatedCamera(
+    const Animation &  animation,
+    const float        time,
+    const int          imageWidth,
+    const int          imageHeight,
+    const CameraLens & lens
+)
+{
+    const float aspectRatio = static_cast<float>(imageWidth)/static_cast<float>(imageHeight);
+
+    return CreateAnimatedCamera(animation, time, CAMERA_PROJECTION_HEIGHT * aspectRatio, CAMERA_PROJECTION_HEIGHT, lens);
+}
+
+CameraLens Application::createCameraLens(const Settings & settings)
+{
+    return settings.ApertureRadius > 0.0f ? CameraLens{settings.ApertureRadius, settings.FocusDistance} : PINHOLE_CAMERA_LENS;
+}
+
+RayMissFunction Application::createRayMissFunction()
+{
+    static const Color BACKGROUND_TOP_COLOR   (0.7f, 0.7f, 0.95f);
+    static const Color BACKGROUND_BOTTOM_COLOR(0.9f, 0.9f, 0.9f);
 
-    return rayColor.Rgb;
+    return std::bind(
+        GetVerticalGradientColor,
+        std::placeholders::_1,
+        BACKGROUND_BOTTOM_COLOR,
+        BACKGROUND_TOP_COLOR
+    );
 }
 
-sdl2utils::SDL_WindowPtr Application::createWindow()
+sdl2utils::SDL_WindowPtr Application::createWindow(const int width, const int height)
 {
     return sdl2utils::SDL_WindowPtr(
         sdl2utils::guards::ensureNotNull(
@@ -191,9 +1466,9 @@ sdl2utils::SDL_WindowPtr Application::createWindow()
                 WINDOW_TITLE,
                 SDL_WINDOWPOS_UNDEFINED,
                 SDL_WINDOWPOS_UNDEFINED,
-                WINDOW_WIDTH,
-                WINDOW_HEIGHT,
-                0u
+                width,
+                height,
+                SDL_WINDOW_RESIZABLE
             ),
             "result of SDL_CreateWindow()"
         )
@@ -217,7 +1492,7 @@ static bool doesRendererSupportPixelFormat(SDL_Renderer * pRenderer, const Uint3
     return false;
 }
 
-sdl2utils::SDL_RendererPtr Application::createRenderer(SDL_Window * const pWindow)
+sdl2utils::SDL_RendererPtr Application::createRenderer(SDL_Window * const pWindow, const int imageWidth, const int imageHeight)
 {
     sdl2utils::SDL_RendererPtr renderer(
         sdl2utils::guards::ensureNotNull(
@@ -229,51 +1504,90 @@ sdl2utils::SDL_RendererPtr Application::createRenderer(SDL_Window * const pWindo
     if (!doesRendererSupportPixelFormat(renderer.get(), SDL_TEXTURE_PIXELFORMAT))
         BOOST_LOG_TRIVIAL(error) << "The renderer does not directly support texture pixel format ARGB8888; rendering will be slow due to conversions";
 
+    // Scale the image to the window, preserving its aspect ratio
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+
+    const int logicalSizeResult = SDL_RenderSetLogicalSize(renderer.get(), imageWidth, imageHeight);
+    assert(logicalSizeResult == 0 && "SDL_RenderSetLogicalSize() must succeed");
+
     return renderer;
 }
 
-sdl2utils::SDL_TexturePtr Application::createStreamingTexture(SDL_Renderer * const pRenderer)
+sdl2utils::SDL_TexturePtr Application::createStreamingTexture(SDL_Renderer * const pRenderer, const int width, const int height)
 {
     return sdl2utils::SDL_TexturePtr(
         sdl2utils::guards::ensureNotNull(
-            SDL_CreateTexture(pRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WINDOW_WIDTH, WINDOW_HEIGHT),
+            SDL_CreateTexture(pRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height),
             "result of SDL_CreateTexture()"
         )
     );
 }
 
-std::vector<Body> Application::createRaytracingScene()
+bool Application::saveImage(std::vector<Uint32> & image, const int width, const int height, const std::string & path)
 {
-    return {
-        {
-            std::make_shared<PlaneRayTarget>(Vector3(0.0f, -0.5f, 0.0f), Vector3(0.0f, 1.0f, 0.0f)),
-            Material{
-                Color(0.75f, 0.75f, 0.75f),
-                0.25f, 0.85f, 0.0f, 1.0f
-            }
-        },
-        {
-            std::make_shared<SphereRayTarget>(Vector3(0.0f, 0.0f, 1.0f), 0.5f),
-            Material{
-                Color(0.75f, 0.75f,  0.75f),
-                0.975f, 0.975f, 0.975f, 1.5f
-            }
-        },
-        {
-            std::make_shared<SphereRayTarget>(Vector3(0.75f, -0.25f, 0.75f), 0.25f),
-            Material{
-                Color(0.35f, 0.7f, 0.35f),
-                0.75f, 1.0f, 0.0f, 1.0f
-            }
-        },
-        {
-            std::make_shared<SphereRayTarget>(Vector3(-1.25f, 0.25f, 1.5f), 0.75f),
-            Material{
-                Color(0.8f, 0.4f, 0.6f),
-                0.0f, 1.0f, 0.0f, 1.0f
-            }
-        }
-    };
+    const ScopedTimelineEvent event("image write");
+
+    const sdl2utils::SDL_SurfacePtr surface(
+        SDL_CreateRGBSurfaceWithFormatFrom(
+            image.data(),
+            width,
+            height,
+            32,
+            width*sizeof(Uint32),
+            SDL_TEXTURE_PIXELFORMAT
+        )
+    );
+
+    if (!surface || IMG_SavePNG(surface.get(), path.c_str()) != 0)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to save image to " << path << ": " << SDL_GetError();
+        return false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Saved image to " << path;
+
+    return true;
+}
+
+bool Application::loadImage(const std::string & path, const int width, const int height, std::vector<Uint32> & image)
+{
+    const ScopedTimelineEvent event("image read");
+
+    const sdl2utils::SDL_SurfacePtr loadedSurface(IMG_Load(path.c_str()));
+    if (!loadedSurface)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to load image from " << path << ": " << SDL_GetError();
+        return false;
+    }
+
+    const sdl2utils::SDL_SurfacePtr surface(SDL_ConvertSurfaceFormat(loadedSurface.get(), SDL_TEXTURE_PIXELFORMAT, 0));
+    if (!surface)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to convert image loaded from " << path << ": " << SDL_GetError();
+        return false;
+    }
+
+    if (surface->w != width || surface->h != height)
+    {
+        BOOST_LOG_TRIVIAL(error)
+            << "Image loaded from " << path << " is " << surface->w << "x" << surface->h
+            << ", expected " << width << "x" << height;
+        return false;
+    }
+
+    image.resize(static_cast<size_t>(width)*height);
+
+    // Rows of the surface may be padded
+    for (int y = 0; y < height; y++)
+    {
+        std::memcpy(
+            image.data() + static_cast<size_t>(y)*width,
+            static_cast<const Uint8 *>(surface->pixels) + static_cast<size_t>(y)*surface->pitch,
+            width*sizeof(Uint32)
+        );
+    }
+
+    return true;
 }
 
 } // namespace rtwe
\ No newline at end of file
@@ -1,11 +1,18 @@
 #ifndef RTWE_APPLICATION_H
 #define RTWE_APPLICATION_H
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <sdl2utils/raii.h>
 #include <sdl2utils/pointers.h>
 
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "tracing.h"
+
 namespace rtwe
 {
 
@@ -13,7 +20,15 @@ namespace rtwe
 // Forward declarations
 //
 
-struct Body;
+struct IIntegrator;
+struct ISampler;
+struct Animation;
+struct Checkpoint;
+struct RenderJob;
+struct CameraLens;
+class ProgressiveRenderer;
+class Camera;
+class CameraController;
 
 //
 //
@@ -23,7 +38,7 @@ class Application final
 {
 public: // Construction
 
-    explicit Application();
+    explicit Application(Settings settings);
 
 public: // Deleted
 
@@ -39,29 +54,176 @@ public: // Interface
 
 private: // Service
 
-    static sdl2utils::SDL_WindowPtr createWindow();
+    /**
+     * @brief Renders the scene chosen in settings, in the window or headlessly.
+     */
+    int renderScene();
+
+    int renderInteractively(ProgressiveRenderer & renderer, CameraController & cameraController);
+
+    /**
+     * @brief Renders the configured number of samples per pixel without a window, then saves the image.
+     */
+    int renderHeadless(ProgressiveRenderer & renderer);
+
+    /**
+     * @brief Renders the configured number of samples per pixel on farm workers, then saves the image.
+     */
+    int renderFarm(ProgressiveRenderer & renderer);
+
+    /**
+     * @brief Renders jobs of the configured farm coordinator, as a worker, until it has no more of them.
+     */
+    int renderFarmJobs();
+
+    /**
+     * @brief Renders the configured range of samples per pixel without a window, then saves them as a partial render
+     * along with the image.
+     */
+    int renderPartial(ProgressiveRenderer & renderer);
+
+    /**
+     * @brief Merges the partial renders in the configured directory, then saves the image, and the merged partial if configured.
+     */
+    int mergePartialRenders();
+
+    /**
+     * @brief Renders jobs queued in the configured directory, one after another, until none are left if configured,
+     * or else for as long as the process runs.
+     */
+    int serveRenderJobs();
+
+    /**
+     * @brief Renders the job's samples per pixel with the shared thread pool, then saves the image.
+     */
+    int renderJob(const RenderJob & job);
+
+    /**
+     * @brief Renders frames of the scene's animation, overlapping the scene update for the next frame and the writing
+     * of the previous one with tracing of the current one, unless configured otherwise.
+     */
+    int renderAnimation();
+
+    /**
+     * @brief Saves the image of what the renderer has accumulated, and the heatmap if one is chosen in the given settings,
+     * which are the application's own or a render job's.
+     */
+    int saveRenderedImages(ProgressiveRenderer & renderer, const Settings & settings);
+
+    /**
+     * @brief Restores the renderer's progress from the configured checkpoint, unless there is none yet.
+     *
+     * @return false if the checkpoint couldn't be loaded, or was rendered with other settings.
+     */
+    bool resumeFromCheckpoint(ProgressiveRenderer & renderer) const;
+
+    /**
+     * @brief Copies the renderer's progress, taking a few milliseconds, so that it can be written while rendering goes on.
+     */
+    Checkpoint createCheckpoint(const ProgressiveRenderer & renderer) const;
+
+    /**
+     * @brief Renders each canonical scene at a fixed resolution and sample count, then compares it to its reference image.
+     *
+     * @return 1 if any image couldn't be saved or loaded, or differs from its reference more than noise would explain.
+     */
+    int benchmarkScenes();
+
+    /**
+     * @brief Renders each scene with each sampler and integrator, then one scene through a lens and with motion blur,
+     * at a fixed resolution and sample count, on a single thread and on several, then compares hashes of the accumulated samples.
+     *
+     * @return 1 if any combination hashes differently on a different number of threads.
+     */
+    int checkDeterminism();
+
+    /**
+     * @brief Controller of the initial view, looking along z at the scenes' center.
+     */
+    static CameraController createCameraController(const int imageWidth, const int imageHeight, const CameraLens & lens);
+
+    /**
+     * @brief Camera of the animation at the given time, with the same projection as the initial view's.
+     */
+    static Camera createAnimatedCamera(
+        const Animation &  animation,
+        const float        time,
+        const int          imageWidth,
+        const int          imageHeight,
+        const CameraLens & lens
+    );
+
+    /**
+     * @brief Lens of the configured aperture and focus distance, or a pinhole without an aperture.
+     */
+    static CameraLens createCameraLens(const Settings & settings);
+
+    /**
+     * @brief Background of the scenes, a gradient from light gray at the bottom to light blue at the top.
+     */
+    static RayMissFunction createRayMissFunction();
+
+    /**
+     * @brief Seed of a checkpoint being resumed, so that its samples continue the same sequences, or else the configured one,
+     * or a new one.
+     */
+    static std::uint32_t createSamplerSeed(const Settings & settings);
+
+    static sdl2utils::SDL_WindowPtr createWindow(const int width, const int height);
+
+    static sdl2utils::SDL_RendererPtr createRenderer(SDL_Window * const pWindow, const int imageWidth, const int imageHeight);
+
+    static sdl2utils::SDL_TexturePtr createStreamingTexture(SDL_Renderer * const pRenderer, const int width, const int height);
+
+    static bool saveImage(std::vector<Uint32> & image, const int width, const int height, const std::string & path);
+
+    /**
+     * @brief Loads an image of the given size as ARGB, e.g. one saved by saveImage().
+     */
+    static bool loadImage(const std::string & path, const int width, const int height, std::vector<Uint32> & image);
 
-    static sdl2utils::SDL_RendererPtr createRenderer(SDL_Window * const pWindow);
+private: // Constants
 
-    static sdl2utils::SDL_TexturePtr createStreamingTexture(SDL_Renderer * const pRenderer);
+    static const char * const WINDOW_TITLE;
 
-    static std::vector<Body> createRaytracingScene();
+    static const int    SDL_INIT_FLAGS;
+    static const int    SDL_HEADLESS_INIT_FLAGS;
+    static const Uint32 SDL_TEXTURE_PIXELFORMAT;
 
-private: // Constants
+    static const Uint32 PRESENT_INTERVAL_MS;
+    static const Uint32 PRESENT_STATS_INTERVAL_MS;
+    static const Uint32 TITLE_STATS_INTERVAL_MS;
 
-    static const int WINDOW_WIDTH;
-    static const int WINDOW_HEIGHT;
+    static const int HEATMAP_SAMPLE_COUNT;
 
-    static const float WINDOW_ASPECT_RATIO;
+    static const int SCENE_BENCHMARK_IMAGE_WIDTH;
+    static const int SCENE_BENCHMARK_IMAGE_HEIGHT;
+    static const int SCENE_BENCHMARK_SAMPLE_COUNT;
 
-    static const char * const WINDOW_TITLE;
+    static const double SCENE_BENCHMARK_MAX_RMSE;
+    static const double SCENE_BENCHMARK_MAX_MEAN_BIAS;
 
-    static const int    SDL_INIT_FLAGS;
-    static const Uint32 SDL_TEXTURE_PIXELFORMAT;
+    static const int DETERMINISM_CHECK_IMAGE_WIDTH;
+    static const int DETERMINISM_CHECK_IMAGE_HEIGHT;
+    static const int DETERMINISM_CHECK_SAMPLE_COUNT;
+
+    static const size_t DETERMINISM_CHECK_MIN_THREAD_COUNT;
+
+    static const CameraLens DETERMINISM_CHECK_LENS;
+    static const float      DETERMINISM_CHECK_SHUTTER_DURATION;
+
+    static const float CAMERA_PROJECTION_HEIGHT;
 
 private: // Members
 
     const sdl2utils::raii::ScopedSDLCore m_ScopedSDLCore;
+
+    const Settings                     m_Settings;
+    const std::unique_ptr<IIntegrator> m_Integrator;
+    const std::uint32_t                m_SamplerSeed;
+    const std::unique_ptr<ISampler>    m_Sampler;
+
+    ThreadPool m_ThreadPool;
 };
 
 } // namespace rtwe
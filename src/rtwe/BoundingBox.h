@@ -0,0 +1,154 @@
+#ifndef RTWE_BOUNDING_BOX_H
+#define RTWE_BOUNDING_BOX_H
+
+#include <cmath>
+
+#include "types.h"
+#include "Ray.h"
+
+namespace rtwe
+{
+
+struct BoundingBox final
+{
+public: // Attributes
+
+    Vector3 Min;
+    Vector3 Max;
+
+public: // Construction
+
+    inline BoundingBox();
+
+    inline BoundingBox(Vector3 min, Vector3 max);
+
+public: // Interface
+
+    inline bool IsEmpty() const;
+
+    inline Vector3 GetCenter() const;
+
+    inline float GetSurfaceArea() const;
+
+    inline void Expand(const BoundingBox & other);
+
+    inline void Expand(const Vector3 & point);
+
+    /**
+     * @brief Slab test against a ray with precomputed inverse direction.
+     *
+     * @return Whether the ray overlaps the box within [minRayParam, maxRayParam].
+     */
+    inline bool IsHitBy(
+        const Ray &     ray,
+        const Vector3 & inverseRayDirection,
+        const float     minRayParam,
+        const float     maxRayParam
+    ) const;
+};
+
+/**
+ * @brief Bounds of a moving body at the start and the end of (a part of) the shutter interval.
+ *
+ * Interpolating them linearly gives bounds of the body at any time in between, so they must be conservative
+ * for motion which isn't linear itself.
+ */
+struct MotionBoundingBox final
+{
+    BoundingBox Start;
+    BoundingBox End;
+};
+
+//
+// Utilities
+//
+
+inline BoundingBox UniteBoundingBoxes(const BoundingBox & box0, const BoundingBox & box1)
+{
+    return BoundingBox(
+        box0.Min.cwiseMin(box1.Min),
+        box0.Max.cwiseMax(box1.Max)
+    );
+}
+
+inline BoundingBox InterpolateBoundingBoxes(const BoundingBox & box0, const BoundingBox & box1, const float fraction)
+{
+    return BoundingBox(
+        box0.Min + fraction*(box1.Min - box0.Min),
+        box0.Max + fraction*(box1.Max - box0.Max)
+    );
+}
+
+//
+// Construction
+//
+
+inline BoundingBox::BoundingBox():
+    Min(Vector3::Constant(INFINITY)),
+    Max(Vector3::Constant(-INFINITY))
+{
+    // Empty
+}
+
+inline BoundingBox::BoundingBox(Vector3 min, Vector3 max):
+    Min(std::move(min)),
+    Max(std::move(max))
+{
+    // Empty
+}
+
+//
+// Interface
+//
+
+inline bool BoundingBox::IsEmpty() const
+{
+    return (Min.array() > Max.array()).any();
+}
+
+inline Vector3 BoundingBox::GetCenter() const
+{
+    return 0.5f*(Min + Max);
+}
+
+inline float BoundingBox::GetSurfaceArea() const
+{
+    if (IsEmpty())
+        return 0.0f;
+
+    const Vector3 extent = Max - Min;
+
+    return 2.0f*(extent.x()*extent.y() + extent.y()*extent.z() + extent.z()*extent.x());
+}
+
+inline void BoundingBox::Expand(const BoundingBox & other)
+{
+    Min = Min.cwiseMin(other.Min);
+    Max = Max.cwiseMax(other.Max);
+}
+
+inline void BoundingBox::Expand(const Vector3 & point)
+{
+    Min = Min.cwiseMin(point);
+    Max = Max.cwiseMax(point);
+}
+
+inline bool BoundingBox::IsHitBy(
+    const Ray &     ray,
+    const Vector3 & inverseRayDirection,
+    const float     minRayParam,
+    const float     maxRayParam
+) const
+{
+    const Vector3 params0 = (Min - ray.Origin).cwiseProduct(inverseRayDirection);
+    const Vector3 params1 = (Max - ray.Origin).cwiseProduct(inverseRayDirection);
+
+    const float entryParam = std::max(minRayParam, params0.cwiseMin(params1).maxCoeff());
+    const float exitParam  = std::min(maxRayParam, params0.cwiseMax(params1).minCoeff());
+
+    return entryParam <= exitParam;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_BOUNDING_BOX_H
@@ -0,0 +1,786 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+
+#include "constants.h"
+#include "targets.h"
+#include "timeline.h"
+#include "ThreadPool.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr size_t BVH_BIN_COUNT                = 16;
+constexpr size_t BVH_MIN_LEAF_PRIMITIVE_COUNT = 2;
+constexpr size_t BVH_MAX_LEAF_PRIMITIVE_COUNT = 8;
+constexpr size_t BVH_MAX_DEPTH                = 64;
+
+// As many as a leaf's PrimitiveCount can hold, which only leaves at the depth limit come close to
+constexpr size_t BVH_MAX_LEAF_NODE_PRIMITIVE_COUNT = std::numeric_limits<decltype(Bvh::Node::PrimitiveCount)>::max();
+constexpr size_t BVH_REFIT_CHUNK_SIZE         = 256;
+
+constexpr float BVH_TRAVERSAL_COST    = 1.0f;
+constexpr float BVH_INTERSECTION_COST = 1.0f;
+
+// Nodes of moving bodies get bounds at the ends of this many steps of the shutter interval,
+// which bound paths of up to as many linear segments spread evenly over the interval exactly
+constexpr size_t BVH_MOTION_STEP_COUNT        = 4;
+constexpr size_t BVH_MOTION_STEP_BOUNDS_COUNT = BVH_MOTION_STEP_COUNT + 1;
+
+//
+// Service types
+//
+
+namespace
+{
+
+struct BuildPrimitive final
+{
+    BoundingBox   Bounds;
+    Vector3       Centroid;
+    std::uint32_t BodyIndex;
+};
+
+struct BuildState final
+{
+    std::vector<Bvh::Node> &                  Nodes;
+    std::vector<BuildPrimitive> &             Primitives;
+    std::vector<std::vector<std::uint32_t>> & NodeIndicesByDepth;
+};
+
+struct FloatInterval final
+{
+    float Min;
+    float Max;
+};
+
+struct SplitCandidate final
+{
+    float  Cost;
+    int    Axis;
+    size_t Bin;
+};
+
+} // anonymous namespace
+
+//
+// Service
+//
+
+static void BuildNode(BuildState & state, const size_t nodeIndex, const size_t begin, const size_t end, const size_t depth);
+
+/**
+ * @return Number of median splits it takes for the primitives to fit into leaves.
+ */
+static size_t GetMedianSplitDepth(size_t primitiveCount);
+
+/**
+ * @return Index of the step of the shutter interval, which the time falls into.
+ */
+static inline size_t FindMotionStep(const float time, float & stepFraction);
+
+/**
+ * @brief Expands bounds at each step of the shutter interval, so that they contain the target at any time of the step.
+ */
+static void ExpandStepBounds(const IRayTarget & target, BoundingBox * const pStepBounds);
+
+//
+// Construction
+//
+
+Bvh::Bvh():
+    m_BuildSahCost(0.0f),
+    m_SahCost     (0.0f)
+{
+    // Empty
+}
+
+Bvh::Bvh(const std::vector<Body> & bodies, const std::vector<size_t> & bodyIndices, const bool interpolateMotionBounds):
+    Bvh()
+{
+    if (bodyIndices.empty())
+        return;
+
+    std::vector<BuildPrimitive> primitives;
+    primitives.reserve(bodyIndices.size());
+
+    bool hasMotion = false;
+
+    for (const size_t bodyIndex : bodyIndices)
+    {
+        const IRayTarget & target = *bodies[bodyIndex].RayTarget;
+
+        // Moving bodies are grouped by where they are in the middle of the interval, and get their step bounds fitted later
+        const std::optional<MotionBoundingBox> middleBoundingBox = interpolateMotionBounds
+            ? target.TryGetMotionBoundingBox(0.5f, 0.5f)
+            : std::nullopt;
+
+        hasMotion |= middleBoundingBox.has_value();
+
+        const std::optional<BoundingBox> boundingBox = middleBoundingBox.has_value()
+            ? middleBoundingBox->Start
+            : target.TryGetBoundingBox();
+
+        assert(boundingBox.has_value() && "only bounded bodies may be put into a BVH");
+
+        primitives.push_back(BuildPrimitive{
+            *boundingBox,
+            boundingBox->GetCenter(),
+            static_cast<std::uint32_t>(bodyIndex)
+        });
+    }
+
+    m_Nodes.reserve(2*primitives.size());
+    m_Nodes.emplace_back();
+
+    BuildState state{m_Nodes, primitives, m_NodeIndicesByDepth};
+    BuildNode(state, 0, 0, primitives.size(), 0);
+
+    m_BodyIndices.reserve(primitives.size());
+    for (const BuildPrimitive & primitive : primitives)
+        m_BodyIndices.push_back(primitive.BodyIndex);
+
+    if (hasMotion)
+    {
+        m_NodeStepBounds.resize(m_Nodes.size()*BVH_MOTION_STEP_BOUNDS_COUNT);
+
+        // Children follow their parents in depth-first order, so going backwards fits them first
+        for (size_t i = m_Nodes.size(); i > 0; i--)
+            refitNode(bodies, i - 1);
+    }
+
+    m_BuildSahCost = m_SahCost = calculateSahCost();
+}
+
+//
+// Interface
+//
+
+void Bvh::Refit(const std::vector<Body> & bodies, ThreadPool & threadPool)
+{
+    const ScopedTimelineEvent event("BVH refit");
+
+    for (auto levelIt = m_NodeIndicesByDepth.crbegin(); levelIt != m_NodeIndicesByDepth.crend(); ++levelIt)
+    {
+        const std::vector<std::uint32_t> & levelNodeIndices = *levelIt;
+
+        const size_t chunkCount = (levelNodeIndices.size() + BVH_REFIT_CHUNK_SIZE - 1)/BVH_REFIT_CHUNK_SIZE;
+
+        threadPool.ParallelFor(
+            chunkCount,
+            [this, &bodies, &levelNodeIndices](const size_t chunkIndex) {
+                const size_t begin = chunkIndex*BVH_REFIT_CHUNK_SIZE;
+                const size_t end   = std::min(begin + BVH_REFIT_CHUNK_SIZE, levelNodeIndices.size());
+
+                for (size_t i = begin; i < end; i++)
+                    refitNode(bodies, levelNodeIndices[i]);
+            }
+        );
+    }
+
+    m_SahCost = calculateSahCost();
+}
+
+std::optional<BodyHit> Bvh::TryHit(
+    const std::vector<Body> & bodies,
+    const Ray &               ray,
+    const float               minRayParam,
+    const float               maxRayParam,
+    TestCounts * const        pTestCounts
+) const
+{
+    if (m_Nodes.empty())
+        return std::nullopt;
+
+    const Vector3 inverseRayDirection = ray.Direction.cwiseInverse();
+    const bool    hasMotion           = HasMotion();
+
+    float        motionStepFraction = 0.0f;
+    const size_t motionStep         = hasMotion ? FindMotionStep(ray.Time, motionStepFraction) : 0;
+
+    std::optional<BodyHit> result;
+    float currentMaxRayParam = maxRayParam;
+
+    std::array<std::uint32_t, BVH_MAX_DEPTH> nodeIndexStack;
+    size_t                                   nodeIndexStackSize = 0;
+
+    // Counted locally and added to the output once, to keep the traversal loop tight
+    std::uint64_t nodeTestCount      = 0;
+    std::uint64_t primitiveTestCount = 0;
+
+    nodeIndexStack[nodeIndexStackSize++] = 0;
+    while (nodeIndexStackSize > 0)
+    {
+        const std::uint32_t nodeIndex = nodeIndexStack[--nodeIndexStackSize];
+        const Node &        node      = m_Nodes[nodeIndex];
+
+        nodeTestCount++;
+
+        const bool isNodeHit = hasMotion
+            ? getNodeBoundsAtTime(nodeIndex, motionStep, motionStepFraction)
+                .IsHitBy(ray, inverseRayDirection, minRayParam, currentMaxRayParam)
+            : node.Bounds.IsHitBy(ray, inverseRayDirection, minRayParam, currentMaxRayParam);
+
+        if (!isNodeHit)
+            continue;
+
+        if (node.IsLeaf())
+        {
+            primitiveTestCount += node.PrimitiveCount;
+
+            for (size_t i = node.FirstIndex; i < node.FirstIndex + node.PrimitiveCount; i++)
+            {
+                const size_t bodyIndex = m_BodyIndices[i];
+
+                if (std::optional<RayHit> rayHit = bodies[bodyIndex].RayTarget->TryHit(ray, minRayParam, currentMaxRayParam))
+                {
+                    currentMaxRayParam = rayHit->RayParam;
+                    result             = BodyHit{std::move(*rayHit), bodyIndex};
+                }
+            }
+
+            continue;
+        }
+
+        // Visit the child nearer along the split axis first, so that farther subtrees get culled more often
+        const bool          isDirectionNegative = ray.Direction[node.SplitAxis] < 0.0f;
+        const std::uint32_t leftChildIndex      = nodeIndex + 1;
+        const std::uint32_t rightChildIndex     = node.FirstIndex;
+
+        assert(nodeIndexStackSize + 2 <= nodeIndexStack.size());
+        nodeIndexStack[nodeIndexStackSize++] = isDirectionNegative ? leftChildIndex  : rightChildIndex;
+        nodeIndexStack[nodeIndexStackSize++] = isDirectionNegative ? rightChildIndex : leftChildIndex;
+    }
+
+    if (pTestCounts != nullptr)
+    {
+        pTestCounts->NodeTests      += nodeTestCount;
+        pTestCounts->PrimitiveTests += primitiveTestCount;
+    }
+
+    return result;
+}
+
+static inline FloatInterval MultiplyIntervals(const FloatInterval & interval0, const FloatInterval & interval1);
+
+void Bvh::HitPacket(
+    const std::vector<Body> & bodies,
+    const RayPacket &         packet,
+    const float               minRayParam,
+    RayPacketHits &           hits,
+    TestCounts * const        pTestCounts
+) const
+{
+    if (m_Nodes.empty())
+        return;
+
+    const std::array<const FloatPacket *, 3> origins{&packet.OriginX, &packet.OriginY, &packet.OriginZ};
+
+    const std::array<FloatPacket, 3> inverseDirections{
+        packet.DirectionX.inverse(),
+        packet.DirectionY.inverse(),
+        packet.DirectionZ.inverse()
+    };
+
+    // Interval culling is only conservative if directions of all rays have the same (non-zero) sign along each axis
+
+    bool isIntervalCullingApplicable = true;
+
+    std::array<FloatInterval, 3> originIntervals;
+    std::array<FloatInterval, 3> inverseDirectionIntervals;
+    std::array<bool, 3>          areDirectionsNegative;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        originIntervals[axis]           = FloatInterval{origins[axis]->minCoeff(), origins[axis]->maxCoeff()};
+        inverseDirectionIntervals[axis] = FloatInterval{inverseDirections[axis].minCoeff(), inverseDirections[axis].maxCoeff()};
+        areDirectionsNegative[axis]     = inverseDirectionIntervals[axis].Max < 0.0f;
+
+        isIntervalCullingApplicable &=
+            (areDirectionsNegative[axis] || inverseDirectionIntervals[axis].Min > 0.0f) &&
+            std::isfinite(inverseDirectionIntervals[axis].Min) && std::isfinite(inverseDirectionIntervals[axis].Max);
+    }
+
+    const auto isPacketMissingBox = [&](const BoundingBox & box, const float maxRayParam) {
+        float entryParamLowerBound = minRayParam;
+        float exitParamUpperBound  = maxRayParam;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float entryPlane = areDirectionsNegative[axis] ? box.Max[axis] : box.Min[axis];
+            const float exitPlane  = areDirectionsNegative[axis] ? box.Min[axis] : box.Max[axis];
+
+            const FloatInterval & originInterval = originIntervals[axis];
+
+            const FloatInterval entryParams = MultiplyIntervals(
+                FloatInterval{entryPlane - originInterval.Max, entryPlane - originInterval.Min},
+                inverseDirectionIntervals[axis]
+            );
+            const FloatInterval exitParams = MultiplyIntervals(
+                FloatInterval{exitPlane - originInterval.Max, exitPlane - originInterval.Min},
+                inverseDirectionIntervals[axis]
+            );
+
+            entryParamLowerBound = std::max(entryParamLowerBound, entryParams.Min);
+            exitParamUpperBound  = std::min(exitParamUpperBound,  exitParams.Max);
+        }
+
+        return entryParamLowerBound > exitParamUpperBound;
+    };
+
+    const auto getRaysHittingBox = [&](const BoundingBox & box) {
+        FloatPacket entryParams = FloatPacket::Constant(minRayParam);
+        FloatPacket exitParams  = hits.RayParams;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const FloatPacket params0 = (box.Min[axis] - *origins[axis])*inverseDirections[axis];
+            const FloatPacket params1 = (box.Max[axis] - *origins[axis])*inverseDirections[axis];
+
+            entryParams = entryParams.max(params0.min(params1));
+            exitParams  = exitParams.min(params0.max(params1));
+        }
+
+        return MaskPacket(entryParams <= exitParams);
+    };
+
+    // Rays of a packet sample different times, so each of them is tested against the node's bounds at its own time;
+    // culling the whole packet wouldn't save much, as the packet's bounds are the union of all of those
+
+    const bool hasMotion = HasMotion();
+
+    std::array<size_t, RAY_PACKET_SIZE> motionSteps{};
+    std::array<float, RAY_PACKET_SIZE>  motionStepFractions{};
+
+    if (hasMotion)
+    {
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+            motionSteps[i] = FindMotionStep(packet.Times[i], motionStepFractions[i]);
+    }
+
+    const auto getRaysHittingMovingNode = [&](const size_t nodeIndex) {
+        std::array<FloatPacket, 3> boxMins;
+        std::array<FloatPacket, 3> boxMaxs;
+
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            const BoundingBox box = getNodeBoundsAtTime(nodeIndex, motionSteps[i], motionStepFractions[i]);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                boxMins[axis][i] = box.Min[axis];
+                boxMaxs[axis][i] = box.Max[axis];
+            }
+        }
+
+        FloatPacket entryParams = FloatPacket::Constant(minRayParam);
+        FloatPacket exitParams  = hits.RayParams;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const FloatPacket params0 = (boxMins[axis] - *origins[axis])*inverseDirections[axis];
+            const FloatPacket params1 = (boxMaxs[axis] - *origins[axis])*inverseDirections[axis];
+
+            entryParams = entryParams.max(params0.min(params1));
+            exitParams  = exitParams.min(params0.max(params1));
+        }
+
+        return MaskPacket(entryParams <= exitParams);
+    };
+
+    std::array<std::uint32_t, BVH_MAX_DEPTH> nodeIndexStack;
+    size_t                                   nodeIndexStackSize = 0;
+
+    std::uint64_t nodeTestCount      = 0;
+    std::uint64_t primitiveTestCount = 0;
+
+    nodeIndexStack[nodeIndexStackSize++] = 0;
+    while (nodeIndexStackSize > 0)
+    {
+        const std::uint32_t nodeIndex = nodeIndexStack[--nodeIndexStackSize];
+        const Node &        node      = m_Nodes[nodeIndex];
+
+        nodeTestCount++;
+
+        if (hasMotion)
+        {
+            if (!getRaysHittingMovingNode(nodeIndex).any())
+                continue;
+        }
+        else
+        {
+            if (isIntervalCullingApplicable && isPacketMissingBox(node.Bounds, hits.RayParams.maxCoeff()))
+                continue;
+
+            if (!getRaysHittingBox(node.Bounds).any())
+                continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            primitiveTestCount += node.PrimitiveCount;
+
+            for (size_t i = node.FirstIndex; i < node.FirstIndex + node.PrimitiveCount; i++)
+            {
+                const int        bodyIndex = static_cast<int>(m_BodyIndices[i]);
+                const MaskPacket hitMask   = bodies[bodyIndex].RayTarget->TryHitPacket(packet, minRayParam, hits.RayParams);
+
+                hits.BodyIndices = hitMask.select(IntPacket::Constant(bodyIndex), hits.BodyIndices);
+            }
+
+            continue;
+        }
+
+        // Rays in a packet are assumed to be coherent, so the first one decides traversal order
+        const bool          isDirectionNegative = packet.GetRay(0).Direction[node.SplitAxis] < 0.0f;
+        const std::uint32_t leftChildIndex      = nodeIndex + 1;
+        const std::uint32_t rightChildIndex     = node.FirstIndex;
+
+        assert(nodeIndexStackSize + 2 <= nodeIndexStack.size());
+        nodeIndexStack[nodeIndexStackSize++] = isDirectionNegative ? leftChildIndex  : rightChildIndex;
+        nodeIndexStack[nodeIndexStackSize++] = isDirectionNegative ? rightChildIndex : leftChildIndex;
+    }
+
+    if (pTestCounts != nullptr)
+    {
+        pTestCounts->NodeTests      += nodeTestCount*RAY_PACKET_SIZE;
+        pTestCounts->PrimitiveTests += primitiveTestCount*RAY_PACKET_SIZE;
+    }
+}
+
+//
+// Service
+//
+
+void Bvh::refitNode(const std::vector<Body> & bodies, const size_t nodeIndex)
+{
+    Node & node = m_Nodes[nodeIndex];
+
+    if (HasMotion())
+    {
+        BoundingBox * const pStepBounds = &m_NodeStepBounds[nodeIndex*BVH_MOTION_STEP_BOUNDS_COUNT];
+
+        std::fill(pStepBounds, pStepBounds + BVH_MOTION_STEP_BOUNDS_COUNT, BoundingBox());
+
+        if (node.IsLeaf())
+        {
+            for (size_t i = node.FirstIndex; i < node.FirstIndex + node.PrimitiveCount; i++)
+                ExpandStepBounds(*bodies[m_BodyIndices[i]].RayTarget, pStepBounds);
+        }
+        else
+        {
+            const BoundingBox * const pLeftStepBounds  = &m_NodeStepBounds[(nodeIndex + 1)*BVH_MOTION_STEP_BOUNDS_COUNT];
+            const BoundingBox * const pRightStepBounds = &m_NodeStepBounds[node.FirstIndex*BVH_MOTION_STEP_BOUNDS_COUNT];
+
+            for (size_t step = 0; step < BVH_MOTION_STEP_BOUNDS_COUNT; step++)
+                pStepBounds[step] = UniteBoundingBoxes(pLeftStepBounds[step], pRightStepBounds[step]);
+        }
+
+        // Interpolated bounds lie within the ones they're interpolated between
+        BoundingBox bounds;
+        for (size_t step = 0; step < BVH_MOTION_STEP_BOUNDS_COUNT; step++)
+            bounds.Expand(pStepBounds[step]);
+
+        node.Bounds = bounds;
+    }
+    else if (node.IsLeaf())
+    {
+        BoundingBox bounds;
+        for (size_t i = node.FirstIndex; i < node.FirstIndex + node.PrimitiveCount; i++)
+        {
+            const std::optional<BoundingBox> boundingBox = bodies[m_BodyIndices[i]].RayTarget->TryGetBoundingBox();
+            assert(boundingBox.has_value());
+
+            bounds.Expand(*boundingBox);
+        }
+
+        node.Bounds = bounds;
+    }
+    else
+    {
+        node.Bounds = UniteBoundingBoxes(m_Nodes[nodeIndex + 1].Bounds, m_Nodes[node.FirstIndex].Bounds);
+    }
+}
+
+float Bvh::calculateSahCost() const
+{
+    if (m_Nodes.empty())
+        return 0.0f;
+
+    const float rootSurfaceArea = getNodeSurfaceArea(0);
+    if (rootSurfaceArea <= 0.0f)
+        return 0.0f;
+
+    float cost = 0.0f;
+    for (size_t i = 0; i < m_Nodes.size(); i++)
+    {
+        const Node & node = m_Nodes[i];
+
+        const float nodeCost = node.IsLeaf()
+            ? BVH_INTERSECTION_COST*static_cast<float>(node.PrimitiveCount)
+            : BVH_TRAVERSAL_COST;
+
+        cost += nodeCost*getNodeSurfaceArea(i);
+    }
+
+    return cost/rootSurfaceArea;
+}
+
+float Bvh::getNodeSurfaceArea(const size_t nodeIndex) const
+{
+    if (!HasMotion())
+        return m_Nodes[nodeIndex].Bounds.GetSurfaceArea();
+
+    // Rays are as likely to sample any time, so the area that matters is the average one over the interval
+    float surfaceAreaSum = 0.0f;
+    for (size_t step = 0; step < BVH_MOTION_STEP_BOUNDS_COUNT; step++)
+        surfaceAreaSum += m_NodeStepBounds[nodeIndex*BVH_MOTION_STEP_BOUNDS_COUNT + step].GetSurfaceArea();
+
+    return surfaceAreaSum/static_cast<float>(BVH_MOTION_STEP_BOUNDS_COUNT);
+}
+
+inline BoundingBox Bvh::getNodeBoundsAtTime(const size_t nodeIndex, const size_t motionStep, const float motionStepFraction) const
+{
+    const BoundingBox * const pStepBounds = &m_NodeStepBounds[nodeIndex*BVH_MOTION_STEP_BOUNDS_COUNT + motionStep];
+
+    return InterpolateBoundingBoxes(pStepBounds[0], pStepBounds[1], motionStepFraction);
+}
+
+static inline FloatInterval MultiplyIntervals(const FloatInterval & interval0, const FloatInterval & interval1)
+{
+    const float product0 = interval0.Min*interval1.Min;
+    const float product1 = interval0.Min*interval1.Max;
+    const float product2 = interval0.Max*interval1.Min;
+    const float product3 = interval0.Max*interval1.Max;
+
+    return FloatInterval{
+        std::min(std::min(product0, product1), std::min(product2, product3)),
+        std::max(std::max(product0, product1), std::max(product2, product3))
+    };
+}
+
+static inline SplitCandidate FindBestSplit(
+    const std::vector<BuildPrimitive> & primitives,
+    const size_t                        begin,
+    const size_t                        end,
+    const BoundingBox &                 centroidBounds
+)
+{
+    SplitCandidate bestSplit{INFINITY, -1, 0};
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float axisMin    = centroidBounds.Min[axis];
+        const float axisExtent = centroidBounds.Max[axis] - axisMin;
+        if (axisExtent <= 0.0f)
+            continue;
+
+        std::array<BoundingBox, BVH_BIN_COUNT> binBounds;
+        std::array<size_t, BVH_BIN_COUNT>      binCounts{};
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const float  relativePosition = (primitives[i].Centroid[axis] - axisMin)/axisExtent;
+            const size_t bin              = std::min(static_cast<size_t>(relativePosition*BVH_BIN_COUNT), BVH_BIN_COUNT - 1);
+
+            binBounds[bin].Expand(primitives[i].Bounds);
+            binCounts[bin]++;
+        }
+
+        // Sweep from the right to get surface areas of all possible right-hand sides
+        std::array<float, BVH_BIN_COUNT> rightCosts{};
+        BoundingBox                      rightBounds;
+        size_t                           rightCount = 0;
+        for (size_t bin = BVH_BIN_COUNT - 1; bin > 0; bin--)
+        {
+            rightBounds.Expand(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin] = rightBounds.GetSurfaceArea()*static_cast<float>(rightCount);
+        }
+
+        BoundingBox leftBounds;
+        size_t      leftCount = 0;
+        for (size_t bin = 0; bin < BVH_BIN_COUNT - 1; bin++)
+        {
+            leftBounds.Expand(binBounds[bin]);
+            leftCount += binCounts[bin];
+
+            const float cost = leftBounds.GetSurfaceArea()*static_cast<float>(leftCount) + rightCosts[bin + 1];
+            if (cost < bestSplit.Cost)
+                bestSplit = SplitCandidate{cost, axis, bin};
+        }
+    }
+
+    return bestSplit;
+}
+
+static size_t GetMedianSplitDepth(size_t primitiveCount)
+{
+    size_t depth = 0;
+    for (; primitiveCount > BVH_MAX_LEAF_NODE_PRIMITIVE_COUNT; depth++)
+        primitiveCount = (primitiveCount + 1)/2;
+
+    return depth;
+}
+
+static void BuildNode(BuildState & state, const size_t nodeIndex, const size_t begin, const size_t end, const size_t depth)
+{
+    assert(begin < end);
+
+    if (state.NodeIndicesByDepth.size() <= depth)
+        state.NodeIndicesByDepth.resize(depth + 1);
+
+    state.NodeIndicesByDepth[depth].push_back(static_cast<std::uint32_t>(nodeIndex));
+
+    BoundingBox bounds;
+    BoundingBox centroidBounds;
+    for (size_t i = begin; i < end; i++)
+    {
+        bounds.Expand(state.Primitives[i].Bounds);
+        centroidBounds.Expand(state.Primitives[i].Centroid);
+    }
+
+    const size_t primitiveCount = end - begin;
+
+    const auto makeLeaf = [&]() {
+        Bvh::Node & node    = state.Nodes[nodeIndex];
+        node.Bounds         = bounds;
+        node.FirstIndex     = static_cast<std::uint32_t>(begin);
+        node.PrimitiveCount = static_cast<std::uint16_t>(primitiveCount);
+        node.SplitAxis      = 0;
+    };
+
+    // Median splits are forced early enough for the depth limit to only be reached by primitives that fit into a leaf
+    const bool isMedianSplitForced = primitiveCount > BVH_MAX_LEAF_NODE_PRIMITIVE_COUNT
+        && depth + 2 + GetMedianSplitDepth(primitiveCount) >= BVH_MAX_DEPTH;
+
+    if (primitiveCount <= BVH_MIN_LEAF_PRIMITIVE_COUNT || depth + 2 >= BVH_MAX_DEPTH)
+    {
+        assert(primitiveCount <= BVH_MAX_LEAF_NODE_PRIMITIVE_COUNT);
+
+        makeLeaf();
+        return;
+    }
+
+    // Primitives all at one point have bounds without area to weigh splits by, and no split would separate them anyway
+    const float surfaceArea = bounds.GetSurfaceArea();
+    if (!(surfaceArea > 0.0f) && primitiveCount <= BVH_MAX_LEAF_NODE_PRIMITIVE_COUNT)
+    {
+        makeLeaf();
+        return;
+    }
+
+    const SplitCandidate bestSplit = isMedianSplitForced || !(surfaceArea > 0.0f)
+        ? SplitCandidate{INFINITY, -1, 0}
+        : FindBestSplit(state.Primitives, begin, end, centroidBounds);
+
+    const float leafCost  = BVH_INTERSECTION_COST*static_cast<float>(primitiveCount);
+    const float splitCost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST*bestSplit.Cost/surfaceArea;
+
+    if (primitiveCount <= BVH_MAX_LEAF_PRIMITIVE_COUNT && (bestSplit.Axis < 0 || leafCost <= splitCost))
+    {
+        makeLeaf();
+        return;
+    }
+
+    const auto primitivesBegin = state.Primitives.begin() + begin;
+    const auto primitivesEnd   = state.Primitives.begin() + end;
+
+    auto primitivesMiddle = primitivesBegin;
+    int  splitAxis        = bestSplit.Axis;
+
+    if (bestSplit.Axis >= 0)
+    {
+        const float axisMin    = centroidBounds.Min[splitAxis];
+        const float axisExtent = centroidBounds.Max[splitAxis] - axisMin;
+
+        primitivesMiddle = std::partition(
+            primitivesBegin,
+            primitivesEnd,
+            [&](const BuildPrimitive & primitive) {
+                const float  relativePosition = (primitive.Centroid[splitAxis] - axisMin)/axisExtent;
+                const size_t bin              = std::min(static_cast<size_t>(relativePosition*BVH_BIN_COUNT), BVH_BIN_COUNT - 1);
+
+                return bin <= bestSplit.Bin;
+            }
+        );
+    }
+
+    // Fall back to a median split if all centroids coincide or binning failed to separate primitives
+    if (primitivesMiddle == primitivesBegin || primitivesMiddle == primitivesEnd)
+    {
+        const Vector3 centroidExtent = centroidBounds.Max - centroidBounds.Min;
+        centroidExtent.maxCoeff(&splitAxis);
+
+        primitivesMiddle = primitivesBegin + primitiveCount/2;
+        std::nth_element(
+            primitivesBegin,
+            primitivesMiddle,
+            primitivesEnd,
+            [splitAxis](const BuildPrimitive & primitive0, const BuildPrimitive & primitive1) {
+                return primitive0.Centroid[splitAxis] < primitive1.Centroid[splitAxis];
+            }
+        );
+    }
+
+    const size_t middle = primitivesMiddle - state.Primitives.begin();
+
+    const size_t leftChildIndex = state.Nodes.size();
+    assert(leftChildIndex == nodeIndex + 1);
+    state.Nodes.emplace_back();
+    BuildNode(state, leftChildIndex, begin, middle, depth + 1);
+
+    const size_t rightChildIndex = state.Nodes.size();
+    state.Nodes.emplace_back();
+    BuildNode(state, rightChildIndex, middle, end, depth + 1);
+
+    Bvh::Node & node    = state.Nodes[nodeIndex];
+    node.Bounds         = bounds;
+    node.FirstIndex     = static_cast<std::uint32_t>(rightChildIndex);
+    node.PrimitiveCount = 0;
+    node.SplitAxis      = static_cast<std::uint8_t>(splitAxis);
+}
+
+static inline size_t FindMotionStep(const float time, float & stepFraction)
+{
+    const float  stepPosition = std::clamp(time, 0.0f, 1.0f)*static_cast<float>(BVH_MOTION_STEP_COUNT);
+    const size_t step         = std::min(static_cast<size_t>(stepPosition), BVH_MOTION_STEP_COUNT - 1);
+
+    stepFraction = stepPosition - static_cast<float>(step);
+
+    return step;
+}
+
+static void ExpandStepBounds(const IRayTarget & target, BoundingBox * const pStepBounds)
+{
+    for (size_t step = 0; step < BVH_MOTION_STEP_COUNT; step++)
+    {
+        const float startTime = static_cast<float>(step)/static_cast<float>(BVH_MOTION_STEP_COUNT);
+        const float endTime   = static_cast<float>(step + 1)/static_cast<float>(BVH_MOTION_STEP_COUNT);
+
+        const std::optional<MotionBoundingBox> motionBoundingBox = target.TryGetMotionBoundingBox(startTime, endTime);
+        if (!motionBoundingBox.has_value())
+        {
+            // Static targets are where they are at every step
+            const std::optional<BoundingBox> boundingBox = target.TryGetBoundingBox();
+            assert(boundingBox.has_value());
+
+            for (size_t i = 0; i < BVH_MOTION_STEP_BOUNDS_COUNT; i++)
+                pStepBounds[i].Expand(*boundingBox);
+
+            return;
+        }
+
+        pStepBounds[step].Expand(motionBoundingBox->Start);
+        pStepBounds[step + 1].Expand(motionBoundingBox->End);
+    }
+}
+
+} // namespace rtwe
@@ -0,0 +1,210 @@
+#ifndef RTWE_BVH_H
+#define RTWE_BVH_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "types.h"
+#include "BoundingBox.h"
+#include "RayPacket.h"
+#include "tracing.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class ThreadPool;
+
+//
+//
+//
+
+/**
+ * @brief Bounding volume hierarchy over the bounded bodies of a scene, built with binned SAH.
+ *
+ * Nodes are stored in depth-first order, so the left child of an inner node
+ * immediately follows it. The hierarchy references bodies by index and does not own them.
+ *
+ * If bodies move over the shutter interval, nodes also get bounds at evenly spaced steps of it, which traversals interpolate
+ * between at each ray's time. Bounds of fast moving bodies then stay about as tight as those of static ones, even along
+ * curved paths, rather than stretching along whole paths and overlapping each other, as bounds over the interval would.
+ */
+class Bvh final
+{
+public: // Types
+
+    struct Node final
+    {
+        BoundingBox   Bounds;         // Over the whole shutter interval, if bodies move
+        std::uint32_t FirstIndex;     // Right child index for inner nodes, first primitive index for leaves
+        std::uint16_t PrimitiveCount; // Zero for inner nodes
+        std::uint8_t  SplitAxis;
+
+        inline bool IsLeaf() const;
+    };
+
+    /**
+     * @brief Tests made by traversals, summed over the rays of a packet.
+     */
+    struct TestCounts final
+    {
+        std::uint64_t NodeTests;
+        std::uint64_t PrimitiveTests;
+    };
+
+public: // Construction
+
+    Bvh();
+
+    /**
+     * @param bodyIndices             Indices of bodies to include; all of them must have bounds.
+     * @param interpolateMotionBounds Whether nodes should follow moving bodies over the shutter interval,
+     *                                rather than bound all of their paths (only worth disabling for comparison).
+     *                                Bodies are only known to move if they do when the hierarchy is built.
+     */
+    Bvh(const std::vector<Body> & bodies, const std::vector<size_t> & bodyIndices, const bool interpolateMotionBounds = true);
+
+public: // Interface
+
+    /**
+     * @brief Recomputes node bounds bottom-up after bodies have moved, keeping the topology intact.
+     *
+     * Nodes of each depth level are refitted in parallel, deepest level first.
+     */
+    void Refit(const std::vector<Body> & bodies, ThreadPool & threadPool);
+
+    /**
+     * @param pTestCounts If not nullptr, node and primitive tests get added to it, which is only done when they are needed
+     *                    (sampled statistics, cost heatmaps).
+     */
+    std::optional<BodyHit> TryHit(
+        const std::vector<Body> & bodies,
+        const Ray &               ray,
+        const float               minRayParam,
+        const float               maxRayParam,
+        TestCounts * const        pTestCounts = nullptr
+    ) const;
+
+    /**
+     * @brief Traverses the hierarchy with a whole packet of rays, updating hits which are closer than the ones already found.
+     *
+     * Nodes are culled for the entire packet at once using interval arithmetic
+     * over the packet's origins and directions, before per-ray box tests.
+     */
+    void HitPacket(
+        const std::vector<Body> & bodies,
+        const RayPacket &         packet,
+        const float               minRayParam,
+        RayPacketHits &           hits,
+        TestCounts * const        pTestCounts = nullptr
+    ) const;
+
+    inline bool IsEmpty() const;
+
+    /**
+     * @return Bounds of the root node over the whole shutter interval, or an empty box if there are no nodes.
+     */
+    inline BoundingBox GetBounds() const;
+
+    inline bool HasMotion() const;
+
+    inline const std::vector<Node> & GetNodes() const;
+
+    inline const std::vector<std::uint32_t> & GetBodyIndices() const;
+
+    /**
+     * @return Expected cost of tracing a ray through the hierarchy, relative to the root surface area.
+     */
+    inline float GetSahCost() const;
+
+    /**
+     * @return Ratio of the current SAH cost to the one right after the build (1.0f for a fresh hierarchy).
+     */
+    inline float GetSahCostDegradation() const;
+
+private: // Service
+
+    void refitNode(const std::vector<Body> & bodies, const size_t nodeIndex);
+
+    float calculateSahCost() const;
+
+    /**
+     * @return Surface area averaged over the steps of the shutter interval, if bodies move.
+     */
+    float getNodeSurfaceArea(const size_t nodeIndex) const;
+
+    /**
+     * @param motionStep Step of the shutter interval, as found for the time, along with how far into the step it is.
+     */
+    inline BoundingBox getNodeBoundsAtTime(const size_t nodeIndex, const size_t motionStep, const float motionStepFraction) const;
+
+private: // Members
+
+    std::vector<Node>                       m_Nodes;
+    std::vector<BoundingBox>                m_NodeStepBounds; // At steps of the shutter interval per node; empty unless bodies move
+    std::vector<std::uint32_t>              m_BodyIndices;
+    std::vector<std::vector<std::uint32_t>> m_NodeIndicesByDepth;
+
+    float m_BuildSahCost;
+    float m_SahCost;
+};
+
+//
+// Node
+//
+
+inline bool Bvh::Node::IsLeaf() const
+{
+    return PrimitiveCount > 0;
+}
+
+//
+// Interface
+//
+
+inline bool Bvh::IsEmpty() const
+{
+    return m_Nodes.empty();
+}
+
+inline BoundingBox Bvh::GetBounds() const
+{
+    return m_Nodes.empty()
+        ? BoundingBox()
+        : m_Nodes.front().Bounds;
+}
+
+inline bool Bvh::HasMotion() const
+{
+    return !m_NodeStepBounds.empty();
+}
+
+inline const std::vector<Bvh::Node> & Bvh::GetNodes() const
+{
+    return m_Nodes;
+}
+
+inline const std::vector<std::uint32_t> & Bvh::GetBodyIndices() const
+{
+    return m_BodyIndices;
+}
+
+inline float Bvh::GetSahCost() const
+{
+    return m_SahCost;
+}
+
+inline float Bvh::GetSahCostDegradation() const
+{
+    return m_BuildSahCost > 0.0f
+        ? m_SahCost/m_BuildSahCost
+        : 1.0f;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_BVH_H
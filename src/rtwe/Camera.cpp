@@ -0,0 +1,81 @@
+#include "Camera.h"
+
+#include <algorithm>
+
+namespace rtwe
+{
+
+//
+// Interface
+//
+
+Ray Camera::CreateLensRay(
+    const float normalizedTargetX,
+    const float normalizedTargetY,
+    const float time,
+    const float lensValueX,
+    const float lensValueY
+) const
+{
+    const Ray centerRay = CreateRay(normalizedTargetX, normalizedTargetY, time);
+    if (!HasAperture())
+        return centerRay;
+
+    const std::pair<float, float> lensPoint  = SampleConcentricDisk(lensValueX, lensValueY);
+    const Vector3                 lensOffset = m_LensRight*lensPoint.first + m_LensUp*lensPoint.second;
+
+    return Ray(
+        centerRay.Origin + lensOffset,
+        centerRay.Direction - lensOffset,
+        time
+    );
+}
+
+void Camera::CreateImageRays(
+    const int                imageWidth,
+    const int                imageHeight,
+    const CameraRaySamples & samples,
+    std::vector<Ray> &       rays
+) const
+{
+    // Image y points down, from normalized target y of 1 at the top edge
+    const Vector3 pixelCornerDirection = m_FocusCornerDirection + m_FocusUp;
+    const Vector3 pixelRight           = m_FocusRight/static_cast<float>(imageWidth);
+    const Vector3 pixelDown            = -m_FocusUp/static_cast<float>(imageHeight);
+
+    const size_t count = samples.GetCount();
+
+    rays.resize(count);
+    for (size_t first = 0; first < count; first += RAY_PACKET_SIZE)
+    {
+        const int packetSize = static_cast<int>(std::min(count - first, static_cast<size_t>(RAY_PACKET_SIZE)));
+
+        // Lanes past the end of the last packet are created from zeros, then dropped
+        const auto loadPacket = [first, packetSize](const std::vector<float> & values) {
+            if (packetSize == RAY_PACKET_SIZE)
+                return FloatPacket(FloatPacket::Map(values.data() + first));
+
+            FloatPacket packet = FloatPacket::Zero();
+            for (int i = 0; i < packetSize; i++)
+                packet[i] = values[first + i];
+
+            return packet;
+        };
+
+        const RayPacket packet = createRayPacket(
+            pixelCornerDirection,
+            pixelRight,
+            pixelDown,
+            loadPacket(samples.ImageXs),
+            loadPacket(samples.ImageYs),
+            loadPacket(samples.Times),
+            loadPacket(samples.LensValuesX),
+            loadPacket(samples.LensValuesY)
+        );
+
+        for (int i = 0; i < packetSize; i++)
+            rays[first + i] = packet.GetRay(i);
+    }
+}
+
+} // namespace rtwe
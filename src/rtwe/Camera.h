@@ -1,72 +1,416 @@
 #ifndef RTWE_CAMERA_H
 #define RTWE_CAMERA_H
 
+#include <cassert>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include "types.h"
 #include "Ray.h"
+#include "RayPacket.h"
+#include "sampling.h"
 
 namespace rtwe
 {
 
+//
+// Interface types
+//
+
+/**
+ * @brief Thin lens, which keeps only what's at the focus distance sharp; a zero aperture radius makes a pinhole camera.
+ */
+struct CameraLens final
+{
+    float ApertureRadius;
+    float FocusDistance; // Of the plane in focus, along the view direction, from the camera's origin
+};
+
+constexpr CameraLens PINHOLE_CAMERA_LENS{0.0f, 1.0f};
+
+/**
+ * @brief Position of a camera ray within an image and on the lens, with its time.
+ */
+struct CameraRaySample final
+{
+    float ImageX;     // In pixels, with a pixel's center at its integer coordinates
+    float ImageY;
+    float LensValueX; // In [0, 1), mapped onto the lens, which pinhole cameras ignore
+    float LensValueY;
+    float Time;
+};
+
+/**
+ * @brief Positions of camera rays within an image and on the lens, with their times, in SoA layout,
+ *        so that rays can be created a packet at a time.
+ */
+struct CameraRaySamples final
+{
+public: // Attributes
+
+    std::vector<float> ImageXs;     // In pixels, with a pixel's center at its integer coordinates
+    std::vector<float> ImageYs;
+    std::vector<float> LensValuesX; // In [0, 1), mapped onto the lens, which pinhole cameras ignore
+    std::vector<float> LensValuesY;
+    std::vector<float> Times;
+
+public: // Interface
+
+    inline size_t GetCount() const;
+
+    inline void Resize(const size_t count);
+
+    inline void Set(const size_t index, const CameraRaySample & sample);
+};
+
+//
+// Camera
+//
+
 class Camera final
 {
 public: // Construction
 
     inline Camera(
-        Vector3       origin,
-        Vector3       projectionCenter,
-        const Vector3 up,
-        const float   projectionWidth,
-        const float   projectionHeight
+        Vector3            origin,
+        Vector3            projectionCenter,
+        const Vector3      up,
+        const float        projectionWidth,
+        const float        projectionHeight,
+        const CameraLens & lens = PINHOLE_CAMERA_LENS
     );
 
 public: // Interface
 
-    inline Ray CreateRay(const float normalizedTargetX, const float normalizedTargetY) const;
+    /**
+     * @brief Creates the ray from the lens center, as of a pinhole camera, whatever the aperture.
+     *
+     * @param time Time within the shutter interval, which the camera itself doesn't move over.
+     */
+    inline Ray CreateRay(const float normalizedTargetX, const float normalizedTargetY, const float time = 0.0f) const;
+
+    /**
+     * @brief Creates the ray from the given point of the lens towards the point in focus along CreateRay()'s ray,
+     *        or just the latter without an aperture.
+     *
+     * @param lensValueX Along with lensValueY, a value in [0, 1) choosing the point of the lens.
+     */
+    Ray CreateLensRay(
+        const float normalizedTargetX,
+        const float normalizedTargetY,
+        const float time,
+        const float lensValueX,
+        const float lensValueY
+    ) const;
+
+    inline RayPacket CreateRayPacket(
+        const FloatPacket & normalizedTargetXs,
+        const FloatPacket & normalizedTargetYs,
+        const FloatPacket & times,
+        const FloatPacket & lensValuesX,
+        const FloatPacket & lensValuesY
+    ) const;
+
+    /**
+     * @brief Creates the ray through the sample's position in pixels of an image, like CreateImageRays() does for many.
+     */
+    inline Ray CreateImageRay(const int imageWidth, const int imageHeight, const CameraRaySample & sample) const;
+
+    /**
+     * @brief Creates rays through positions in pixels of an image, e.g. of all samples of a tile, a packet at a time.
+     *
+     * Directions advance by per-pixel increments, precomputed once per call, so that each takes two multiply-adds per component.
+     */
+    void CreateImageRays(
+        const int                imageWidth,
+        const int                imageHeight,
+        const CameraRaySamples & samples,
+        std::vector<Ray> &       rays
+    ) const;
+
+    /**
+     * @brief Inverse of CreateRay(): finds normalized target coordinates of the ray passing through the given point.
+     *
+     * Rays from the lens center are projected, so with an aperture, the point only appears there when in focus.
+     *
+     * @return Coordinates, which may lie outside of [0, 1] for points outside of the view,
+     *         or nothing for points behind the camera.
+     */
+    inline std::optional<std::pair<float, float>> TryProjectPoint(const Vector3 & point) const;
+
+    inline const Vector3 & GetOrigin() const;
+
+    inline bool HasAperture() const;
+
+private: // Service
+
+    /**
+     * @brief Ratio of the focus distance to the projection plane's, by which directions to the latter stretch to the former.
+     */
+    static inline float getFocusScale(const Vector3 & centerDirection, const CameraLens & lens);
+
+    /**
+     * @brief Creates rays towards points of the focus plane at the given corner plus multiples of the given increments.
+     */
+    inline RayPacket createRayPacket(
+        const Vector3 &     cornerDirection,
+        const Vector3 &     xIncrement,
+        const Vector3 &     yIncrement,
+        const FloatPacket & xs,
+        const FloatPacket & ys,
+        const FloatPacket & times,
+        const FloatPacket & lensValuesX,
+        const FloatPacket & lensValuesY
+    ) const;
 
 private: // Members
 
-    const Vector3 m_Origin;
-    const Vector3 m_ProjectionCenter;
-    const Vector3 m_ProjectionUp;
-    const Vector3 m_ProjectionRight;
+    Vector3 m_Origin;
+    Vector3 m_ProjectionCenter;
+    Vector3 m_ProjectionUp;
+    Vector3 m_ProjectionRight;
+
+    // Directions to the focus plane, which is the projection plane for pinhole cameras,
+    // so that a ray's direction only takes two multiply-adds per component
+    Vector3 m_FocusCornerDirection; // At normalized target coordinates (0, 0)
+    Vector3 m_FocusRight;           // From there to normalized target x of 1
+    Vector3 m_FocusUp;
+
+    float   m_ApertureRadius;
+    Vector3 m_LensRight; // Aperture radius long
+    Vector3 m_LensUp;
 };
 
+//
+// Utilities
+//
+
+/**
+ * @brief Samples a camera ray's position within the pixel, on the lens and within the shutter interval, in that order,
+ *        from the first dimensions of a pixel sample, which all integrators take this way so that samplers' dimensions line up.
+ *
+ * Lens dimensions are only taken with an aperture, and the time dimension only if time is sampled.
+ *
+ * @param isTimeSampled Whether the ray should sample a time within the shutter interval, which only matters if bodies move.
+ */
+inline CameraRaySample SampleCameraRay(
+    const Camera & camera,
+    const int      pixelX,
+    const int      pixelY,
+    const bool     isTimeSampled,
+    SampleStream & samples
+);
+
+//
+// CameraRaySamples
+//
+
+inline size_t CameraRaySamples::GetCount() const
+{
+    return ImageXs.size();
+}
+
+inline void CameraRaySamples::Resize(const size_t count)
+{
+    ImageXs.resize(count);
+    ImageYs.resize(count);
+    LensValuesX.resize(count);
+    LensValuesY.resize(count);
+    Times.resize(count);
+}
+
+inline void CameraRaySamples::Set(const size_t index, const CameraRaySample & sample)
+{
+    assert(index < GetCount());
+
+    ImageXs[index]     = sample.ImageX;
+    ImageYs[index]     = sample.ImageY;
+    LensValuesX[index] = sample.LensValueX;
+    LensValuesY[index] = sample.LensValueY;
+    Times[index]       = sample.Time;
+}
+
 //
 // Construction
 //
 
 inline Camera::Camera(
-    Vector3       origin,
-    Vector3       projectionCenter,
-    const Vector3 up,
-    const float   projectionWidth,
-    const float   projectionHeight
+    Vector3            origin,
+    Vector3            projectionCenter,
+    const Vector3      up,
+    const float        projectionWidth,
+    const float        projectionHeight,
+    const CameraLens & lens
 ):
-    m_Origin          (std::move(origin)),
-    m_ProjectionCenter(std::move(projectionCenter)),
-    m_ProjectionUp    (projectionHeight * up.normalized()),
-    m_ProjectionRight (projectionWidth  * up.cross(m_ProjectionCenter - m_Origin).normalized())
+    m_Origin              (std::move(origin)),
+    m_ProjectionCenter    (std::move(projectionCenter)),
+    m_ProjectionUp        (projectionHeight * up.normalized()),
+    m_ProjectionRight     (projectionWidth  * up.cross(m_ProjectionCenter - m_Origin).normalized()),
+    m_FocusCornerDirection(
+        getFocusScale(m_ProjectionCenter - m_Origin, lens)
+            * (m_ProjectionCenter - m_Origin - 0.5f*m_ProjectionRight - 0.5f*m_ProjectionUp)
+    ),
+    m_FocusRight          (getFocusScale(m_ProjectionCenter - m_Origin, lens) * m_ProjectionRight),
+    m_FocusUp             (getFocusScale(m_ProjectionCenter - m_Origin, lens) * m_ProjectionUp),
+    m_ApertureRadius      (lens.ApertureRadius),
+    m_LensRight           (lens.ApertureRadius * m_ProjectionRight.normalized()),
+    m_LensUp              (lens.ApertureRadius * m_ProjectionUp.normalized())
 {
-    // Empty
+    assert(lens.ApertureRadius >= 0.0f && lens.FocusDistance > 0.0f);
 }
 
 //
 // Interface
 //
 
-inline Ray Camera::CreateRay(const float normalizedTargetX, const float normalizedTargetY) const
+inline Ray Camera::CreateRay(const float normalizedTargetX, const float normalizedTargetY, const float time) const
 {
-    const Vector3 raytracingTarget =
-        m_ProjectionCenter + 
-        m_ProjectionRight * (normalizedTargetX - 0.5f) +
-        m_ProjectionUp    * (normalizedTargetY - 0.5f);
-
     return Ray(
         m_Origin,
-        raytracingTarget - m_Origin
+        m_FocusCornerDirection + m_FocusRight*normalizedTargetX + m_FocusUp*normalizedTargetY,
+        time
     );
 }
 
+inline Ray Camera::CreateImageRay(const int imageWidth, const int imageHeight, const CameraRaySample & sample) const
+{
+    return CreateLensRay(
+        sample.ImageX/static_cast<float>(imageWidth),
+        1.0f - sample.ImageY/static_cast<float>(imageHeight),
+        sample.Time,
+        sample.LensValueX,
+        sample.LensValueY
+    );
+}
+
+inline RayPacket Camera::CreateRayPacket(
+    const FloatPacket & normalizedTargetXs,
+    const FloatPacket & normalizedTargetYs,
+    const FloatPacket & times,
+    const FloatPacket & lensValuesX,
+    const FloatPacket & lensValuesY
+) const
+{
+    return createRayPacket(
+        m_FocusCornerDirection,
+        m_FocusRight,
+        m_FocusUp,
+        normalizedTargetXs,
+        normalizedTargetYs,
+        times,
+        lensValuesX,
+        lensValuesY
+    );
+}
+
+inline std::optional<std::pair<float, float>> Camera::TryProjectPoint(const Vector3 & point) const
+{
+    const Vector3 projectionNormal = m_ProjectionRight.cross(m_ProjectionUp);
+    const Vector3 pointDirection   = point - m_Origin;
+
+    const float directionDotNormal = pointDirection.dot(projectionNormal);
+    const float centerDotNormal    = (m_ProjectionCenter - m_Origin).dot(projectionNormal);
+
+    // The point must be on the same side of the origin as the projection plane
+    if (directionDotNormal*centerDotNormal <= 0.0f)
+        return std::nullopt;
+
+    const Vector3 offset = m_Origin + pointDirection*(centerDotNormal/directionDotNormal) - m_ProjectionCenter;
+
+    return std::make_pair(
+        offset.dot(m_ProjectionRight)/m_ProjectionRight.squaredNorm() + 0.5f,
+        offset.dot(m_ProjectionUp)/m_ProjectionUp.squaredNorm()       + 0.5f
+    );
+}
+
+inline const Vector3 & Camera::GetOrigin() const
+{
+    return m_Origin;
+}
+
+inline bool Camera::HasAperture() const
+{
+    return m_ApertureRadius > 0.0f;
+}
+
+//
+// Service
+//
+
+inline float Camera::getFocusScale(const Vector3 & centerDirection, const CameraLens & lens)
+{
+    // Pinhole cameras keep directions to the projection plane, as everything is in focus anyway
+    return lens.ApertureRadius > 0.0f ? lens.FocusDistance/centerDirection.norm() : 1.0f;
+}
+
+inline RayPacket Camera::createRayPacket(
+    const Vector3 &     cornerDirection,
+    const Vector3 &     xIncrement,
+    const Vector3 &     yIncrement,
+    const FloatPacket & xs,
+    const FloatPacket & ys,
+    const FloatPacket & times,
+    const FloatPacket & lensValuesX,
+    const FloatPacket & lensValuesY
+) const
+{
+    RayPacket packet;
+
+    packet.OriginX = FloatPacket::Constant(m_Origin.x());
+    packet.OriginY = FloatPacket::Constant(m_Origin.y());
+    packet.OriginZ = FloatPacket::Constant(m_Origin.z());
+
+    packet.DirectionX = cornerDirection.x() + xIncrement.x()*xs + yIncrement.x()*ys;
+    packet.DirectionY = cornerDirection.y() + xIncrement.y()*xs + yIncrement.y()*ys;
+    packet.DirectionZ = cornerDirection.z() + xIncrement.z()*xs + yIncrement.z()*ys;
+
+    packet.Times = times;
+
+    if (!HasAperture())
+        return packet;
+
+    const std::pair<FloatPacket, FloatPacket> lensPoints = SampleConcentricDisks(lensValuesX, lensValuesY);
+
+    const FloatPacket lensOffsetsX = m_LensRight.x()*lensPoints.first + m_LensUp.x()*lensPoints.second;
+    const FloatPacket lensOffsetsY = m_LensRight.y()*lensPoints.first + m_LensUp.y()*lensPoints.second;
+    const FloatPacket lensOffsetsZ = m_LensRight.z()*lensPoints.first + m_LensUp.z()*lensPoints.second;
+
+    packet.OriginX += lensOffsetsX;
+    packet.OriginY += lensOffsetsY;
+    packet.OriginZ += lensOffsetsZ;
+
+    packet.DirectionX -= lensOffsetsX;
+    packet.DirectionY -= lensOffsetsY;
+    packet.DirectionZ -= lensOffsetsZ;
+
+    return packet;
+}
+
+//
+// Utilities
+//
+
+inline CameraRaySample SampleCameraRay(
+    const Camera & camera,
+    const int      pixelX,
+    const int      pixelY,
+    const bool     isTimeSampled,
+    SampleStream & samples
+)
+{
+    CameraRaySample sample;
+
+    // Jittered around the pixel's center
+    sample.ImageX     = static_cast<float>(pixelX) + samples.GetNextValue() - 0.5f;
+    sample.ImageY     = static_cast<float>(pixelY) + samples.GetNextValue() - 0.5f;
+    sample.LensValueX = camera.HasAperture() ? samples.GetNextValue() : 0.5f;
+    sample.LensValueY = camera.HasAperture() ? samples.GetNextValue() : 0.5f;
+    sample.Time       = isTimeSampled        ? samples.GetNextValue() : 0.0f;
+
+    return sample;
+}
+
 } // namespace rtwe
 
 #endif // RTWE_CAMERA_H
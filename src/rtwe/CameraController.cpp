@@ -0,0 +1,132 @@
+#include "CameraController.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <SDL.h>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+const float CameraController::MOVE_SPEED        = 0.5f;
+const float CameraController::FAST_MOVE_FACTOR  = 4.0f;
+const float CameraController::MOUSE_SENSITIVITY = 0.003f;
+
+// Slightly less than straight up or down, where the camera's right direction would be undefined
+const float CameraController::MAX_PITCH = 1.5f;
+
+static const Vector3 WORLD_UP(0.0f, 1.0f, 0.0f);
+
+//
+// Construction
+//
+
+CameraController::CameraController(
+    Vector3            position,
+    const Vector3 &    forward,
+    const float        projectionWidth,
+    const float        projectionHeight,
+    const CameraLens & lens
+):
+    m_Position        (std::move(position)),
+    m_Yaw             (std::atan2(forward.x(), forward.z())),
+    m_Pitch           (std::clamp(std::asin(forward.normalized().y()), -MAX_PITCH, MAX_PITCH)),
+    m_ProjectionWidth (projectionWidth),
+    m_ProjectionHeight(projectionHeight),
+    m_Lens            (lens)
+{
+    assert(forward.squaredNorm() > 0.0f);
+}
+
+//
+// Interface
+//
+
+bool CameraController::Update(const float deltaSeconds)
+{
+    bool isChanged = false;
+
+    // Relative mouse state is reset by each call, so it's queried even if not dragging
+    int mouseDeltaX = 0;
+    int mouseDeltaY = 0;
+
+    const Uint32 mouseButtons = SDL_GetRelativeMouseState(&mouseDeltaX, &mouseDeltaY);
+
+    if ((mouseButtons & SDL_BUTTON_LMASK) != 0 && (mouseDeltaX != 0 || mouseDeltaY != 0))
+    {
+        m_Yaw  += MOUSE_SENSITIVITY*static_cast<float>(mouseDeltaX);
+        m_Pitch = std::clamp(m_Pitch - MOUSE_SENSITIVITY*static_cast<float>(mouseDeltaY), -MAX_PITCH, MAX_PITCH);
+
+        isChanged = true;
+    }
+
+    const Uint8 * const keyboardState = SDL_GetKeyboardState(nullptr);
+
+    // Moving forward and backward keeps the height, like walking
+    const Vector3 forward = Vector3(std::sin(m_Yaw), 0.0f, std::cos(m_Yaw));
+    const Vector3 right   = WORLD_UP.cross(forward);
+
+    Vector3 direction = Vector3::Zero();
+
+    if (keyboardState[SDL_SCANCODE_W])
+        direction += forward;
+    if (keyboardState[SDL_SCANCODE_S])
+        direction -= forward;
+    if (keyboardState[SDL_SCANCODE_D])
+        direction += right;
+    if (keyboardState[SDL_SCANCODE_A])
+        direction -= right;
+    if (keyboardState[SDL_SCANCODE_E])
+        direction += WORLD_UP;
+    if (keyboardState[SDL_SCANCODE_Q])
+        direction -= WORLD_UP;
+
+    if (direction.squaredNorm() > 0.0f)
+    {
+        const float speed = keyboardState[SDL_SCANCODE_LSHIFT] ? FAST_MOVE_FACTOR*MOVE_SPEED : MOVE_SPEED;
+
+        m_Position += direction.normalized()*(speed*deltaSeconds);
+
+        isChanged = true;
+    }
+
+    return isChanged;
+}
+
+Camera CameraController::CreateCamera() const
+{
+    const Vector3 forward = getForward();
+
+    // Camera's projection plane is only undistorted with an up direction orthogonal to the view direction
+    const Vector3 right = WORLD_UP.cross(forward).normalized();
+    const Vector3 up    = forward.cross(right);
+
+    return Camera(
+        m_Position,
+        m_Position + forward,
+        up,
+        m_ProjectionWidth,
+        m_ProjectionHeight,
+        m_Lens
+    );
+}
+
+//
+// Service
+//
+
+Vector3 CameraController::getForward() const
+{
+    return Vector3(
+        std::sin(m_Yaw)*std::cos(m_Pitch),
+        std::sin(m_Pitch),
+        std::cos(m_Yaw)*std::cos(m_Pitch)
+    );
+}
+
+} // namespace rtwe
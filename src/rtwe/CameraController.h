@@ -0,0 +1,62 @@
+#ifndef RTWE_CAMERA_CONTROLLER_H
+#define RTWE_CAMERA_CONTROLLER_H
+
+#include "types.h"
+#include "Camera.h"
+
+namespace rtwe
+{
+
+/**
+ * @brief Moves a camera around with WASD (Q/E for down/up, Shift to move faster) and turns it while dragging the mouse.
+ *
+ * Uses the same left-handed coordinate system as the scene, with y pointing up.
+ */
+class CameraController final
+{
+public: // Constants
+
+    static const float MOVE_SPEED;        // Units per second
+    static const float FAST_MOVE_FACTOR;
+    static const float MOUSE_SENSITIVITY; // Radians per pixel
+    static const float MAX_PITCH;
+
+public: // Construction
+
+    CameraController(
+        Vector3            position,
+        const Vector3 &    forward,
+        const float        projectionWidth,
+        const float        projectionHeight,
+        const CameraLens & lens = PINHOLE_CAMERA_LENS
+    );
+
+public: // Interface
+
+    /**
+     * @brief Applies keyboard and mouse state, which must have been pumped (e.g. by polling events) beforehand.
+     *
+     * @return Whether the camera moved or turned.
+     */
+    bool Update(const float deltaSeconds);
+
+    Camera CreateCamera() const;
+
+private: // Service
+
+    Vector3 getForward() const;
+
+private: // Members
+
+    Vector3 m_Position;
+    float   m_Yaw;
+    float   m_Pitch;
+
+    const float      m_ProjectionWidth;
+    const float      m_ProjectionHeight;
+    const CameraLens m_Lens;
+};
+
+} // namespace rtwe
+
+#endif // RTWE_CAMERA_CONTROLLER_H
@@ -0,0 +1,20 @@
+#ifndef RTWE_IMAGE_RECT_H
+#define RTWE_IMAGE_RECT_H
+
+namespace rtwe
+{
+
+/**
+ * @brief Rectangle of pixels within an image, e.g. a tile.
+ */
+struct ImageRect final
+{
+    int X;
+    int Y;
+    int Width;
+    int Height;
+};
+
+} // namespace rtwe
+
+#endif // RTWE_IMAGE_RECT_H
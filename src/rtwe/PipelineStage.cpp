@@ -0,0 +1,98 @@
+#include "PipelineStage.h"
+
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Construction
+//
+
+PipelineStage::PipelineStage(FrameFunction function, const char * const threadName):
+    m_Function      (std::move(function)),
+    m_IsRunningFrame(false),
+    m_IsStopping    (false)
+{
+    if (threadName != nullptr)
+        m_Thread = std::thread(&PipelineStage::stageLoop, this, threadName);
+}
+
+PipelineStage::~PipelineStage()
+{
+    if (!m_Thread.joinable())
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_FrameChangedCondition.notify_all();
+    m_Thread.join();
+}
+
+//
+// Interface
+//
+
+void PipelineStage::Start(const long frameIndex)
+{
+    if (!m_Thread.joinable())
+    {
+        m_Function(frameIndex);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+
+        m_FrameChangedCondition.wait(lock, [this]() { return isIdle(); });
+        m_PendingFrameIndex = frameIndex;
+    }
+
+    m_FrameChangedCondition.notify_all();
+}
+
+void PipelineStage::Wait()
+{
+    if (!m_Thread.joinable())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    m_FrameChangedCondition.wait(lock, [this]() { return isIdle(); });
+}
+
+//
+// Service
+//
+
+void PipelineStage::stageLoop(const char * const threadName)
+{
+    NameTimelineThread(threadName);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        m_FrameChangedCondition.wait(lock, [this]() { return m_PendingFrameIndex.has_value() || m_IsStopping; });
+
+        // Stopping only once the pending frame is done, as the caller handed it over expecting it to be
+        if (!m_PendingFrameIndex.has_value())
+            return;
+
+        const long frameIndex = *m_PendingFrameIndex;
+        m_PendingFrameIndex.reset();
+        m_IsRunningFrame = true;
+
+        lock.unlock();
+        m_Function(frameIndex);
+        lock.lock();
+
+        m_IsRunningFrame = false;
+        m_FrameChangedCondition.notify_all();
+    }
+}
+
+} // namespace rtwe
@@ -0,0 +1,92 @@
+#ifndef RTWE_PIPELINE_STAGE_H
+#define RTWE_PIPELINE_STAGE_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace rtwe
+{
+
+/**
+ * @brief Stage of a pipeline of frames, run on a thread of its own for the lifetime of the pipeline,
+ * which takes one frame at a time while the caller goes on with other stages of other frames.
+ *
+ * Holds at most one frame, so that the caller blocks handing over the next one until the stage is done with the last one,
+ * and frames go through the stage one at a time, in the order they're handed over. A stage without a thread runs each frame
+ * on the calling thread as it's handed over, so that the same pipeline can run its stages one after another.
+ */
+class PipelineStage final
+{
+public: // Types
+
+    using FrameFunction = std::function<void(long)>;
+
+public: // Construction
+
+    /**
+     * @param threadName Name of the stage's thread on the timeline, or nullptr for a stage without a thread.
+     */
+    PipelineStage(FrameFunction function, const char * const threadName);
+
+    /**
+     * @brief Waits for the stage to be done with the frame it holds, if any.
+     */
+    ~PipelineStage();
+
+public: // Deleted
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage(PipelineStage&&)      = delete;
+
+    PipelineStage& operator=(const PipelineStage&) = delete;
+    PipelineStage& operator=(PipelineStage&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Waits for the stage to be done with the previous frame, then hands the frame over and returns right away.
+     */
+    void Start(const long frameIndex);
+
+    /**
+     * @brief Waits for the stage to be done with the last frame handed over.
+     */
+    void Wait();
+
+private: // Service
+
+    void stageLoop(const char * const threadName);
+
+    /**
+     * @brief Whether the stage holds no frame; must be called with the mutex locked.
+     */
+    inline bool isIdle() const;
+
+private: // Members
+
+    const FrameFunction m_Function;
+
+    std::mutex              m_Mutex;
+    std::condition_variable m_FrameChangedCondition;
+    std::optional<long>     m_PendingFrameIndex;
+    bool                    m_IsRunningFrame;
+    bool                    m_IsStopping;
+
+    std::thread m_Thread;
+};
+
+//
+// Service
+//
+
+inline bool PipelineStage::isIdle() const
+{
+    return !m_PendingFrameIndex.has_value() && !m_IsRunningFrame;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_PIPELINE_STAGE_H
@@ -0,0 +1,572 @@
+#include "ProgressiveRenderer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "constants.h"
+#include "stats.h"
+#include "timeline.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+const int ProgressiveRenderer::TILE_SIZE = 64;
+
+// Must divide TILE_SIZE, so that each tile maps onto whole preview pixels
+const std::array<int, 2> ProgressiveRenderer::PREVIEW_BLOCK_SIZES{4, 2};
+
+// Reprojected pixels are weighted as if they had at most this many samples, so that view-dependent shading
+// (reflections, refractions), which reprojection knows nothing about, gets replaced by new samples reasonably soon
+const float ProgressiveRenderer::MAX_REPROJECTED_SAMPLE_COUNT = 16.0f;
+
+// Of the distance from the camera for hit points, or absolute for directions of rays which missed;
+// loose enough for the up to half a pixel of misalignment on surfaces seen at grazing angles
+const float ProgressiveRenderer::REPROJECTION_RELATIVE_TOLERANCE = 0.02f;
+
+// Below this, it's better to show a preview than a mostly black image
+const float ProgressiveRenderer::MIN_REPROJECTED_PIXEL_FRACTION = 0.5f;
+
+const size_t ProgressiveRenderer::NO_BODY_INDEX = std::numeric_limits<size_t>::max();
+
+//
+// Construction
+//
+
+ProgressiveRenderer::ProgressiveRenderer(
+    const Scene &         scene,
+    Camera                camera,
+    const ISampler &      sampler,
+    RayMissFunction       rayMissFunction,
+    const IIntegrator &   integrator,
+    ThreadPool &          threadPool,
+    const int             imageWidth,
+    const int             imageHeight,
+    const RenderOptions & options
+):
+    m_Scene               (scene),
+    m_Sampler             (sampler),
+    m_RayMissFunction     (std::move(rayMissFunction)),
+    m_Integrator          (integrator),
+    m_ThreadPool          (threadPool),
+    m_Options             (options),
+    m_Tiles               (createTiles(imageWidth, imageHeight)),
+    m_Camera              (camera),
+    m_PendingCamera       (std::move(camera)),
+    m_IsCameraChanged     (false),
+    m_AccumulationBuffer  (std::make_unique<AccumulationBuffer>(imageWidth, imageHeight)),
+    m_ReprojectionBuffer  (options.ReprojectHistory ? std::make_unique<AccumulationBuffer>(imageWidth, imageHeight) : nullptr),
+    m_FirstHits           (options.ReprojectHistory ? static_cast<size_t>(imageWidth)*imageHeight : 0),
+    m_NextFirstHits       (m_FirstHits.size()),
+    m_AreFirstHitsValid   (false),
+    m_ArePreviewsPending  (options.RenderPreviews),
+    m_BackImage           (static_cast<size_t>(imageWidth)*imageHeight, 0u),
+    m_IsTileUpdated       (m_Tiles.size(), false),
+    m_IsStopping          (false),
+    m_CompletedPassCount  (0)
+{
+    assert(imageWidth > 0 && imageHeight > 0);
+
+    if (!options.RenderPreviews)
+        return;
+
+    for (const int blockSize : PREVIEW_BLOCK_SIZES)
+    {
+        assert(TILE_SIZE%blockSize == 0);
+
+        m_PreviewBuffers.push_back(
+            std::make_unique<AccumulationBuffer>(
+                (imageWidth  + blockSize - 1)/blockSize,
+                (imageHeight + blockSize - 1)/blockSize
+            )
+        );
+    }
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    Stop();
+}
+
+//
+// Interface
+//
+
+void ProgressiveRenderer::Start()
+{
+    assert(!m_RenderThread.joinable() && "Start() must not be called twice");
+
+    m_IsStopping.store(false, std::memory_order_relaxed);
+    m_RenderThread = std::thread(&ProgressiveRenderer::renderLoop, this);
+}
+
+void ProgressiveRenderer::Stop()
+{
+    if (!m_RenderThread.joinable())
+        return;
+
+    m_IsStopping.store(true, std::memory_order_relaxed);
+    m_RenderThread.join();
+}
+
+void ProgressiveRenderer::RenderPasses(const long passCount)
+{
+    assert(!m_RenderThread.joinable() && "RenderPasses() must not be called while the render thread is running");
+
+    for (long i = 0; i < passCount; i++)
+    {
+        if (m_IsCameraChanged.load(std::memory_order_relaxed))
+            applyCameraChange();
+
+        renderPass();
+    }
+}
+
+std::vector<PixelCost> ProgressiveRenderer::RenderPixelCosts(const int sampleCount)
+{
+    assert(!m_RenderThread.joinable() && "RenderPixelCosts() must not be called while the render thread is running");
+
+    if (m_IsCameraChanged.load(std::memory_order_relaxed))
+        applyCameraChange();
+
+    return rtwe::RenderPixelCosts(
+        m_Scene,
+        m_Camera,
+        m_Sampler,
+        m_RayMissFunction,
+        m_ThreadPool,
+        GetImageWidth(),
+        GetImageHeight(),
+        sampleCount
+    );
+}
+
+void ProgressiveRenderer::RestoreAccumulation(
+    const std::vector<Vector3> & pixelRgbs,
+    const std::vector<float> &   sampleCounts,
+    const long                   completedPassCount
+)
+{
+    assert(!m_RenderThread.joinable() && "RestoreAccumulation() must not be called while the render thread is running");
+
+    if (m_IsCameraChanged.load(std::memory_order_relaxed))
+        applyCameraChange();
+
+    m_AccumulationBuffer->CopyFrom(pixelRgbs, sampleCounts);
+
+    m_ThreadPool.ParallelFor(
+        m_Tiles.size(),
+        [this](const size_t tileIndex) {
+            resolveTile(tileIndex);
+        }
+    );
+
+    m_ArePreviewsPending = false;
+    m_CompletedPassCount.store(completedPassCount, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::SetCamera(const Camera & camera)
+{
+    const std::lock_guard<std::mutex> lock(m_PendingCameraMutex);
+
+    m_PendingCamera = camera;
+    m_IsCameraChanged.store(true, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::TakeUpdatedTiles(std::vector<Uint32> & image, std::vector<ImageRect> & updatedTiles)
+{
+    assert(image.size() == m_BackImage.size());
+
+    updatedTiles.clear();
+
+    const std::lock_guard<std::mutex> lock(m_BackImageMutex);
+
+    for (const size_t tileIndex : m_UpdatedTileIndices)
+    {
+        const ImageRect & tile = m_Tiles[tileIndex];
+
+        for (int y = tile.Y; y < tile.Y + tile.Height; y++)
+        {
+            const size_t rowOffset = static_cast<size_t>(y)*GetImageWidth() + tile.X;
+
+            std::copy_n(m_BackImage.data() + rowOffset, tile.Width, image.data() + rowOffset);
+        }
+
+        updatedTiles.push_back(tile);
+        m_IsTileUpdated[tileIndex] = false;
+    }
+
+    m_UpdatedTileIndices.clear();
+}
+
+//
+// Service
+//
+
+void ProgressiveRenderer::renderLoop()
+{
+    NameTimelineThread("render");
+
+    while (!m_IsStopping.load(std::memory_order_relaxed))
+    {
+        if (m_IsCameraChanged.load(std::memory_order_relaxed))
+            applyCameraChange();
+
+        if (m_ArePreviewsPending)
+        {
+            // If interrupted by another camera change or Stop(), the previews are started over on the next iteration or start
+            renderPreviews();
+            m_ArePreviewsPending = isInterrupted();
+
+            continue;
+        }
+
+        renderPass();
+    }
+}
+
+void ProgressiveRenderer::applyCameraChange()
+{
+    const ScopedTimelineEvent event("camera change");
+
+    const Camera previousCamera = m_Camera;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_PendingCameraMutex);
+
+        m_Camera = m_PendingCamera;
+        m_IsCameraChanged.store(false, std::memory_order_relaxed);
+    }
+
+    const bool isReprojected = m_Options.ReprojectHistory && m_AreFirstHitsValid && tryReprojectHistory(previousCamera);
+
+    if (!isReprojected)
+        m_AccumulationBuffer->Clear();
+
+    m_ArePreviewsPending = !isReprojected && !m_PreviewBuffers.empty();
+}
+
+bool ProgressiveRenderer::tryReprojectHistory(const Camera & previousCamera)
+{
+    assert(m_Options.ReprojectHistory && m_AreFirstHitsValid);
+
+    std::atomic<size_t> reprojectedPixelCount(0);
+
+    m_ThreadPool.ParallelFor(
+        m_Tiles.size(),
+        [this, &previousCamera, &reprojectedPixelCount](const size_t tileIndex) {
+            reprojectedPixelCount.fetch_add(reprojectTile(m_Tiles[tileIndex], previousCamera), std::memory_order_relaxed);
+        }
+    );
+
+    // Either way, first hits are now known for the new camera
+    std::swap(m_FirstHits, m_NextFirstHits);
+
+    if (reprojectedPixelCount.load() < MIN_REPROJECTED_PIXEL_FRACTION*m_FirstHits.size())
+        return false;
+
+    std::swap(m_AccumulationBuffer, m_ReprojectionBuffer);
+
+    m_ThreadPool.ParallelFor(
+        m_Tiles.size(),
+        [this](const size_t tileIndex) {
+            resolveTile(tileIndex);
+        }
+    );
+
+    return true;
+}
+
+void ProgressiveRenderer::renderPass()
+{
+    const ScopedTimelineEvent event("pass", "pass", m_CompletedPassCount.load(std::memory_order_relaxed));
+
+    const bool shouldRecordFirstHits = m_Options.ReprojectHistory && !m_AreFirstHitsValid;
+
+    m_ThreadPool.ParallelFor(
+        m_Tiles.size(),
+        [this, shouldRecordFirstHits](const size_t tileIndex) {
+            // Let the remaining tiles of the pass be skipped quickly once stopping or the camera changes
+            if (!isInterrupted())
+                renderTile(tileIndex, shouldRecordFirstHits);
+        }
+    );
+
+    if (isInterrupted())
+        return;
+
+    m_AreFirstHitsValid = m_AreFirstHitsValid || shouldRecordFirstHits;
+
+    m_CompletedPassCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressiveRenderer::renderPreviews()
+{
+    for (size_t i = 0; i < m_PreviewBuffers.size() && !isInterrupted(); i++)
+        renderPreviewPass(PREVIEW_BLOCK_SIZES[i], *m_PreviewBuffers[i]);
+}
+
+void ProgressiveRenderer::renderPreviewPass(const int blockSize, AccumulationBuffer & previewBuffer)
+{
+    const ScopedTimelineEvent event("preview pass", "block size", blockSize);
+
+    previewBuffer.Clear();
+
+    m_ThreadPool.ParallelFor(
+        m_Tiles.size(),
+        [this, blockSize, &previewBuffer](const size_t tileIndex) {
+            if (!isInterrupted())
+                renderPreviewTile(tileIndex, blockSize, previewBuffer);
+        }
+    );
+}
+
+void ProgressiveRenderer::renderTile(const size_t tileIndex, const bool shouldRecordFirstHits)
+{
+    const ScopedTimelineEvent event("tile", "tile", static_cast<std::int64_t>(tileIndex));
+
+    const ImageRect & tile = m_Tiles[tileIndex];
+
+    m_Integrator.AccumulateSamples(
+        m_Scene,
+        m_Camera,
+        m_Sampler,
+        m_RayMissFunction,
+        tile,
+        *m_AccumulationBuffer
+    );
+
+    m_AccumulationBuffer->CountSamples(tile);
+
+    if (shouldRecordFirstHits)
+        recordFirstHits(tile, m_FirstHits);
+
+    resolveTile(tileIndex);
+}
+
+void ProgressiveRenderer::renderPreviewTile(const size_t tileIndex, const int blockSize, AccumulationBuffer & previewBuffer)
+{
+    const ScopedTimelineEvent event("preview tile", "tile", static_cast<std::int64_t>(tileIndex));
+
+    const ImageRect & tile = m_Tiles[tileIndex];
+
+    const ImageRect previewRect{
+        tile.X/blockSize,
+        tile.Y/blockSize,
+        (tile.Width  + blockSize - 1)/blockSize,
+        (tile.Height + blockSize - 1)/blockSize
+    };
+
+    m_Integrator.AccumulateSamples(
+        m_Scene,
+        m_Camera,
+        m_Sampler,
+        m_RayMissFunction,
+        previewRect,
+        previewBuffer
+    );
+
+    // Resolve each preview row once, then replicate its pixels over the block's rows and columns
+
+    thread_local std::vector<Uint32> previewRowPixels;
+    thread_local std::vector<Uint32> tilePixels;
+
+    previewRowPixels.resize(previewRect.Width);
+    tilePixels.resize(tile.Width*tile.Height);
+
+    for (int previewY = 0; previewY < previewRect.Height; previewY++)
+    {
+        ResolvePixelRow(
+            previewBuffer.GetRow(previewRect.Y + previewY) + previewRect.X,
+            previewRect.Width,
+            1.0f,
+            m_Options.ToneMapping,
+            previewRowPixels.data()
+        );
+
+        const int blockEndY = std::min((previewY + 1)*blockSize, tile.Height);
+        for (int y = previewY*blockSize; y < blockEndY; y++)
+        {
+            for (int x = 0; x < tile.Width; x++)
+                tilePixels[y*tile.Width + x] = previewRowPixels[x/blockSize];
+        }
+    }
+
+    publishTile(tileIndex, tilePixels);
+}
+
+void ProgressiveRenderer::recordFirstHits(const ImageRect & tile, std::vector<FirstHit> & firstHits) const
+{
+    const int imageWidth  = GetImageWidth();
+    const int imageHeight = GetImageHeight();
+
+    for (int y = tile.Y; y < tile.Y + tile.Height; y++)
+    {
+        for (int x = tile.X; x < tile.X + tile.Width; x++)
+        {
+            // Same convention as in integrators: a pixel's center maps onto its integer coordinates
+            const Ray ray = m_Camera.CreateRay(
+                static_cast<float>(x)/static_cast<float>(imageWidth),
+                1.0f - static_cast<float>(y)/static_cast<float>(imageHeight)
+            );
+
+            const std::optional<BodyHit> bodyHit = m_Scene.TryHit(ray, RAYTRACE_MIN_RAY_PARAM, INFINITY);
+
+            firstHits[static_cast<size_t>(y)*imageWidth + x] = bodyHit.has_value()
+                ? FirstHit{bodyHit->Hit.Hitpoint, bodyHit->BodyIndex}
+                : FirstHit{ray.Direction.normalized(), NO_BODY_INDEX};
+        }
+    }
+}
+
+size_t ProgressiveRenderer::reprojectTile(const ImageRect & tile, const Camera & previousCamera)
+{
+    const ScopedTimelineEvent event("reprojection");
+
+    recordFirstHits(tile, m_NextFirstHits);
+
+    const int imageWidth  = GetImageWidth();
+    const int imageHeight = GetImageHeight();
+
+    size_t reprojectedPixelCount = 0;
+
+    for (int y = tile.Y; y < tile.Y + tile.Height; y++)
+    {
+        Vector3 * const rowRgbs         = m_ReprojectionBuffer->GetRow(y);
+        float * const   rowSampleCounts = m_ReprojectionBuffer->GetSampleCountRow(y);
+
+        for (int x = tile.X; x < tile.X + tile.Width; x++)
+        {
+            rowRgbs[x]         = Vector3::Zero();
+            rowSampleCounts[x] = 0.0f;
+
+            const FirstHit & firstHit = m_NextFirstHits[static_cast<size_t>(y)*imageWidth + x];
+            const bool       isHit    = firstHit.BodyIndex != NO_BODY_INDEX;
+
+            // Directions of rays which missed are projected as points at infinity, i.e. relative to the origin
+            const std::optional<std::pair<float, float>> previousTarget = previousCamera.TryProjectPoint(
+                isHit ? firstHit.Point : Vector3(previousCamera.GetOrigin() + firstHit.Point)
+            );
+
+            if (!previousTarget.has_value())
+                continue;
+
+            const long previousX = std::lround(previousTarget->first*static_cast<float>(imageWidth));
+            const long previousY = std::lround((1.0f - previousTarget->second)*static_cast<float>(imageHeight));
+
+            if (previousX < 0 || previousX >= imageWidth || previousY < 0 || previousY >= imageHeight)
+                continue;
+
+            // The same surface point (or background direction) must have been seen through the previous pixel,
+            // otherwise it was occluded, or the pixel covered an edge
+
+            const FirstHit & previousFirstHit = m_FirstHits[previousY*imageWidth + previousX];
+
+            if (previousFirstHit.BodyIndex != firstHit.BodyIndex)
+                continue;
+
+            const float tolerance = isHit
+                ? REPROJECTION_RELATIVE_TOLERANCE*(firstHit.Point - m_Camera.GetOrigin()).norm()
+                : REPROJECTION_RELATIVE_TOLERANCE;
+
+            if ((previousFirstHit.Point - firstHit.Point).squaredNorm() > tolerance*tolerance)
+                continue;
+
+            const float previousSampleCount = m_AccumulationBuffer->GetSampleCountRow(previousY)[previousX];
+
+            if (previousSampleCount <= 0.0f)
+                continue;
+
+            const float sampleCount = std::min(previousSampleCount, MAX_REPROJECTED_SAMPLE_COUNT);
+
+            rowRgbs[x]         = m_AccumulationBuffer->GetRow(previousY)[previousX]*(sampleCount/previousSampleCount);
+            rowSampleCounts[x] = sampleCount;
+
+            reprojectedPixelCount++;
+        }
+    }
+
+    return reprojectedPixelCount;
+}
+
+void ProgressiveRenderer::resolveTile(const size_t tileIndex)
+{
+    const ScopedTimelineEvent event("resolve", "tile", static_cast<std::int64_t>(tileIndex));
+
+    const ImageRect & tile = m_Tiles[tileIndex];
+
+    // Resolve into a thread-local buffer first, so that the back image stays locked only for a plain copy
+
+    thread_local std::vector<Uint32> tilePixels;
+    tilePixels.resize(tile.Width*tile.Height);
+
+    {
+        const ScopedStageTimer timer(StatStage::Resolve, static_cast<std::uint64_t>(tile.Width*tile.Height));
+
+        for (int y = 0; y < tile.Height; y++)
+        {
+            ResolvePixelRow(
+                m_AccumulationBuffer->GetRow(tile.Y + y) + tile.X,
+                m_AccumulationBuffer->GetSampleCountRow(tile.Y + y) + tile.X,
+                tile.Width,
+                m_Options.ToneMapping,
+                tilePixels.data() + y*tile.Width
+            );
+        }
+    }
+
+    publishTile(tileIndex, tilePixels);
+}
+
+void ProgressiveRenderer::publishTile(const size_t tileIndex, const std::vector<Uint32> & tilePixels)
+{
+    const ImageRect & tile = m_Tiles[tileIndex];
+    assert(tilePixels.size() == static_cast<size_t>(tile.Width*tile.Height));
+
+    const std::lock_guard<std::mutex> lock(m_BackImageMutex);
+
+    for (int y = 0; y < tile.Height; y++)
+    {
+        std::copy_n(
+            tilePixels.data() + y*tile.Width,
+            tile.Width,
+            m_BackImage.data() + static_cast<size_t>(tile.Y + y)*GetImageWidth() + tile.X
+        );
+    }
+
+    // A tile may be rendered again before the previous result is taken, but only needs to be uploaded once
+    if (!m_IsTileUpdated[tileIndex])
+    {
+        m_IsTileUpdated[tileIndex] = true;
+        m_UpdatedTileIndices.push_back(tileIndex);
+    }
+}
+
+std::vector<ImageRect> ProgressiveRenderer::createTiles(const int imageWidth, const int imageHeight)
+{
+    std::vector<ImageRect> tiles;
+
+    for (int y = 0; y < imageHeight; y += TILE_SIZE)
+    {
+        for (int x = 0; x < imageWidth; x += TILE_SIZE)
+        {
+            tiles.push_back(ImageRect{
+                x,
+                y,
+                std::min(TILE_SIZE, imageWidth - x),
+                std::min(TILE_SIZE, imageHeight - y)
+            });
+        }
+    }
+
+    return tiles;
+}
+
+} // namespace rtwe
@@ -0,0 +1,292 @@
+#ifndef RTWE_PROGRESSIVE_RENDERER_H
+#define RTWE_PROGRESSIVE_RENDERER_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "tracing.h"
+#include "integrators.h"
+#include "heatmap.h"
+#include "sampling.h"
+#include "resolve.h"
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class Scene;
+class ThreadPool;
+
+//
+// Interface types
+//
+
+struct RenderOptions final
+{
+    ToneMappingOperator ToneMapping;
+    bool                RenderPreviews;
+    bool                ReprojectHistory; // On camera changes, instead of always starting over
+};
+
+//
+// ProgressiveRenderer
+//
+
+/**
+ * @brief Keeps adding samples to an image on a dedicated thread, publishing the resolved result tile by tile.
+ *
+ * Each pass traces one more sample for every pixel, with tiles distributed over the thread pool.
+ * As soon as a tile is done, it is resolved into the back image, and can be fetched at any time with TakeUpdatedTiles();
+ * tiles of a partially completed pass simply have one sample more than the rest.
+ *
+ * Optionally, the render thread first renders coarse previews, tracing one sample per 4x4 and then per 2x2 block of pixels
+ * into separate low resolution buffers, and upscales them into the back image, so that something is shown quickly.
+ * Full resolution passes then replace the preview tile by tile.
+ *
+ * When the camera changes, accumulated samples are either discarded, or reprojected: each pixel's primary ray hit
+ * is looked up in the previous view, and if the same surface point was visible there, that pixel's history is reused.
+ */
+class ProgressiveRenderer final
+{
+public: // Constants
+
+    static const int TILE_SIZE;
+
+    static const std::array<int, 2> PREVIEW_BLOCK_SIZES;
+
+    static const float MAX_REPROJECTED_SAMPLE_COUNT;
+    static const float REPROJECTION_RELATIVE_TOLERANCE;
+    static const float MIN_REPROJECTED_PIXEL_FRACTION;
+
+public: // Construction
+
+    /**
+     * @brief Does not start rendering until Start() is called. All references must outlive the renderer.
+     */
+    ProgressiveRenderer(
+        const Scene &         scene,
+        Camera                camera,
+        const ISampler &      sampler,
+        RayMissFunction       rayMissFunction,
+        const IIntegrator &   integrator,
+        ThreadPool &          threadPool,
+        const int             imageWidth,
+        const int             imageHeight,
+        const RenderOptions & options
+    );
+
+    ~ProgressiveRenderer();
+
+public: // Deleted
+
+    ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+    ProgressiveRenderer(ProgressiveRenderer&&)      = delete;
+
+    ProgressiveRenderer& operator=(const ProgressiveRenderer&) = delete;
+    ProgressiveRenderer& operator=(ProgressiveRenderer&&)      = delete;
+
+public: // Interface
+
+    void Start();
+
+    /**
+     * @brief Abandons the pass in progress and waits for the render thread to finish.
+     */
+    void Stop();
+
+    /**
+     * @brief Renders the given number of passes on the calling thread (and the thread pool), instead of the render thread.
+     *
+     * Must not be called between Start() and Stop(). Camera changes are applied before each pass.
+     */
+    void RenderPasses(const long passCount);
+
+    /**
+     * @brief Traces the given number of samples per pixel of the current view, recording what each pixel cost (see heatmap.h).
+     *
+     * Must not be called between Start() and Stop(). Accumulated samples are left as they are.
+     */
+    std::vector<PixelCost> RenderPixelCosts(const int sampleCount);
+
+    /**
+     * @brief Replaces accumulated samples with ones copied earlier, e.g. from a checkpoint, and resolves the whole image.
+     *
+     * Must not be called between Start() and Stop(). Previews are skipped, as the restored samples take their place.
+     *
+     * @param completedPassCount Passes which the restored samples amount to, which further passes count on from.
+     */
+    void RestoreAccumulation(const std::vector<Vector3> & pixelRgbs, const std::vector<float> & sampleCounts, const long completedPassCount);
+
+    /**
+     * @brief Makes the renderer abandon the pass in progress and continue with the given camera.
+     *
+     * Safe to call from any thread.
+     */
+    void SetCamera(const Camera & camera);
+
+    /**
+     * @brief Copies tiles of the back image resolved since the last call into the given image (ARGB, row by row).
+     *
+     * @param updatedTiles Receives the rects of the copied tiles, so that only they need to be uploaded.
+     */
+    void TakeUpdatedTiles(std::vector<Uint32> & image, std::vector<ImageRect> & updatedTiles);
+
+    inline int GetImageWidth() const;
+
+    inline int GetImageHeight() const;
+
+    /**
+     * @brief Number of full resolution passes completed since the start, including those before camera changes.
+     */
+    inline long GetCompletedPassCount() const;
+
+    inline const AccumulationBuffer & GetAccumulationBuffer() const;
+
+private: // Service types
+
+    struct FirstHit final
+    {
+        Vector3 Point;     // Normalized ray direction if nothing was hit
+        size_t  BodyIndex; // NO_BODY_INDEX if nothing was hit
+    };
+
+    static const size_t NO_BODY_INDEX;
+
+private: // Service
+
+    void renderLoop();
+
+    /**
+     * @brief Whether the render thread should abandon what it's doing, because of Stop() or SetCamera().
+     */
+    inline bool isInterrupted() const;
+
+    /**
+     * @brief Switches to the camera passed to SetCamera(), reprojecting or discarding accumulated samples.
+     *
+     * Previews become pending if the history was discarded.
+     */
+    void applyCameraChange();
+
+    bool tryReprojectHistory(const Camera & previousCamera);
+
+    void renderPass();
+
+    void renderPreviews();
+
+    void renderPreviewPass(const int blockSize, AccumulationBuffer & previewBuffer);
+
+    void renderTile(const size_t tileIndex, const bool recordFirstHits);
+
+    void renderPreviewTile(const size_t tileIndex, const int blockSize, AccumulationBuffer & previewBuffer);
+
+    /**
+     * @brief Traces a ray through the center of each of the tile's pixels, recording what it hit first.
+     */
+    void recordFirstHits(const ImageRect & tile, std::vector<FirstHit> & firstHits) const;
+
+    /**
+     * @brief Fills the tile's pixels in the reprojection buffer from m_AccumulationBuffer, as seen from the previous camera.
+     *
+     * @return Number of pixels with reused history.
+     */
+    size_t reprojectTile(const ImageRect & tile, const Camera & previousCamera);
+
+    void resolveTile(const size_t tileIndex);
+
+    /**
+     * @brief Copies resolved pixels of a tile (row by row) into the back image and marks the tile as updated.
+     */
+    void publishTile(const size_t tileIndex, const std::vector<Uint32> & tilePixels);
+
+    static std::vector<ImageRect> createTiles(const int imageWidth, const int imageHeight);
+
+private: // Members
+
+    const Scene &         m_Scene;
+    const ISampler &      m_Sampler;
+    const RayMissFunction m_RayMissFunction;
+    const IIntegrator &   m_Integrator;
+    ThreadPool &          m_ThreadPool;
+
+    const RenderOptions          m_Options;
+    const std::vector<ImageRect> m_Tiles;
+
+    // Only accessed by the rendering thread
+    Camera m_Camera;
+
+    std::mutex        m_PendingCameraMutex;
+    Camera            m_PendingCamera;
+    std::atomic<bool> m_IsCameraChanged;
+
+    std::unique_ptr<AccumulationBuffer> m_AccumulationBuffer;
+    std::unique_ptr<AccumulationBuffer> m_ReprojectionBuffer; // Only if reprojecting
+
+    // Of m_Camera, if valid; computed along with the first pass after the history is discarded
+    std::vector<FirstHit> m_FirstHits;
+    std::vector<FirstHit> m_NextFirstHits;
+    bool                  m_AreFirstHitsValid;
+
+    // One per PREVIEW_BLOCK_SIZES entry, or none if previews are disabled
+    std::vector<std::unique_ptr<AccumulationBuffer>> m_PreviewBuffers;
+
+    // Kept across Stop() and Start(), so that interrupted previews get finished after a restart, and finished ones aren't redone
+    bool m_ArePreviewsPending;
+
+    std::mutex          m_BackImageMutex;
+    std::vector<Uint32> m_BackImage;
+    std::vector<bool>   m_IsTileUpdated;
+    std::vector<size_t> m_UpdatedTileIndices;
+
+    std::atomic<bool> m_IsStopping;
+    std::atomic<long> m_CompletedPassCount;
+
+    std::thread m_RenderThread;
+};
+
+//
+// Interface
+//
+
+inline int ProgressiveRenderer::GetImageWidth() const
+{
+    return m_AccumulationBuffer->GetWidth();
+}
+
+inline int ProgressiveRenderer::GetImageHeight() const
+{
+    return m_AccumulationBuffer->GetHeight();
+}
+
+inline long ProgressiveRenderer::GetCompletedPassCount() const
+{
+    return m_CompletedPassCount.load(std::memory_order_relaxed);
+}
+
+inline const AccumulationBuffer & ProgressiveRenderer::GetAccumulationBuffer() const
+{
+    return *m_AccumulationBuffer;
+}
+
+//
+// Service
+//
+
+inline bool ProgressiveRenderer::isInterrupted() const
+{
+    return m_IsStopping.load(std::memory_order_relaxed) || m_IsCameraChanged.load(std::memory_order_relaxed);
+}
+
+} // namespace rtwe
+
+#endif // RTWE_PROGRESSIVE_RENDERER_H
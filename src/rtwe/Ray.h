@@ -12,12 +12,13 @@ public: // Attributes
 
     Vector3 Origin;
     Vector3 Direction;
+    float   Time; // Within the shutter interval, in [0, 1], for where moving bodies are when the ray hits them
 
 public: // Construction
 
     Ray() = default;
 
-    inline Ray(Vector3 origin, Vector3 direction);
+    inline Ray(Vector3 origin, Vector3 direction, const float time = 0.0f);
 
 public: // Interface
 
@@ -30,9 +31,10 @@ public: // Interface
 // Construction
 //
 
-inline Ray::Ray(Vector3 origin, Vector3 direction):
+inline Ray::Ray(Vector3 origin, Vector3 direction, const float time):
     Origin   (std::move(origin)),
-    Direction(std::move(direction))
+    Direction(std::move(direction)),
+    Time     (time)
 {
     // Empty
 }
@@ -0,0 +1,95 @@
+#ifndef RTWE_RAY_PACKET_H
+#define RTWE_RAY_PACKET_H
+
+#include "types.h"
+#include "Ray.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr int RAY_PACKET_SIZE = 8;
+
+//
+// Types
+//
+
+using FloatPacket = Eigen::Array<float, RAY_PACKET_SIZE, 1>;
+using IntPacket   = Eigen::Array<int,   RAY_PACKET_SIZE, 1>;
+using MaskPacket  = Eigen::Array<bool,  RAY_PACKET_SIZE, 1>;
+
+/**
+ * @brief Fixed-size group of rays in SoA layout, so that each operation processes the whole packet in SIMD registers.
+ */
+struct RayPacket final
+{
+public: // Attributes
+
+    FloatPacket OriginX;
+    FloatPacket OriginY;
+    FloatPacket OriginZ;
+
+    FloatPacket DirectionX;
+    FloatPacket DirectionY;
+    FloatPacket DirectionZ;
+
+    FloatPacket Times;
+
+public: // Interface
+
+    inline Ray GetRay(const int index) const;
+
+    inline void SetRay(const int index, const Ray & ray);
+};
+
+/**
+ * @brief One vector per ray of a packet, in SoA layout.
+ */
+struct Vector3Packet final
+{
+    FloatPacket X;
+    FloatPacket Y;
+    FloatPacket Z;
+};
+
+/**
+ * @brief Closest hits found for rays of a packet; a negative body index means a miss.
+ */
+struct RayPacketHits final
+{
+    FloatPacket RayParams;
+    IntPacket   BodyIndices;
+};
+
+//
+// Interface
+//
+
+inline Ray RayPacket::GetRay(const int index) const
+{
+    return Ray(
+        Vector3(OriginX[index],    OriginY[index],    OriginZ[index]),
+        Vector3(DirectionX[index], DirectionY[index], DirectionZ[index]),
+        Times[index]
+    );
+}
+
+inline void RayPacket::SetRay(const int index, const Ray & ray)
+{
+    OriginX[index] = ray.Origin.x();
+    OriginY[index] = ray.Origin.y();
+    OriginZ[index] = ray.Origin.z();
+
+    DirectionX[index] = ray.Direction.x();
+    DirectionY[index] = ray.Direction.y();
+    DirectionZ[index] = ray.Direction.z();
+
+    Times[index] = ray.Time;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_RAY_PACKET_H
@@ -0,0 +1,151 @@
+#include "Scene.h"
+
+#include <boost/log/trivial.hpp>
+
+#include "heatmap.h"
+#include "stats.h"
+#include "targets.h"
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+const float Scene::DEFAULT_MAX_SAH_COST_DEGRADATION = 1.5f;
+
+//
+// Construction
+//
+
+Scene::Scene(std::vector<Body> bodies, const bool interpolateMotionBounds):
+    m_Bodies                  (std::move(bodies)),
+    m_HasMotion               (false),
+    m_InterpolatesMotionBounds(interpolateMotionBounds)
+{
+    for (size_t i = 0; i < m_Bodies.size(); i++)
+    {
+        m_HasMotion |= m_Bodies[i].RayTarget->TryGetMotionBoundingBox(0.0f, 1.0f).has_value();
+
+        if (m_Bodies[i].RayTarget->TryGetBoundingBox().has_value())
+            m_BoundedBodyIndices.push_back(i);
+        else
+            m_UnboundedBodyIndices.push_back(i);
+    }
+
+    RebuildAccelerationStructure();
+}
+
+//
+// Interface
+//
+
+std::optional<BodyHit> Scene::TryHit(const Ray & ray, const float minRayParam, const float maxRayParam) const
+{
+    const ScopedStageTimer timer(StatStage::Intersection);
+
+    PixelCost * const pPixelCost = pCurrentPixelCost;
+
+    // Tests are only counted when something consumes them, which is rare enough not to slow down other calls
+    const bool shouldCountTests = timer.IsTimed() || pPixelCost != nullptr;
+
+    Bvh::TestCounts testCounts{0, 0};
+
+    std::optional<BodyHit> result = m_Bvh.TryHit(m_Bodies, ray, minRayParam, maxRayParam, shouldCountTests ? &testCounts : nullptr);
+    float currentMaxRayParam = result.has_value() ? result->Hit.RayParam : maxRayParam;
+
+    for (const size_t bodyIndex : m_UnboundedBodyIndices)
+    {
+        if (std::optional<RayHit> rayHit = m_Bodies[bodyIndex].RayTarget->TryHit(ray, minRayParam, currentMaxRayParam))
+        {
+            currentMaxRayParam = rayHit->RayParam;
+            result             = BodyHit{std::move(*rayHit), bodyIndex};
+        }
+    }
+
+    if (timer.IsTimed())
+    {
+        CountStat(StatCounter::BvhNodeTests,            testCounts.NodeTests);
+        CountStat(StatCounter::BoundedPrimitiveTests,   testCounts.PrimitiveTests);
+        CountStat(StatCounter::UnboundedPrimitiveTests, m_UnboundedBodyIndices.size());
+    }
+
+    if (pPixelCost != nullptr)
+    {
+        pPixelCost->NodeTests      += testCounts.NodeTests;
+        pPixelCost->PrimitiveTests += testCounts.PrimitiveTests + m_UnboundedBodyIndices.size();
+        pPixelCost->RayCount++;
+    }
+
+    return result;
+}
+
+RayPacketHits Scene::TryHitPacket(const RayPacket & packet, const float minRayParam, const float maxRayParam) const
+{
+    const ScopedStageTimer timer(StatStage::Intersection, RAY_PACKET_SIZE);
+
+    RayPacketHits hits{
+        FloatPacket::Constant(maxRayParam),
+        IntPacket::Constant(-1)
+    };
+
+    Bvh::TestCounts testCounts{0, 0};
+
+    m_Bvh.HitPacket(m_Bodies, packet, minRayParam, hits, timer.IsTimed() ? &testCounts : nullptr);
+
+    if (timer.IsTimed())
+    {
+        CountStat(StatCounter::BvhNodeTests,            testCounts.NodeTests);
+        CountStat(StatCounter::BoundedPrimitiveTests,   testCounts.PrimitiveTests);
+        CountStat(StatCounter::UnboundedPrimitiveTests, m_UnboundedBodyIndices.size()*RAY_PACKET_SIZE);
+    }
+
+    for (const size_t bodyIndex : m_UnboundedBodyIndices)
+    {
+        const MaskPacket hitMask = m_Bodies[bodyIndex].RayTarget->TryHitPacket(packet, minRayParam, hits.RayParams);
+
+        hits.BodyIndices = hitMask.select(IntPacket::Constant(static_cast<int>(bodyIndex)), hits.BodyIndices);
+    }
+
+    return hits;
+}
+
+std::optional<BodyHit> Scene::TryHitBody(
+    const size_t bodyIndex,
+    const Ray &  ray,
+    const float  minRayParam,
+    const float  maxRayParam
+) const
+{
+    std::optional<RayHit> rayHit = m_Bodies[bodyIndex].RayTarget->TryHit(ray, minRayParam, maxRayParam);
+
+    if (!rayHit.has_value())
+        return std::nullopt;
+
+    return BodyHit{std::move(*rayHit), bodyIndex};
+}
+
+bool Scene::UpdateAccelerationStructure(ThreadPool & threadPool, const float maxSahCostDegradation)
+{
+    m_Bvh.Refit(m_Bodies, threadPool);
+
+    if (m_Bvh.GetSahCostDegradation() <= maxSahCostDegradation)
+        return false;
+
+    BOOST_LOG_TRIVIAL(debug) << "BVH SAH cost degraded by a factor of " << m_Bvh.GetSahCostDegradation() << " after refit; rebuilding";
+
+    RebuildAccelerationStructure();
+
+    return true;
+}
+
+void Scene::RebuildAccelerationStructure()
+{
+    const ScopedTimelineEvent event("BVH build", "bodies", static_cast<std::int64_t>(m_BoundedBodyIndices.size()));
+
+    m_Bvh = Bvh(m_Bodies, m_BoundedBodyIndices, m_InterpolatesMotionBounds);
+}
+
+} // namespace rtwe
@@ -0,0 +1,127 @@
+#ifndef RTWE_SCENE_H
+#define RTWE_SCENE_H
+
+#include <optional>
+#include <vector>
+
+#include "tracing.h"
+#include "Bvh.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class ThreadPool;
+
+//
+//
+//
+
+/**
+ * @brief Set of bodies along with an acceleration structure for finding ray hits among them.
+ *
+ * Bounded bodies (e.g. spheres) are put into a BVH, while unbounded ones (e.g. planes) are tested one by one.
+ */
+class Scene final
+{
+public: // Constants
+
+    static const float DEFAULT_MAX_SAH_COST_DEGRADATION;
+
+public: // Construction
+
+    /**
+     * @param interpolateMotionBounds See Bvh; only worth disabling to compare with bounds over whole paths of moving bodies.
+     */
+    explicit Scene(std::vector<Body> bodies, const bool interpolateMotionBounds = true);
+
+public: // Interface
+
+    std::optional<BodyHit> TryHit(const Ray & ray, const float minRayParam, const float maxRayParam) const;
+
+    /**
+     * @brief Finds closest hits for all rays of a packet at once.
+     *
+     * Only ray params and body indices are found; the rest of RayHit can be obtained via TryHitBody().
+     */
+    RayPacketHits TryHitPacket(const RayPacket & packet, const float minRayParam, const float maxRayParam) const;
+
+    std::optional<BodyHit> TryHitBody(
+        const size_t bodyIndex,
+        const Ray &  ray,
+        const float  minRayParam,
+        const float  maxRayParam
+    ) const;
+
+    /**
+     * @brief Brings the acceleration structure up to date after bodies have moved, without changing the set of bodies.
+     *
+     * The BVH is refitted, and rebuilt from scratch once its SAH cost degrades past the given ratio to its build-time cost.
+     *
+     * @return Whether the BVH was rebuilt.
+     */
+    bool UpdateAccelerationStructure(
+        ThreadPool & threadPool,
+        const float  maxSahCostDegradation = DEFAULT_MAX_SAH_COST_DEGRADATION
+    );
+
+    void RebuildAccelerationStructure();
+
+    inline bool IsEmpty() const;
+
+    /**
+     * @return Whether any of the bodies moves over the shutter interval, so that rays should sample times within it.
+     */
+    inline bool HasMotion() const;
+
+    inline const std::vector<Body> & GetBodies() const;
+
+    inline const Bvh & GetBvh() const;
+
+    inline const std::vector<size_t> & GetUnboundedBodyIndices() const;
+
+private: // Members
+
+    std::vector<Body>   m_Bodies;
+    std::vector<size_t> m_BoundedBodyIndices;
+    std::vector<size_t> m_UnboundedBodyIndices;
+    bool                m_HasMotion;
+    bool                m_InterpolatesMotionBounds;
+    Bvh                 m_Bvh;
+};
+
+//
+// Interface
+//
+
+inline bool Scene::IsEmpty() const
+{
+    return m_Bodies.empty();
+}
+
+inline bool Scene::HasMotion() const
+{
+    return m_HasMotion;
+}
+
+inline const std::vector<Body> & Scene::GetBodies() const
+{
+    return m_Bodies;
+}
+
+inline const Bvh & Scene::GetBvh() const
+{
+    return m_Bvh;
+}
+
+inline const std::vector<size_t> & Scene::GetUnboundedBodyIndices() const
+{
+    return m_UnboundedBodyIndices;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_SCENE_H
@@ -0,0 +1,607 @@
+#include "Settings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace rtwe
+{
+
+//
+// Service types
+//
+
+namespace
+{
+
+struct OptionDescription final
+{
+    const char * Name;
+    const char * ValueName; // nullptr for flags, which take no value
+    const char * Description;
+
+    std::function<void(Settings & settings, const std::string & value)> Apply;
+};
+
+} // anonymous namespace
+
+//
+// Constants
+//
+
+// About the distance from the initial camera position to the central spheres of each scene
+constexpr float DEFAULT_FOCUS_DISTANCE = 2.0f;
+
+//
+// Service
+//
+
+static IntegratorType ParseIntegratorType(const std::string & value)
+{
+    if (value == "pixel")
+        return IntegratorType::Pixel;
+    else if (value == "wavefront")
+        return IntegratorType::Wavefront;
+
+    throw std::invalid_argument("unknown integrator '" + value + "', expected 'pixel' or 'wavefront'");
+}
+
+static SamplerType ParseSamplerType(const std::string & value)
+{
+    if (value == "random")
+        return SamplerType::Random;
+    else if (value == "halton")
+        return SamplerType::Halton;
+    else if (value == "sobol")
+        return SamplerType::Sobol;
+    else if (value == "blue-noise")
+        return SamplerType::BlueNoise;
+
+    throw std::invalid_argument("unknown sampler '" + value + "', expected 'random', 'halton', 'sobol' or 'blue-noise'");
+}
+
+static std::pair<int, int> ParseSize(const std::string & value)
+{
+    int  width     = 0;
+    int  height    = 0;
+    char separator = '\0';
+    char trailing  = '\0';
+
+    std::istringstream stream(value);
+    if (!(stream >> width >> separator >> height) || separator != 'x' || stream >> trailing || width <= 0 || height <= 0)
+        throw std::invalid_argument("invalid size '" + value + "', expected <width>x<height>, e.g. 1920x1080");
+
+    return {width, height};
+}
+
+static long ParsePositiveInteger(const std::string & value)
+{
+    long result   = 0;
+    char trailing = '\0';
+
+    std::istringstream stream(value);
+    if (!(stream >> result) || stream >> trailing || result <= 0)
+        throw std::invalid_argument("invalid number '" + value + "', expected a positive integer");
+
+    return result;
+}
+
+static long ParseNonNegativeInteger(const std::string & value)
+{
+    long result   = 0;
+    char trailing = '\0';
+
+    std::istringstream stream(value);
+    if (!(stream >> result) || stream >> trailing || result < 0)
+        throw std::invalid_argument("invalid number '" + value + "', expected a non-negative integer");
+
+    return result;
+}
+
+static float ParseFraction(const std::string & value)
+{
+    float result   = 0.0f;
+    char  trailing = '\0';
+
+    std::istringstream stream(value);
+    if (!(stream >> result) || stream >> trailing || !(result > 0.0f && result <= 1.0f))
+        throw std::invalid_argument("invalid fraction '" + value + "', expected a number greater than 0 and at most 1");
+
+    return result;
+}
+
+static float ParsePositiveNumber(const std::string & value)
+{
+    float result   = 0.0f;
+    char  trailing = '\0';
+
+    std::istringstream stream(value);
+    if (!(stream >> result) || stream >> trailing || !(result > 0.0f && std::isfinite(result)))
+        throw std::invalid_argument("invalid number '" + value + "', expected a positive number");
+
+    return result;
+}
+
+static std::uint32_t ParseSeed(const std::string & value)
+{
+    const long seed = ParseNonNegativeInteger(value);
+    if (static_cast<unsigned long>(seed) > UINT32_MAX)
+        throw std::invalid_argument("invalid seed '" + value + "', expected at most " + std::to_string(UINT32_MAX));
+
+    return static_cast<std::uint32_t>(seed);
+}
+
+static unsigned short ParsePort(const std::string & value)
+{
+    const long port = ParsePositiveInteger(value);
+    if (port > 65535)
+        throw std::invalid_argument("invalid port '" + value + "', expected at most 65535");
+
+    return static_cast<unsigned short>(port);
+}
+
+static ToneMappingOperator ParseToneMappingOperator(const std::string & value)
+{
+    if (value == "none")
+        return ToneMappingOperator::None;
+    else if (value == "reinhard")
+        return ToneMappingOperator::Reinhard;
+    else if (value == "aces")
+        return ToneMappingOperator::Aces;
+
+    throw std::invalid_argument("unknown tone mapping operator '" + value + "', expected 'none', 'reinhard' or 'aces'");
+}
+
+static SceneType ParseSceneType(const std::string & value)
+{
+    for (int i = 0; i < SCENE_TYPE_COUNT; i++)
+    {
+        if (value == GetSceneName(static_cast<SceneType>(i)))
+            return static_cast<SceneType>(i);
+    }
+
+    throw std::invalid_argument("unknown scene '" + value + "', expected 'default', 'many-spheres' or 'glass'");
+}
+
+static HeatmapMetric ParseHeatmapMetric(const std::string & value)
+{
+    if (value == "none")
+        return HeatmapMetric::None;
+    else if (value == "nodes")
+        return HeatmapMetric::NodeTests;
+    else if (value == "primitives")
+        return HeatmapMetric::PrimitiveTests;
+    else if (value == "rays")
+        return HeatmapMetric::RayCount;
+    else if (value == "time")
+        return HeatmapMetric::Time;
+
+    throw std::invalid_argument("unknown heatmap metric '" + value + "', expected 'none', 'nodes', 'primitives', 'rays' or 'time'");
+}
+
+static const std::vector<OptionDescription> & GetOptionDescriptions()
+{
+    static const std::vector<OptionDescription> OPTION_DESCRIPTIONS{
+        {
+            "--help", nullptr,
+            "Print this message and exit.",
+            [](Settings & settings, const std::string & /*value*/) { settings.ShowHelp = true; }
+        },
+        {
+            "--scene", "default|many-spheres|glass",
+            "Scene to render: spheres of each material on a glossy floor (default), a thousand small random spheres"
+            " around them (many-spheres) or mostly glass spheres, some nested, in front of matte ones (glass).",
+            [](Settings & settings, const std::string & value) { settings.Scene = ParseSceneType(value); }
+        },
+        {
+            "--resolution", "width>x<height",
+            "Size of the rendered image (800x600 by default); the window shows it scaled to fit.",
+            [](Settings & settings, const std::string & value) {
+                std::tie(settings.ImageWidth, settings.ImageHeight) = ParseSize(value);
+            }
+        },
+        {
+            "--window-size", "width>x<height",
+            "Size of the window (800x600 by default).",
+            [](Settings & settings, const std::string & value) {
+                std::tie(settings.WindowWidth, settings.WindowHeight) = ParseSize(value);
+            }
+        },
+        {
+            "--no-preview", nullptr,
+            "Don't show coarse previews, rendered at 1/16 and 1/4 of the resolution, before the first full resolution pass.",
+            [](Settings & settings, const std::string & /*value*/) { settings.RenderPreviews = false; }
+        },
+        {
+            "--no-reprojection", nullptr,
+            "Start accumulating over after each camera move, instead of reusing samples of surfaces which stay visible.",
+            [](Settings & settings, const std::string & /*value*/) { settings.ReprojectHistory = false; }
+        },
+        {
+            "--headless", nullptr,
+            "Render without a window, save the image and exit.",
+            [](Settings & settings, const std::string & /*value*/) { settings.IsHeadless = true; }
+        },
+        {
+            "--samples", "count",
+            "Number of samples per pixel to render in headless mode (16 by default).",
+            [](Settings & settings, const std::string & value) { settings.HeadlessSampleCount = ParsePositiveInteger(value); }
+        },
+        {
+            "--output", "path",
+            "PNG file to save the image to in headless mode (rtwe.png by default).",
+            [](Settings & settings, const std::string & value) { settings.OutputImagePath = value; }
+        },
+        {
+            "--checkpoint", "path",
+            "File to save the progress of a headless render to, periodically and once it's done; each save replaces the last"
+            " in one step, so that a render killed at any time leaves a usable checkpoint.",
+            [](Settings & settings, const std::string & value) { settings.CheckpointPath = value; }
+        },
+        {
+            "--checkpoint-interval", "seconds",
+            "Time between checkpoints (600 by default).",
+            [](Settings & settings, const std::string & value) { settings.CheckpointIntervalSeconds = ParsePositiveInteger(value); }
+        },
+        {
+            "--resume", nullptr,
+            "Continue the render saved in the checkpoint file, if there is one, up to the total number of samples;"
+            " resolution, scene, sampler, lens, integrator and integrator options must be the same as when it was saved.",
+            [](Settings & settings, const std::string & /*value*/) { settings.ResumeFromCheckpoint = true; }
+        },
+        {
+            "--farm", "worker-count",
+            "Split a headless render into jobs of a few samples per pixel each, and render them on the given number of worker"
+            " processes started on this machine, along with any remote workers which connect; jobs of workers which die go to other"
+            " workers. Each local worker gets an equal share of hardware threads, or --threads of them."
+            " Logs the speedup over a single worker and the efficiency per worker, so that runs with different numbers of workers"
+            " can be compared.",
+            [](Settings & settings, const std::string & value) { settings.FarmWorkerCount = ParsePositiveInteger(value); }
+        },
+        {
+            "--farm-port", "port",
+            "Port to listen on for remote workers with --farm; without it, only workers on this machine can connect.",
+            [](Settings & settings, const std::string & value) { settings.FarmPort = ParsePort(value); }
+        },
+        {
+            "--farm-job-timeout", "seconds",
+            "Time a worker gets to send back the result of a job with --farm, before the job goes to another worker and the worker"
+            " gets disconnected (600 by default); raise it for renders whose jobs take longer.",
+            [](Settings & settings, const std::string & value) { settings.FarmJobTimeoutSeconds = ParsePositiveInteger(value); }
+        },
+        {
+            "--farm-worker", "host>:<port",
+            "Render jobs of the farm coordinator at the given address, which sends all rendering options but --threads, and exit"
+            " once it has no more jobs.",
+            [](Settings & settings, const std::string & value) {
+                settings.FarmCoordinatorAddress = value;
+                settings.IsHeadless             = true;
+            }
+        },
+        {
+            "--partial", "path",
+            "Save the per-pixel sums and sample counts of a headless render to the given file, along with the image, so that it can"
+            " be merged with partials of the same frame rendered elsewhere, with adjoining sample ranges and, with the random"
+            " sampler, the same --seed. With --merge, the file to save the merged partial to.",
+            [](Settings & settings, const std::string & value) { settings.PartialPath = value; }
+        },
+        {
+            "--first-sample", "index",
+            "Index of each pixel's first sample to render with --partial (0 by default), so that nodes rendering a frame"
+            " together each take a range of samples.",
+            [](Settings & settings, const std::string & value) { settings.FirstSampleIndex = ParseNonNegativeInteger(value); }
+        },
+        {
+            "--variance", nullptr,
+            "With --partial, also save sums of squared sample luminance, from which merging estimates the noise left in the image.",
+            [](Settings & settings, const std::string & /*value*/) { settings.RecordVariance = true; }
+        },
+        {
+            "--merge", "dir",
+            "Sum up all partial renders (*.rtwep) in the given directory, a band of rows at a time, so that memory use doesn't"
+            " depend on their number, and save the image to the --output path; --tone-mapping applies.",
+            [](Settings & settings, const std::string & value) {
+                settings.MergePath  = value;
+                settings.IsHeadless = true;
+            }
+        },
+        {
+            "--serve", "job-dir",
+            "Keep rendering jobs queued in the given directory as *.job files of options, such as --scene, --resolution,"
+            " --samples and --output, e.g. \"--scene glass --samples 64 --output glass.png\", and mark each as <name>.done"
+            " or <name>.failed. The thread pool and built scenes are kept from job to job, and the next job is loaded while"
+            " the current one renders. Options besides job ones apply to all jobs.",
+            [](Settings & settings, const std::string & value) {
+                settings.ServePath  = value;
+                settings.IsHeadless = true;
+            }
+        },
+        {
+            "--exit-when-idle", nullptr,
+            "With --serve, exit once no jobs are left, e.g. to render a batch, rather than wait for more.",
+            [](Settings & settings, const std::string & /*value*/) { settings.ExitWhenIdle = true; }
+        },
+        {
+            "--animate", "frame-count",
+            "Render one loop of the scene's animation of the camera and bodies as the given number of frames, each with"
+            " --samples samples per pixel, and save them as the --output path with frame numbers appended, e.g. rtwe-0000.png.",
+            [](Settings & settings, const std::string & value) {
+                settings.AnimationFrameCount = ParsePositiveInteger(value);
+                settings.IsHeadless          = true;
+            }
+        },
+        {
+            "--no-frame-pipelining", nullptr,
+            "With --animate, render frames one after another, instead of updating the scene for the next frame and writing"
+            " the previous one while tracing the current one; for comparison.",
+            [](Settings & settings, const std::string & /*value*/) { settings.PipelineFrames = false; }
+        },
+        {
+            "--shutter", "fraction",
+            "With --animate, keep the shutter open for the given fraction of each frame's duration, e.g. 0.5,"
+            " blurring the motion of bodies over it (but not the camera's).",
+            [](Settings & settings, const std::string & value) { settings.ShutterFraction = ParseFraction(value); }
+        },
+        {
+            "--aperture", "radius",
+            "Radius of the camera's lens, e.g. 0.05, blurring what's nearer or farther than the focus distance (depth of field);"
+            " a pinhole camera, with everything in focus, by default.",
+            [](Settings & settings, const std::string & value) { settings.ApertureRadius = ParsePositiveNumber(value); }
+        },
+        {
+            "--focus-distance", "distance",
+            "With --aperture, distance from the camera to the plane in focus (2 by default, about that of each scene's central spheres).",
+            [](Settings & settings, const std::string & value) { settings.FocusDistance = ParsePositiveNumber(value); }
+        },
+        {
+            "--integrator", "pixel|wavefront",
+            "Trace each pixel's path to the end (pixel, default) or advance all paths bounce by bounce (wavefront).",
+            [](Settings & settings, const std::string & value) { settings.Integrator = ParseIntegratorType(value); }
+        },
+        {
+            "--no-ray-packets", nullptr,
+            "Trace primary rays one by one instead of in packets (pixel integrator only).",
+            [](Settings & settings, const std::string & /*value*/) { settings.IntegrationOptions.UsePrimaryRayPackets = false; }
+        },
+        {
+            "--no-ray-sorting", nullptr,
+            "Don't reorder secondary rays by direction and origin before each bounce (wavefront integrator only).",
+            [](Settings & settings, const std::string & /*value*/) { settings.IntegrationOptions.SortSecondaryRays = false; }
+        },
+        {
+            "--sampler", "random|halton|sobol|blue-noise",
+            "Source of values for pixel jitter and scattering: independent random numbers, or a low-discrepancy sequence (sobol, default).",
+            [](Settings & settings, const std::string & value) { settings.Sampler = ParseSamplerType(value); }
+        },
+        {
+            "--seed", "value",
+            "Seed of the random sampler, which other samplers ignore (a new random one on each run by default).",
+            [](Settings & settings, const std::string & value) { settings.SamplerSeed = ParseSeed(value); }
+        },
+        {
+            "--deterministic", nullptr,
+            "Render the same image, bit for bit, on every run and whatever the number of threads; only the random sampler"
+            " differs otherwise. Headless mode logs a hash of the accumulated samples, so that runs can be compared.",
+            [](Settings & settings, const std::string & /*value*/) { settings.IsDeterministic = true; }
+        },
+        {
+            "--threads", "count",
+            "Number of threads to render with (one per hardware thread by default).",
+            [](Settings & settings, const std::string & value) { settings.ThreadCount = ParsePositiveInteger(value); }
+        },
+        {
+            "--tone-mapping", "none|reinhard|aces",
+            "Map radiance to displayable range by just clamping it (none, default) or with a Reinhard or ACES filmic curve.",
+            [](Settings & settings, const std::string & value) { settings.ToneMapping = ParseToneMappingOperator(value); }
+        },
+        {
+            "--timeline", "path",
+            "Record what each thread does (passes, tiles, BVH builds, resolves, presents) and save the most recent events on exit"
+            " as Chrome trace JSON, which can be opened in Perfetto.",
+            [](Settings & settings, const std::string & value) { settings.TimelinePath = value; }
+        },
+        {
+            "--heatmap", "none|nodes|primitives|rays|time",
+            "Per-pixel cost to show as a false-color heatmap: BVH node tests, primitive tests, rays traced (path depth) or time."
+            " In headless mode, the heatmap is saved next to the image, as <output>-heatmap.png; in the window, H cycles through them.",
+            [](Settings & settings, const std::string & value) { settings.Heatmap = ParseHeatmapMetric(value); }
+        },
+        {
+            "--benchmark", "reference-dir",
+            "Render each scene headlessly at a fixed resolution and sample count, report time, throughput and peak memory use,"
+            " and compare the images to references <scene>.png in the given directory, e.g. src/bench/references;"
+            " exits with 1 if any differs more than noise would explain."
+            " Integrator and sampler options apply, other rendering options don't.",
+            [](Settings & settings, const std::string & value) { settings.BenchmarkReferencePath = value; }
+        },
+        {
+            "--update-references", nullptr,
+            "With --benchmark, save the rendered images as the new references instead of comparing them.",
+            [](Settings & settings, const std::string & /*value*/) { settings.UpdateBenchmarkReferences = true; }
+        },
+        {
+            "--check-determinism", nullptr,
+            "Render each scene with each sampler and integrator headlessly, then one scene through a lens and with motion blur,"
+            " once on a single thread and once on several, and compare hashes of the accumulated samples; exits with 1 if any differ."
+            " Integrator options and --threads, if more than the minimum of 4, apply, other rendering options don't.",
+            [](Settings & settings, const std::string & /*value*/) { settings.CheckDeterminism = true; }
+        }
+    };
+
+    return OPTION_DESCRIPTIONS;
+}
+
+//
+// Construction
+//
+
+Settings::Settings():
+    ShowHelp                  (false),
+    Scene                     (SceneType::Default),
+    ImageWidth                (800),
+    ImageHeight               (600),
+    WindowWidth               (800),
+    WindowHeight              (600),
+    RenderPreviews            (true),
+    ReprojectHistory          (true),
+    IsHeadless                (false),
+    HeadlessSampleCount       (16),
+    OutputImagePath           ("rtwe.png"),
+    CheckpointPath            (),
+    CheckpointIntervalSeconds (600),
+    ResumeFromCheckpoint      (false),
+    FarmWorkerCount           (0),
+    FarmPort                  (0),
+    FarmJobTimeoutSeconds     (600),
+    FarmCoordinatorAddress    (),
+    PartialPath               (),
+    FirstSampleIndex          (0),
+    RecordVariance            (false),
+    MergePath                 (),
+    ServePath                 (),
+    ExitWhenIdle              (false),
+    AnimationFrameCount       (0),
+    PipelineFrames            (true),
+    ShutterFraction           (0.0f),
+    ApertureRadius            (0.0f),
+    FocusDistance             (DEFAULT_FOCUS_DISTANCE),
+    Integrator                (IntegratorType::Pixel),
+    IntegrationOptions        {true, true},
+    Sampler                   (SamplerType::Sobol),
+    SamplerSeed               (),
+    IsDeterministic           (false),
+    ThreadCount               (0),
+    ToneMapping               (ToneMappingOperator::None),
+    TimelinePath              (),
+    Heatmap                   (HeatmapMetric::None),
+    BenchmarkReferencePath    (),
+    UpdateBenchmarkReferences (false),
+    CheckDeterminism          (false)
+{
+    // Empty
+}
+
+//
+// Interface
+//
+
+Settings Settings::FromCommandLine(const int argc, const char * const * const argv)
+{
+    const std::vector<OptionDescription> & optionDescriptions = GetOptionDescriptions();
+
+    Settings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+
+        const auto optionIt = std::find_if(
+            optionDescriptions.cbegin(),
+            optionDescriptions.cend(),
+            [&argument](const OptionDescription & option) { return argument == option.Name; }
+        );
+
+        if (optionIt == optionDescriptions.cend())
+            throw std::invalid_argument("unknown option '" + argument + "'");
+
+        if (optionIt->ValueName == nullptr)
+        {
+            optionIt->Apply(settings, std::string());
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw std::invalid_argument("option '" + argument + "' requires a value");
+
+        optionIt->Apply(settings, argv[++i]);
+    }
+
+    if (!settings.CheckpointPath.empty() && !settings.IsHeadless)
+        throw std::invalid_argument("option '--checkpoint' requires '--headless'");
+
+    if (settings.ResumeFromCheckpoint && settings.CheckpointPath.empty())
+        throw std::invalid_argument("option '--resume' requires '--checkpoint'");
+
+    if (settings.FarmWorkerCount > 0 && !settings.IsHeadless)
+        throw std::invalid_argument("option '--farm' requires '--headless'");
+
+    if (settings.FarmWorkerCount > 0 && (!settings.CheckpointPath.empty() || !settings.FarmCoordinatorAddress.empty()))
+        throw std::invalid_argument("option '--farm' can't be combined with '--checkpoint' or '--farm-worker'");
+
+    if (settings.FarmPort != 0 && settings.FarmWorkerCount == 0)
+        throw std::invalid_argument("option '--farm-port' requires '--farm'");
+
+    if (!settings.PartialPath.empty() && !settings.IsHeadless)
+        throw std::invalid_argument("option '--partial' requires '--headless' or '--merge'");
+
+    if (!settings.PartialPath.empty() && (!settings.CheckpointPath.empty() || settings.FarmWorkerCount > 0))
+        throw std::invalid_argument("option '--partial' can't be combined with '--checkpoint' or '--farm'");
+
+    if ((settings.FirstSampleIndex > 0 || settings.RecordVariance) && (settings.PartialPath.empty() || !settings.MergePath.empty()))
+        throw std::invalid_argument("options '--first-sample' and '--variance' require '--partial', and don't apply to '--merge'");
+
+    if (settings.CheckDeterminism && (!settings.BenchmarkReferencePath.empty() || !settings.ServePath.empty()))
+        throw std::invalid_argument("option '--check-determinism' can't be combined with '--benchmark' or '--serve'");
+
+    if (!settings.ServePath.empty()
+        && (!settings.CheckpointPath.empty() || settings.FarmWorkerCount > 0 || !settings.FarmCoordinatorAddress.empty()
+            || !settings.PartialPath.empty() || !settings.MergePath.empty() || !settings.BenchmarkReferencePath.empty()))
+    {
+        throw std::invalid_argument(
+            "option '--serve' can't be combined with '--checkpoint', '--farm', '--farm-worker', '--partial', '--merge' or '--benchmark'"
+        );
+    }
+
+    if (settings.ExitWhenIdle && settings.ServePath.empty())
+        throw std::invalid_argument("option '--exit-when-idle' requires '--serve'");
+
+    // The timeline is only saved on exit, which a service never gets to otherwise
+    if (!settings.TimelinePath.empty() && !settings.ServePath.empty() && !settings.ExitWhenIdle)
+        throw std::invalid_argument("option '--timeline' requires '--exit-when-idle' with '--serve'");
+
+    if (settings.AnimationFrameCount > 0
+        && (!settings.CheckpointPath.empty() || settings.FarmWorkerCount > 0 || !settings.FarmCoordinatorAddress.empty()
+            || !settings.PartialPath.empty() || !settings.MergePath.empty() || !settings.ServePath.empty()
+            || !settings.BenchmarkReferencePath.empty()))
+    {
+        throw std::invalid_argument(
+            "option '--animate' can't be combined with '--checkpoint', '--farm', '--farm-worker', '--partial', '--merge',"
+            " '--serve' or '--benchmark'"
+        );
+    }
+
+    if (!settings.PipelineFrames && settings.AnimationFrameCount == 0)
+        throw std::invalid_argument("option '--no-frame-pipelining' requires '--animate'");
+
+    if (settings.ShutterFraction > 0.0f && settings.AnimationFrameCount == 0)
+        throw std::invalid_argument("option '--shutter' requires '--animate'");
+
+    if (settings.FocusDistance != DEFAULT_FOCUS_DISTANCE && settings.ApertureRadius == 0.0f)
+        throw std::invalid_argument("option '--focus-distance' requires '--aperture'");
+
+    return settings;
+}
+
+std::string Settings::GetUsage()
+{
+    std::ostringstream usage;
+
+    usage << "Usage: rtwe [options]\n\nOptions:\n";
+    for (const OptionDescription & option : GetOptionDescriptions())
+    {
+        usage << "  " << option.Name;
+        if (option.ValueName != nullptr)
+            usage << " <" << option.ValueName << ">";
+
+        usage << "\n      " << option.Description << "\n";
+    }
+
+    return usage.str();
+}
+
+} // namespace rtwe
@@ -0,0 +1,101 @@
+#ifndef RTWE_SETTINGS_H
+#define RTWE_SETTINGS_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "integrators.h"
+#include "heatmap.h"
+#include "sampling.h"
+#include "resolve.h"
+#include "scenes.h"
+
+namespace rtwe
+{
+
+/**
+ * @brief Options chosen at runtime, via the command line.
+ */
+struct Settings final
+{
+public: // Attributes
+
+    bool ShowHelp;
+
+    SceneType Scene;
+
+    int ImageWidth;
+    int ImageHeight;
+
+    int WindowWidth;
+    int WindowHeight;
+
+    bool RenderPreviews;
+    bool ReprojectHistory;
+
+    bool        IsHeadless;
+    long        HeadlessSampleCount;
+    std::string OutputImagePath;
+
+    std::string CheckpointPath; // Empty unless headless renders should be checkpointed
+    long        CheckpointIntervalSeconds;
+    bool        ResumeFromCheckpoint;
+
+    long           FarmWorkerCount;        // 0 unless headless renders should be split among worker processes
+    unsigned short FarmPort;               // 0 for an ephemeral port, which only local workers can connect to
+    long           FarmJobTimeoutSeconds;
+    std::string    FarmCoordinatorAddress; // Empty unless rendering jobs of a farm coordinator, as a worker
+
+    std::string PartialPath; // Empty unless headless renders should be saved as partials, or merged partials saved
+    long        FirstSampleIndex;
+    bool        RecordVariance;
+    std::string MergePath;   // Empty unless merging partial renders
+
+    std::string ServePath; // Empty unless serving render jobs queued in a directory
+    bool        ExitWhenIdle;
+
+    long  AnimationFrameCount; // 0 unless rendering an animation of the scene
+    bool  PipelineFrames;
+    float ShutterFraction;     // Of each frame's duration, over which motion is blurred; 0 for no motion blur
+
+    float ApertureRadius; // Of the camera's lens; 0 for a pinhole camera, with everything in focus
+    float FocusDistance;
+
+    IntegratorType    Integrator;
+    IntegratorOptions IntegrationOptions;
+
+    SamplerType                  Sampler;
+    std::optional<std::uint32_t> SamplerSeed;
+    bool                         IsDeterministic;
+
+    long ThreadCount; // Including the thread which starts rendering; 0 for one per hardware thread
+
+    ToneMappingOperator ToneMapping;
+
+    std::string TimelinePath; // Empty unless a timeline should be recorded
+
+    HeatmapMetric Heatmap;
+
+    std::string BenchmarkReferencePath; // Empty unless benchmarking canonical scenes
+    bool        UpdateBenchmarkReferences;
+
+    bool CheckDeterminism;
+
+public: // Construction
+
+    Settings();
+
+public: // Interface
+
+    /**
+     * @throws std::invalid_argument If an option is unknown, lacks a value or has an invalid one.
+     */
+    static Settings FromCommandLine(const int argc, const char * const * const argv);
+
+    static std::string GetUsage();
+};
+
+} // namespace rtwe
+
+#endif // RTWE_SETTINGS_H
@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+
+#include <cassert>
+
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Construction
+//
+
+ThreadPool::ThreadPool(const size_t workerCount):
+    m_pJobFunction   (nullptr),
+    m_JobItemCount   (0),
+    m_JobGeneration  (0),
+    m_BusyWorkerCount(0),
+    m_IsStopping     (false),
+    m_NextJobItem    (0)
+{
+    m_Workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+        m_Workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_JobAvailableCondition.notify_all();
+
+    for (std::thread & worker : m_Workers)
+        worker.join();
+}
+
+//
+// Interface
+//
+
+void ThreadPool::ParallelFor(const size_t count, const IndexFunction & function)
+{
+    if (count == 0)
+        return;
+
+    if (m_Workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            function(i);
+
+        return;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        assert(m_pJobFunction == nullptr && "ParallelFor() must not be called concurrently");
+
+        m_pJobFunction    = &function;
+        m_JobItemCount    = count;
+        m_BusyWorkerCount = m_Workers.size();
+        m_NextJobItem.store(0, std::memory_order_relaxed);
+        m_JobGeneration++;
+    }
+
+    m_JobAvailableCondition.notify_all();
+
+    runJobItems();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_JobFinishedCondition.wait(lock, [this]() { return m_BusyWorkerCount == 0; });
+
+    m_pJobFunction = nullptr;
+}
+
+size_t ThreadPool::GetDefaultWorkerCount()
+{
+    const unsigned int hardwareThreadCount = std::thread::hardware_concurrency();
+
+    return hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 0;
+}
+
+//
+// Service
+//
+
+void ThreadPool::workerLoop()
+{
+    NameTimelineThread("worker");
+
+    unsigned long lastJobGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobAvailableCondition.wait(lock, [this, lastJobGeneration]() {
+                return m_IsStopping || m_JobGeneration != lastJobGeneration;
+            });
+
+            if (m_IsStopping)
+                return;
+
+            lastJobGeneration = m_JobGeneration;
+        }
+
+        runJobItems();
+
+        {
+            const std::lock_guard<std::mutex> lock(m_Mutex);
+            m_BusyWorkerCount--;
+        }
+
+        m_JobFinishedCondition.notify_one();
+    }
+}
+
+void ThreadPool::runJobItems()
+{
+    assert(m_pJobFunction != nullptr);
+
+    while (true)
+    {
+        const size_t item = m_NextJobItem.fetch_add(1, std::memory_order_relaxed);
+        if (item >= m_JobItemCount)
+            return;
+
+        (*m_pJobFunction)(item);
+    }
+}
+
+} // namespace rtwe
@@ -0,0 +1,87 @@
+#ifndef RTWE_THREAD_POOL_H
+#define RTWE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtwe
+{
+
+/**
+ * @brief Fixed set of worker threads executing data-parallel loops.
+ *
+ * The thread calling ParallelFor() participates in the work, so a pool
+ * with zero workers degrades to a plain serial loop.
+ */
+class ThreadPool final
+{
+public: // Types
+
+    using IndexFunction = std::function<void(size_t)>;
+
+public: // Construction
+
+    explicit ThreadPool(const size_t workerCount = GetDefaultWorkerCount());
+
+    ~ThreadPool();
+
+public: // Deleted
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&)      = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Invokes function(i) for every i in [0, count) and waits for all invocations to finish.
+     *
+     * Must not be called concurrently from several threads.
+     */
+    void ParallelFor(const size_t count, const IndexFunction & function);
+
+    inline size_t GetThreadCount() const;
+
+    static size_t GetDefaultWorkerCount();
+
+private: // Service
+
+    void workerLoop();
+
+    void runJobItems();
+
+private: // Members
+
+    std::vector<std::thread> m_Workers;
+
+    std::mutex              m_Mutex;
+    std::condition_variable m_JobAvailableCondition;
+    std::condition_variable m_JobFinishedCondition;
+
+    const IndexFunction * m_pJobFunction;
+    size_t                m_JobItemCount;
+    unsigned long         m_JobGeneration;
+    size_t                m_BusyWorkerCount;
+    bool                  m_IsStopping;
+
+    std::atomic<size_t> m_NextJobItem;
+};
+
+//
+// Interface
+//
+
+inline size_t ThreadPool::GetThreadCount() const
+{
+    return m_Workers.size() + 1;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_THREAD_POOL_H
@@ -0,0 +1,326 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "targets.h"
+#include "timeline.h"
+#include "Scene.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const Vector3 WORLD_UP(0.0f, 1.0f, 0.0f);
+
+// Of SceneType::ManySpheres, one in every MANY_SPHERES_HOPPING_SPHERE_STRIDE spheres hops once per loop, each at its own time
+constexpr size_t MANY_SPHERES_HOPPING_SPHERE_STRIDE = 20;
+constexpr float  MANY_SPHERES_HOP_HEIGHT            = 0.3f;
+constexpr float  MANY_SPHERES_HOP_DURATION          = 0.2f;
+
+// Paths of moving spheres over the shutter interval are split into this many linear segments, to follow eased motion
+constexpr size_t MOTION_BLUR_SEGMENT_COUNT = 4;
+
+//
+// Service
+//
+
+/**
+ * @brief Finds the keyframes around the given time, and how far between them it is, eased in and out.
+ *
+ * @return Index of the keyframe before the time, whose successor is the one after it.
+ */
+template <typename Keyframe>
+static size_t FindKeyframeSegment(const std::vector<Keyframe> & keyframes, const float time, float & easedFraction);
+
+static inline float EaseInOut(const float fraction);
+
+static Vector3 InterpolatePosition(const std::vector<PositionKeyframe> & keyframes, const float time);
+
+static inline const SphereRayTarget & GetSphere(const Body & body);
+
+/**
+ * @brief Track of a sphere which rests, then hops up and back down, starting at the given time.
+ */
+static BodyTrack CreateHopTrack(
+    const size_t    bodyIndex,
+    const Vector3 & restPosition,
+    const float     height,
+    const float     startTime,
+    const float     duration
+);
+
+//
+// Utilities
+//
+
+Animation CreateSceneAnimation(const SceneType type, const std::vector<Body> & bodies)
+{
+    switch (type)
+    {
+    case SceneType::Default:
+    {
+        // Camera circles around the spheres, above and in front of them, while the small one hops twice
+        const Vector3 target(0.0f, 0.0f, 1.0f);
+
+        const Vector3 & smallSpherePosition = GetSphere(bodies[2]).GetCenter();
+        const Vector3 & largeSpherePosition = GetSphere(bodies[3]).GetCenter();
+
+        return Animation{
+            {
+                {0.0f,  Vector3( 0.0f, 0.0f, -1.0f), target},
+                {0.25f, Vector3( 1.2f, 0.4f, -0.6f), target},
+                {0.5f,  Vector3( 0.0f, 0.8f, -1.4f), target},
+                {0.75f, Vector3(-1.2f, 0.4f, -0.6f), target},
+                {1.0f,  Vector3( 0.0f, 0.0f, -1.0f), target}
+            },
+            {
+                {
+                    2,
+                    {
+                        {0.0f,  smallSpherePosition},
+                        {0.25f, smallSpherePosition + Vector3(0.0f, 0.6f, 0.0f)},
+                        {0.5f,  smallSpherePosition},
+                        {0.75f, smallSpherePosition + Vector3(0.0f, 0.6f, 0.0f)},
+                        {1.0f,  smallSpherePosition}
+                    }
+                },
+                {
+                    3,
+                    {
+                        {0.0f, largeSpherePosition},
+                        {0.5f, largeSpherePosition + Vector3(0.4f, 0.0f, -0.3f)},
+                        {1.0f, largeSpherePosition}
+                    }
+                }
+            }
+        };
+    }
+    case SceneType::ManySpheres:
+    {
+        // Camera moves in over the spheres and back, while some of them hop, one after another
+        const Vector3 target(0.0f, -0.3f, 3.0f);
+
+        Animation animation{
+            {
+                {0.0f, Vector3(0.0f, 0.0f, -1.0f), target},
+                {0.5f, Vector3(0.3f, 0.4f,  0.2f), target},
+                {1.0f, Vector3(0.0f, 0.0f, -1.0f), target}
+            },
+            {}
+        };
+
+        for (size_t i = 1; i < bodies.size(); i += MANY_SPHERES_HOPPING_SPHERE_STRIDE)
+        {
+            const size_t hopIndex  = i/MANY_SPHERES_HOPPING_SPHERE_STRIDE;
+            const size_t hopCount  = (bodies.size() - 1)/MANY_SPHERES_HOPPING_SPHERE_STRIDE + 1;
+            const float  startTime = (1.0f - MANY_SPHERES_HOP_DURATION)*static_cast<float>(hopIndex)/static_cast<float>(hopCount);
+
+            animation.BodyTracks.push_back(
+                CreateHopTrack(i, GetSphere(bodies[i]).GetCenter(), MANY_SPHERES_HOP_HEIGHT, startTime, MANY_SPHERES_HOP_DURATION)
+            );
+        }
+
+        return animation;
+    }
+    case SceneType::Glass:
+    {
+        // Camera pans from side to side, while the inner sphere moves up and down within its shell and another one bobs
+        const Vector3 target(0.0f, 0.0f, 1.5f);
+
+        const Vector3 & innerSpherePosition    = GetSphere(bodies[2]).GetCenter();
+        const Vector3 & floatingSpherePosition = GetSphere(bodies[5]).GetCenter();
+
+        return Animation{
+            {
+                {0.0f,  Vector3( 0.0f, 0.1f, -1.0f), target},
+                {0.25f, Vector3(-0.6f, 0.1f, -0.9f), target},
+                {0.75f, Vector3( 0.6f, 0.1f, -0.9f), target},
+                {1.0f,  Vector3( 0.0f, 0.1f, -1.0f), target}
+            },
+            {
+                {
+                    2,
+                    {
+                        {0.0f,  innerSpherePosition},
+                        {0.25f, innerSpherePosition + Vector3(0.0f,  0.2f, 0.0f)},
+                        {0.75f, innerSpherePosition + Vector3(0.0f, -0.2f, 0.0f)},
+                        {1.0f,  innerSpherePosition}
+                    }
+                },
+                {
+                    5,
+                    {
+                        {0.0f, floatingSpherePosition},
+                        {0.5f, floatingSpherePosition + Vector3(0.0f, -0.25f, 0.0f)},
+                        {1.0f, floatingSpherePosition}
+                    }
+                }
+            }
+        };
+    }
+    }
+
+    assert(false && "unknown scene type");
+    return {};
+}
+
+Camera CreateAnimatedCamera(
+    const Animation &  animation,
+    const float        time,
+    const float        projectionWidth,
+    const float        projectionHeight,
+    const CameraLens & lens
+)
+{
+    const std::vector<CameraKeyframe> & keyframes = animation.CameraKeyframes;
+
+    float        easedFraction = 0.0f;
+    const size_t index         = FindKeyframeSegment(keyframes, time, easedFraction);
+
+    const Vector3 origin = keyframes[index].Origin + easedFraction*(keyframes[index + 1].Origin - keyframes[index].Origin);
+    const Vector3 target = keyframes[index].Target + easedFraction*(keyframes[index + 1].Target - keyframes[index].Target);
+
+    const Vector3 forward = (target - origin).normalized();
+
+    // As in CameraController, the projection plane is only undistorted with an up direction orthogonal to the view direction
+    const Vector3 right = WORLD_UP.cross(forward).normalized();
+    const Vector3 up    = forward.cross(right);
+
+    return Camera(origin, origin + forward, up, projectionWidth, projectionHeight, lens);
+}
+
+void MakeAnimatedSpheresMoving(const Animation & animation, std::vector<Body> & bodies)
+{
+    for (const BodyTrack & track : animation.BodyTracks)
+    {
+        assert(track.BodyIndex < bodies.size());
+
+        const SphereRayTarget & sphere = GetSphere(bodies[track.BodyIndex]);
+
+        bodies[track.BodyIndex].RayTarget = std::make_shared<MovingSphereRayTarget>(
+            std::vector<Vector3>{sphere.GetCenter()},
+            sphere.GetRadius()
+        );
+    }
+}
+
+void AnimateScene(
+    const Animation & animation,
+    const float       time,
+    const float       shutterDuration,
+    Scene &           scene,
+    ThreadPool &      threadPool
+)
+{
+    const ScopedTimelineEvent event("scene animation", "tracks", static_cast<std::int64_t>(animation.BodyTracks.size()));
+
+    const std::vector<Body> & bodies = scene.GetBodies();
+
+    for (const BodyTrack & track : animation.BodyTracks)
+    {
+        assert(track.BodyIndex < bodies.size());
+
+        // Targets are shared by pointer, so the scene's own sphere gets moved
+        IRayTarget * const pTarget = bodies[track.BodyIndex].RayTarget.get();
+
+        if (MovingSphereRayTarget * const pMovingSphere = dynamic_cast<MovingSphereRayTarget *>(pTarget))
+        {
+            std::vector<Vector3> centers(MOTION_BLUR_SEGMENT_COUNT + 1);
+            for (size_t i = 0; i < centers.size(); i++)
+            {
+                const float shutterTime = shutterDuration*static_cast<float>(i)/static_cast<float>(MOTION_BLUR_SEGMENT_COUNT);
+
+                centers[i] = InterpolatePosition(track.Keyframes, time + shutterTime);
+            }
+
+            pMovingSphere->SetCenters(std::move(centers));
+            continue;
+        }
+
+        SphereRayTarget * const pSphere = dynamic_cast<SphereRayTarget *>(pTarget);
+        assert(pSphere != nullptr && "only spheres can be animated");
+
+        pSphere->SetCenter(InterpolatePosition(track.Keyframes, time));
+    }
+
+    scene.UpdateAccelerationStructure(threadPool);
+}
+
+//
+// Service
+//
+
+template <typename Keyframe>
+static size_t FindKeyframeSegment(const std::vector<Keyframe> & keyframes, const float time, float & easedFraction)
+{
+    assert(keyframes.size() >= 2 && keyframes.front().Time == 0.0f && keyframes.back().Time == 1.0f);
+
+    const float clampedTime = std::clamp(time, 0.0f, 1.0f);
+
+    const auto nextIt = std::upper_bound(
+        keyframes.cbegin() + 1,
+        keyframes.cend() - 1,
+        clampedTime,
+        [](const float value, const Keyframe & keyframe) { return value < keyframe.Time; }
+    );
+
+    const Keyframe & next     = *nextIt;
+    const Keyframe & previous = *(nextIt - 1);
+
+    easedFraction = EaseInOut((clampedTime - previous.Time)/(next.Time - previous.Time));
+
+    return static_cast<size_t>(nextIt - keyframes.cbegin()) - 1;
+}
+
+static inline float EaseInOut(const float fraction)
+{
+    return fraction*fraction*(3.0f - 2.0f*fraction);
+}
+
+static Vector3 InterpolatePosition(const std::vector<PositionKeyframe> & keyframes, const float time)
+{
+    float        easedFraction = 0.0f;
+    const size_t index         = FindKeyframeSegment(keyframes, time, easedFraction);
+
+    return keyframes[index].Position + easedFraction*(keyframes[index + 1].Position - keyframes[index].Position);
+}
+
+static inline const SphereRayTarget & GetSphere(const Body & body)
+{
+    const SphereRayTarget * const pSphere = dynamic_cast<const SphereRayTarget *>(body.RayTarget.get());
+    assert(pSphere != nullptr && "only spheres can be animated");
+
+    return *pSphere;
+}
+
+static BodyTrack CreateHopTrack(
+    const size_t    bodyIndex,
+    const Vector3 & restPosition,
+    const float     height,
+    const float     startTime,
+    const float     duration
+)
+{
+    assert(startTime >= 0.0f && startTime + duration <= 1.0f);
+
+    const Vector3 topPosition = restPosition + Vector3(0.0f, height, 0.0f);
+
+    BodyTrack track{bodyIndex, {{0.0f, restPosition}}};
+
+    if (startTime > 0.0f)
+        track.Keyframes.push_back({startTime, restPosition});
+
+    track.Keyframes.push_back({startTime + 0.5f*duration, topPosition});
+    track.Keyframes.push_back({startTime + duration, restPosition});
+
+    if (startTime + duration < 1.0f)
+        track.Keyframes.push_back({1.0f, restPosition});
+
+    return track;
+}
+
+} // namespace rtwe
@@ -0,0 +1,102 @@
+#ifndef RTWE_ANIMATION_H
+#define RTWE_ANIMATION_H
+
+#include <vector>
+
+#include "types.h"
+#include "tracing.h"
+#include "scenes.h"
+#include "Camera.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class Scene;
+class ThreadPool;
+
+//
+// Interface types
+//
+
+/**
+ * @brief Camera at the given time, looking at the target, with times in [0, 1] over one loop of the animation.
+ */
+struct CameraKeyframe final
+{
+    float   Time;
+    Vector3 Origin;
+    Vector3 Target;
+};
+
+struct PositionKeyframe final
+{
+    float   Time;
+    Vector3 Position;
+};
+
+/**
+ * @brief Keyframes of a sphere's center; other bodies can't be moved.
+ */
+struct BodyTrack final
+{
+    size_t                        BodyIndex;
+    std::vector<PositionKeyframe> Keyframes;
+};
+
+/**
+ * @brief Looping animation of the camera and bodies of a scene, whose keyframes must start at time 0 and end at time 1.
+ *
+ * Motion between keyframes is eased in and out, so that it's smooth where it stops or turns around, e.g. at the ends of a hop.
+ */
+struct Animation final
+{
+    std::vector<CameraKeyframe> CameraKeyframes;
+    std::vector<BodyTrack>      BodyTracks;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Animation of one of the canonical scenes, whose bodies are needed for where its spheres rest.
+ */
+Animation CreateSceneAnimation(const SceneType type, const std::vector<Body> & bodies);
+
+/**
+ * @brief Camera at the given time, with its projection plane at unit distance, like that of CameraController.
+ */
+Camera CreateAnimatedCamera(
+    const Animation &  animation,
+    const float        time,
+    const float        projectionWidth,
+    const float        projectionHeight,
+    const CameraLens & lens = PINHOLE_CAMERA_LENS
+);
+
+/**
+ * @brief Replaces spheres which the animation moves with moving ones, so that their motion can be blurred.
+ */
+void MakeAnimatedSpheresMoving(const Animation & animation, std::vector<Body> & bodies);
+
+/**
+ * @brief Moves the scene's spheres to where they are at the given time, then brings its acceleration structure up to date.
+ *
+ * Spheres made moving by MakeAnimatedSpheresMoving() follow their paths over the shutter interval instead,
+ * which starts at the given time and lasts for the given duration, in the same units.
+ */
+void AnimateScene(
+    const Animation & animation,
+    const float       time,
+    const float       shutterDuration,
+    Scene &           scene,
+    ThreadPool &      threadPool
+);
+
+} // namespace rtwe
+
+#endif // RTWE_ANIMATION_H
@@ -0,0 +1,67 @@
+#include "binary_files.h"
+
+#include <filesystem>
+#include <boost/log/trivial.hpp>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const char * const TEMPORARY_FILE_SUFFIX = ".tmp";
+
+//
+// Construction
+//
+
+ReplacingFileWriter::ReplacingFileWriter(std::string path):
+    m_Path         (std::move(path)),
+    m_TemporaryPath(m_Path + TEMPORARY_FILE_SUFFIX),
+    m_File         (m_TemporaryPath, std::ios::binary | std::ios::trunc),
+    m_IsCommitted  (false)
+{
+    // Empty
+}
+
+ReplacingFileWriter::~ReplacingFileWriter()
+{
+    if (m_IsCommitted)
+        return;
+
+    m_File.close();
+
+    std::error_code error;
+    std::filesystem::remove(m_TemporaryPath, error);
+}
+
+//
+// Interface
+//
+
+bool ReplacingFileWriter::Commit()
+{
+    m_File.close();
+
+    if (!m_File)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to write " << m_TemporaryPath;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(m_TemporaryPath, m_Path, error);
+
+    if (error)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to rename " << m_TemporaryPath << " to " << m_Path << ": " << error.message();
+        return false;
+    }
+
+    m_IsCommitted = true;
+
+    return true;
+}
+
+} // namespace rtwe
@@ -0,0 +1,88 @@
+#ifndef RTWE_BINARY_FILES_H
+#define RTWE_BINARY_FILES_H
+
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace rtwe
+{
+
+//
+// ReplacingFileWriter
+//
+
+/**
+ * @brief Writes a file by way of a temporary one next to it, which only replaces the file once it's complete,
+ * so that a process killed or failing while writing leaves the previous file intact.
+ *
+ * The temporary file is removed if the writer is destroyed without committing, e.g. when writing is abandoned halfway.
+ */
+class ReplacingFileWriter final
+{
+public: // Construction
+
+    explicit ReplacingFileWriter(std::string path);
+
+    ~ReplacingFileWriter();
+
+public: // Deleted
+
+    ReplacingFileWriter(const ReplacingFileWriter&) = delete;
+    ReplacingFileWriter(ReplacingFileWriter&&)      = delete;
+
+    ReplacingFileWriter& operator=(const ReplacingFileWriter&) = delete;
+    ReplacingFileWriter& operator=(ReplacingFileWriter&&)      = delete;
+
+public: // Interface
+
+    inline std::ostream & GetStream();
+
+    /**
+     * @brief Closes the temporary file and renames it over the path, which replaces it in one step on both POSIX and Windows.
+     *
+     * @return Whether everything written got to the file; failures are logged.
+     */
+    bool Commit();
+
+private: // Members
+
+    const std::string m_Path;
+    const std::string m_TemporaryPath;
+
+    std::ofstream m_File;
+    bool          m_IsCommitted;
+};
+
+//
+// Interface
+//
+
+inline std::ostream & ReplacingFileWriter::GetStream()
+{
+    return m_File;
+}
+
+//
+// Utilities
+//
+
+/**
+ * @brief Writes the value's bytes as they are, in native byte order, for files meant to be read on the machine which wrote them.
+ */
+template <typename T>
+inline void WriteValue(std::ostream & stream, const T & value)
+{
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool TryReadValue(std::istream & stream, T & value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+} // namespace rtwe
+
+#endif // RTWE_BINARY_FILES_H
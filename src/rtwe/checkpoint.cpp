@@ -0,0 +1,239 @@
+#include "checkpoint.h"
+
+#include <array>
+#include <cassert>
+#include <fstream>
+#include <boost/log/trivial.hpp>
+
+#include "binary_files.h"
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const std::array<char, 8> CHECKPOINT_MAGIC{'R', 'T', 'W', 'E', 'C', 'K', 'P', 'T'};
+
+constexpr std::uint32_t CHECKPOINT_VERSION = 4;
+
+//
+// Service
+//
+
+static bool TryReadHeader(std::istream & stream, CheckpointHeader & header);
+
+//
+// Construction
+//
+
+CheckpointWriter::CheckpointWriter(std::string path):
+    m_Path      (std::move(path)),
+    m_IsStopping(false)
+{
+    m_WriterThread = std::thread(&CheckpointWriter::writeLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_CheckpointPendingCondition.notify_one();
+    m_WriterThread.join();
+}
+
+//
+// Interface
+//
+
+void CheckpointWriter::Write(Checkpoint checkpoint)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_PendingCheckpoint = std::move(checkpoint);
+    }
+
+    m_CheckpointPendingCondition.notify_one();
+}
+
+//
+// Service
+//
+
+void CheckpointWriter::writeLoop()
+{
+    NameTimelineThread("checkpoint");
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        m_CheckpointPendingCondition.wait(lock, [this]() { return m_PendingCheckpoint.has_value() || m_IsStopping; });
+
+        // Stopping only once the pending checkpoint is written, as it's the most recent progress
+        if (!m_PendingCheckpoint.has_value())
+            return;
+
+        const Checkpoint checkpoint = std::move(*m_PendingCheckpoint);
+        m_PendingCheckpoint.reset();
+
+        lock.unlock();
+        SaveCheckpoint(checkpoint, m_Path);
+        lock.lock();
+    }
+}
+
+//
+// Utilities
+//
+
+bool SaveCheckpoint(const Checkpoint & checkpoint, const std::string & path)
+{
+    const ScopedTimelineEvent event("checkpoint write", "passes", checkpoint.Header.CompletedPassCount);
+
+    const CheckpointHeader & header = checkpoint.Header;
+
+    assert(checkpoint.PixelRgbs.size() == static_cast<size_t>(header.ImageWidth)*header.ImageHeight);
+    assert(checkpoint.SampleCounts.size() == checkpoint.PixelRgbs.size());
+
+    ReplacingFileWriter writer(path);
+    std::ostream &      file = writer.GetStream();
+
+    file.write(CHECKPOINT_MAGIC.data(), CHECKPOINT_MAGIC.size());
+    WriteValue(file, CHECKPOINT_VERSION);
+    WriteValue(file, static_cast<std::int32_t>(header.ImageWidth));
+    WriteValue(file, static_cast<std::int32_t>(header.ImageHeight));
+    WriteValue(file, static_cast<std::int32_t>(header.Scene));
+    WriteValue(file, static_cast<std::int32_t>(header.Sampler));
+    WriteValue(file, header.SamplerSeed);
+    WriteValue(file, header.Lens.ApertureRadius);
+    WriteValue(file, header.Lens.FocusDistance);
+    WriteValue(file, static_cast<std::int32_t>(header.Integrator));
+    WriteValue(file, static_cast<std::uint8_t>(header.IntegrationOptions.UsePrimaryRayPackets ? 1 : 0));
+    WriteValue(file, static_cast<std::uint8_t>(header.IntegrationOptions.SortSecondaryRays ? 1 : 0));
+    WriteValue(file, static_cast<std::int64_t>(header.CompletedPassCount));
+
+    for (const Vector3 & pixelRgb : checkpoint.PixelRgbs)
+        file.write(reinterpret_cast<const char *>(pixelRgb.data()), 3*sizeof(float));
+
+    file.write(reinterpret_cast<const char *>(checkpoint.SampleCounts.data()), checkpoint.SampleCounts.size()*sizeof(float));
+
+    if (!writer.Commit())
+        return false;
+
+    BOOST_LOG_TRIVIAL(info) << "Saved checkpoint with " << header.CompletedPassCount << " passes to " << path;
+
+    return true;
+}
+
+std::optional<CheckpointHeader> LoadCheckpointHeader(const std::string & path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    CheckpointHeader header;
+    if (!file || !TryReadHeader(file, header))
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read checkpoint header from " << path;
+        return std::nullopt;
+    }
+
+    return header;
+}
+
+std::optional<Checkpoint> LoadCheckpoint(const std::string & path)
+{
+    const ScopedTimelineEvent event("checkpoint read");
+
+    std::ifstream file(path, std::ios::binary);
+
+    Checkpoint checkpoint;
+    if (!file || !TryReadHeader(file, checkpoint.Header))
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read checkpoint header from " << path;
+        return std::nullopt;
+    }
+
+    const size_t pixelCount = static_cast<size_t>(checkpoint.Header.ImageWidth)*checkpoint.Header.ImageHeight;
+
+    checkpoint.PixelRgbs.resize(pixelCount);
+    checkpoint.SampleCounts.resize(pixelCount);
+
+    for (Vector3 & pixelRgb : checkpoint.PixelRgbs)
+        file.read(reinterpret_cast<char *>(pixelRgb.data()), 3*sizeof(float));
+
+    file.read(reinterpret_cast<char *>(checkpoint.SampleCounts.data()), pixelCount*sizeof(float));
+
+    // Anything past the samples means the file isn't what its header says either
+    if (!file || file.peek() != std::ifstream::traits_type::eof())
+    {
+        BOOST_LOG_TRIVIAL(error) << "Checkpoint " << path << " is truncated or corrupt";
+        return std::nullopt;
+    }
+
+    return checkpoint;
+}
+
+//
+// Service
+//
+
+static bool TryReadHeader(std::istream & stream, CheckpointHeader & header)
+{
+    std::array<char, CHECKPOINT_MAGIC.size()> magic;
+
+    std::uint32_t version            = 0;
+    std::int32_t  imageWidth         = 0;
+    std::int32_t  imageHeight        = 0;
+    std::int32_t  scene              = 0;
+    std::int32_t  sampler            = 0;
+    std::uint32_t samplerSeed        = 0;
+    float         apertureRadius     = 0.0f;
+    float         focusDistance      = 0.0f;
+    std::int32_t  integrator         = 0;
+    std::uint8_t  usePrimaryPackets  = 0;
+    std::uint8_t  sortSecondaryRays  = 0;
+    std::int64_t  completedPassCount = 0;
+
+    const bool isRead = stream.read(magic.data(), magic.size())
+        && TryReadValue(stream, version)
+        && TryReadValue(stream, imageWidth)
+        && TryReadValue(stream, imageHeight)
+        && TryReadValue(stream, scene)
+        && TryReadValue(stream, sampler)
+        && TryReadValue(stream, samplerSeed)
+        && TryReadValue(stream, apertureRadius)
+        && TryReadValue(stream, focusDistance)
+        && TryReadValue(stream, integrator)
+        && TryReadValue(stream, usePrimaryPackets)
+        && TryReadValue(stream, sortSecondaryRays)
+        && TryReadValue(stream, completedPassCount);
+
+    if (!isRead || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION)
+        return false;
+
+    if (imageWidth <= 0 || imageHeight <= 0 || scene < 0 || scene >= SCENE_TYPE_COUNT || sampler < 0 || sampler >= SAMPLER_TYPE_COUNT
+        || !(apertureRadius >= 0.0f && focusDistance > 0.0f) || integrator < 0 || integrator >= INTEGRATOR_TYPE_COUNT
+        || usePrimaryPackets > 1 || sortSecondaryRays > 1 || completedPassCount < 0)
+        return false;
+
+    header = CheckpointHeader{
+        imageWidth,
+        imageHeight,
+        static_cast<SceneType>(scene),
+        static_cast<SamplerType>(sampler),
+        samplerSeed,
+        CameraLens{apertureRadius, focusDistance},
+        static_cast<IntegratorType>(integrator),
+        IntegratorOptions{usePrimaryPackets != 0, sortSecondaryRays != 0},
+        static_cast<long>(completedPassCount)
+    };
+
+    return true;
+}
+
+} // namespace rtwe
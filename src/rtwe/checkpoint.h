@@ -0,0 +1,127 @@
+#ifndef RTWE_CHECKPOINT_H
+#define RTWE_CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "Camera.h"
+#include "integrators.h"
+#include "sampling.h"
+#include "scenes.h"
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+/**
+ * @brief What a checkpoint was rendered with, which a resumed render must match.
+ */
+struct CheckpointHeader final
+{
+    int               ImageWidth;
+    int               ImageHeight;
+    SceneType         Scene;
+    SamplerType       Sampler;
+    std::uint32_t     SamplerSeed;
+    CameraLens        Lens;
+    IntegratorType    Integrator;
+    IntegratorOptions IntegrationOptions;
+    long              CompletedPassCount;
+};
+
+/**
+ * @brief Progress of a render: accumulated sums and sample counts of all pixels, row by row.
+ *
+ * Samplers are stateless, so along with the seed, per-pixel sample counts are all the state needed to continue each pixel's
+ * sample sequence exactly where it left off.
+ */
+struct Checkpoint final
+{
+    CheckpointHeader     Header;
+    std::vector<Vector3> PixelRgbs;
+    std::vector<float>   SampleCounts;
+};
+
+//
+// CheckpointWriter
+//
+
+/**
+ * @brief Saves checkpoints on a thread of its own, so that rendering goes on while they're written.
+ *
+ * If checkpoints are submitted faster than they can be written, only the latest of the pending ones gets written.
+ */
+class CheckpointWriter final
+{
+public: // Construction
+
+    explicit CheckpointWriter(std::string path);
+
+    /**
+     * @brief Waits for the pending checkpoint, if any, to be written.
+     */
+    ~CheckpointWriter();
+
+public: // Deleted
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter(CheckpointWriter&&)      = delete;
+
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(CheckpointWriter&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Hands the checkpoint over to the writing thread and returns right away.
+     */
+    void Write(Checkpoint checkpoint);
+
+private: // Service
+
+    void writeLoop();
+
+private: // Members
+
+    const std::string m_Path;
+
+    std::mutex                m_Mutex;
+    std::condition_variable   m_CheckpointPendingCondition;
+    std::optional<Checkpoint> m_PendingCheckpoint;
+    bool                      m_IsStopping;
+
+    std::thread m_WriterThread;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Writes the checkpoint to a temporary file next to the given path, then renames it over the path,
+ * so that a render killed while writing leaves the previous checkpoint intact.
+ *
+ * The format is a small header followed by raw floats in native byte order, as checkpoints are meant to be resumed
+ * on the machine which wrote them.
+ */
+bool SaveCheckpoint(const Checkpoint & checkpoint, const std::string & path);
+
+/**
+ * @brief Reads just the header, e.g. to check what a checkpoint was rendered with before loading it whole.
+ */
+std::optional<CheckpointHeader> LoadCheckpointHeader(const std::string & path);
+
+std::optional<Checkpoint> LoadCheckpoint(const std::string & path);
+
+} // namespace rtwe
+
+#endif // RTWE_CHECKPOINT_H
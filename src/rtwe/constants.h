@@ -8,6 +8,8 @@ namespace rtwe
 
 constexpr float EPSILON = std::numeric_limits<float>::epsilon();
 
+constexpr float PI = 3.14159265358979323846f;
+
 #ifdef NDEBUG
 #define RTWE_RELEASE
 constexpr bool IS_RELEASE = true;
@@ -20,6 +22,8 @@ constexpr bool IS_DEBUG = !IS_RELEASE;
 
 constexpr float RAYTRACE_MIN_RAY_PARAM = 0.0001f;
 
+constexpr int MAX_RAY_TRACE_DEPTH = 8;
+
 constexpr float ENVIRONMENT_REFRACTIVE_INDEX = 1.0f;
 
 }
@@ -0,0 +1,708 @@
+#include "farm.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <sstream>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/dll/runtime_symbol_info.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/process/args.hpp>
+#include <boost/process/child.hpp>
+
+#include "timeline.h"
+
+namespace rtwe
+{
+
+using boost::asio::ip::tcp;
+
+//
+// Constants
+//
+
+static const std::array<char, 8> FARM_MAGIC{'R', 'T', 'W', 'E', 'F', 'A', 'R', 'M'};
+
+// Messages are raw values in native byte order, so a worker of another byte order fails the check too
+constexpr std::uint32_t FARM_PROTOCOL_VERSION = 3;
+
+static_assert(sizeof(Vector3) == 3*sizeof(float), "pixel sums must be sent as one array of floats");
+
+// Jobs of a few passes each balance the load among several workers, while keeping the overhead of sending results low;
+// the number of jobs doesn't depend on the number of workers, so that deterministic renders come out the same with any of them
+const long FarmCoordinator::FARM_JOB_COUNT = 32;
+
+const int FarmCoordinator::ACCEPT_POLL_INTERVAL_MS = 20;
+
+//
+// Service
+//
+
+template <typename T>
+static inline void AppendValue(std::vector<char> & message, const T & value);
+
+template <typename T>
+static inline T ReadValue(tcp::socket & socket);
+
+static void WriteHello(tcp::socket & socket);
+
+static bool TryReadHello(tcp::socket & socket);
+
+static void WriteConfig(tcp::socket & socket, const FarmConfig & config);
+
+static FarmConfig ReadConfig(tcp::socket & socket);
+
+static void WriteJob(tcp::socket & socket, const FarmJob & job);
+
+static FarmJob ReadJob(tcp::socket & socket);
+
+static void WriteJobResult(tcp::socket & socket, const FarmJobResult & result);
+
+/**
+ * @param ioContext Context of the socket, which mustn't be run by any other thread.
+ *
+ * @throws boost::system::system_error If the connection breaks off, the result isn't one of the given size,
+ * or it isn't all read by the deadline.
+ */
+static FarmJobResult ReadJobResult(
+    boost::asio::io_context &                   ioContext,
+    tcp::socket &                               socket,
+    const int                                   imageWidth,
+    const int                                   imageHeight,
+    const std::chrono::steady_clock::time_point deadline
+);
+
+/**
+ * @brief All interfaces for the given port, or an ephemeral port on the loopback interface, which only local workers can connect to.
+ */
+static tcp::endpoint CreateListeningEndpoint(const unsigned short port);
+
+static std::string DescribeEndpoint(const tcp::socket & socket);
+
+//
+// Construction
+//
+
+FarmCoordinator::FarmCoordinator(FarmConfig config, const long passCount, const unsigned short port, const long jobTimeoutSeconds):
+    m_Config              (std::move(config)),
+    m_PassCount           (passCount),
+    m_AcceptsRemoteWorkers(port != 0),
+    m_JobTimeout          (jobTimeoutSeconds),
+    m_IoContext           (),
+    m_Acceptor            (m_IoContext, CreateListeningEndpoint(port)),
+    m_JobCount            (0),
+    m_MergedJobCount      (0),
+    m_ReassignedJobCount  (0),
+    m_ConnectedWorkerCount(0),
+    m_Seconds             (0.0),
+    m_PixelRgbs           (static_cast<size_t>(m_Config.ImageWidth)*m_Config.ImageHeight, Vector3::Zero()),
+    m_SampleCounts        (m_PixelRgbs.size(), 0.0f)
+{
+    assert(m_PassCount > 0);
+    assert(m_JobTimeout.count() > 0);
+
+    const long jobPassCount = (m_PassCount + FARM_JOB_COUNT - 1)/FARM_JOB_COUNT;
+
+    for (long firstPassIndex = 0; firstPassIndex < m_PassCount; firstPassIndex += jobPassCount)
+        m_QueuedJobs.push_back(FarmJob{m_JobCount++, firstPassIndex, std::min(jobPassCount, m_PassCount - firstPassIndex)});
+
+    std::reverse(m_QueuedJobs.begin(), m_QueuedJobs.end());
+}
+
+FarmCoordinator::~FarmCoordinator()
+{
+    for (const std::unique_ptr<boost::process::child> & pLocalWorker : m_LocalWorkers)
+    {
+        std::error_code error;
+        if (pLocalWorker->running(error))
+            pLocalWorker->terminate(error);
+    }
+
+    // Threads of workers which are still connected return once their sockets get closed along with the processes
+    for (std::thread & workerThread : m_WorkerThreads)
+        workerThread.join();
+}
+
+//
+// Interface
+//
+
+bool FarmCoordinator::Run(const long localWorkerCount, const std::vector<std::string> & localWorkerArguments)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    try
+    {
+        const auto executablePath = boost::dll::program_location();
+
+        for (long i = 0; i < localWorkerCount; i++)
+            m_LocalWorkers.push_back(std::make_unique<boost::process::child>(executablePath, boost::process::args(localWorkerArguments)));
+    }
+    catch (const std::exception & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to start local workers: " << exception.what();
+        return false;
+    }
+
+    // Accepting is polled, so that this thread also notices when there are no workers left to do the remaining jobs
+    m_Acceptor.non_blocking(true);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (!areAllJobsDone())
+    {
+        lock.unlock();
+
+        // Each worker's socket gets a context of its own, which its thread runs while reading a result
+        auto                      ioContext = std::make_unique<boost::asio::io_context>();
+        boost::system::error_code error;
+        tcp::socket               socket(*ioContext);
+
+        m_Acceptor.accept(socket, error);
+
+        lock.lock();
+
+        if (!error)
+        {
+            socket.set_option(tcp::no_delay(true));
+            socket.set_option(boost::asio::socket_base::keep_alive(true));
+
+            const size_t workerIndex = m_WorkerReports.size();
+
+            m_WorkerReports.push_back(FarmWorkerReport{DescribeEndpoint(socket), 0, 0.0, false});
+            m_ConnectedWorkerCount++;
+
+            BOOST_LOG_TRIVIAL(info) << "Worker " << workerIndex << " connected from " << m_WorkerReports.back().Address;
+
+            m_WorkerThreads.emplace_back(&FarmCoordinator::serveWorker, this, std::move(ioContext), std::move(socket), workerIndex);
+            continue;
+        }
+
+        if (error != boost::asio::error::would_block && error != boost::asio::error::try_again)
+            BOOST_LOG_TRIVIAL(error) << "Failed to accept a worker: " << error.message();
+
+        if (m_ConnectedWorkerCount == 0 && !m_AcceptsRemoteWorkers && !isAnyLocalWorkerRunning())
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "All workers are gone with " << m_JobCount - m_MergedJobCount << " of " << m_JobCount << " jobs left";
+            return false;
+        }
+
+        m_JobsChangedCondition.wait_for(lock, std::chrono::milliseconds(ACCEPT_POLL_INTERVAL_MS));
+    }
+
+    m_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    lock.unlock();
+
+    // Workers waiting for jobs get told to exit once all are done, so their threads and processes finish by themselves
+    for (std::thread & workerThread : m_WorkerThreads)
+        workerThread.join();
+
+    m_WorkerThreads.clear();
+
+    for (const std::unique_ptr<boost::process::child> & pLocalWorker : m_LocalWorkers)
+    {
+        std::error_code error;
+        pLocalWorker->wait(error);
+    }
+
+    return true;
+}
+
+FarmReport FarmCoordinator::GetReport() const
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+
+    const std::uint64_t sampleCount = static_cast<std::uint64_t>(m_PixelRgbs.size())*static_cast<std::uint64_t>(m_PassCount);
+
+    return FarmReport{m_Seconds, sampleCount, m_JobCount, m_ReassignedJobCount, m_WorkerReports};
+}
+
+//
+// Service
+//
+
+void FarmCoordinator::serveWorker(std::unique_ptr<boost::asio::io_context> ioContext, tcp::socket socket, const size_t workerIndex)
+{
+    NameTimelineThread("farm connection");
+
+    std::optional<FarmJob> job;
+    bool                   isLost = false;
+
+    try
+    {
+        if (TryReadHello(socket))
+        {
+            WriteConfig(socket, m_Config);
+
+            while ((job = takeJob()).has_value())
+            {
+                const auto deadline = std::chrono::steady_clock::now() + m_JobTimeout;
+
+                WriteJob(socket, *job);
+
+                FarmJobResult result = ReadJobResult(*ioContext, socket, m_Config.ImageWidth, m_Config.ImageHeight, deadline);
+
+                if (result.JobIndex != job->Index)
+                    throw boost::system::system_error(boost::asio::error::invalid_argument, "result of another job");
+
+                job.reset();
+                completeJob(std::move(result), workerIndex);
+            }
+
+            // A job with no passes tells the worker to exit
+            WriteJob(socket, FarmJob{-1, 0, 0});
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(error) << "Worker " << workerIndex << " isn't an rtwe worker of the same version, disconnecting it";
+            isLost = true;
+        }
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Lost worker " << workerIndex << ": " << exception.what();
+        isLost = true;
+
+        if (job.has_value())
+            requeueJob(*job);
+    }
+
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_WorkerReports[workerIndex].IsLost = isLost;
+    m_ConnectedWorkerCount--;
+    m_JobsChangedCondition.notify_all();
+}
+
+std::optional<FarmJob> FarmCoordinator::takeJob()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    // Jobs handed out to other workers may still come back, if those workers die
+    m_JobsChangedCondition.wait(lock, [this]() { return !m_QueuedJobs.empty() || areAllJobsDone(); });
+
+    if (m_QueuedJobs.empty())
+        return std::nullopt;
+
+    const FarmJob job = m_QueuedJobs.back();
+    m_QueuedJobs.pop_back();
+
+    return job;
+}
+
+void FarmCoordinator::requeueJob(const FarmJob & job)
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Earliest jobs first, as later results wait for them to be merged
+    m_QueuedJobs.insert(
+        std::upper_bound(
+            m_QueuedJobs.begin(),
+            m_QueuedJobs.end(),
+            job,
+            [](const FarmJob & lhs, const FarmJob & rhs) { return lhs.Index > rhs.Index; }
+        ),
+        job
+    );
+
+    m_ReassignedJobCount++;
+
+    BOOST_LOG_TRIVIAL(info) << "Job " << job.Index << " goes back to the queue";
+
+    m_JobsChangedCondition.notify_all();
+}
+
+void FarmCoordinator::completeJob(FarmJobResult result, const size_t workerIndex)
+{
+    const ScopedTimelineEvent event("farm merge", "job", result.JobIndex);
+
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+
+    FarmWorkerReport & workerReport = m_WorkerReports[workerIndex];
+    workerReport.CompletedJobCount++;
+    workerReport.RenderSeconds += result.RenderSeconds;
+
+    m_UnmergedResults.emplace(result.JobIndex, std::move(result));
+
+    // Float sums depend on the order of additions, which is kept the same by merging jobs in order
+    for (auto resultIt = m_UnmergedResults.begin(); resultIt != m_UnmergedResults.end() && resultIt->first == m_MergedJobCount;)
+    {
+        const FarmJobResult & mergedResult = resultIt->second;
+
+        for (size_t i = 0; i < m_PixelRgbs.size(); i++)
+        {
+            m_PixelRgbs[i]    += mergedResult.PixelRgbs[i];
+            m_SampleCounts[i] += mergedResult.SampleCounts[i];
+        }
+
+        resultIt = m_UnmergedResults.erase(resultIt);
+        m_MergedJobCount++;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Worker " << workerIndex << " completed a job, " << m_MergedJobCount << " of " << m_JobCount << " merged";
+
+    m_JobsChangedCondition.notify_all();
+}
+
+bool FarmCoordinator::areAllJobsDone() const
+{
+    return m_MergedJobCount == m_JobCount;
+}
+
+bool FarmCoordinator::isAnyLocalWorkerRunning()
+{
+    return std::any_of(
+        m_LocalWorkers.begin(),
+        m_LocalWorkers.end(),
+        [](const std::unique_ptr<boost::process::child> & pLocalWorker) {
+            std::error_code error;
+            return pLocalWorker->running(error);
+        }
+    );
+}
+
+//
+// FarmWorkerConnection
+//
+
+FarmWorkerConnection::FarmWorkerConnection(std::unique_ptr<boost::asio::io_context> ioContext, tcp::socket socket):
+    m_IoContext  (std::move(ioContext)),
+    m_Socket     (std::move(socket)),
+    m_ImageWidth (0),
+    m_ImageHeight(0)
+{
+    // Empty
+}
+
+std::optional<FarmWorkerConnection> FarmWorkerConnection::Connect(const std::string & coordinatorAddress)
+{
+    const size_t separatorIndex = coordinatorAddress.rfind(':');
+    if (separatorIndex == std::string::npos)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Coordinator address " << coordinatorAddress << " lacks a port, expected <host>:<port>";
+        return std::nullopt;
+    }
+
+    auto        ioContext = std::make_unique<boost::asio::io_context>();
+    tcp::socket socket(*ioContext);
+
+    try
+    {
+        tcp::resolver resolver(*ioContext);
+
+        boost::asio::connect(
+            socket,
+            resolver.resolve(coordinatorAddress.substr(0, separatorIndex), coordinatorAddress.substr(separatorIndex + 1))
+        );
+
+        socket.set_option(tcp::no_delay(true));
+        socket.set_option(boost::asio::socket_base::keep_alive(true));
+
+        WriteHello(socket);
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to connect to coordinator " << coordinatorAddress << ": " << exception.what();
+        return std::nullopt;
+    }
+
+    return FarmWorkerConnection(std::move(ioContext), std::move(socket));
+}
+
+std::optional<FarmConfig> FarmWorkerConnection::ReceiveConfig()
+{
+    try
+    {
+        const FarmConfig config = ReadConfig(m_Socket);
+
+        m_ImageWidth  = config.ImageWidth;
+        m_ImageHeight = config.ImageHeight;
+
+        return config;
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to receive config from coordinator: " << exception.what();
+        return std::nullopt;
+    }
+}
+
+std::optional<FarmJob> FarmWorkerConnection::ReceiveJob()
+{
+    try
+    {
+        return ReadJob(m_Socket);
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to receive a job from coordinator: " << exception.what();
+        return std::nullopt;
+    }
+}
+
+bool FarmWorkerConnection::SendResult(const FarmJobResult & result)
+{
+    assert(result.PixelRgbs.size() == static_cast<size_t>(m_ImageWidth)*m_ImageHeight);
+    assert(result.SampleCounts.size() == result.PixelRgbs.size());
+
+    try
+    {
+        WriteJobResult(m_Socket, result);
+        return true;
+    }
+    catch (const boost::system::system_error & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to send result of job " << result.JobIndex << " to coordinator: " << exception.what();
+        return false;
+    }
+}
+
+//
+// Utilities
+//
+
+std::string DescribeFarmReport(const FarmReport & report)
+{
+    double renderSeconds   = 0.0;
+    size_t keptWorkerCount = 0;
+    for (const FarmWorkerReport & workerReport : report.Workers)
+    {
+        renderSeconds += workerReport.RenderSeconds;
+
+        if (!workerReport.IsLost)
+            keptWorkerCount++;
+    }
+
+    // A single worker would have rendered all jobs one after another, without sending any results; workers sharing cores,
+    // e.g. more local ones than hardware threads, take longer for each job, which makes the estimate too high
+    const double speedup     = report.Seconds > 0.0 ? renderSeconds/report.Seconds : 0.0;
+    const size_t workerCount = std::max<size_t>(report.Workers.size(), 1);
+
+    std::ostringstream description;
+    description.precision(3);
+    description
+        << "Farm rendered " << report.JobCount << " jobs in " << report.Seconds << " s on " << report.Workers.size() << " workers"
+        << " (" << (report.Seconds > 0.0 ? static_cast<double>(report.SampleCount)/report.Seconds/1.0e6 : 0.0) << " million samples/s"
+        << ", " << report.Workers.size() - keptWorkerCount << " workers lost, " << report.ReassignedJobCount << " jobs reassigned)"
+        << ": speedup " << speedup << " over a single worker, efficiency " << 100.0*speedup/workerCount << "%";
+
+    for (size_t i = 0; i < report.Workers.size(); i++)
+    {
+        const FarmWorkerReport & workerReport = report.Workers[i];
+
+        description
+            << "\n  worker " << i << " at " << workerReport.Address << ": " << workerReport.CompletedJobCount << " jobs"
+            << " in " << workerReport.RenderSeconds << " s"
+            << ", busy " << (report.Seconds > 0.0 ? 100.0*workerReport.RenderSeconds/report.Seconds : 0.0) << "% of the time"
+            << (workerReport.IsLost ? ", lost" : "");
+    }
+
+    return description.str();
+}
+
+//
+// Service
+//
+
+template <typename T>
+static inline void AppendValue(std::vector<char> & message, const T & value)
+{
+    const char * const pValueBytes = reinterpret_cast<const char *>(&value);
+
+    message.insert(message.end(), pValueBytes, pValueBytes + sizeof(T));
+}
+
+template <typename T>
+static inline T ReadValue(tcp::socket & socket)
+{
+    T value;
+    boost::asio::read(socket, boost::asio::buffer(&value, sizeof(T)));
+
+    return value;
+}
+
+static void WriteHello(tcp::socket & socket)
+{
+    std::vector<char> message(FARM_MAGIC.begin(), FARM_MAGIC.end());
+    AppendValue(message, FARM_PROTOCOL_VERSION);
+
+    boost::asio::write(socket, boost::asio::buffer(message));
+}
+
+static bool TryReadHello(tcp::socket & socket)
+{
+    std::array<char, FARM_MAGIC.size()> magic;
+    boost::asio::read(socket, boost::asio::buffer(magic));
+
+    return magic == FARM_MAGIC && ReadValue<std::uint32_t>(socket) == FARM_PROTOCOL_VERSION;
+}
+
+static void WriteConfig(tcp::socket & socket, const FarmConfig & config)
+{
+    std::vector<char> message;
+    AppendValue(message, static_cast<std::int32_t>(config.ImageWidth));
+    AppendValue(message, static_cast<std::int32_t>(config.ImageHeight));
+    AppendValue(message, static_cast<std::int32_t>(config.Scene));
+    AppendValue(message, static_cast<std::int32_t>(config.Sampler));
+    AppendValue(message, config.SamplerSeed);
+    AppendValue(message, static_cast<std::int32_t>(config.Integrator));
+    AppendValue(message, static_cast<std::uint8_t>(config.IntegrationOptions.UsePrimaryRayPackets));
+    AppendValue(message, static_cast<std::uint8_t>(config.IntegrationOptions.SortSecondaryRays));
+    AppendValue(message, config.Lens.ApertureRadius);
+    AppendValue(message, config.Lens.FocusDistance);
+
+    boost::asio::write(socket, boost::asio::buffer(message));
+}
+
+static FarmConfig ReadConfig(tcp::socket & socket)
+{
+    const std::int32_t  imageWidth           = ReadValue<std::int32_t>(socket);
+    const std::int32_t  imageHeight          = ReadValue<std::int32_t>(socket);
+    const std::int32_t  scene                = ReadValue<std::int32_t>(socket);
+    const std::int32_t  sampler              = ReadValue<std::int32_t>(socket);
+    const std::uint32_t samplerSeed          = ReadValue<std::uint32_t>(socket);
+    const std::int32_t  integrator           = ReadValue<std::int32_t>(socket);
+    const std::uint8_t  usePrimaryRayPackets = ReadValue<std::uint8_t>(socket);
+    const std::uint8_t  sortSecondaryRays    = ReadValue<std::uint8_t>(socket);
+    const float         apertureRadius       = ReadValue<float>(socket);
+    const float         focusDistance        = ReadValue<float>(socket);
+
+    if (imageWidth <= 0 || imageHeight <= 0 || scene < 0 || scene >= SCENE_TYPE_COUNT || sampler < 0 || sampler >= SAMPLER_TYPE_COUNT
+        || (integrator != static_cast<std::int32_t>(IntegratorType::Pixel) && integrator != static_cast<std::int32_t>(IntegratorType::Wavefront))
+        || !(apertureRadius >= 0.0f && focusDistance > 0.0f))
+        throw boost::system::system_error(boost::asio::error::invalid_argument, "invalid config");
+
+    return FarmConfig{
+        imageWidth,
+        imageHeight,
+        static_cast<SceneType>(scene),
+        static_cast<SamplerType>(sampler),
+        samplerSeed,
+        static_cast<IntegratorType>(integrator),
+        IntegratorOptions{usePrimaryRayPackets != 0, sortSecondaryRays != 0},
+        CameraLens{apertureRadius, focusDistance}
+    };
+}
+
+static void WriteJob(tcp::socket & socket, const FarmJob & job)
+{
+    std::vector<char> message;
+    AppendValue(message, static_cast<std::int64_t>(job.Index));
+    AppendValue(message, static_cast<std::int64_t>(job.FirstPassIndex));
+    AppendValue(message, static_cast<std::int64_t>(job.PassCount));
+
+    boost::asio::write(socket, boost::asio::buffer(message));
+}
+
+static FarmJob ReadJob(tcp::socket & socket)
+{
+    const std::int64_t index          = ReadValue<std::int64_t>(socket);
+    const std::int64_t firstPassIndex = ReadValue<std::int64_t>(socket);
+    const std::int64_t passCount      = ReadValue<std::int64_t>(socket);
+
+    if (firstPassIndex < 0 || passCount < 0)
+        throw boost::system::system_error(boost::asio::error::invalid_argument, "invalid job");
+
+    return FarmJob{static_cast<long>(index), static_cast<long>(firstPassIndex), static_cast<long>(passCount)};
+}
+
+static void WriteJobResult(tcp::socket & socket, const FarmJobResult & result)
+{
+    std::vector<char> header;
+    AppendValue(header, static_cast<std::int64_t>(result.JobIndex));
+    AppendValue(header, result.RenderSeconds);
+
+    const std::array<boost::asio::const_buffer, 3> buffers{
+        boost::asio::buffer(header),
+        boost::asio::buffer(result.PixelRgbs.data(), result.PixelRgbs.size()*sizeof(Vector3)),
+        boost::asio::buffer(result.SampleCounts)
+    };
+
+    boost::asio::write(socket, buffers);
+}
+
+static FarmJobResult ReadJobResult(
+    boost::asio::io_context &                   ioContext,
+    tcp::socket &                               socket,
+    const int                                   imageWidth,
+    const int                                   imageHeight,
+    const std::chrono::steady_clock::time_point deadline
+)
+{
+    const size_t pixelCount = static_cast<size_t>(imageWidth)*imageHeight;
+
+    std::int64_t  jobIndex      = 0;
+    double        renderSeconds = 0.0;
+    FarmJobResult result{0, 0.0, std::vector<Vector3>(pixelCount), std::vector<float>(pixelCount)};
+
+    const std::array<boost::asio::mutable_buffer, 4> buffers{
+        boost::asio::buffer(&jobIndex, sizeof(jobIndex)),
+        boost::asio::buffer(&renderSeconds, sizeof(renderSeconds)),
+        boost::asio::buffer(result.PixelRgbs.data(), pixelCount*sizeof(Vector3)),
+        boost::asio::buffer(result.SampleCounts)
+    };
+
+    // Reading asynchronously, as only then can it be cancelled once the deadline passes, by a timer run on the same thread
+    boost::asio::steady_timer deadlineTimer(ioContext, deadline);
+    boost::system::error_code readError;
+    bool                      isRead     = false;
+    bool                      isTimedOut = false;
+
+    boost::asio::async_read(socket, buffers, [&](const boost::system::error_code & error, const size_t /*byteCount*/) {
+        readError = error;
+        isRead    = true;
+        deadlineTimer.cancel();
+    });
+
+    deadlineTimer.async_wait([&](const boost::system::error_code & error) {
+        // The read may complete right as the timer expires, with both handlers queued
+        if (error || isRead)
+            return;
+
+        isTimedOut = true;
+        socket.cancel();
+    });
+
+    ioContext.restart();
+    ioContext.run();
+
+    if (isTimedOut)
+        throw boost::system::system_error(boost::asio::error::timed_out, "no result by the job's deadline");
+
+    if (readError)
+        throw boost::system::system_error(readError);
+
+    result.JobIndex      = static_cast<long>(jobIndex);
+    result.RenderSeconds = renderSeconds;
+
+    return result;
+}
+
+static tcp::endpoint CreateListeningEndpoint(const unsigned short port)
+{
+    return port != 0
+        ? tcp::endpoint(tcp::v4(), port)
+        : tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0);
+}
+
+static std::string DescribeEndpoint(const tcp::socket & socket)
+{
+    boost::system::error_code error;
+    const tcp::endpoint       endpoint = socket.remote_endpoint(error);
+
+    if (error)
+        return "unknown address";
+
+    std::ostringstream description;
+    description << endpoint;
+
+    return description.str();
+}
+
+} // namespace rtwe
@@ -0,0 +1,276 @@
+#ifndef RTWE_FARM_H
+#define RTWE_FARM_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "types.h"
+#include "integrators.h"
+#include "sampling.h"
+#include "scenes.h"
+#include "Camera.h"
+
+namespace boost { namespace process { class child; } }
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+/**
+ * @brief Everything a worker needs to render jobs of a frame, sent by the coordinator, so that workers take no options of their own
+ * besides the number of threads.
+ */
+struct FarmConfig final
+{
+    int               ImageWidth;
+    int               ImageHeight;
+    SceneType         Scene;
+    SamplerType       Sampler;
+    std::uint32_t     SamplerSeed;
+    IntegratorType    Integrator;
+    IntegratorOptions IntegrationOptions;
+    CameraLens        Lens;
+};
+
+/**
+ * @brief A range of passes over the whole image, i.e. of sample indices of every pixel.
+ */
+struct FarmJob final
+{
+    long Index;
+    long FirstPassIndex;
+    long PassCount;
+};
+
+/**
+ * @brief Samples of a job, accumulated from zero: merging a result means adding its sums and sample counts.
+ */
+struct FarmJobResult final
+{
+    long                 JobIndex;
+    double               RenderSeconds;
+    std::vector<Vector3> PixelRgbs;
+    std::vector<float>   SampleCounts;
+};
+
+struct FarmWorkerReport final
+{
+    std::string Address;
+    long        CompletedJobCount;
+    double      RenderSeconds;
+    bool        IsLost; // Connection broke off, e.g. as the worker died, or its result was late, with its job handed to another worker
+};
+
+struct FarmReport final
+{
+    double                        Seconds;
+    std::uint64_t                 SampleCount;
+    long                          JobCount;
+    long                          ReassignedJobCount;
+    std::vector<FarmWorkerReport> Workers;
+};
+
+//
+// FarmCoordinator
+//
+
+/**
+ * @brief Splits the samples per pixel of a frame into jobs, hands them out to worker processes over TCP and merges their results.
+ *
+ * Each connected worker is served by a thread of its own, doing blocking reads and writes. A worker whose connection breaks off,
+ * as it does when the worker process dies, has its job put back in the queue for another worker to take; so does a worker
+ * which doesn't send the result of its job in time, e.g. as it hangs, or its machine went away without closing the connection,
+ * after which it gets disconnected.
+ *
+ * Results are merged in the order of jobs, and the split into jobs doesn't depend on the number of workers, so that
+ * deterministic renders sum up to the same image with any number of them.
+ */
+class FarmCoordinator final
+{
+public: // Construction
+
+    /**
+     * @param port Port to listen on for remote workers; 0 for an ephemeral port on the loopback interface, for local workers only.
+     * @param jobTimeoutSeconds Time from handing a job out to receiving all of its result, after which it goes to another worker.
+     *
+     * @throws boost::system::system_error If the port can't be listened on, e.g. as it's in use.
+     */
+    FarmCoordinator(FarmConfig config, const long passCount, const unsigned short port, const long jobTimeoutSeconds);
+
+    /**
+     * @brief Terminates local workers which are still running, e.g. after Run() gave up.
+     */
+    ~FarmCoordinator();
+
+public: // Deleted
+
+    FarmCoordinator(const FarmCoordinator&) = delete;
+    FarmCoordinator(FarmCoordinator&&)      = delete;
+
+    FarmCoordinator& operator=(const FarmCoordinator&) = delete;
+    FarmCoordinator& operator=(FarmCoordinator&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Starts local workers, running this executable with the given arguments, and serves them along with any remote
+     * workers which connect, until all jobs are done.
+     *
+     * @return false if local workers couldn't be started, or all of them are gone with jobs left and no remote workers can connect.
+     */
+    bool Run(const long localWorkerCount, const std::vector<std::string> & localWorkerArguments);
+
+    inline unsigned short GetPort() const;
+
+    inline const std::vector<Vector3> & GetPixelRgbs() const;
+
+    inline const std::vector<float> & GetSampleCounts() const;
+
+    FarmReport GetReport() const;
+
+private: // Service
+
+    /**
+     * @param ioContext Context of the socket, of this worker's alone, so that reads of its results can be timed out on its thread.
+     */
+    void serveWorker(std::unique_ptr<boost::asio::io_context> ioContext, boost::asio::ip::tcp::socket socket, const size_t workerIndex);
+
+    /**
+     * @brief Blocks until a job is queued, or all jobs are done, in which case returns nullopt.
+     */
+    std::optional<FarmJob> takeJob();
+
+    void requeueJob(const FarmJob & job);
+
+    /**
+     * @brief Merges the result, and any results of later jobs which were waiting for it, into the accumulated samples.
+     */
+    void completeJob(FarmJobResult result, const size_t workerIndex);
+
+    bool areAllJobsDone() const;
+
+    bool isAnyLocalWorkerRunning();
+
+private: // Constants
+
+    static const long FARM_JOB_COUNT;
+
+    static const int ACCEPT_POLL_INTERVAL_MS;
+
+private: // Members
+
+    const FarmConfig           m_Config;
+    const long                 m_PassCount;
+    const bool                 m_AcceptsRemoteWorkers;
+    const std::chrono::seconds m_JobTimeout;
+
+    boost::asio::io_context        m_IoContext;
+    boost::asio::ip::tcp::acceptor m_Acceptor;
+
+    std::vector<std::unique_ptr<boost::process::child>> m_LocalWorkers;
+    std::vector<std::thread>                            m_WorkerThreads;
+
+    mutable std::mutex            m_Mutex;
+    std::condition_variable       m_JobsChangedCondition;
+    std::vector<FarmJob>          m_QueuedJobs; // Sorted by descending index, so that the next job is at the back
+    long                          m_JobCount;
+    long                          m_MergedJobCount;
+    long                          m_ReassignedJobCount;
+    std::map<long, FarmJobResult> m_UnmergedResults;
+    size_t                        m_ConnectedWorkerCount;
+    std::vector<FarmWorkerReport> m_WorkerReports;
+    double                        m_Seconds;
+
+    std::vector<Vector3> m_PixelRgbs;
+    std::vector<float>   m_SampleCounts;
+};
+
+//
+// FarmWorkerConnection
+//
+
+/**
+ * @brief Worker's end of the connection to a coordinator: receives the frame's config and jobs, and sends back results.
+ *
+ * Functions log and return nullopt or false once the connection breaks off, after which it can't be used any more.
+ */
+class FarmWorkerConnection final
+{
+public: // Construction
+
+    /**
+     * @param coordinatorAddress host:port of the coordinator.
+     */
+    static std::optional<FarmWorkerConnection> Connect(const std::string & coordinatorAddress);
+
+public: // Interface
+
+    std::optional<FarmConfig> ReceiveConfig();
+
+    /**
+     * @return A job with no passes once the coordinator has no more jobs, and the worker should exit.
+     */
+    std::optional<FarmJob> ReceiveJob();
+
+    bool SendResult(const FarmJobResult & result);
+
+private: // Construction
+
+    FarmWorkerConnection(std::unique_ptr<boost::asio::io_context> ioContext, boost::asio::ip::tcp::socket socket);
+
+private: // Members
+
+    // Owned through a pointer, so that the connection can be moved while the socket refers to it
+    std::unique_ptr<boost::asio::io_context> m_IoContext;
+    boost::asio::ip::tcp::socket             m_Socket;
+
+    int m_ImageWidth;
+    int m_ImageHeight;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Speedup of the farm over a single one of its workers, i.e. the workers' total render time over the time the frame took,
+ * and efficiency, the speedup per worker, along with what each worker did.
+ */
+std::string DescribeFarmReport(const FarmReport & report);
+
+//
+// FarmCoordinator
+//
+
+inline unsigned short FarmCoordinator::GetPort() const
+{
+    return m_Acceptor.local_endpoint().port();
+}
+
+inline const std::vector<Vector3> & FarmCoordinator::GetPixelRgbs() const
+{
+    return m_PixelRgbs;
+}
+
+inline const std::vector<float> & FarmCoordinator::GetSampleCounts() const
+{
+    return m_SampleCounts;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_FARM_H
@@ -0,0 +1,217 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Color.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const std::array<Color, 5> HEATMAP_COLORS{
+    Color(0.0f, 0.0f, 0.3f),
+    Color(0.0f, 0.4f, 1.0f),
+    Color(0.0f, 0.8f, 0.3f),
+    Color(1.0f, 0.9f, 0.0f),
+    Color(1.0f, 0.0f, 0.0f)
+};
+
+constexpr float HEATMAP_MAX_VALUE_PERCENTILE = 0.99f;
+
+//
+// Service
+//
+
+/**
+ * @brief Time stamp counter on x86, which takes a few nanoseconds to read, or steady clock nanoseconds elsewhere.
+ */
+static inline std::uint64_t ReadCycleCounter();
+
+static inline std::uint64_t ReadClockNanoseconds();
+
+static inline float GetPixelCostValue(const PixelCost & pixelCost, const HeatmapMetric metric);
+
+static Color GetHeatmapColor(const float value);
+
+//
+// Utilities
+//
+
+std::vector<PixelCost> RenderPixelCosts(
+    const Scene &           scene,
+    const Camera &          camera,
+    const ISampler &        sampler,
+    const RayMissFunction & rayMissFunction,
+    ThreadPool &            threadPool,
+    const int               imageWidth,
+    const int               imageHeight,
+    const int               sampleCount
+)
+{
+    const ScopedTimelineEvent event("pixel costs", "samples", sampleCount);
+
+    std::vector<PixelCost> pixelCosts(static_cast<size_t>(imageWidth)*imageHeight, PixelCost{0, 0, 0, 0});
+
+    // Counter ticks are converted to nanoseconds with their rate over the whole pass
+    const std::uint64_t startClockNanoseconds = ReadClockNanoseconds();
+    const std::uint64_t startCycleCount       = ReadCycleCounter();
+
+    threadPool.ParallelFor(static_cast<size_t>(imageHeight), [&](const size_t rowIndex) {
+        const int         y             = static_cast<int>(rowIndex);
+        PixelCost * const rowPixelCosts = pixelCosts.data() + rowIndex*imageWidth;
+
+        for (int x = 0; x < imageWidth; x++)
+        {
+            PixelCost & pixelCost = rowPixelCosts[x];
+
+            pCurrentPixelCost = &pixelCost;
+
+            const std::uint64_t pixelStartCycleCount = ReadCycleCounter();
+
+            for (int i = 0; i < sampleCount; i++)
+            {
+                SampleStream samples(sampler, x, y, static_cast<std::uint32_t>(i));
+
+                // Same jitter as the integrators use, so that costs match the pixels' footprints in the image
+                const Ray cameraRay =
+                    camera.CreateImageRay(imageWidth, imageHeight, SampleCameraRay(camera, x, y, scene.HasMotion(), samples));
+
+                TraceRay(scene, cameraRay, rayMissFunction, samples);
+            }
+
+            pixelCost.Nanoseconds = ReadCycleCounter() - pixelStartCycleCount;
+
+            pCurrentPixelCost = nullptr;
+        }
+    });
+
+    const std::uint64_t cycleCount          = ReadCycleCounter() - startCycleCount;
+    const double        nanosecondsPerCycle = cycleCount > 0
+        ? static_cast<double>(ReadClockNanoseconds() - startClockNanoseconds)/static_cast<double>(cycleCount)
+        : 1.0;
+
+    for (PixelCost & pixelCost : pixelCosts)
+        pixelCost.Nanoseconds = static_cast<std::uint64_t>(static_cast<double>(pixelCost.Nanoseconds)*nanosecondsPerCycle);
+
+    return pixelCosts;
+}
+
+Heatmap CreateHeatmap(const std::vector<PixelCost> & pixelCosts, const HeatmapMetric metric, const int sampleCount)
+{
+    assert(metric != HeatmapMetric::None && "heatmap must show a metric");
+    assert(sampleCount > 0);
+
+    std::vector<float> values(pixelCosts.size());
+    for (size_t i = 0; i < pixelCosts.size(); i++)
+        values[i] = GetPixelCostValue(pixelCosts[i], metric)/static_cast<float>(sampleCount);
+
+    Heatmap heatmap{std::vector<Uint32>(values.size(), 0u), 0.0f};
+
+    if (values.empty())
+        return heatmap;
+
+    std::vector<float> sortedValues(values);
+
+    const auto maxValueIt = sortedValues.begin() + static_cast<std::ptrdiff_t>(HEATMAP_MAX_VALUE_PERCENTILE*(sortedValues.size() - 1));
+    std::nth_element(sortedValues.begin(), maxValueIt, sortedValues.end());
+
+    heatmap.MaxValue = *maxValueIt;
+
+    const float valueScale = heatmap.MaxValue > 0.0f ? 1.0f/heatmap.MaxValue : 0.0f;
+
+    for (size_t i = 0; i < values.size(); i++)
+        heatmap.Image[i] = GetHeatmapColor(values[i]*valueScale).ToArgb();
+
+    return heatmap;
+}
+
+HeatmapMetric GetNextHeatmapMetric(const HeatmapMetric metric)
+{
+    return static_cast<HeatmapMetric>((static_cast<int>(metric) + 1) % HEATMAP_METRIC_COUNT);
+}
+
+const char * DescribeHeatmapMetric(const HeatmapMetric metric)
+{
+    switch (metric)
+    {
+    case HeatmapMetric::None:
+        return "nothing";
+    case HeatmapMetric::NodeTests:
+        return "BVH node tests per sample";
+    case HeatmapMetric::PrimitiveTests:
+        return "primitive tests per sample";
+    case HeatmapMetric::RayCount:
+        return "rays per sample (path depth)";
+    case HeatmapMetric::Time:
+        return "nanoseconds per sample";
+    }
+
+    assert(false && "unknown heatmap metric");
+    return "";
+}
+
+//
+// Service
+//
+
+static inline std::uint64_t ReadCycleCounter()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return ReadClockNanoseconds();
+#endif
+}
+
+static inline std::uint64_t ReadClockNanoseconds()
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+    );
+}
+
+static inline float GetPixelCostValue(const PixelCost & pixelCost, const HeatmapMetric metric)
+{
+    switch (metric)
+    {
+    case HeatmapMetric::None:
+        return 0.0f;
+    case HeatmapMetric::NodeTests:
+        return static_cast<float>(pixelCost.NodeTests);
+    case HeatmapMetric::PrimitiveTests:
+        return static_cast<float>(pixelCost.PrimitiveTests);
+    case HeatmapMetric::RayCount:
+        return static_cast<float>(pixelCost.RayCount);
+    case HeatmapMetric::Time:
+        return static_cast<float>(pixelCost.Nanoseconds);
+    }
+
+    assert(false && "unknown heatmap metric");
+    return 0.0f;
+}
+
+static Color GetHeatmapColor(const float value)
+{
+    const float  position   = std::clamp(value, 0.0f, 1.0f)*static_cast<float>(HEATMAP_COLORS.size() - 1);
+    const size_t colorIndex = std::min(static_cast<size_t>(position), HEATMAP_COLORS.size() - 2);
+
+    return LerpColor(HEATMAP_COLORS[colorIndex], HEATMAP_COLORS[colorIndex + 1], position - static_cast<float>(colorIndex));
+}
+
+} // namespace rtwe
@@ -0,0 +1,98 @@
+#ifndef RTWE_HEATMAP_H
+#define RTWE_HEATMAP_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "tracing.h"
+#include "sampling.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class Scene;
+class Camera;
+class ThreadPool;
+
+//
+// Interface types
+//
+
+enum class HeatmapMetric
+{
+    None,
+    NodeTests,
+    PrimitiveTests,
+    RayCount,
+    Time
+};
+
+constexpr int HEATMAP_METRIC_COUNT = 5;
+
+/**
+ * @brief Work done to trace all samples of one pixel.
+ */
+struct PixelCost final
+{
+    std::uint64_t NodeTests;
+    std::uint64_t PrimitiveTests; // Both in BVH leaves and unbounded ones
+    std::uint64_t RayCount;       // Rays traced, i.e. path depth summed over samples
+    std::uint64_t Nanoseconds;
+};
+
+struct Heatmap final
+{
+    std::vector<Uint32> Image;    // ARGB, row by row
+    float               MaxValue; // Value per sample which maps to the hottest color
+};
+
+// Set while RenderPixelCosts() traces a pixel, so that Scene::TryHit() adds to its cost; nullptr the rest of the time
+inline thread_local PixelCost * pCurrentPixelCost = nullptr;
+
+//
+// Utilities
+//
+
+/**
+ * @brief Traces the given number of samples of each pixel, recording what each pixel cost.
+ *
+ * Costs come from a pass of their own, tracing samples ray by ray with TraceRay(), since packets and wavefronts
+ * of the integrators work on many pixels at once, which makes per-pixel costs unattributable.
+ * Time is read with the CPU's time stamp counter where available, as the steady clock is too coarse for single pixels.
+ */
+std::vector<PixelCost> RenderPixelCosts(
+    const Scene &           scene,
+    const Camera &          camera,
+    const ISampler &        sampler,
+    const RayMissFunction & rayMissFunction,
+    ThreadPool &            threadPool,
+    const int               imageWidth,
+    const int               imageHeight,
+    const int               sampleCount
+);
+
+/**
+ * @brief Maps a metric of each pixel's cost per sample to false color, from dark blue through green and yellow to red.
+ *
+ * Red stands for the 99th percentile and above, so that a few extreme pixels don't leave the rest of the image dark.
+ */
+Heatmap CreateHeatmap(const std::vector<PixelCost> & pixelCosts, const HeatmapMetric metric, const int sampleCount);
+
+/**
+ * @brief Metric shown after the given one when cycling through heatmaps, with HeatmapMetric::None (no heatmap) among them.
+ */
+HeatmapMetric GetNextHeatmapMetric(const HeatmapMetric metric);
+
+/**
+ * @brief What the values of a metric count, e.g. for logs.
+ */
+const char * DescribeHeatmapMetric(const HeatmapMetric metric);
+
+} // namespace rtwe
+
+#endif // RTWE_HEATMAP_H
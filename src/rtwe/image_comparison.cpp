@@ -0,0 +1,43 @@
+#include "image_comparison.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace rtwe
+{
+
+//
+// Utilities
+//
+
+ImageDifference CompareImages(const std::vector<Uint32> & image, const std::vector<Uint32> & referenceImage)
+{
+    assert(image.size() == referenceImage.size() && "images must be of the same size");
+
+    if (image.empty())
+        return ImageDifference{0.0, 0.0};
+
+    // Integer sums are exact, whatever the size of the image
+    std::int64_t  differenceSum        = 0;
+    std::uint64_t squaredDifferenceSum = 0;
+
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            const int difference = static_cast<int>((image[i] >> shift) & 0xFF) - static_cast<int>((referenceImage[i] >> shift) & 0xFF);
+
+            differenceSum        += difference;
+            squaredDifferenceSum += static_cast<std::uint64_t>(difference*difference);
+        }
+    }
+
+    const double channelValueCount = 3.0*static_cast<double>(image.size());
+
+    return ImageDifference{
+        std::sqrt(static_cast<double>(squaredDifferenceSum)/channelValueCount)/255.0,
+        static_cast<double>(differenceSum)/channelValueCount/255.0
+    };
+}
+
+} // namespace rtwe
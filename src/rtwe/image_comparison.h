@@ -0,0 +1,35 @@
+#ifndef RTWE_IMAGE_COMPARISON_H
+#define RTWE_IMAGE_COMPARISON_H
+
+#include <vector>
+
+#include "types.h"
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+/**
+ * @brief Differences of displayed (sRGB-encoded) channel values, in [0, 1] rather than [0, 255].
+ */
+struct ImageDifference final
+{
+    double Rmse;     // Root mean square difference, covering both noise and bias
+    double MeanBias; // Mean signed difference, near zero for unbiased noise, positive if the image is brighter
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Compares RGB channels of two ARGB images of the same size, ignoring alpha.
+ */
+ImageDifference CompareImages(const std::vector<Uint32> & image, const std::vector<Uint32> & referenceImage);
+
+} // namespace rtwe
+
+#endif // RTWE_IMAGE_COMPARISON_H
@@ -0,0 +1,558 @@
+#include "integrators.h"
+
+#include <array>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "constants.h"
+#include "math_utils.h"
+#include "ray_sorting.h"
+#include "stats.h"
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+#include "Scene.h"
+
+namespace rtwe
+{
+
+//
+// Service types
+//
+
+namespace
+{
+
+struct PathState final
+{
+    Ray          CurrentRay;
+    Vector3      Throughput;
+    Vector3 *    pAccumulatedPixelRgb;
+    SampleStream Samples;
+    int          Depth;
+};
+
+struct ShadingRequest final
+{
+    PathState        Path;
+    RayHit           Hit;
+    const Material * pMaterial;
+    int              SortKey;
+};
+
+struct WavefrontQueues final
+{
+    std::vector<PathState>      ActivePaths;
+    std::vector<PathState>      NextActivePaths;
+    std::vector<ShadingRequest> ShadingRequests;
+    std::vector<ShadingRequest> SortedShadingRequests;
+    std::vector<RaySortItem>    RaySortItems;
+    std::vector<RaySortItem>    ScratchRaySortItems;
+    CameraRaySamples            CameraSamples;
+    std::vector<Ray>            CameraRays;
+};
+
+} // anonymous namespace
+
+//
+// Constants
+//
+
+constexpr int DIRECTION_OCTANT_COUNT = 8;
+constexpr int SHADING_SORT_KEY_COUNT = SCATTER_TYPE_COUNT*DIRECTION_OCTANT_COUNT;
+
+//
+// Service
+//
+
+static inline Vector3 SamplePixelRgb(
+    const Scene &           scene,
+    const Camera &          camera,
+    const RayMissFunction & rayMissFunc,
+    const int               imageWidth,
+    const int               imageHeight,
+    const int               pixelX,
+    const int               pixelY,
+    SampleStream &          samples
+);
+
+static inline std::array<Vector3, RAY_PACKET_SIZE> SamplePixelRowRgbs(
+    const Scene &                               scene,
+    const Camera &                              camera,
+    const RayMissFunction &                     rayMissFunc,
+    const int                                   imageWidth,
+    const int                                   imageHeight,
+    const int                                   firstPixelX,
+    const int                                   pixelY,
+    std::array<SampleStream, RAY_PACKET_SIZE> & samples
+);
+
+/**
+ * @param isTimeSampled Like SampleCameraRay()'s.
+ */
+static inline Ray CreateJitteredCameraRay(
+    const Camera & camera,
+    const int      imageWidth,
+    const int      imageHeight,
+    const int      pixelX,
+    const int      pixelY,
+    const bool     isTimeSampled,
+    SampleStream & samples
+);
+
+static inline std::uint32_t GetSampleIndex(const float sampleCount);
+
+static inline int GetDirectionOctant(const Vector3 & direction);
+
+//
+// PixelIntegrator
+//
+
+//
+// Construction
+//
+
+PixelIntegrator::PixelIntegrator(const bool usePrimaryRayPackets):
+    m_UsePrimaryRayPackets(usePrimaryRayPackets)
+{
+    // Empty
+}
+
+//
+// IIntegrator
+//
+
+void PixelIntegrator::AccumulateSamples(
+    const Scene &           scene,
+    const Camera &          camera,
+    const ISampler &        sampler,
+    const RayMissFunction & rayMissFunction,
+    const ImageRect &       rect,
+    AccumulationBuffer &    accumulationBuffer
+) const
+{
+    const int imageWidth  = accumulationBuffer.GetWidth();
+    const int imageHeight = accumulationBuffer.GetHeight();
+
+    for (int y = rect.Y; y < rect.Y + rect.Height; y++)
+    {
+        Vector3 * const     rowAccumulatedPixelRgbs = accumulationBuffer.GetRow(y);
+        const float * const rowSampleCounts         = accumulationBuffer.GetSampleCountRow(y);
+
+        int x = rect.X;
+
+        // Trace primary rays of neighboring pixels together in packets, and the rest of the row one by one
+        if (m_UsePrimaryRayPackets)
+        {
+            for (; x + RAY_PACKET_SIZE <= rect.X + rect.Width; x += RAY_PACKET_SIZE)
+            {
+                std::array<SampleStream, RAY_PACKET_SIZE> samples;
+                for (int i = 0; i < RAY_PACKET_SIZE; i++)
+                    samples[i] = SampleStream(sampler, x + i, y, GetSampleIndex(rowSampleCounts[x + i]));
+
+                const std::array<Vector3, RAY_PACKET_SIZE> sampleRgbs = SamplePixelRowRgbs(
+                    scene,
+                    camera,
+                    rayMissFunction,
+                    imageWidth,
+                    imageHeight,
+                    x,
+                    y,
+                    samples
+                );
+
+                for (int i = 0; i < RAY_PACKET_SIZE; i++)
+                    rowAccumulatedPixelRgbs[x + i] += sampleRgbs[i];
+            }
+        }
+
+        for (; x < rect.X + rect.Width; x++)
+        {
+            SampleStream samples(sampler, x, y, GetSampleIndex(rowSampleCounts[x]));
+
+            rowAccumulatedPixelRgbs[x] += SamplePixelRgb(
+                scene,
+                camera,
+                rayMissFunction,
+                imageWidth,
+                imageHeight,
+                x,
+                y,
+                samples
+            );
+        }
+    }
+}
+
+//
+//
+//
+
+//
+// WavefrontIntegrator
+//
+
+//
+// Construction
+//
+
+WavefrontIntegrator::WavefrontIntegrator(const bool sortSecondaryRays):
+    m_SortSecondaryRays(sortSecondaryRays)
+{
+    // Empty
+}
+
+//
+// IIntegrator
+//
+
+void WavefrontIntegrator::AccumulateSamples(
+    const Scene &           scene,
+    const Camera &          camera,
+    const ISampler &        sampler,
+    const RayMissFunction & rayMissFunction,
+    const ImageRect &       rect,
+    AccumulationBuffer &    accumulationBuffer
+) const
+{
+    const int imageWidth  = accumulationBuffer.GetWidth();
+    const int imageHeight = accumulationBuffer.GetHeight();
+
+    // Queues are kept per thread, so that their memory gets reused between calls
+    thread_local WavefrontQueues queues;
+
+    std::vector<PathState> &      activePaths           = queues.ActivePaths;
+    std::vector<PathState> &      nextActivePaths       = queues.NextActivePaths;
+    std::vector<ShadingRequest> & shadingRequests       = queues.ShadingRequests;
+    std::vector<ShadingRequest> & sortedShadingRequests = queues.SortedShadingRequests;
+
+    // Generate, sampling the whole rect first, so that its camera rays get created a packet at a time
+
+    CameraRaySamples & cameraRaySamples = queues.CameraSamples;
+    std::vector<Ray> & cameraRays       = queues.CameraRays;
+
+    cameraRaySamples.Resize(static_cast<size_t>(rect.Width)*rect.Height);
+
+    activePaths.clear();
+    for (int y = rect.Y; y < rect.Y + rect.Height; y++)
+    {
+        Vector3 * const     rowAccumulatedPixelRgbs = accumulationBuffer.GetRow(y);
+        const float * const rowSampleCounts         = accumulationBuffer.GetSampleCountRow(y);
+
+        for (int x = rect.X; x < rect.X + rect.Width; x++)
+        {
+            SampleStream samples(sampler, x, y, GetSampleIndex(rowSampleCounts[x]));
+
+            cameraRaySamples.Set(activePaths.size(), SampleCameraRay(camera, x, y, scene.HasMotion(), samples));
+
+            activePaths.push_back(PathState{
+                Ray(),
+                Vector3::Ones(),
+                rowAccumulatedPixelRgbs + x,
+                samples,
+                0
+            });
+        }
+    }
+
+    {
+        const ScopedStageTimer timer(StatStage::CameraRays, activePaths.size());
+
+        camera.CreateImageRays(imageWidth, imageHeight, cameraRaySamples, cameraRays);
+    }
+
+    for (size_t i = 0; i < activePaths.size(); i++)
+        activePaths[i].CurrentRay = cameraRays[i];
+
+    const std::vector<Body> & bodies      = scene.GetBodies();
+    const BoundingBox         sceneBounds = scene.GetBvh().GetBounds();
+
+    bool arePathsPrimary = true;
+    while (!activePaths.empty())
+    {
+        // Reorder secondary rays by direction and origin (primary rays are already coherent in scanline order)
+
+        if (m_SortSecondaryRays && !arePathsPrimary)
+        {
+            std::vector<RaySortItem> & raySortItems = queues.RaySortItems;
+
+            raySortItems.resize(activePaths.size());
+            for (size_t i = 0; i < activePaths.size(); i++)
+                raySortItems[i] = RaySortItem{GetRaySortKey(activePaths[i].CurrentRay, sceneBounds), static_cast<std::uint32_t>(i)};
+
+            RadixSortRays(raySortItems, queues.ScratchRaySortItems);
+
+            nextActivePaths.resize(activePaths.size());
+            for (size_t i = 0; i < raySortItems.size(); i++)
+                nextActivePaths[i] = activePaths[raySortItems[i].Index];
+
+            std::swap(activePaths, nextActivePaths);
+        }
+
+        arePathsPrimary = false;
+
+        // Intersect, accumulating and dropping paths which escaped the scene
+
+        shadingRequests.clear();
+        for (const PathState & path : activePaths)
+        {
+            const std::optional<BodyHit> bodyHit = path.Depth < MAX_RAY_TRACE_DEPTH
+                ? scene.TryHit(path.CurrentRay, RAYTRACE_MIN_RAY_PARAM, INFINITY)
+                : std::nullopt;
+
+            if (!bodyHit.has_value())
+            {
+                *path.pAccumulatedPixelRgb += multiplyElements(path.Throughput, ShadeRayMiss(rayMissFunction, path.CurrentRay).Rgb);
+                continue;
+            }
+
+            // Scattering continues with the same bounce's sample dimensions, after the scatter type
+            PathState shadedPath = path;
+            shadedPath.Samples.StartBounce(path.Depth);
+
+            const Material &  material    = bodies[bodyHit->BodyIndex].Material;
+            const ScatterType scatterType = SelectScatterType(material, shadedPath.Samples);
+
+            shadingRequests.push_back(ShadingRequest{
+                shadedPath,
+                bodyHit->Hit,
+                &material,
+                static_cast<int>(scatterType)*DIRECTION_OCTANT_COUNT + GetDirectionOctant(path.CurrentRay.Direction)
+            });
+        }
+
+        // Sort by scatter type and direction octant (counting sort, as there are few distinct keys)
+
+        std::array<size_t, SHADING_SORT_KEY_COUNT + 1> sortKeyOffsets{};
+        for (const ShadingRequest & request : shadingRequests)
+            sortKeyOffsets[request.SortKey + 1]++;
+
+        for (int key = 0; key < SHADING_SORT_KEY_COUNT; key++)
+            sortKeyOffsets[key + 1] += sortKeyOffsets[key];
+
+        const std::array<size_t, SHADING_SORT_KEY_COUNT + 1> sortKeyRangeBegins = sortKeyOffsets;
+
+        sortedShadingRequests.resize(shadingRequests.size());
+        for (const ShadingRequest & request : shadingRequests)
+            sortedShadingRequests[sortKeyOffsets[request.SortKey]++] = request;
+
+        // Scatter each scatter type's queue with its own loop, so that there's no per-ray dispatch
+
+        nextActivePaths.clear();
+
+        const auto pushScatteredPath = [&](const ShadingRequest & request, const std::optional<ScatteredRay> & scatteredRay) {
+            // Absorbed paths contribute black, so they are simply dropped
+            if (!scatteredRay.has_value())
+                return;
+
+            nextActivePaths.push_back(PathState{
+                scatteredRay->Ray,
+                multiplyElements(request.Path.Throughput, scatteredRay->Attenuation.Rgb),
+                request.Path.pAccumulatedPixelRgb,
+                request.Path.Samples,
+                request.Path.Depth + 1
+            });
+        };
+
+        const auto scatterQueue = [&](const ScatterType scatterType, const auto scatterFunc, const auto scatterPacketFunc) {
+            const size_t begin = sortKeyRangeBegins[static_cast<int>(scatterType)*DIRECTION_OCTANT_COUNT];
+            const size_t end   = sortKeyRangeBegins[(static_cast<int>(scatterType) + 1)*DIRECTION_OCTANT_COUNT];
+
+            size_t i = begin;
+
+            // Whole packets first if the scatter type has a packet variant, then the remainder ray by ray
+            if constexpr (!std::is_same_v<std::decay_t<decltype(scatterPacketFunc)>, std::nullptr_t>)
+            {
+                std::array<const Ray *, RAY_PACKET_SIZE>      rays;
+                std::array<const RayHit *, RAY_PACKET_SIZE>   rayHits;
+                std::array<const Material *, RAY_PACKET_SIZE> materials;
+                std::array<SampleStream *, RAY_PACKET_SIZE>   samples;
+
+                for (; i + RAY_PACKET_SIZE <= end; i += RAY_PACKET_SIZE)
+                {
+                    for (int j = 0; j < RAY_PACKET_SIZE; j++)
+                    {
+                        ShadingRequest & request = sortedShadingRequests[i + j];
+
+                        rays[j]      = &request.Path.CurrentRay;
+                        rayHits[j]   = &request.Hit;
+                        materials[j] = request.pMaterial;
+                        samples[j]   = &request.Path.Samples;
+                    }
+
+                    std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> scatteredRays;
+                    {
+                        const ScopedStageTimer timer(GetScatterStatStage(scatterType), RAY_PACKET_SIZE);
+
+                        scatteredRays = scatterPacketFunc(rays, rayHits, materials, samples);
+                    }
+
+                    for (int j = 0; j < RAY_PACKET_SIZE; j++)
+                        pushScatteredPath(sortedShadingRequests[i + j], scatteredRays[j]);
+                }
+            }
+
+            for (; i < end; i++)
+            {
+                ShadingRequest & request = sortedShadingRequests[i];
+
+                std::optional<ScatteredRay> scatteredRay;
+                {
+                    const ScopedStageTimer timer(GetScatterStatStage(scatterType));
+
+                    scatteredRay = scatterFunc(request.Path.CurrentRay, request.Hit, *request.pMaterial, request.Path.Samples);
+                }
+
+                pushScatteredPath(request, scatteredRay);
+            }
+        };
+
+        scatterQueue(ScatterType::Metallic,   TryScatterMetallic,   TryScatterMetallicPacket);
+        scatterQueue(ScatterType::Refractive, TryScatterRefractive, nullptr);
+        scatterQueue(ScatterType::Lambertian, TryScatterLambertian, TryScatterLambertianPacket);
+
+        std::swap(activePaths, nextActivePaths);
+    }
+}
+
+//
+//
+//
+
+//
+// Utilities
+//
+
+std::unique_ptr<IIntegrator> CreateIntegrator(const IntegratorType type, const IntegratorOptions & options)
+{
+    switch (type)
+    {
+    case IntegratorType::Pixel:
+        return std::make_unique<PixelIntegrator>(options.UsePrimaryRayPackets);
+    case IntegratorType::Wavefront:
+        return std::make_unique<WavefrontIntegrator>(options.SortSecondaryRays);
+    }
+
+    assert(false && "unknown integrator type");
+    return nullptr;
+}
+
+const char * GetIntegratorName(const IntegratorType type)
+{
+    switch (type)
+    {
+    case IntegratorType::Pixel:
+        return "pixel";
+    case IntegratorType::Wavefront:
+        return "wavefront";
+    }
+
+    assert(false && "unknown integrator type");
+    return "";
+}
+
+//
+// Service
+//
+
+static inline Vector3 SamplePixelRgb(
+    const Scene &           scene,
+    const Camera &          camera,
+    const RayMissFunction & rayMissFunc,
+    const int               imageWidth,
+    const int               imageHeight,
+    const int               pixelX,
+    const int               pixelY,
+    SampleStream &          samples
+)
+{
+    const Ray ray = CreateJitteredCameraRay(camera, imageWidth, imageHeight, pixelX, pixelY, scene.HasMotion(), samples);
+
+    const Color rayColor = TraceRay(
+        scene,
+        ray,
+        rayMissFunc,
+        samples
+    );
+
+    return rayColor.Rgb;
+}
+
+static inline std::array<Vector3, RAY_PACKET_SIZE> SamplePixelRowRgbs(
+    const Scene &                               scene,
+    const Camera &                              camera,
+    const RayMissFunction &                     rayMissFunc,
+    const int                                   imageWidth,
+    const int                                   imageHeight,
+    const int                                   firstPixelX,
+    const int                                   pixelY,
+    std::array<SampleStream, RAY_PACKET_SIZE> & samples
+)
+{
+    RayPacket packet;
+    {
+        const ScopedStageTimer timer(StatStage::CameraRays, RAY_PACKET_SIZE);
+
+        FloatPacket normalizedSampleXs;
+        FloatPacket normalizedSampleYs;
+        FloatPacket lensValuesX;
+        FloatPacket lensValuesY;
+        FloatPacket sampleTimes;
+
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            const CameraRaySample sample = SampleCameraRay(camera, firstPixelX + i, pixelY, scene.HasMotion(), samples[i]);
+
+            normalizedSampleXs[i] = sample.ImageX/static_cast<float>(imageWidth);
+            normalizedSampleYs[i] = 1.0f - sample.ImageY/static_cast<float>(imageHeight);
+            lensValuesX[i]        = sample.LensValueX;
+            lensValuesY[i]        = sample.LensValueY;
+            sampleTimes[i]        = sample.Time;
+        }
+
+        packet = camera.CreateRayPacket(normalizedSampleXs, normalizedSampleYs, sampleTimes, lensValuesX, lensValuesY);
+    }
+
+    const std::array<Color, RAY_PACKET_SIZE> rayColors = TraceRayPacket(
+        scene,
+        packet,
+        rayMissFunc,
+        samples
+    );
+
+    std::array<Vector3, RAY_PACKET_SIZE> result;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        result[i] = rayColors[i].Rgb;
+
+    return result;
+}
+
+static inline Ray CreateJitteredCameraRay(
+    const Camera & camera,
+    const int      imageWidth,
+    const int      imageHeight,
+    const int      pixelX,
+    const int      pixelY,
+    const bool     isTimeSampled,
+    SampleStream & samples
+)
+{
+    const ScopedStageTimer timer(StatStage::CameraRays);
+
+    return camera.CreateImageRay(imageWidth, imageHeight, SampleCameraRay(camera, pixelX, pixelY, isTimeSampled, samples));
+}
+
+static inline std::uint32_t GetSampleIndex(const float sampleCount)
+{
+    // Counts are whole numbers, just stored as floats for resolving
+    return static_cast<std::uint32_t>(sampleCount);
+}
+
+static inline int GetDirectionOctant(const Vector3 & direction)
+{
+    return (direction.x() < 0.0f ? 1 : 0) |
+           (direction.y() < 0.0f ? 2 : 0) |
+           (direction.z() < 0.0f ? 4 : 0);
+}
+
+} // namespace rtwe
@@ -0,0 +1,147 @@
+#ifndef RTWE_INTEGRATORS_H
+#define RTWE_INTEGRATORS_H
+
+#include <memory>
+
+#include "types.h"
+#include "ImageRect.h"
+#include "tracing.h"
+#include "sampling.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class Scene;
+class Camera;
+class AccumulationBuffer;
+
+//
+// Interface types
+//
+
+enum class IntegratorType
+{
+    Pixel,
+    Wavefront
+};
+
+constexpr int INTEGRATOR_TYPE_COUNT = 2;
+
+struct IntegratorOptions final
+{
+    bool UsePrimaryRayPackets; // Pixel integrator only
+    bool SortSecondaryRays;    // Wavefront integrator only
+};
+
+//
+// IIntegrator
+//
+
+struct IIntegrator
+{
+    virtual ~IIntegrator() = default;
+
+    /**
+     * @brief Traces one sample for each pixel in the given region of the image, adding its RGB to the pixel's accumulated RGB.
+     *
+     * Each pixel's current sample count is the index of the new sample in the sampler's sequence for that pixel.
+     * Safe to call concurrently for non-overlapping regions. Since each pixel gets a single addition per call,
+     * its sum only depends on the order of calls for its region, never on which thread makes them.
+     *
+     * @param accumulationBuffer Accumulated RGBs of the whole image, which also defines its size.
+     */
+    virtual void AccumulateSamples(
+        const Scene &           scene,
+        const Camera &          camera,
+        const ISampler &        sampler,
+        const RayMissFunction & rayMissFunction,
+        const ImageRect &       rect,
+        AccumulationBuffer &    accumulationBuffer
+    ) const = 0;
+};
+
+//
+// PixelIntegrator
+//
+
+/**
+ * @brief Traces each sample's path to the end before moving on to the next pixel.
+ */
+class PixelIntegrator final:
+    public IIntegrator
+{
+public: // Construction
+
+    explicit PixelIntegrator(const bool usePrimaryRayPackets);
+
+public: // IIntegrator
+
+    virtual void AccumulateSamples(
+        const Scene &           scene,
+        const Camera &          camera,
+        const ISampler &        sampler,
+        const RayMissFunction & rayMissFunction,
+        const ImageRect &       rect,
+        AccumulationBuffer &    accumulationBuffer
+    ) const override;
+
+private: // Members
+
+    const bool m_UsePrimaryRayPackets;
+};
+
+//
+// WavefrontIntegrator
+//
+
+/**
+ * @brief Advances paths of all pixels in a region together, one stage at a time.
+ *
+ * Each bounce first intersects all active paths, then drops terminated ones (stream compaction),
+ * sorts the rest by scatter type and direction octant, and finally scatters each group in a tight loop,
+ * a whole packet at a time for the scatter types which have packet variants.
+ */
+class WavefrontIntegrator final:
+    public IIntegrator
+{
+public: // Construction
+
+    /**
+     * @param sortSecondaryRays Whether to reorder paths by GetRaySortKey() before each bounce, to make traversal more coherent.
+     */
+    explicit WavefrontIntegrator(const bool sortSecondaryRays);
+
+public: // IIntegrator
+
+    virtual void AccumulateSamples(
+        const Scene &           scene,
+        const Camera &          camera,
+        const ISampler &        sampler,
+        const RayMissFunction & rayMissFunction,
+        const ImageRect &       rect,
+        AccumulationBuffer &    accumulationBuffer
+    ) const override;
+
+private: // Members
+
+    const bool m_SortSecondaryRays;
+};
+
+//
+// Utilities
+//
+
+std::unique_ptr<IIntegrator> CreateIntegrator(const IntegratorType type, const IntegratorOptions & options);
+
+/**
+ * @brief Name of the integrator as used on the command line.
+ */
+const char * GetIntegratorName(const IntegratorType type);
+
+} // namespace rtwe
+
+#endif // RTWE_INTEGRATORS_H
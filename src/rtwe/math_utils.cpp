@@ -10,9 +10,10 @@ namespace rtwe
 
 float GetRandomValue()
 {
-    static std::random_device                    randomDevice;
-    static std::mt19937                          generator(randomDevice()); // TODO: Look into replacing this with Xorshift
-    static std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    // Each rendering thread gets its own generator, so that they don't contend or race for its state
+    thread_local std::random_device                    randomDevice;
+    thread_local std::mt19937                          generator(randomDevice()); // TODO: Look into replacing this with Xorshift
+    thread_local std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
 
 	return distribution(generator);
 }
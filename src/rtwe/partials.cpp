@@ -0,0 +1,532 @@
+#include "partials.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <boost/log/trivial.hpp>
+
+#include "AccumulationBuffer.h"
+#include "ThreadPool.h"
+#include "binary_files.h"
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const std::array<char, 8> PARTIAL_RENDER_MAGIC{'R', 'T', 'W', 'E', 'P', 'A', 'R', 'T'};
+
+constexpr std::uint32_t PARTIAL_RENDER_VERSION = 3;
+
+// Rec. 709 luminance weights, as the renderer works in linear sRGB
+static const Vector3 LUMINANCE_WEIGHTS(0.2126f, 0.7152f, 0.0722f);
+
+// Rows are merged in bands of about this size per file, which bounds the memory a merge takes, while keeping reads large
+constexpr size_t PARTIAL_MERGE_BAND_BYTE_SIZE = 8*1024*1024;
+
+//
+// Service
+//
+
+static void WriteHeader(std::ostream & stream, const PartialRenderHeader & header);
+
+static bool TryReadHeader(std::istream & stream, PartialRenderHeader & header);
+
+static inline size_t GetRecordFloatCount(const bool hasVariance);
+
+/**
+ * @brief Size the file of a partial with the given header must have, to tell truncated files apart before merging.
+ */
+static std::uintmax_t GetPartialRenderFileSize(const PartialRenderHeader & header);
+
+/**
+ * @brief Whether the two partials sample the same sequences, so that their sample ranges tell which samples they hold.
+ */
+static bool DoPartialsShareSampler(const PartialRenderHeader & lhs, const PartialRenderHeader & rhs);
+
+/**
+ * @brief Checks that the partials' sample ranges follow each other without gaps or overlaps, in any order,
+ * so that their merge holds one range of samples, as its header says.
+ */
+static bool AreSampleRangesContiguous(const std::vector<std::string> & paths, const std::vector<PartialRenderHeader> & headers);
+
+/**
+ * @brief Reads records of the given rows of a partial, skipping over the header and the rows before them.
+ */
+static bool TryReadRecords(const std::string & path, const int firstRowIndex, const int rowCount, std::vector<float> & records);
+
+//
+// Construction
+//
+
+LuminanceSquareAccumulator::LuminanceSquareAccumulator(const int imageWidth, const int imageHeight):
+    m_ImageWidth         (imageWidth),
+    m_LuminanceSums      (static_cast<size_t>(imageWidth)*imageHeight, 0.0f),
+    m_LuminanceSquareSums(m_LuminanceSums.size(), 0.0f)
+{
+    // Empty
+}
+
+//
+// Interface
+//
+
+void LuminanceSquareAccumulator::AddPass(const AccumulationBuffer & accumulationBuffer, ThreadPool & threadPool)
+{
+    const ScopedTimelineEvent event("luminance squares");
+
+    assert(accumulationBuffer.GetWidth() == m_ImageWidth);
+    assert(static_cast<size_t>(accumulationBuffer.GetHeight())*m_ImageWidth == m_LuminanceSums.size());
+
+    threadPool.ParallelFor(static_cast<size_t>(accumulationBuffer.GetHeight()), [&](const size_t rowIndex) {
+        const Vector3 * const rowPixelRgbs           = accumulationBuffer.GetRow(static_cast<int>(rowIndex));
+        float * const         rowLuminanceSums       = m_LuminanceSums.data() + rowIndex*m_ImageWidth;
+        float * const         rowLuminanceSquareSums = m_LuminanceSquareSums.data() + rowIndex*m_ImageWidth;
+
+        for (int x = 0; x < m_ImageWidth; x++)
+        {
+            const float luminanceSum    = rowPixelRgbs[x].dot(LUMINANCE_WEIGHTS);
+            const float sampleLuminance = luminanceSum - rowLuminanceSums[x];
+
+            rowLuminanceSums[x]        = luminanceSum;
+            rowLuminanceSquareSums[x] += sampleLuminance*sampleLuminance;
+        }
+    });
+}
+
+//
+// Utilities
+//
+
+bool SavePartialRender(const PartialRender & partial, const std::string & path)
+{
+    const ScopedTimelineEvent event("partial write");
+
+    const PartialRenderHeader & header     = partial.Header;
+    const size_t                pixelCount = static_cast<size_t>(header.ImageWidth)*header.ImageHeight;
+
+    assert(partial.PixelRgbs.size() == pixelCount);
+    assert(partial.SampleCounts.size() == pixelCount);
+    assert(partial.LuminanceSquareSums.size() == (header.HasVariance ? pixelCount : 0));
+
+    ReplacingFileWriter writer(path);
+    std::ostream &      file = writer.GetStream();
+
+    WriteHeader(file, header);
+
+    // Records are written a row at a time, so that the interleaved copy stays small
+    const size_t       recordFloatCount = GetRecordFloatCount(header.HasVariance);
+    std::vector<float> rowRecords(static_cast<size_t>(header.ImageWidth)*recordFloatCount);
+
+    for (int y = 0; y < header.ImageHeight; y++)
+    {
+        for (int x = 0; x < header.ImageWidth; x++)
+        {
+            const size_t pixelIndex = static_cast<size_t>(y)*header.ImageWidth + x;
+            float * const pRecord   = rowRecords.data() + x*recordFloatCount;
+
+            pRecord[0] = partial.PixelRgbs[pixelIndex].x();
+            pRecord[1] = partial.PixelRgbs[pixelIndex].y();
+            pRecord[2] = partial.PixelRgbs[pixelIndex].z();
+            pRecord[3] = partial.SampleCounts[pixelIndex];
+
+            if (header.HasVariance)
+                pRecord[4] = partial.LuminanceSquareSums[pixelIndex];
+        }
+
+        file.write(reinterpret_cast<const char *>(rowRecords.data()), rowRecords.size()*sizeof(float));
+    }
+
+    if (!writer.Commit())
+        return false;
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Saved partial render of samples " << header.FirstSampleIndex << " to " << header.FirstSampleIndex + header.SamplesPerPixel - 1
+        << " to " << path;
+
+    return true;
+}
+
+std::optional<PartialRenderHeader> LoadPartialRenderHeader(const std::string & path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    PartialRenderHeader header;
+    if (!file || !TryReadHeader(file, header))
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read partial render header from " << path;
+        return std::nullopt;
+    }
+
+    return header;
+}
+
+std::optional<PartialRenderHeader> MergePartialRenders(
+    const std::vector<std::string> &  paths,
+    const std::string &               mergedPath,
+    const MergedPartialRowsFunction & processMergedRows
+)
+{
+    const ScopedTimelineEvent event("partial merge", "partials", static_cast<std::int64_t>(paths.size()));
+
+    assert(!paths.empty());
+
+    // All headers are checked before merging starts, so that a merge of hundreds of partials doesn't fail halfway through
+    std::vector<PartialRenderHeader> headers;
+    headers.reserve(paths.size());
+
+    for (const std::string & path : paths)
+    {
+        const std::optional<PartialRenderHeader> header = LoadPartialRenderHeader(path);
+        if (!header.has_value())
+            return std::nullopt;
+
+        std::error_code      error;
+        const std::uintmax_t fileSize = std::filesystem::file_size(path, error);
+
+        if (error || fileSize != GetPartialRenderFileSize(*header))
+        {
+            BOOST_LOG_TRIVIAL(error) << "Partial render " << path << " is truncated or corrupt";
+            return std::nullopt;
+        }
+
+        headers.push_back(*header);
+    }
+
+    PartialRenderHeader mergedHeader = headers.front();
+    mergedHeader.SamplesPerPixel    = 0;
+    mergedHeader.MergedPartialCount = 0;
+
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        const PartialRenderHeader & header = headers[i];
+
+        if (header.ImageWidth != mergedHeader.ImageWidth || header.ImageHeight != mergedHeader.ImageHeight || header.Scene != mergedHeader.Scene)
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Partial render " << paths[i] << " is " << header.ImageWidth << "x" << header.ImageHeight
+                << " of scene " << GetSceneName(header.Scene) << ", unlike " << paths.front();
+            return std::nullopt;
+        }
+
+        // Samples focused differently don't average into one image, even if each one's sums are fine on their own
+        if (header.Lens.ApertureRadius != mergedHeader.Lens.ApertureRadius || header.Lens.FocusDistance != mergedHeader.Lens.FocusDistance)
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Partial render " << paths[i] << " was rendered with aperture " << header.Lens.ApertureRadius
+                << " and focus distance " << header.Lens.FocusDistance << ", unlike " << paths.front();
+            return std::nullopt;
+        }
+
+        // A merged partial has a single sampler and seed, like any other, so that it can be merged again
+        if (!DoPartialsShareSampler(header, mergedHeader))
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Partial render " << paths[i] << " was rendered with the " << GetSamplerName(header.Sampler)
+                << " sampler with seed " << header.SamplerSeed << ", unlike " << paths.front()
+                << "; give nodes the same sampler, and the same --seed with the random sampler";
+            return std::nullopt;
+        }
+
+        mergedHeader.FirstSampleIndex    = std::min(mergedHeader.FirstSampleIndex, header.FirstSampleIndex);
+        mergedHeader.SamplesPerPixel    += header.SamplesPerPixel;
+        mergedHeader.MergedPartialCount += header.MergedPartialCount;
+        mergedHeader.HasVariance         = mergedHeader.HasVariance && header.HasVariance;
+    }
+
+    if (!AreSampleRangesContiguous(paths, headers))
+        return std::nullopt;
+
+    // Returning early, e.g. when a file can't be read, removes what was merged so far along with the writer
+    std::optional<ReplacingFileWriter> mergedWriter;
+
+    if (!mergedPath.empty())
+    {
+        mergedWriter.emplace(mergedPath);
+        WriteHeader(mergedWriter->GetStream(), mergedHeader);
+    }
+
+    const int    imageWidth        = mergedHeader.ImageWidth;
+    const int    imageHeight       = mergedHeader.ImageHeight;
+    const size_t rowRecordByteSize = static_cast<size_t>(imageWidth)*GetRecordFloatCount(true)*sizeof(float);
+    const int    bandRowCount      =
+        static_cast<int>(std::clamp<size_t>(PARTIAL_MERGE_BAND_BYTE_SIZE/rowRecordByteSize, 1, static_cast<size_t>(imageHeight)));
+    const size_t bandPixelCount    = static_cast<size_t>(bandRowCount)*imageWidth;
+
+    std::vector<Vector3> bandPixelRgbs(bandPixelCount);
+    std::vector<float>   bandSampleCounts(bandPixelCount);
+    std::vector<float>   bandLuminanceSquareSums(mergedHeader.HasVariance ? bandPixelCount : 0);
+
+    // One buffer gets read into while the other is added up
+    std::array<std::vector<float>, 2> bandRecords;
+    std::vector<float>                mergedBandRecords;
+
+    for (int firstRowIndex = 0; firstRowIndex < imageHeight; firstRowIndex += bandRowCount)
+    {
+        const int    rowCount   = std::min(bandRowCount, imageHeight - firstRowIndex);
+        const size_t pixelCount = static_cast<size_t>(rowCount)*imageWidth;
+
+        std::fill(bandPixelRgbs.begin(), bandPixelRgbs.end(), Vector3::Zero());
+        std::fill(bandSampleCounts.begin(), bandSampleCounts.end(), 0.0f);
+        std::fill(bandLuminanceSquareSums.begin(), bandLuminanceSquareSums.end(), 0.0f);
+
+        std::future<bool> isRead = std::async(
+            std::launch::async,
+            TryReadRecords, std::cref(paths.front()), firstRowIndex, rowCount, std::ref(bandRecords[0])
+        );
+
+        // Partials are added up in the given order, so that merging the same files gives the same sums
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (!isRead.get())
+            {
+                BOOST_LOG_TRIVIAL(error)
+                    << "Failed to read rows " << firstRowIndex << " to " << firstRowIndex + rowCount - 1 << " of " << paths[i];
+                return std::nullopt;
+            }
+
+            if (i + 1 < paths.size())
+            {
+                isRead = std::async(
+                    std::launch::async,
+                    TryReadRecords, std::cref(paths[i + 1]), firstRowIndex, rowCount, std::ref(bandRecords[(i + 1) % 2])
+                );
+            }
+
+            const float * const pRecords         = bandRecords[i % 2].data();
+            const size_t        recordFloatCount = GetRecordFloatCount(headers[i].HasVariance);
+
+            for (size_t j = 0; j < pixelCount; j++)
+            {
+                const float * const pRecord = pRecords + j*recordFloatCount;
+
+                bandPixelRgbs[j]    += Vector3(pRecord[0], pRecord[1], pRecord[2]);
+                bandSampleCounts[j] += pRecord[3];
+            }
+
+            if (mergedHeader.HasVariance)
+            {
+                for (size_t j = 0; j < pixelCount; j++)
+                    bandLuminanceSquareSums[j] += pRecords[j*recordFloatCount + 4];
+            }
+        }
+
+        processMergedRows(
+            MergedPartialRows{
+                firstRowIndex,
+                rowCount,
+                bandPixelRgbs.data(),
+                bandSampleCounts.data(),
+                mergedHeader.HasVariance ? bandLuminanceSquareSums.data() : nullptr
+            }
+        );
+
+        if (!mergedWriter.has_value())
+            continue;
+
+        const size_t mergedRecordFloatCount = GetRecordFloatCount(mergedHeader.HasVariance);
+        mergedBandRecords.resize(pixelCount*mergedRecordFloatCount);
+
+        for (size_t j = 0; j < pixelCount; j++)
+        {
+            float * const pRecord = mergedBandRecords.data() + j*mergedRecordFloatCount;
+
+            pRecord[0] = bandPixelRgbs[j].x();
+            pRecord[1] = bandPixelRgbs[j].y();
+            pRecord[2] = bandPixelRgbs[j].z();
+            pRecord[3] = bandSampleCounts[j];
+
+            if (mergedHeader.HasVariance)
+                pRecord[4] = bandLuminanceSquareSums[j];
+        }
+
+        mergedWriter->GetStream().write(reinterpret_cast<const char *>(mergedBandRecords.data()), mergedBandRecords.size()*sizeof(float));
+    }
+
+    if (!mergedWriter.has_value())
+        return mergedHeader;
+
+    if (!mergedWriter->Commit())
+        return std::nullopt;
+
+    BOOST_LOG_TRIVIAL(info) << "Saved merged partial render to " << mergedPath;
+
+    return mergedHeader;
+}
+
+float GetLuminanceStandardError(const Vector3 & pixelRgb, const float sampleCount, const float luminanceSquareSum)
+{
+    if (sampleCount < 2.0f)
+        return 0.0f;
+
+    const float luminanceMean = pixelRgb.dot(LUMINANCE_WEIGHTS)/sampleCount;
+    // Unbiased sample variance; rounding can take the difference of means slightly below zero
+    const float variance =
+        std::max(luminanceSquareSum/sampleCount - luminanceMean*luminanceMean, 0.0f)*sampleCount/(sampleCount - 1.0f);
+
+    return std::sqrt(variance/sampleCount);
+}
+
+//
+// Service
+//
+
+static void WriteHeader(std::ostream & stream, const PartialRenderHeader & header)
+{
+    stream.write(PARTIAL_RENDER_MAGIC.data(), PARTIAL_RENDER_MAGIC.size());
+    WriteValue(stream, PARTIAL_RENDER_VERSION);
+    WriteValue(stream, static_cast<std::int32_t>(header.ImageWidth));
+    WriteValue(stream, static_cast<std::int32_t>(header.ImageHeight));
+    WriteValue(stream, static_cast<std::int32_t>(header.Scene));
+    WriteValue(stream, static_cast<std::int32_t>(header.Sampler));
+    WriteValue(stream, header.SamplerSeed);
+    WriteValue(stream, header.Lens.ApertureRadius);
+    WriteValue(stream, header.Lens.FocusDistance);
+    WriteValue(stream, static_cast<std::int64_t>(header.FirstSampleIndex));
+    WriteValue(stream, static_cast<std::int64_t>(header.SamplesPerPixel));
+    WriteValue(stream, static_cast<std::int32_t>(header.MergedPartialCount));
+    WriteValue(stream, static_cast<std::uint32_t>(header.HasVariance ? 1 : 0));
+}
+
+static bool TryReadHeader(std::istream & stream, PartialRenderHeader & header)
+{
+    std::array<char, PARTIAL_RENDER_MAGIC.size()> magic;
+
+    std::uint32_t version            = 0;
+    std::int32_t  imageWidth         = 0;
+    std::int32_t  imageHeight        = 0;
+    std::int32_t  scene              = 0;
+    std::int32_t  sampler            = 0;
+    std::uint32_t samplerSeed        = 0;
+    float         apertureRadius     = 0.0f;
+    float         focusDistance      = 0.0f;
+    std::int64_t  firstSampleIndex   = 0;
+    std::int64_t  samplesPerPixel    = 0;
+    std::int32_t  mergedPartialCount = 0;
+    std::uint32_t hasVariance        = 0;
+
+    const bool isRead = stream.read(magic.data(), magic.size())
+        && TryReadValue(stream, version)
+        && TryReadValue(stream, imageWidth)
+        && TryReadValue(stream, imageHeight)
+        && TryReadValue(stream, scene)
+        && TryReadValue(stream, sampler)
+        && TryReadValue(stream, samplerSeed)
+        && TryReadValue(stream, apertureRadius)
+        && TryReadValue(stream, focusDistance)
+        && TryReadValue(stream, firstSampleIndex)
+        && TryReadValue(stream, samplesPerPixel)
+        && TryReadValue(stream, mergedPartialCount)
+        && TryReadValue(stream, hasVariance);
+
+    if (!isRead || magic != PARTIAL_RENDER_MAGIC || version != PARTIAL_RENDER_VERSION)
+        return false;
+
+    if (imageWidth <= 0 || imageHeight <= 0 || scene < 0 || scene >= SCENE_TYPE_COUNT || sampler < 0 || sampler >= SAMPLER_TYPE_COUNT
+        || !(apertureRadius >= 0.0f && focusDistance > 0.0f) || firstSampleIndex < 0 || samplesPerPixel <= 0 || mergedPartialCount <= 0 || hasVariance > 1)
+        return false;
+
+    header = PartialRenderHeader{
+        imageWidth,
+        imageHeight,
+        static_cast<SceneType>(scene),
+        static_cast<SamplerType>(sampler),
+        samplerSeed,
+        CameraLens{apertureRadius, focusDistance},
+        static_cast<long>(firstSampleIndex),
+        static_cast<long>(samplesPerPixel),
+        mergedPartialCount,
+        hasVariance != 0
+    };
+
+    return true;
+}
+
+static inline size_t GetRecordFloatCount(const bool hasVariance)
+{
+    return hasVariance ? 5 : 4;
+}
+
+static std::uintmax_t GetPartialRenderFileSize(const PartialRenderHeader & header)
+{
+    std::ostringstream headerStream;
+    WriteHeader(headerStream, header);
+
+    const std::uintmax_t pixelCount = static_cast<std::uintmax_t>(header.ImageWidth)*header.ImageHeight;
+
+    return headerStream.str().size() + pixelCount*GetRecordFloatCount(header.HasVariance)*sizeof(float);
+}
+
+static bool DoPartialsShareSampler(const PartialRenderHeader & lhs, const PartialRenderHeader & rhs)
+{
+    // Other samplers ignore seeds, and give the same values for the same sample indices
+    return lhs.Sampler == rhs.Sampler && (lhs.Sampler != SamplerType::Random || lhs.SamplerSeed == rhs.SamplerSeed);
+}
+
+static bool AreSampleRangesContiguous(const std::vector<std::string> & paths, const std::vector<PartialRenderHeader> & headers)
+{
+    std::vector<size_t> sortedIndices(headers.size());
+    for (size_t i = 0; i < sortedIndices.size(); i++)
+        sortedIndices[i] = i;
+
+    // Stable, so that partials starting at the same sample are reported in the given order
+    std::stable_sort(sortedIndices.begin(), sortedIndices.end(), [&](const size_t lhs, const size_t rhs) {
+        return headers[lhs].FirstSampleIndex < headers[rhs].FirstSampleIndex;
+    });
+
+    for (size_t i = 1; i < sortedIndices.size(); i++)
+    {
+        const size_t previousIndex = sortedIndices[i - 1];
+        const size_t index         = sortedIndices[i];
+
+        const long previousEndSampleIndex = headers[previousIndex].FirstSampleIndex + headers[previousIndex].SamplesPerPixel;
+        const long firstSampleIndex       = headers[index].FirstSampleIndex;
+
+        if (firstSampleIndex < previousEndSampleIndex)
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Partial renders " << paths[previousIndex] << " and " << paths[index] << " share samples, which would be counted twice;"
+                << " give nodes different sample ranges";
+            return false;
+        }
+
+        if (firstSampleIndex > previousEndSampleIndex)
+        {
+            BOOST_LOG_TRIVIAL(error)
+                << "Partial renders " << paths[previousIndex] << " and " << paths[index] << " leave samples " << previousEndSampleIndex
+                << " to " << firstSampleIndex - 1 << " out, so that the merge wouldn't be one range of samples;"
+                << " render the missing range as well";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool TryReadRecords(const std::string & path, const int firstRowIndex, const int rowCount, std::vector<float> & records)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    PartialRenderHeader header;
+    if (!file || !TryReadHeader(file, header))
+        return false;
+
+    const size_t rowFloatCount = static_cast<size_t>(header.ImageWidth)*GetRecordFloatCount(header.HasVariance);
+
+    records.resize(rowFloatCount*rowCount);
+
+    file.seekg(static_cast<std::streamoff>(rowFloatCount*firstRowIndex*sizeof(float)), std::ios::cur);
+    file.read(reinterpret_cast<char *>(records.data()), records.size()*sizeof(float));
+
+    return static_cast<bool>(file);
+}
+
+} // namespace rtwe
@@ -0,0 +1,162 @@
+#ifndef RTWE_PARTIALS_H
+#define RTWE_PARTIALS_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "Camera.h"
+#include "sampling.h"
+#include "scenes.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+class AccumulationBuffer;
+class ThreadPool;
+
+//
+// Constants
+//
+
+// Extension of partial render files, which merging looks for in a directory
+constexpr const char * PARTIAL_RENDER_FILE_EXTENSION = ".rtwep";
+
+//
+// Interface types
+//
+
+/**
+ * @brief Which samples a partial render holds, so that merging can check that partials don't repeat each other's samples.
+ */
+struct PartialRenderHeader final
+{
+    int           ImageWidth;
+    int           ImageHeight;
+    SceneType     Scene;
+    SamplerType   Sampler;
+    std::uint32_t SamplerSeed;
+    CameraLens    Lens;
+    long          FirstSampleIndex;
+    long          SamplesPerPixel;
+    int           MergedPartialCount; // 1 unless the partial was merged from others, whose ranges make up its range
+    bool          HasVariance;
+};
+
+/**
+ * @brief Per-pixel sums of a range of each pixel's samples, row by row, which add up with those of the ranges next to it.
+ *
+ * Along with sums of squared sample luminance, if recorded, sums give each pixel's variance, and so the noise left after merging.
+ */
+struct PartialRender final
+{
+    PartialRenderHeader  Header;
+    std::vector<Vector3> PixelRgbs;
+    std::vector<float>   SampleCounts;
+    std::vector<float>   LuminanceSquareSums; // Empty unless the header says it has variance
+};
+
+/**
+ * @brief Band of consecutive rows of a merge, valid only during the call it's passed to.
+ */
+struct MergedPartialRows final
+{
+    int             FirstRowIndex;
+    int             RowCount;
+    const Vector3 * PixelRgbs;
+    const float *   SampleCounts;
+    const float *   LuminanceSquareSums; // nullptr unless all partials have variance
+};
+
+using MergedPartialRowsFunction = std::function<void(const MergedPartialRows & rows)>;
+
+//
+// LuminanceSquareAccumulator
+//
+
+/**
+ * @brief Sums squares of each pixel's sample luminance as passes get rendered.
+ *
+ * Integrators only accumulate sums, but as each pass adds one sample to every pixel, the sample is the difference
+ * of the pixel's sums before and after the pass.
+ */
+class LuminanceSquareAccumulator final
+{
+public: // Construction
+
+    LuminanceSquareAccumulator(const int imageWidth, const int imageHeight);
+
+public: // Interface
+
+    /**
+     * @brief Must be called after each pass, with samples accumulated from zero.
+     */
+    void AddPass(const AccumulationBuffer & accumulationBuffer, ThreadPool & threadPool);
+
+    inline const std::vector<float> & GetLuminanceSquareSums() const;
+
+private: // Members
+
+    const int m_ImageWidth;
+
+    std::vector<float> m_LuminanceSums;
+    std::vector<float> m_LuminanceSquareSums;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Writes the partial to a temporary file next to the given path, then renames it over the path, like SaveCheckpoint().
+ *
+ * The format is a small header followed by a record of floats per pixel, row by row, in native byte order:
+ * RGB sums, the sample count and, if recorded, the sum of squared luminance. Records being interleaved lets merging
+ * read the same band of rows from each file in one go.
+ */
+bool SavePartialRender(const PartialRender & partial, const std::string & path);
+
+std::optional<PartialRenderHeader> LoadPartialRenderHeader(const std::string & path);
+
+/**
+ * @brief Sums up partials band by band of rows, so that memory use only depends on the band size,
+ * however many partials there are and whatever their resolution, and passes each band on once it's merged.
+ *
+ * Partials must be of the same size, scene, lens and sampler, with the random sampler of the same seed too, and their sample
+ * ranges must make up one range without gaps or overlaps, so that the merge is a partial like any other. Each band of a file
+ * is read while the previous file's band is added up.
+ *
+ * @param mergedPath Partial render file to save the merged one to, or empty for none.
+ *
+ * @return Header of the merged partial, or nullopt if any partial couldn't be read or they don't fit together.
+ */
+std::optional<PartialRenderHeader> MergePartialRenders(
+    const std::vector<std::string> &  paths,
+    const std::string &               mergedPath,
+    const MergedPartialRowsFunction & processMergedRows
+);
+
+/**
+ * @brief Standard error of the mean of a pixel's samples, i.e. how noisy its averaged luminance still is.
+ */
+float GetLuminanceStandardError(const Vector3 & pixelRgb, const float sampleCount, const float luminanceSquareSum);
+
+//
+// LuminanceSquareAccumulator
+//
+
+inline const std::vector<float> & LuminanceSquareAccumulator::GetLuminanceSquareSums() const
+{
+    return m_LuminanceSquareSums;
+}
+
+} // namespace rtwe
+
+#endif // RTWE_PARTIALS_H
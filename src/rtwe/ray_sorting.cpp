@@ -0,0 +1,174 @@
+#include "ray_sorting.h"
+
+#include <algorithm>
+#include <array>
+
+#include "constants.h"
+#include "Ray.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr int RADIX_BITS        = 8;
+constexpr int RADIX_BUCKETS     = 1 << RADIX_BITS;
+constexpr int RADIX_PASS_COUNT  = 32/RADIX_BITS;
+
+constexpr size_t RADIX_SORT_MIN_CHUNK_SIZE = 4096;
+
+constexpr int ORIGIN_QUANTIZATION_BITS    = 7;
+constexpr int DIRECTION_QUANTIZATION_BITS = 4;
+
+//
+// Service
+//
+
+static inline std::uint32_t SpreadBitsBy2(std::uint32_t value);
+
+static inline std::uint32_t Quantize(const float value, const int bits);
+
+//
+// Utilities
+//
+
+std::uint32_t GetRaySortKey(const Ray & ray, const BoundingBox & originBounds)
+{
+    const Vector3 & direction = ray.Direction;
+
+    const std::uint32_t directionOctant =
+        (direction.x() < 0.0f ? 1u : 0u) |
+        (direction.y() < 0.0f ? 2u : 0u) |
+        (direction.z() < 0.0f ? 4u : 0u);
+
+    // Project the absolute direction onto the plane |x| + |y| + |z| = 1, so that two coordinates identify it within the octant
+    const Vector3 absoluteDirection  = direction.cwiseAbs();
+    const float   absoluteSum        = absoluteDirection.sum();
+    const Vector3 projectedDirection = absoluteSum > 0.0f ? Vector3(absoluteDirection/absoluteSum) : Vector3::Zero();
+
+    const std::uint32_t quantizedDirection =
+        (Quantize(projectedDirection.x(), DIRECTION_QUANTIZATION_BITS) << DIRECTION_QUANTIZATION_BITS) |
+        Quantize(projectedDirection.y(), DIRECTION_QUANTIZATION_BITS);
+
+    const Vector3 originExtent     = originBounds.Max - originBounds.Min;
+    const Vector3 relativeOrigin   = (ray.Origin - originBounds.Min).cwiseQuotient(originExtent.cwiseMax(Vector3::Constant(EPSILON)));
+    const std::uint32_t originCode =
+        (SpreadBitsBy2(Quantize(relativeOrigin.x(), ORIGIN_QUANTIZATION_BITS)) << 2) |
+        (SpreadBitsBy2(Quantize(relativeOrigin.y(), ORIGIN_QUANTIZATION_BITS)) << 1) |
+        (SpreadBitsBy2(Quantize(relativeOrigin.z(), ORIGIN_QUANTIZATION_BITS)) << 0);
+
+    return (directionOctant << (3*ORIGIN_QUANTIZATION_BITS + 2*DIRECTION_QUANTIZATION_BITS)) |
+           (originCode      << (2*DIRECTION_QUANTIZATION_BITS)) |
+           quantizedDirection;
+}
+
+void RadixSortRays(
+    std::vector<RaySortItem> & items,
+    std::vector<RaySortItem> & scratchItems,
+    ThreadPool * const         pThreadPool
+)
+{
+    const size_t itemCount = items.size();
+    if (itemCount <= 1)
+        return;
+
+    scratchItems.resize(itemCount);
+
+    const size_t maxChunkCount = pThreadPool != nullptr ? pThreadPool->GetThreadCount() : 1;
+    const size_t chunkCount    = std::max<size_t>(1, std::min(maxChunkCount, itemCount/RADIX_SORT_MIN_CHUNK_SIZE));
+    const size_t chunkSize     = (itemCount + chunkCount - 1)/chunkCount;
+
+    const auto forEachChunk = [&](const auto & function) {
+        const auto chunkFunction = [&](const size_t chunkIndex) {
+            const size_t begin = chunkIndex*chunkSize;
+            const size_t end   = std::min(begin + chunkSize, itemCount);
+
+            function(chunkIndex, begin, end);
+        };
+
+        if (pThreadPool != nullptr && chunkCount > 1)
+            pThreadPool->ParallelFor(chunkCount, chunkFunction);
+        else
+            for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+                chunkFunction(chunkIndex);
+    };
+
+    std::vector<std::array<size_t, RADIX_BUCKETS>> chunkOffsets(chunkCount);
+
+    for (int pass = 0; pass < RADIX_PASS_COUNT; pass++)
+    {
+        const int shift = pass*RADIX_BITS;
+
+        forEachChunk([&](const size_t chunkIndex, const size_t begin, const size_t end) {
+            std::array<size_t, RADIX_BUCKETS> & histogram = chunkOffsets[chunkIndex];
+            histogram.fill(0);
+
+            for (size_t i = begin; i < end; i++)
+                histogram[(items[i].Key >> shift) & (RADIX_BUCKETS - 1)]++;
+        });
+
+        // Turn per-chunk histograms into scatter offsets: buckets in order, and chunks in order within each bucket
+
+        size_t offset = 0;
+        bool   isPassRedundant = false;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            size_t bucketSize = 0;
+            for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+            {
+                const size_t chunkBucketSize = chunkOffsets[chunkIndex][bucket];
+
+                chunkOffsets[chunkIndex][bucket] = offset;
+                offset     += chunkBucketSize;
+                bucketSize += chunkBucketSize;
+            }
+
+            isPassRedundant |= (bucketSize == itemCount);
+        }
+
+        // All keys have the same digit, so this pass wouldn't change anything
+        if (isPassRedundant)
+            continue;
+
+        forEachChunk([&](const size_t chunkIndex, const size_t begin, const size_t end) {
+            std::array<size_t, RADIX_BUCKETS> & offsets = chunkOffsets[chunkIndex];
+
+            for (size_t i = begin; i < end; i++)
+                scratchItems[offsets[(items[i].Key >> shift) & (RADIX_BUCKETS - 1)]++] = items[i];
+        });
+
+        std::swap(items, scratchItems);
+    }
+}
+
+//
+// Service
+//
+
+static inline std::uint32_t SpreadBitsBy2(std::uint32_t value)
+{
+    value &= 0x000003FF;
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8))  & 0x0300F00F;
+    value = (value | (value << 4))  & 0x030C30C3;
+    value = (value | (value << 2))  & 0x09249249;
+
+    return value;
+}
+
+static inline std::uint32_t Quantize(const float value, const int bits)
+{
+    const std::uint32_t maxQuantizedValue = (1u << bits) - 1;
+
+    // Written so that NaN gets mapped to zero as well
+    if (!(value > 0.0f))
+        return 0;
+
+    return std::min(static_cast<std::uint32_t>(std::min(value, 1.0f)*static_cast<float>(maxQuantizedValue + 1)), maxQuantizedValue);
+}
+
+} // namespace rtwe
@@ -0,0 +1,57 @@
+#ifndef RTWE_RAY_SORTING_H
+#define RTWE_RAY_SORTING_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+namespace rtwe
+{
+
+//
+// Forward declarations
+//
+
+struct Ray;
+struct BoundingBox;
+class ThreadPool;
+
+//
+// Interface types
+//
+
+struct RaySortItem final
+{
+    std::uint32_t Key;
+    std::uint32_t Index;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Computes a key which places rays with similar directions and nearby origins close to each other.
+ *
+ * The top 3 bits hold the direction octant, the next 21 bits interleave (Morton-code) the origin quantized
+ * within the given bounds, and the lowest 8 bits hold the direction quantized within its octant.
+ */
+std::uint32_t GetRaySortKey(const Ray & ray, const BoundingBox & originBounds);
+
+/**
+ * @brief Stably sorts items by key with an LSD radix sort, processing 8 bits per pass.
+ *
+ * Passes are split into chunks processed in parallel on the given thread pool, if any.
+ *
+ * @param scratchItems Buffer reused between calls to avoid allocations; its contents are overwritten.
+ */
+void RadixSortRays(
+    std::vector<RaySortItem> & items,
+    std::vector<RaySortItem> & scratchItems,
+    ThreadPool * const         pThreadPool = nullptr
+);
+
+} // namespace rtwe
+
+#endif // RTWE_RAY_SORTING_H
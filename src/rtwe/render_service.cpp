@@ -0,0 +1,292 @@
+#include "render_service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include <boost/log/trivial.hpp>
+
+#include "timeline.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const char * const RENDER_JOB_RUNNING_SUFFIX = ".running";
+static const char * const RENDER_JOB_DONE_SUFFIX    = ".done";
+static const char * const RENDER_JOB_FAILED_SUFFIX  = ".failed";
+
+// Jobs are files dropped in by hand or by scripts, so a fraction of a second until one is noticed doesn't matter
+const int RenderJobLoader::JOB_POLL_INTERVAL_MS = 250;
+
+//
+// Service
+//
+
+/**
+ * @brief Paths of the jobs queued in the directory, in order of file names, i.e. the order they're taken in.
+ */
+static std::vector<std::filesystem::path> ListQueuedRenderJobs(const std::string & jobDirectoryPath);
+
+/**
+ * @brief Parses the job's options, as if they were given on the command line of a headless render.
+ *
+ * @return nullopt if an option is invalid, or isn't about what to render, e.g. --farm.
+ */
+static std::optional<Settings> LoadRenderJobSettings(const std::string & claimedPath);
+
+//
+// Construction
+//
+
+SceneCache::SceneCache():
+    m_Mutex    (),
+    m_Scenes   (),
+    m_HitCount (0),
+    m_MissCount(0)
+{
+    // Empty
+}
+
+RenderJobLoader::RenderJobLoader(std::string jobDirectoryPath, SceneCache & sceneCache):
+    m_JobDirectoryPath(std::move(jobDirectoryPath)),
+    m_SceneCache      (sceneCache),
+    m_IsJobLoaded     (false),
+    m_IsStopping      (false)
+{
+    m_LoaderThread = std::thread(&RenderJobLoader::loadLoop, this);
+}
+
+RenderJobLoader::~RenderJobLoader()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_JobTakenCondition.notify_one();
+    m_LoaderThread.join();
+}
+
+//
+// Interface
+//
+
+const Scene & SceneCache::GetScene(const SceneType sceneType)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    const auto sceneIt = m_Scenes.find(sceneType);
+    if (sceneIt != m_Scenes.end())
+    {
+        m_HitCount++;
+        return *sceneIt->second;
+    }
+
+    m_MissCount++;
+
+    const ScopedTimelineEvent event("scene build");
+
+    return *m_Scenes.emplace(sceneType, std::make_unique<Scene>(CreateSceneBodies(sceneType))).first->second;
+}
+
+long SceneCache::GetHitCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    return m_HitCount;
+}
+
+long SceneCache::GetMissCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    return m_MissCount;
+}
+
+std::optional<RenderJob> RenderJobLoader::TakeJob()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    m_JobLoadedCondition.wait(lock, [this]() { return m_IsJobLoaded; });
+
+    std::optional<RenderJob> job = std::move(m_LoadedJob);
+    m_LoadedJob.reset();
+    m_IsJobLoaded = false;
+
+    lock.unlock();
+    m_JobTakenCondition.notify_one();
+
+    return job;
+}
+
+//
+// Service
+//
+
+void RenderJobLoader::loadLoop()
+{
+    NameTimelineThread("job loader");
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    bool isDirectoryEmpty = false;
+
+    while (true)
+    {
+        m_JobTakenCondition.wait(lock, [this]() { return !m_IsJobLoaded || m_IsStopping; });
+
+        // Only waiting out the interval once the directory turned out empty, so that jobs follow each other without delay
+        if (isDirectoryEmpty)
+            m_JobTakenCondition.wait_for(lock, std::chrono::milliseconds(JOB_POLL_INTERVAL_MS), [this]() { return m_IsStopping; });
+
+        if (m_IsStopping)
+            return;
+
+        lock.unlock();
+        std::optional<RenderJob> job = LoadNextRenderJob(m_JobDirectoryPath, m_SceneCache);
+        lock.lock();
+
+        isDirectoryEmpty = !job.has_value();
+
+        m_LoadedJob   = std::move(job);
+        m_IsJobLoaded = true;
+
+        m_JobLoadedCondition.notify_one();
+    }
+}
+
+//
+// Utilities
+//
+
+std::optional<RenderJob> LoadNextRenderJob(const std::string & jobDirectoryPath, SceneCache & sceneCache)
+{
+    const ScopedTimelineEvent event("job load");
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    for (const std::filesystem::path & queuedPath : ListQueuedRenderJobs(jobDirectoryPath))
+    {
+        const std::string name        = queuedPath.filename().string();
+        const std::string claimedPath = queuedPath.string() + RENDER_JOB_RUNNING_SUFFIX;
+
+        // Fails if another service has taken the job since it was listed
+        std::error_code error;
+        std::filesystem::rename(queuedPath, claimedPath, error);
+
+        if (error)
+            continue;
+
+        RenderJob job{name, claimedPath, Settings(), nullptr, nullptr, nullptr, 0.0};
+
+        std::optional<Settings> jobSettings = LoadRenderJobSettings(claimedPath);
+        if (!jobSettings.has_value())
+        {
+            FinishRenderJob(job, false);
+            continue;
+        }
+
+        job.JobSettings = std::move(*jobSettings);
+
+        const std::uint32_t samplerSeed = job.JobSettings.SamplerSeed.has_value()
+            ? *job.JobSettings.SamplerSeed
+            : CreateSamplerSeed(job.JobSettings.IsDeterministic);
+
+        job.JobScene    = &sceneCache.GetScene(job.JobSettings.Scene);
+        job.Integrator  = CreateIntegrator(job.JobSettings.Integrator, job.JobSettings.IntegrationOptions);
+        job.Sampler     = CreateSampler(job.JobSettings.Sampler, samplerSeed);
+        job.LoadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        return job;
+    }
+
+    return std::nullopt;
+}
+
+void FinishRenderJob(const RenderJob & job, const bool isSucceeded)
+{
+    const std::filesystem::path claimedPath(job.ClaimedPath);
+    const std::filesystem::path finishedPath =
+        claimedPath.parent_path() / (job.Name + (isSucceeded ? RENDER_JOB_DONE_SUFFIX : RENDER_JOB_FAILED_SUFFIX));
+
+    std::error_code error;
+    std::filesystem::rename(claimedPath, finishedPath, error);
+
+    if (error)
+        BOOST_LOG_TRIVIAL(error) << "Failed to rename " << claimedPath << " to " << finishedPath << ": " << error.message();
+}
+
+//
+// Service
+//
+
+static std::vector<std::filesystem::path> ListQueuedRenderJobs(const std::string & jobDirectoryPath)
+{
+    std::vector<std::filesystem::path> queuedPaths;
+
+    std::error_code error;
+    for (const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(jobDirectoryPath, error))
+    {
+        if (entry.is_regular_file(error) && entry.path().extension() == RENDER_JOB_FILE_EXTENSION)
+            queuedPaths.push_back(entry.path());
+    }
+
+    std::sort(queuedPaths.begin(), queuedPaths.end());
+
+    return queuedPaths;
+}
+
+static std::optional<Settings> LoadRenderJobSettings(const std::string & claimedPath)
+{
+    std::ifstream file(claimedPath);
+    if (!file)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read render job " << claimedPath;
+        return std::nullopt;
+    }
+
+    // Program name first, as on a command line
+    std::vector<std::string> arguments{"rtwe", "--headless"};
+    std::copy(std::istream_iterator<std::string>(file), std::istream_iterator<std::string>(), std::back_inserter(arguments));
+
+    std::vector<const char *> argv;
+    argv.reserve(arguments.size());
+
+    for (const std::string & argument : arguments)
+        argv.push_back(argument.c_str());
+
+    Settings settings;
+    try
+    {
+        settings = Settings::FromCommandLine(static_cast<int>(argv.size()), argv.data());
+    }
+    catch (const std::invalid_argument & exception)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Render job " << claimedPath << " is invalid: " << exception.what();
+        return std::nullopt;
+    }
+
+    // Options which choose another mode, or a file of the service's own, would make the job something other than a render
+    const bool isRenderOnly = settings.CheckpointPath.empty() && settings.FarmWorkerCount == 0
+        && settings.FarmCoordinatorAddress.empty() && settings.PartialPath.empty() && settings.MergePath.empty()
+        && settings.ServePath.empty() && settings.AnimationFrameCount == 0 && settings.TimelinePath.empty()
+        && settings.BenchmarkReferencePath.empty() && !settings.CheckDeterminism && !settings.ShowHelp;
+
+    if (!isRenderOnly)
+    {
+        BOOST_LOG_TRIVIAL(error)
+            << "Render job " << claimedPath << " is invalid: only options choosing what to render and where to save it apply";
+        return std::nullopt;
+    }
+
+    return settings;
+}
+
+} // namespace rtwe
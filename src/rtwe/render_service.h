@@ -0,0 +1,177 @@
+#ifndef RTWE_RENDER_SERVICE_H
+#define RTWE_RENDER_SERVICE_H
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "integrators.h"
+#include "sampling.h"
+#include "scenes.h"
+#include "Scene.h"
+#include "Settings.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+// Extension of job files, which the service looks for in its job directory
+constexpr const char * RENDER_JOB_FILE_EXTENSION = ".job";
+
+//
+// SceneCache
+//
+
+/**
+ * @brief Scenes built for jobs so far, acceleration structures included, kept for later jobs of the same scene.
+ *
+ * Scenes are never evicted, as there are only a few of them, so references stay valid as long as the cache.
+ * Thread-safe, so that the next job's scene can be built while the current job renders.
+ */
+class SceneCache final
+{
+public: // Construction
+
+    SceneCache();
+
+public: // Deleted
+
+    SceneCache(const SceneCache&) = delete;
+    SceneCache(SceneCache&&)      = delete;
+
+    SceneCache& operator=(const SceneCache&) = delete;
+    SceneCache& operator=(SceneCache&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Builds the scene on first use, blocking other callers meanwhile.
+     */
+    const Scene & GetScene(const SceneType sceneType);
+
+    long GetHitCount() const;
+
+    long GetMissCount() const;
+
+private: // Members
+
+    mutable std::mutex                          m_Mutex;
+    std::map<SceneType, std::unique_ptr<Scene>> m_Scenes;
+    long                                        m_HitCount;
+    long                                        m_MissCount;
+};
+
+//
+// Interface types
+//
+
+/**
+ * @brief Job taken from the job directory, with everything it needs to render loaded.
+ */
+struct RenderJob final
+{
+    std::string                  Name;        // File name the job was queued under, e.g. glass-0001.job
+    std::string                  ClaimedPath; // Path of the job's file since it was taken, which other services skip
+    Settings                     JobSettings;
+    const Scene *                JobScene;    // Owned by the scene cache
+    std::unique_ptr<IIntegrator> Integrator;
+    std::unique_ptr<ISampler>    Sampler;
+    double                       LoadSeconds;
+};
+
+//
+// RenderJobLoader
+//
+
+/**
+ * @brief Takes and loads the next job on a thread of its own while the current one renders, so that the thread pool
+ * goes from one job to the next without waiting for files to be read or acceleration structures to be built.
+ *
+ * At most one job is loaded ahead, so that other services sharing the directory can take the rest. While the directory
+ * has no jobs, the thread looks for new ones at an interval.
+ */
+class RenderJobLoader final
+{
+public: // Construction
+
+    /**
+     * @brief Starts loading the first job right away.
+     */
+    RenderJobLoader(std::string jobDirectoryPath, SceneCache & sceneCache);
+
+    /**
+     * @brief Waits for the job being loaded, if any; a job loaded but not taken stays claimed.
+     */
+    ~RenderJobLoader();
+
+public: // Deleted
+
+    RenderJobLoader(const RenderJobLoader&) = delete;
+    RenderJobLoader(RenderJobLoader&&)      = delete;
+
+    RenderJobLoader& operator=(const RenderJobLoader&) = delete;
+    RenderJobLoader& operator=(RenderJobLoader&&)      = delete;
+
+public: // Interface
+
+    /**
+     * @brief Waits for the job loaded ahead, and starts loading the one after it.
+     *
+     * @return nullopt if the directory had no jobs left when last looked at.
+     */
+    std::optional<RenderJob> TakeJob();
+
+private: // Service
+
+    void loadLoop();
+
+private: // Constants
+
+    static const int JOB_POLL_INTERVAL_MS;
+
+private: // Members
+
+    const std::string m_JobDirectoryPath;
+    SceneCache &      m_SceneCache;
+
+    std::mutex               m_Mutex;
+    std::condition_variable  m_JobTakenCondition;
+    std::condition_variable  m_JobLoadedCondition;
+    std::optional<RenderJob> m_LoadedJob;
+    bool                     m_IsJobLoaded; // Even if m_LoadedJob is empty, as the directory had no jobs
+    bool                     m_IsStopping;
+
+    std::thread m_LoaderThread;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Takes the first job in the directory, in order of file names, and loads its scene, integrator and sampler.
+ *
+ * A job is a file of rtwe options, separated by whitespace, which choose what to render and where to save the image,
+ * e.g. "--scene glass --resolution 640x480 --samples 64 --output glass.png". Producers should write it under another name,
+ * then rename it to *.job, so that it's never taken half-written. It's taken by renaming it to <name>.running, which lets
+ * several services share a directory. Jobs with invalid options are logged, marked as failed and skipped.
+ *
+ * @return nullopt if the directory has no jobs left.
+ */
+std::optional<RenderJob> LoadNextRenderJob(const std::string & jobDirectoryPath, SceneCache & sceneCache);
+
+/**
+ * @brief Renames the job's file to <name>.done or <name>.failed, so that producers of jobs can tell how it went.
+ */
+void FinishRenderJob(const RenderJob & job, const bool isSucceeded);
+
+} // namespace rtwe
+
+#endif // RTWE_RENDER_SERVICE_H
@@ -0,0 +1,217 @@
+#include "resolve.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr int RESOLVE_BLOCK_SIZE = 16;
+
+constexpr int SRGB_LUT_BITS = 12;
+constexpr int SRGB_LUT_SIZE = 1 << SRGB_LUT_BITS;
+
+//
+// Service types
+//
+
+namespace
+{
+
+// Channels of consecutive pixels, interleaved like in Vector3 arrays; all of the math is per channel anyway
+using RgbBlock = Eigen::Array<float, 3*RESOLVE_BLOCK_SIZE, 1>;
+
+using SampleCountBlock = Eigen::Array<float, RESOLVE_BLOCK_SIZE, 1>;
+
+using SrgbLut = std::array<Uint8, SRGB_LUT_SIZE>;
+
+} // anonymous namespace
+
+//
+// Service
+//
+
+static const SrgbLut & GetSrgbLut();
+
+static inline void ToneMap(RgbBlock & rgbs, const ToneMappingOperator toneMapping);
+
+static inline void ResolveBlock(
+    RgbBlock                  rgbs,
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+);
+
+/**
+ * @brief Loads up to a block of pixels, padding the rest with zeros.
+ */
+static inline RgbBlock LoadRgbBlock(const Vector3 * const pixelRgbs, const int pixelCount);
+
+/**
+ * @brief Resolves a row block by block, with loadBlock(firstPixel, pixelCount) providing averaged RGBs of each.
+ */
+template <typename LoadBlockFunction>
+static inline void ResolveBlocks(
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs,
+    const LoadBlockFunction & loadBlock
+);
+
+//
+// Utilities
+//
+
+void ResolvePixelRow(
+    const Vector3 * const     accumulatedPixelRgbs,
+    const int                 pixelCount,
+    const float               sampleWeight,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+)
+{
+    ResolveBlocks(
+        pixelCount,
+        toneMapping,
+        argbs,
+        // Returns a block rather than an expression, which would refer to LoadRgbBlock's temporary
+        [&](const int firstPixel, const int blockPixelCount) -> RgbBlock {
+            return LoadRgbBlock(accumulatedPixelRgbs + firstPixel, blockPixelCount)*sampleWeight;
+        }
+    );
+}
+
+void ResolvePixelRow(
+    const Vector3 * const     accumulatedPixelRgbs,
+    const float * const       sampleCounts,
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+)
+{
+    ResolveBlocks(
+        pixelCount,
+        toneMapping,
+        argbs,
+        [&](const int firstPixel, const int blockPixelCount) -> RgbBlock {
+            SampleCountBlock blockSampleCounts = SampleCountBlock::Zero();
+            blockSampleCounts.head(blockPixelCount) = Eigen::Map<const Eigen::ArrayXf>(sampleCounts + firstPixel, blockPixelCount);
+
+            // Pixels without samples resolve to black
+            const SampleCountBlock sampleWeights = (blockSampleCounts > 0.0f).select(blockSampleCounts.inverse(), 0.0f);
+
+            RgbBlock rgbs = LoadRgbBlock(accumulatedPixelRgbs + firstPixel, blockPixelCount);
+            Eigen::Map<Eigen::Array<float, 3, RESOLVE_BLOCK_SIZE>>(rgbs.data()).rowwise() *= sampleWeights.transpose();
+
+            return rgbs;
+        }
+    );
+}
+
+//
+// Service
+//
+
+static const SrgbLut & GetSrgbLut()
+{
+    static const SrgbLut SRGB_LUT = []() {
+        SrgbLut lut;
+
+        for (int i = 0; i < SRGB_LUT_SIZE; i++)
+        {
+            const float linear  = static_cast<float>(i)/static_cast<float>(SRGB_LUT_SIZE - 1);
+            const float encoded = linear <= 0.0031308f
+                ? 12.92f*linear
+                : 1.055f*std::pow(linear, 1.0f/2.4f) - 0.055f;
+
+            lut[i] = static_cast<Uint8>(std::lround(255.0f*std::clamp(encoded, 0.0f, 1.0f)));
+        }
+
+        return lut;
+    }();
+
+    return SRGB_LUT;
+}
+
+static inline void ToneMap(RgbBlock & rgbs, const ToneMappingOperator toneMapping)
+{
+    switch (toneMapping)
+    {
+    case ToneMappingOperator::None:
+        break;
+    case ToneMappingOperator::Reinhard:
+        rgbs = rgbs/(1.0f + rgbs);
+        break;
+    case ToneMappingOperator::Aces:
+        rgbs = (rgbs*(2.51f*rgbs + 0.03f))/(rgbs*(2.43f*rgbs + 0.59f) + 0.14f);
+        break;
+    default:
+        assert(false && "unknown tone mapping operator");
+    }
+}
+
+static inline RgbBlock LoadRgbBlock(const Vector3 * const pixelRgbs, const int pixelCount)
+{
+    assert(pixelCount > 0 && pixelCount <= RESOLVE_BLOCK_SIZE);
+
+    // Vector3 is unpadded, so consecutive pixels are a densely packed array of floats
+    if (pixelCount == RESOLVE_BLOCK_SIZE)
+        return Eigen::Map<const RgbBlock>(pixelRgbs->data());
+
+    RgbBlock rgbs = RgbBlock::Zero();
+    rgbs.head(3*pixelCount) = Eigen::Map<const Eigen::ArrayXf>(pixelRgbs->data(), 3*pixelCount);
+
+    return rgbs;
+}
+
+template <typename LoadBlockFunction>
+static inline void ResolveBlocks(
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs,
+    const LoadBlockFunction & loadBlock
+)
+{
+    assert(pixelCount >= 0);
+
+    for (int i = 0; i < pixelCount; i += RESOLVE_BLOCK_SIZE)
+    {
+        const int blockPixelCount = std::min(RESOLVE_BLOCK_SIZE, pixelCount - i);
+
+        ResolveBlock(loadBlock(i, blockPixelCount), blockPixelCount, toneMapping, argbs + i);
+    }
+}
+
+static inline void ResolveBlock(
+    RgbBlock                  rgbs,
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+)
+{
+    ToneMap(rgbs, toneMapping);
+
+    // Clamping from below via comparison makes NaNs end up as 0 too
+    const RgbBlock clampedRgbs = (rgbs > 0.0f).select(rgbs, 0.0f).min(1.0f);
+
+    const Eigen::Array<int, 3*RESOLVE_BLOCK_SIZE, 1> lutIndices =
+        (clampedRgbs*static_cast<float>(SRGB_LUT_SIZE - 1) + 0.5f).cast<int>();
+
+    const SrgbLut & srgbLut = GetSrgbLut();
+
+    for (int i = 0; i < pixelCount; i++)
+    {
+        argbs[i] = (0xFFu                                          << 24) |
+                   (static_cast<Uint32>(srgbLut[lutIndices[3*i + 0]]) << 16) |
+                   (static_cast<Uint32>(srgbLut[lutIndices[3*i + 1]]) << 8)  |
+                   (static_cast<Uint32>(srgbLut[lutIndices[3*i + 2]]) << 0);
+    }
+}
+
+} // namespace rtwe
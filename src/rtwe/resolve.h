@@ -0,0 +1,54 @@
+#ifndef RTWE_RESOLVE_H
+#define RTWE_RESOLVE_H
+
+#include "types.h"
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+enum class ToneMappingOperator
+{
+    None,     // Just clamp
+    Reinhard, // x/(1 + x)
+    Aces      // Narkowicz's fit of the ACES filmic curve
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Converts accumulated RGBs of consecutive pixels into displayable ARGB8888 values.
+ *
+ * In one pass, averages each pixel's samples, applies the tone mapping operator, clamps to [0, 1]
+ * and sRGB-encodes the result via a lookup table. Pixels are processed in fixed-size blocks,
+ * which the compiler vectorizes.
+ *
+ * @param sampleWeight Reciprocal of the number of samples accumulated for each of the pixels.
+ */
+void ResolvePixelRow(
+    const Vector3 * const     accumulatedPixelRgbs,
+    const int                 pixelCount,
+    const float               sampleWeight,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+);
+
+/**
+ * @brief Same as above, but averages each pixel by its own sample count; pixels without samples become black.
+ */
+void ResolvePixelRow(
+    const Vector3 * const     accumulatedPixelRgbs,
+    const float * const       sampleCounts,
+    const int                 pixelCount,
+    const ToneMappingOperator toneMapping,
+    Uint32 * const            argbs
+);
+
+} // namespace rtwe
+
+#endif // RTWE_RESOLVE_H
@@ -0,0 +1,722 @@
+#include "sampling.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "constants.h"
+#include "math_utils.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+// 2 for the position within the pixel, 2 for the position on the lens and 1 for the time within the shutter interval;
+// scatter type, reflection or refraction, and 2 for the scatter direction
+const int SampleStream::PIXEL_DIMENSION_COUNT  = 5;
+const int SampleStream::BOUNCE_DIMENSION_COUNT = 4;
+
+constexpr std::array<std::uint32_t, 48> HALTON_BASES{
+      2,   3,   5,   7,  11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,  53,
+     59,  61,  67,  71,  73,  79,  83,  89,  97, 101, 103, 107, 109, 113, 127, 131,
+    137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223
+};
+
+constexpr int SOBOL_DIMENSION_COUNT = 4;
+constexpr int SOBOL_BIT_COUNT       = 32;
+
+constexpr int           BLUE_NOISE_SIZE        = 64; // Must be a power of 2
+constexpr int           BLUE_NOISE_PIXEL_COUNT = BLUE_NOISE_SIZE*BLUE_NOISE_SIZE;
+constexpr float         BLUE_NOISE_SIGMA       = 1.5f;
+constexpr std::uint32_t BLUE_NOISE_SEED        = 20240601u;
+
+constexpr std::uint32_t DETERMINISTIC_SAMPLER_SEED = 0u;
+
+constexpr float ONE_MINUS_EPSILON = 1.0f - 1.0f/16777216.0f;
+
+//
+// Service types
+//
+
+namespace
+{
+
+using SobolDirections = std::array<std::array<std::uint32_t, SOBOL_BIT_COUNT>, SOBOL_DIMENSION_COUNT>;
+
+// Ranks of a void-and-cluster pattern, in 32-bit fixed point
+using BlueNoiseTexture = std::array<std::uint32_t, BLUE_NOISE_PIXEL_COUNT>;
+
+// Direction sampling is written once for any number of lanes: scalar functions use a single one
+template <int SIZE>
+using FloatLanes = Eigen::Array<float, SIZE, 1>;
+
+template <int SIZE>
+struct Vector3Lanes final
+{
+    FloatLanes<SIZE> X;
+    FloatLanes<SIZE> Y;
+    FloatLanes<SIZE> Z;
+};
+
+} // anonymous namespace
+
+//
+// Service
+//
+
+static inline float ToUnitFloat(const std::uint32_t bits);
+
+static inline std::uint32_t HashUint32(const std::uint32_t value);
+
+static inline std::uint32_t HashPixelDimension(const int pixelX, const int pixelY, const int dimension);
+
+static inline std::uint32_t ReverseBits(std::uint32_t value);
+
+/**
+ * @brief Owen scrambling of a 32-bit fixed point value in [0, 1), by Burley's hash-based approximation.
+ */
+static inline std::uint32_t ScrambleNestedUniform(const std::uint32_t value, const std::uint32_t seed);
+
+/**
+ * @brief Radical inverse with each digit (including trailing zeros, up to float precision) permuted by a random affine map.
+ */
+static inline float GetScrambledRadicalInverse(const std::uint32_t base, std::uint32_t index, const std::uint32_t seed);
+
+static const SobolDirections & GetSobolDirections();
+
+static inline std::uint32_t GetSobolValue(std::uint32_t index, const int dimension);
+
+static const BlueNoiseTexture & GetBlueNoiseTexture();
+
+static BlueNoiseTexture CreateBlueNoiseTexture();
+
+/**
+ * @brief Fractional part of the square root of the dimension's Halton base, in 32-bit fixed point.
+ */
+static inline std::uint32_t GetKroneckerIncrement(const int dimension);
+
+/**
+ * @brief Directions at given polar angles from unit axes (as cosines) and azimuths around them.
+ */
+template <int SIZE>
+static inline Vector3Lanes<SIZE> GetDirectionsAroundAxes(
+    const Vector3Lanes<SIZE> & unitAxes,
+    const FloatLanes<SIZE> &   cosThetas,
+    const FloatLanes<SIZE> &   phis
+);
+
+template <int SIZE>
+static inline Vector3Lanes<SIZE> SampleCosineHemispheresImpl(
+    const Vector3Lanes<SIZE> & unitNormals,
+    const FloatLanes<SIZE> &   values0,
+    const FloatLanes<SIZE> &   values1
+);
+
+template <int SIZE>
+static inline Vector3Lanes<SIZE> SamplePhongLobesImpl(
+    const Vector3Lanes<SIZE> & unitAxes,
+    const FloatLanes<SIZE> &   exponents,
+    const FloatLanes<SIZE> &   values0,
+    const FloatLanes<SIZE> &   values1
+);
+
+template <int SIZE>
+static inline std::pair<FloatLanes<SIZE>, FloatLanes<SIZE>> SampleConcentricDisksImpl(
+    const FloatLanes<SIZE> & values0,
+    const FloatLanes<SIZE> & values1
+);
+
+static inline Vector3Lanes<1> ToLanes(const Vector3 & vector);
+
+static inline Vector3 FromLanes(const Vector3Lanes<1> & lanes);
+
+//
+// RandomSampler
+//
+
+//
+// Construction
+//
+
+RandomSampler::RandomSampler(const std::uint32_t seed):
+    m_Seed(seed)
+{
+    // Empty
+}
+
+//
+// ISampler
+//
+
+float RandomSampler::GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const
+{
+    assert(dimension >= 0);
+
+    return ToUnitFloat(HashUint32(sampleIndex ^ HashUint32(m_Seed ^ HashPixelDimension(pixelX, pixelY, dimension))));
+}
+
+//
+//
+//
+
+//
+// HaltonSampler
+//
+
+//
+// ISampler
+//
+
+float HaltonSampler::GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const
+{
+    assert(dimension >= 0);
+
+    // Scrambling decorrelates pixels, and also spreads out the first samples in large bases,
+    // which would otherwise all be close to 0
+    return GetScrambledRadicalInverse(
+        HALTON_BASES[dimension%HALTON_BASES.size()],
+        sampleIndex,
+        HashPixelDimension(pixelX, pixelY, dimension)
+    );
+}
+
+//
+//
+//
+
+//
+// SobolSampler
+//
+
+//
+// ISampler
+//
+
+float SobolSampler::GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const
+{
+    assert(dimension >= 0);
+
+    const int           sobolDimension = dimension%SOBOL_DIMENSION_COUNT;
+    const std::uint32_t seed           = HashPixelDimension(pixelX, pixelY, dimension/SOBOL_DIMENSION_COUNT);
+
+    // Shuffling the index too decorrelates groups of dimensions, which all use the same 4D sequence
+    const std::uint32_t shuffledIndex = ScrambleNestedUniform(sampleIndex, seed);
+
+    return ToUnitFloat(
+        ScrambleNestedUniform(
+            GetSobolValue(shuffledIndex, sobolDimension),
+            HashUint32(seed ^ static_cast<std::uint32_t>(sobolDimension))
+        )
+    );
+}
+
+//
+//
+//
+
+//
+// BlueNoiseSampler
+//
+
+//
+// ISampler
+//
+
+float BlueNoiseSampler::GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const
+{
+    assert(pixelX >= 0 && pixelY >= 0 && dimension >= 0);
+
+    // Each dimension reads the texture at its own offset, so that dimensions aren't correlated with each other
+    const std::uint32_t offsetHash = HashUint32(static_cast<std::uint32_t>(dimension));
+
+    const std::uint32_t textureX = (static_cast<std::uint32_t>(pixelX) + offsetHash)         & (BLUE_NOISE_SIZE - 1);
+    const std::uint32_t textureY = (static_cast<std::uint32_t>(pixelY) + (offsetHash >> 16)) & (BLUE_NOISE_SIZE - 1);
+
+    // Additive recurrence over samples keeps consecutive samples of a pixel well spread, with wrap-around for free
+    return ToUnitFloat(
+        GetBlueNoiseTexture()[textureY*BLUE_NOISE_SIZE + textureX] + sampleIndex*GetKroneckerIncrement(dimension)
+    );
+}
+
+//
+//
+//
+
+//
+// Utilities
+//
+
+std::unique_ptr<ISampler> CreateSampler(const SamplerType type, const std::uint32_t seed)
+{
+    switch (type)
+    {
+    case SamplerType::Random:
+        return std::make_unique<RandomSampler>(seed);
+    case SamplerType::Halton:
+        return std::make_unique<HaltonSampler>();
+    case SamplerType::Sobol:
+        return std::make_unique<SobolSampler>();
+    case SamplerType::BlueNoise:
+        return std::make_unique<BlueNoiseSampler>();
+    }
+
+    assert(false && "unknown sampler type");
+    return nullptr;
+}
+
+const char * GetSamplerName(const SamplerType type)
+{
+    switch (type)
+    {
+    case SamplerType::Random:
+        return "random";
+    case SamplerType::Halton:
+        return "halton";
+    case SamplerType::Sobol:
+        return "sobol";
+    case SamplerType::BlueNoise:
+        return "blue-noise";
+    }
+
+    assert(false && "unknown sampler type");
+    return "";
+}
+
+std::uint32_t CreateSamplerSeed(const bool isDeterministic)
+{
+    return isDeterministic ? DETERMINISTIC_SAMPLER_SEED : std::random_device()();
+}
+
+Vector3 SampleCosineHemisphere(const Vector3 & unitNormal, const float value0, const float value1)
+{
+    return FromLanes(SampleCosineHemispheresImpl<1>(
+        ToLanes(unitNormal),
+        FloatLanes<1>::Constant(value0),
+        FloatLanes<1>::Constant(value1)
+    ));
+}
+
+Vector3 SamplePhongLobe(const Vector3 & unitAxis, const float exponent, const float value0, const float value1)
+{
+    return FromLanes(SamplePhongLobesImpl<1>(
+        ToLanes(unitAxis),
+        FloatLanes<1>::Constant(exponent),
+        FloatLanes<1>::Constant(value0),
+        FloatLanes<1>::Constant(value1)
+    ));
+}
+
+Vector3Packet SampleCosineHemispheres(const Vector3Packet & unitNormals, const FloatPacket & values0, const FloatPacket & values1)
+{
+    const Vector3Lanes<RAY_PACKET_SIZE> directions = SampleCosineHemispheresImpl<RAY_PACKET_SIZE>(
+        {unitNormals.X, unitNormals.Y, unitNormals.Z},
+        values0,
+        values1
+    );
+
+    return Vector3Packet{directions.X, directions.Y, directions.Z};
+}
+
+Vector3Packet SamplePhongLobes(
+    const Vector3Packet & unitAxes,
+    const FloatPacket &   exponents,
+    const FloatPacket &   values0,
+    const FloatPacket &   values1
+)
+{
+    const Vector3Lanes<RAY_PACKET_SIZE> directions = SamplePhongLobesImpl<RAY_PACKET_SIZE>(
+        {unitAxes.X, unitAxes.Y, unitAxes.Z},
+        exponents,
+        values0,
+        values1
+    );
+
+    return Vector3Packet{directions.X, directions.Y, directions.Z};
+}
+
+std::pair<float, float> SampleConcentricDisk(const float value0, const float value1)
+{
+    const std::pair<FloatLanes<1>, FloatLanes<1>> point = SampleConcentricDisksImpl<1>(
+        FloatLanes<1>::Constant(value0),
+        FloatLanes<1>::Constant(value1)
+    );
+
+    return std::make_pair(point.first[0], point.second[0]);
+}
+
+std::pair<FloatPacket, FloatPacket> SampleConcentricDisks(const FloatPacket & values0, const FloatPacket & values1)
+{
+    return SampleConcentricDisksImpl<RAY_PACKET_SIZE>(values0, values1);
+}
+
+//
+// Service
+//
+
+static inline float ToUnitFloat(const std::uint32_t bits)
+{
+    // Only as many bits as the mantissa holds, so that the result never rounds up to 1
+    return static_cast<float>(bits >> 8)*(1.0f/16777216.0f);
+}
+
+static inline std::uint32_t HashUint32(const std::uint32_t value)
+{
+    // PCG output permutation (Jarzynski and Olano, "Hash Functions for GPU Rendering")
+    const std::uint32_t state = value*747796405u + 2891336453u;
+    const std::uint32_t word  = ((state >> ((state >> 28u) + 4u)) ^ state)*277803737u;
+
+    return (word >> 22u) ^ word;
+}
+
+static inline std::uint32_t HashPixelDimension(const int pixelX, const int pixelY, const int dimension)
+{
+    return HashUint32(
+        static_cast<std::uint32_t>(pixelX) ^ HashUint32(
+            static_cast<std::uint32_t>(pixelY) ^ HashUint32(
+                static_cast<std::uint32_t>(dimension)
+            )
+        )
+    );
+}
+
+static inline std::uint32_t ReverseBits(std::uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+
+    return (value >> 16) | (value << 16);
+}
+
+static inline std::uint32_t ScrambleNestedUniform(const std::uint32_t value, const std::uint32_t seed)
+{
+    // Laine-Karras permutation only lets each bit affect more significant ones, hence the reversals
+    std::uint32_t x = ReverseBits(value);
+
+    x += seed;
+    x ^= x*0x6C50B47Cu;
+    x ^= x*0xB82F1E52u;
+    x ^= x*0xC7AFE638u;
+    x ^= x*0x8D22F6E6u;
+
+    return ReverseBits(x);
+}
+
+static inline float GetScrambledRadicalInverse(const std::uint32_t base, std::uint32_t index, const std::uint32_t seed)
+{
+    const double inverseBase = 1.0/static_cast<double>(base);
+
+    double result = 0.0;
+    double weight = inverseBase;
+
+    std::uint32_t digitHash = seed;
+
+    while (weight*static_cast<double>(base) > 1.0/16777216.0)
+    {
+        // As the base is prime, any non-zero multiplier makes the map a permutation of digits;
+        // a plain LCG step is enough to vary it from digit to digit, as the seed itself is hashed
+        digitHash = digitHash*747796405u + 2891336453u;
+
+        // Multiply-shift maps 16 random bits onto a range without a division
+        const std::uint32_t multiplier = 1 + (((digitHash >> 16)*(base - 1)) >> 16);
+        const std::uint32_t offset     = ((digitHash & 0xFFFFu)*base) >> 16;
+
+        const std::uint32_t nextIndex = index/base;
+        const std::uint32_t digit     = index - nextIndex*base;
+
+        result += static_cast<double>((multiplier*digit + offset)%base)*weight;
+        weight *= inverseBase;
+        index   = nextIndex;
+    }
+
+    return std::min(static_cast<float>(result), ONE_MINUS_EPSILON);
+}
+
+static const SobolDirections & GetSobolDirections()
+{
+    static const SobolDirections SOBOL_DIRECTIONS = []() {
+        // Primitive polynomial degrees, coefficients and initial direction numbers by Joe and Kuo;
+        // the first dimension is simply the van der Corput sequence
+        struct DimensionParameters final
+        {
+            int                degree;
+            std::uint32_t      coefficients;
+            std::array<int, 3> initialNumbers;
+        };
+
+        static const std::array<DimensionParameters, SOBOL_DIMENSION_COUNT - 1> DIMENSION_PARAMETERS{{
+            {1, 0, {1, 0, 0}},
+            {2, 1, {1, 3, 0}},
+            {3, 1, {1, 3, 1}}
+        }};
+
+        SobolDirections directions;
+
+        for (int bit = 0; bit < SOBOL_BIT_COUNT; bit++)
+            directions[0][bit] = 1u << (SOBOL_BIT_COUNT - 1 - bit);
+
+        for (int dimension = 1; dimension < SOBOL_DIMENSION_COUNT; dimension++)
+        {
+            const DimensionParameters & parameters = DIMENSION_PARAMETERS[dimension - 1];
+            std::array<std::uint32_t, SOBOL_BIT_COUNT> & dimensionDirections = directions[dimension];
+
+            for (int bit = 0; bit < parameters.degree; bit++)
+                dimensionDirections[bit] = static_cast<std::uint32_t>(parameters.initialNumbers[bit]) << (SOBOL_BIT_COUNT - 1 - bit);
+
+            for (int bit = parameters.degree; bit < SOBOL_BIT_COUNT; bit++)
+            {
+                dimensionDirections[bit] = dimensionDirections[bit - parameters.degree] ^ (dimensionDirections[bit - parameters.degree] >> parameters.degree);
+
+                for (int k = 1; k < parameters.degree; k++)
+                {
+                    if ((parameters.coefficients >> (parameters.degree - 1 - k)) & 1u)
+                        dimensionDirections[bit] ^= dimensionDirections[bit - k];
+                }
+            }
+        }
+
+        return directions;
+    }();
+
+    return SOBOL_DIRECTIONS;
+}
+
+static inline std::uint32_t GetSobolValue(std::uint32_t index, const int dimension)
+{
+    const std::array<std::uint32_t, SOBOL_BIT_COUNT> & directions = GetSobolDirections()[dimension];
+
+    std::uint32_t result = 0;
+
+    // Scrambled indices have random high bits, so a branchless loop over all bits is faster than skipping zero bits
+    for (int bit = 0; bit < SOBOL_BIT_COUNT; bit++, index >>= 1)
+        result ^= directions[bit] & (0u - (index & 1u));
+
+    return result;
+}
+
+static const BlueNoiseTexture & GetBlueNoiseTexture()
+{
+    static const BlueNoiseTexture BLUE_NOISE_TEXTURE = CreateBlueNoiseTexture();
+
+    return BLUE_NOISE_TEXTURE;
+}
+
+static inline std::uint32_t GetKroneckerIncrement(const int dimension)
+{
+    static const std::array<std::uint32_t, HALTON_BASES.size()> KRONECKER_INCREMENTS = []() {
+        std::array<std::uint32_t, HALTON_BASES.size()> increments;
+
+        for (size_t i = 0; i < HALTON_BASES.size(); i++)
+        {
+            const double root = std::sqrt(static_cast<double>(HALTON_BASES[i]));
+            increments[i] = static_cast<std::uint32_t>((root - std::floor(root))*4294967296.0);
+        }
+
+        return increments;
+    }();
+
+    return KRONECKER_INCREMENTS[dimension%KRONECKER_INCREMENTS.size()];
+}
+
+static BlueNoiseTexture CreateBlueNoiseTexture()
+{
+    // Ulichney's void-and-cluster method, on a torus so that the texture tiles seamlessly
+
+    std::vector<float> energyKernel(BLUE_NOISE_PIXEL_COUNT);
+    for (int y = 0; y < BLUE_NOISE_SIZE; y++)
+    {
+        for (int x = 0; x < BLUE_NOISE_SIZE; x++)
+        {
+            const int distanceX = std::min(x, BLUE_NOISE_SIZE - x);
+            const int distanceY = std::min(y, BLUE_NOISE_SIZE - y);
+
+            energyKernel[y*BLUE_NOISE_SIZE + x] = std::exp(
+                -static_cast<float>(distanceX*distanceX + distanceY*distanceY)/(2.0f*BLUE_NOISE_SIGMA*BLUE_NOISE_SIGMA)
+            );
+        }
+    }
+
+    std::vector<bool>  isPixelSet(BLUE_NOISE_PIXEL_COUNT, false);
+    std::vector<float> energies(BLUE_NOISE_PIXEL_COUNT, 0.0f);
+
+    const auto setPixel = [&](const int pixelIndex, const bool isSet) {
+        isPixelSet[pixelIndex] = isSet;
+
+        const int   pixelX = pixelIndex%BLUE_NOISE_SIZE;
+        const int   pixelY = pixelIndex/BLUE_NOISE_SIZE;
+        const float sign   = isSet ? 1.0f : -1.0f;
+
+        for (int y = 0; y < BLUE_NOISE_SIZE; y++)
+        {
+            const int kernelRowOffset = ((y - pixelY) & (BLUE_NOISE_SIZE - 1))*BLUE_NOISE_SIZE;
+
+            for (int x = 0; x < BLUE_NOISE_SIZE; x++)
+                energies[y*BLUE_NOISE_SIZE + x] += sign*energyKernel[kernelRowOffset + ((x - pixelX) & (BLUE_NOISE_SIZE - 1))];
+        }
+    };
+
+    // Tightest cluster is the set pixel with the most energy, largest void is the unset one with the least
+    const auto findPixel = [&](const bool isSet, const bool isMaxEnergy) {
+        int pixelIndex = -1;
+
+        for (int i = 0; i < BLUE_NOISE_PIXEL_COUNT; i++)
+        {
+            if (isPixelSet[i] != isSet)
+                continue;
+
+            if (pixelIndex < 0 || (isMaxEnergy ? energies[i] > energies[pixelIndex] : energies[i] < energies[pixelIndex]))
+                pixelIndex = i;
+        }
+
+        return pixelIndex;
+    };
+
+    // Initial pattern: random pixels, evened out by moving pixels from tightest clusters into largest voids
+
+    std::mt19937 generator(BLUE_NOISE_SEED);
+
+    int initialSetPixelCount = 0;
+    while (initialSetPixelCount < BLUE_NOISE_PIXEL_COUNT/10)
+    {
+        const int pixelIndex = static_cast<int>(generator()%BLUE_NOISE_PIXEL_COUNT);
+        if (isPixelSet[pixelIndex])
+            continue;
+
+        setPixel(pixelIndex, true);
+        initialSetPixelCount++;
+    }
+
+    for (int i = 0; i < BLUE_NOISE_PIXEL_COUNT; i++)
+    {
+        const int clusterPixelIndex = findPixel(true, true);
+        setPixel(clusterPixelIndex, false);
+
+        const int voidPixelIndex = findPixel(false, false);
+        setPixel(voidPixelIndex, true);
+
+        if (voidPixelIndex == clusterPixelIndex)
+            break;
+    }
+
+    // Rank the initial pattern's pixels by removing tightest clusters, and the rest by filling largest voids
+
+    const std::vector<bool>  initialIsPixelSet = isPixelSet;
+    const std::vector<float> initialEnergies   = energies;
+
+    std::vector<int> ranks(BLUE_NOISE_PIXEL_COUNT);
+
+    for (int rank = initialSetPixelCount - 1; rank >= 0; rank--)
+    {
+        const int pixelIndex = findPixel(true, true);
+
+        setPixel(pixelIndex, false);
+        ranks[pixelIndex] = rank;
+    }
+
+    isPixelSet = initialIsPixelSet;
+    energies   = initialEnergies;
+
+    for (int rank = initialSetPixelCount; rank < BLUE_NOISE_PIXEL_COUNT; rank++)
+    {
+        const int pixelIndex = findPixel(false, false);
+
+        setPixel(pixelIndex, true);
+        ranks[pixelIndex] = rank;
+    }
+
+    BlueNoiseTexture texture;
+
+    for (int i = 0; i < BLUE_NOISE_PIXEL_COUNT; i++)
+        texture[i] = static_cast<std::uint32_t>((static_cast<double>(ranks[i]) + 0.5)/BLUE_NOISE_PIXEL_COUNT*4294967296.0);
+
+    return texture;
+}
+
+template <int SIZE>
+static inline Vector3Lanes<SIZE> GetDirectionsAroundAxes(
+    const Vector3Lanes<SIZE> & unitAxes,
+    const FloatLanes<SIZE> &   cosThetas,
+    const FloatLanes<SIZE> &   phis
+)
+{
+    // Branchless orthonormal basis around each axis (Duff et al., "Building an Orthonormal Basis, Revisited")
+    const FloatLanes<SIZE> signs = (unitAxes.Z >= 0.0f).select(FloatLanes<SIZE>::Ones(), -FloatLanes<SIZE>::Ones());
+    const FloatLanes<SIZE> a     = -1.0f/(signs + unitAxes.Z);
+    const FloatLanes<SIZE> b     = unitAxes.X*unitAxes.Y*a;
+
+    const FloatLanes<SIZE> sinThetas        = (1.0f - cosThetas.square()).max(0.0f).sqrt();
+    const FloatLanes<SIZE> tangentWeights   = sinThetas*phis.cos();
+    const FloatLanes<SIZE> bitangentWeights = sinThetas*phis.sin();
+
+    // Tangent is (1 + sign*x^2*a, sign*b, -sign*x), bitangent is (b, sign + y^2*a, -y)
+    return Vector3Lanes<SIZE>{
+        tangentWeights*(1.0f + signs*unitAxes.X.square()*a) + bitangentWeights*b + cosThetas*unitAxes.X,
+        tangentWeights*signs*b + bitangentWeights*(signs + unitAxes.Y.square()*a) + cosThetas*unitAxes.Y,
+        -tangentWeights*signs*unitAxes.X - bitangentWeights*unitAxes.Y + cosThetas*unitAxes.Z
+    };
+}
+
+template <int SIZE>
+static inline Vector3Lanes<SIZE> SampleCosineHemispheresImpl(
+    const Vector3Lanes<SIZE> & unitNormals,
+    const FloatLanes<SIZE> &   values0,
+    const FloatLanes<SIZE> &   values1
+)
+{
+    // Uniform point on the unit disk, projected up onto the hemisphere (Malley's method)
+    return GetDirectionsAroundAxes<SIZE>(unitNormals, (1.0f - values0).sqrt(), (2.0f*PI)*values1);
+}
+
+template <int SIZE>
+static inline Vector3Lanes<SIZE> SamplePhongLobesImpl(
+    const Vector3Lanes<SIZE> & unitAxes,
+    const FloatLanes<SIZE> &   exponents,
+    const FloatLanes<SIZE> &   values0,
+    const FloatLanes<SIZE> &   values1
+)
+{
+    // cos(theta) = value0^(1/(exponent + 1)), with pow() expressed by log() and exp(), which have SIMD implementations
+    return GetDirectionsAroundAxes<SIZE>(unitAxes, (values0.log()/(exponents + 1.0f)).exp(), (2.0f*PI)*values1);
+}
+
+template <int SIZE>
+static inline std::pair<FloatLanes<SIZE>, FloatLanes<SIZE>> SampleConcentricDisksImpl(
+    const FloatLanes<SIZE> & values0,
+    const FloatLanes<SIZE> & values1
+)
+{
+    // Concentric squares of [-1, 1]^2 map onto concentric circles, with the larger coordinate as the radius
+    const FloatLanes<SIZE> a = 2.0f*values0 - 1.0f;
+    const FloatLanes<SIZE> b = 2.0f*values1 - 1.0f;
+
+    const auto             areAlongX = a.abs() > b.abs();
+    const FloatLanes<SIZE> radii     = areAlongX.select(a, b);
+
+    // The center has no angle, and would divide 0 by 0
+    const FloatLanes<SIZE> ratios = (radii != 0.0f).select(areAlongX.select(b, a)/radii, 0.0f);
+    const FloatLanes<SIZE> phis   = areAlongX.select((0.25f*PI)*ratios, 0.5f*PI - (0.25f*PI)*ratios);
+
+    return std::make_pair(radii*phis.cos(), radii*phis.sin());
+}
+
+static inline Vector3Lanes<1> ToLanes(const Vector3 & vector)
+{
+    return Vector3Lanes<1>{
+        FloatLanes<1>::Constant(vector.x()),
+        FloatLanes<1>::Constant(vector.y()),
+        FloatLanes<1>::Constant(vector.z())
+    };
+}
+
+static inline Vector3 FromLanes(const Vector3Lanes<1> & lanes)
+{
+    return Vector3(lanes.X[0], lanes.Y[0], lanes.Z[0]);
+}
+
+} // namespace rtwe
@@ -0,0 +1,245 @@
+#ifndef RTWE_SAMPLING_H
+#define RTWE_SAMPLING_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "types.h"
+#include "RayPacket.h"
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+enum class SamplerType
+{
+    Random,
+    Halton,
+    Sobol,
+    BlueNoise
+};
+
+constexpr int SAMPLER_TYPE_COUNT = 4;
+
+//
+// ISampler
+//
+
+/**
+ * @brief Provides values in [0, 1) for each dimension of each sample of each pixel.
+ *
+ * Stateless, so that tiles can be sampled concurrently and in any order: a value only depends on its arguments
+ * (and RandomSampler's seed), and pixels are decorrelated from each other by hashing their coordinates.
+ * Renders are therefore the same whatever the number of threads and the order they take tiles in.
+ */
+struct ISampler
+{
+    virtual ~ISampler() = default;
+
+    virtual float GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const = 0;
+};
+
+//
+// RandomSampler
+//
+
+/**
+ * @brief Uniform values without any stratification, hashed from all arguments and a seed.
+ */
+class RandomSampler final:
+    public ISampler
+{
+public: // Construction
+
+    explicit RandomSampler(const std::uint32_t seed);
+
+public: // ISampler
+
+    virtual float GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const override;
+
+private: // Members
+
+    const std::uint32_t m_Seed;
+};
+
+//
+// HaltonSampler
+//
+
+/**
+ * @brief Radical inverses of the sample index in a prime base per dimension, with digits scrambled per pixel and dimension.
+ *
+ * Dimensions beyond the table of bases reuse them with different scrambling.
+ */
+class HaltonSampler final:
+    public ISampler
+{
+public: // ISampler
+
+    virtual float GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const override;
+};
+
+//
+// SobolSampler
+//
+
+/**
+ * @brief Owen-scrambled Sobol sequence (Burley's hash-based variant).
+ *
+ * Dimensions are taken 4 at a time from a 4D Sobol sequence, each group with its own scrambling seed and index shuffle,
+ * so that any number of dimensions are well stratified on their own and in their first 4D projections.
+ */
+class SobolSampler final:
+    public ISampler
+{
+public: // ISampler
+
+    virtual float GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const override;
+};
+
+//
+// BlueNoiseSampler
+//
+
+/**
+ * @brief Tiled blue noise texture, offset per dimension and advanced by an irrational increment per dimension with each sample.
+ *
+ * Neighboring pixels get dissimilar values, so that the error of the first few samples per pixel
+ * looks like fine high frequency noise rather than blotches.
+ */
+class BlueNoiseSampler final:
+    public ISampler
+{
+public: // ISampler
+
+    virtual float GetValue(const int pixelX, const int pixelY, const std::uint32_t sampleIndex, const int dimension) const override;
+};
+
+//
+// SampleStream
+//
+
+/**
+ * @brief Values of consecutive dimensions of one pixel sample, as consumed along its path.
+ *
+ * The first PIXEL_DIMENSION_COUNT dimensions position the sample within the pixel, on the lens and within the shutter
+ * interval (the lens only for cameras with an aperture, the shutter interval only for scenes with moving bodies, leaving
+ * dimensions which aren't needed unused at the end). After that, each bounce starts at its own fixed dimension, so that
+ * the same decision at the same depth always gets the same dimension, whatever the previous bounces consumed.
+ */
+class SampleStream final
+{
+public: // Constants
+
+    static const int PIXEL_DIMENSION_COUNT;
+    static const int BOUNCE_DIMENSION_COUNT;
+
+public: // Construction
+
+    SampleStream() = default;
+
+    inline SampleStream(const ISampler & sampler, const int pixelX, const int pixelY, const std::uint32_t sampleIndex);
+
+public: // Interface
+
+    inline float GetNextValue();
+
+    inline void StartBounce(const int depth);
+
+private: // Members
+
+    const ISampler * m_pSampler;
+    int              m_PixelX;
+    int              m_PixelY;
+    std::uint32_t    m_SampleIndex;
+    int              m_Dimension;
+};
+
+//
+// Construction
+//
+
+inline SampleStream::SampleStream(const ISampler & sampler, const int pixelX, const int pixelY, const std::uint32_t sampleIndex):
+    m_pSampler   (&sampler),
+    m_PixelX     (pixelX),
+    m_PixelY     (pixelY),
+    m_SampleIndex(sampleIndex),
+    m_Dimension  (0)
+{
+    // Empty
+}
+
+//
+// Interface
+//
+
+inline float SampleStream::GetNextValue()
+{
+    return m_pSampler->GetValue(m_PixelX, m_PixelY, m_SampleIndex, m_Dimension++);
+}
+
+inline void SampleStream::StartBounce(const int depth)
+{
+    assert(depth >= 0);
+    assert(m_Dimension <= PIXEL_DIMENSION_COUNT + depth*BOUNCE_DIMENSION_COUNT && "a bounce must not consume more than BOUNCE_DIMENSION_COUNT dimensions");
+
+    m_Dimension = PIXEL_DIMENSION_COUNT + depth*BOUNCE_DIMENSION_COUNT;
+}
+
+//
+// Utilities
+//
+
+/**
+ * @param seed Seed of a random sampler's values, ignored by other samplers, which always give the same ones.
+ */
+std::unique_ptr<ISampler> CreateSampler(const SamplerType type, const std::uint32_t seed);
+
+/**
+ * @brief Name of the sampler as used on the command line.
+ */
+const char * GetSamplerName(const SamplerType type);
+
+/**
+ * @brief Fixed seed if the same values should be sampled on every run, or a new random one otherwise.
+ */
+std::uint32_t CreateSamplerSeed(const bool isDeterministic);
+
+/**
+ * @brief Cosine-weighted direction in the hemisphere around a unit normal, from two values in [0, 1).
+ *
+ * Maps the values directly, without rejection or branches, so that packet variants below compute the same directions.
+ */
+Vector3 SampleCosineHemisphere(const Vector3 & unitNormal, const float value0, const float value1);
+
+/**
+ * @brief Direction around a unit axis with density proportional to cos(theta)^exponent, from two values in [0, 1).
+ */
+Vector3 SamplePhongLobe(const Vector3 & unitAxis, const float exponent, const float value0, const float value1);
+
+/**
+ * @brief Point on the unit disk, as its x and y, from two values in [0, 1), by Shirley and Chiu's concentric mapping.
+ *
+ * Unlike the polar mapping, it keeps neighboring values neighboring, so that stratification of the values carries over.
+ */
+std::pair<float, float> SampleConcentricDisk(const float value0, const float value1);
+
+Vector3Packet SampleCosineHemispheres(const Vector3Packet & unitNormals, const FloatPacket & values0, const FloatPacket & values1);
+
+Vector3Packet SamplePhongLobes(
+    const Vector3Packet & unitAxes,
+    const FloatPacket &   exponents,
+    const FloatPacket &   values0,
+    const FloatPacket &   values1
+);
+
+std::pair<FloatPacket, FloatPacket> SampleConcentricDisks(const FloatPacket & values0, const FloatPacket & values1);
+
+} // namespace rtwe
+
+#endif // RTWE_SAMPLING_H
@@ -0,0 +1,179 @@
+#include "scenes.h"
+
+#include <cassert>
+#include <random>
+
+#include "targets.h"
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+constexpr float SCENE_FLOOR_HEIGHT = -0.5f;
+
+// Area of the floor covered by CreateManySpheresSceneBodies(), as seen from the default camera
+constexpr float MANY_SPHERES_MIN_X      = -3.0f;
+constexpr float MANY_SPHERES_MAX_X      =  3.0f;
+constexpr float MANY_SPHERES_MIN_Z      =  0.5f;
+constexpr float MANY_SPHERES_MAX_Z      =  6.0f;
+constexpr float MANY_SPHERES_MIN_RADIUS =  0.03f;
+constexpr float MANY_SPHERES_MAX_RADIUS =  0.12f;
+
+// Of SceneType::ManySpheres
+constexpr int           MANY_SPHERES_SCENE_SPHERE_COUNT = 1000;
+constexpr std::uint32_t MANY_SPHERES_SCENE_SEED         = 1;
+
+static const Material GLASS_MATERIAL{Color(0.95f, 0.95f, 0.95f), 0.975f, 0.975f, 0.975f, 1.5f};
+
+//
+// Utilities
+//
+
+std::vector<Body> CreateSceneBodies(const SceneType type)
+{
+    switch (type)
+    {
+    case SceneType::Default:
+        return CreateDefaultSceneBodies();
+    case SceneType::ManySpheres:
+        return CreateManySpheresSceneBodies(MANY_SPHERES_SCENE_SPHERE_COUNT, MANY_SPHERES_SCENE_SEED);
+    case SceneType::Glass:
+        return CreateGlassSceneBodies();
+    }
+
+    assert(false && "unknown scene type");
+    return {};
+}
+
+const char * GetSceneName(const SceneType type)
+{
+    switch (type)
+    {
+    case SceneType::Default:
+        return "default";
+    case SceneType::ManySpheres:
+        return "many-spheres";
+    case SceneType::Glass:
+        return "glass";
+    }
+
+    assert(false && "unknown scene type");
+    return "";
+}
+
+std::vector<Body> CreateDefaultSceneBodies()
+{
+    return {
+        {
+            std::make_shared<PlaneRayTarget>(Vector3(0.0f, SCENE_FLOOR_HEIGHT, 0.0f), Vector3(0.0f, 1.0f, 0.0f)),
+            Material{
+                Color(0.75f, 0.75f, 0.75f),
+                0.25f, 0.85f, 0.0f, 1.0f
+            }
+        },
+        {
+            std::make_shared<SphereRayTarget>(Vector3(0.0f, 0.0f, 1.0f), 0.5f),
+            Material{
+                Color(0.75f, 0.75f,  0.75f),
+                0.975f, 0.975f, 0.975f, 1.5f
+            }
+        },
+        {
+            std::make_shared<SphereRayTarget>(Vector3(0.75f, -0.25f, 0.75f), 0.25f),
+            Material{
+                Color(0.35f, 0.7f, 0.35f),
+                0.75f, 1.0f, 0.0f, 1.0f
+            }
+        },
+        {
+            std::make_shared<SphereRayTarget>(Vector3(-1.25f, 0.25f, 1.5f), 0.75f),
+            Material{
+                Color(0.8f, 0.4f, 0.6f),
+                0.0f, 1.0f, 0.0f, 1.0f
+            }
+        }
+    };
+}
+
+std::vector<Body> CreateManySpheresSceneBodies(const int sphereCount, const std::uint32_t seed)
+{
+    // Distributions are implementation-defined, so values are derived from the generator's output directly
+    std::mt19937 generator(seed);
+
+    const auto getRandomValue = [&generator](const float min, const float max) {
+        return min + (max - min)*static_cast<float>(generator())/static_cast<float>(std::mt19937::max());
+    };
+
+    std::vector<Body> bodies{
+        {
+            std::make_shared<PlaneRayTarget>(Vector3(0.0f, SCENE_FLOOR_HEIGHT, 0.0f), Vector3(0.0f, 1.0f, 0.0f)),
+            Material{
+                Color(0.5f, 0.5f, 0.5f),
+                0.0f, 1.0f, 0.0f, 1.0f
+            }
+        }
+    };
+
+    for (int i = 0; i < sphereCount; i++)
+    {
+        const float radius = getRandomValue(MANY_SPHERES_MIN_RADIUS, MANY_SPHERES_MAX_RADIUS);
+
+        const Vector3 center(
+            getRandomValue(MANY_SPHERES_MIN_X, MANY_SPHERES_MAX_X),
+            SCENE_FLOOR_HEIGHT + radius,
+            getRandomValue(MANY_SPHERES_MIN_Z, MANY_SPHERES_MAX_Z)
+        );
+
+        const Color albedo(getRandomValue(0.2f, 0.9f), getRandomValue(0.2f, 0.9f), getRandomValue(0.2f, 0.9f));
+
+        // Mostly matte, with some metallic and a few glass spheres
+        const float materialChoice = getRandomValue(0.0f, 1.0f);
+
+        Material material{albedo, 0.0f, 1.0f, 0.0f, 1.0f};
+        if (materialChoice > 0.9f)
+            material = GLASS_MATERIAL;
+        else if (materialChoice > 0.6f)
+            material = Material{albedo, 0.8f, getRandomValue(0.7f, 1.0f), 0.0f, 1.0f};
+
+        bodies.push_back({std::make_shared<SphereRayTarget>(center, radius), material});
+    }
+
+    return bodies;
+}
+
+std::vector<Body> CreateGlassSceneBodies()
+{
+    return {
+        {
+            std::make_shared<PlaneRayTarget>(Vector3(0.0f, SCENE_FLOOR_HEIGHT, 0.0f), Vector3(0.0f, 1.0f, 0.0f)),
+            Material{
+                Color(0.75f, 0.75f, 0.75f),
+                0.0f, 1.0f, 0.0f, 1.0f
+            }
+        },
+        // Glass spheres in front, one of them with a smaller one inside
+        {std::make_shared<SphereRayTarget>(Vector3( 0.0f,  0.0f,  1.0f), 0.5f),  GLASS_MATERIAL},
+        {std::make_shared<SphereRayTarget>(Vector3( 0.0f,  0.0f,  1.0f), 0.25f), GLASS_MATERIAL},
+        {std::make_shared<SphereRayTarget>(Vector3(-0.9f, -0.2f,  0.9f), 0.3f),  GLASS_MATERIAL},
+        {std::make_shared<SphereRayTarget>(Vector3( 0.9f, -0.3f,  0.7f), 0.2f),  GLASS_MATERIAL},
+        {std::make_shared<SphereRayTarget>(Vector3( 0.5f,  0.45f, 1.6f), 0.35f), GLASS_MATERIAL},
+        // Matte spheres behind them, to be seen through the glass
+        {
+            std::make_shared<SphereRayTarget>(Vector3(-0.6f, 0.0f, 2.5f), 0.5f),
+            Material{Color(0.8f, 0.2f, 0.2f), 0.0f, 1.0f, 0.0f, 1.0f}
+        },
+        {
+            std::make_shared<SphereRayTarget>(Vector3(0.6f, -0.1f, 2.8f), 0.4f),
+            Material{Color(0.2f, 0.7f, 0.3f), 0.0f, 1.0f, 0.0f, 1.0f}
+        },
+        {
+            std::make_shared<SphereRayTarget>(Vector3(0.0f, 0.3f, 3.5f), 0.8f),
+            Material{Color(0.2f, 0.3f, 0.8f), 0.0f, 1.0f, 0.0f, 1.0f}
+        }
+    };
+}
+
+} // namespace rtwe
@@ -0,0 +1,58 @@
+#ifndef RTWE_SCENES_H
+#define RTWE_SCENES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "tracing.h"
+
+namespace rtwe
+{
+
+//
+// Interface types
+//
+
+enum class SceneType
+{
+    Default,
+    ManySpheres,
+    Glass
+};
+
+constexpr int SCENE_TYPE_COUNT = 3;
+
+//
+// Utilities
+//
+
+/**
+ * @brief Bodies of one of the canonical scenes, all of which are meant to be seen from the application's initial view.
+ */
+std::vector<Body> CreateSceneBodies(const SceneType type);
+
+/**
+ * @brief Name of the scene as used on the command line and in file names.
+ */
+const char * GetSceneName(const SceneType type);
+
+/**
+ * @brief Scene shown by the application: a glass, a metallic and a matte sphere on a glossy floor plane.
+ */
+std::vector<Body> CreateDefaultSceneBodies();
+
+/**
+ * @brief Small spheres of random materials and sizes scattered over the default scene's floor, in front of the camera.
+ *
+ * The same seed always gives the same scene, so that it can be used for comparable measurements.
+ */
+std::vector<Body> CreateManySpheresSceneBodies(const int sphereCount, const std::uint32_t seed);
+
+/**
+ * @brief Glass spheres of various sizes, some nested, in front of colorful matte ones, so that most paths refract several times.
+ */
+std::vector<Body> CreateGlassSceneBodies();
+
+} // namespace rtwe
+
+#endif // RTWE_SCENES_H
@@ -0,0 +1,308 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+static const std::array<const char *, STAT_STAGE_COUNT> STAT_STAGE_NAMES{
+    "camera rays",
+    "intersection",
+    "lambertian scattering",
+    "metallic scattering",
+    "refractive scattering",
+    "miss shading",
+    "resolve"
+};
+
+constexpr int CLOCK_READ_CALIBRATION_COUNT = 1000;
+
+static const std::array<const char *, STAT_COUNTER_COUNT> STAT_COUNTER_NAMES{
+    "BVH node tests",
+    "tests of primitives in BVH leaves",
+    "tests of unbounded primitives"
+};
+
+//
+// Service types
+//
+
+namespace
+{
+
+/**
+ * @brief Statistics of all running threads which have used them, and sums of those of finished threads.
+ *
+ * Finished threads' statistics are kept, so that snapshots never go backwards.
+ */
+struct ThreadStatsRegistry final
+{
+    std::mutex                 Mutex;
+    std::vector<ThreadStats *> RunningThreadStats;
+    StatsSnapshot              FinishedThreadStats{};
+};
+
+/**
+ * @brief Moves statistics of its thread from running to finished ones when the thread exits.
+ */
+struct ThreadStatsRegistration final
+{
+    ~ThreadStatsRegistration();
+};
+
+} // anonymous namespace
+
+// Registration happens in the first timed call of each thread, so that untimed calls don't even check for it
+static thread_local bool isCurrentThreadStatsRegistered = false;
+
+//
+// Service
+//
+
+static void RegisterCurrentThreadStats();
+
+static ThreadStatsRegistry & GetThreadStatsRegistry();
+
+static void AddThreadStats(StatsSnapshot & stats, const ThreadStats & threadStats);
+
+/**
+ * @brief Shortest time between two consecutive reads of the clock used by ScopedStageTimer, measured once.
+ */
+static double GetClockReadNanoseconds();
+
+//
+// ScopedStageTimer
+//
+
+void ScopedStageTimer::startTiming(ThreadStats::Stage & stageStats, const std::uint64_t itemCount)
+{
+    if (!isCurrentThreadStatsRegistered)
+        RegisterCurrentThreadStats();
+
+    AddToStat(stageStats.ItemCount, stageStats.PendingItemCount);
+    stageStats.PendingItemCount = 0;
+
+    m_pTimedStage = &stageStats;
+    m_ItemCount   = itemCount;
+    m_StartTime   = std::chrono::steady_clock::now();
+}
+
+void ScopedStageTimer::finishTiming()
+{
+    const auto elapsedTime = std::chrono::steady_clock::now() - m_StartTime;
+
+    AddToStat(m_pTimedStage->TimedItemCount, m_ItemCount);
+    AddToStat(m_pTimedStage->TimedCallCount, 1);
+    AddToStat(
+        m_pTimedStage->TimedNanoseconds,
+        static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime).count())
+    );
+}
+
+//
+// Utilities
+//
+
+StatsSnapshot TakeStatsSnapshot()
+{
+    ThreadStatsRegistry & registry = GetThreadStatsRegistry();
+
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    StatsSnapshot result = registry.FinishedThreadStats;
+    for (const ThreadStats * const pThreadStats : registry.RunningThreadStats)
+        AddThreadStats(result, *pThreadStats);
+
+    return result;
+}
+
+StatsSnapshot SubtractStats(const StatsSnapshot & later, const StatsSnapshot & earlier)
+{
+    StatsSnapshot result;
+
+    for (int i = 0; i < STAT_STAGE_COUNT; i++)
+    {
+        result.Stages[i].ItemCount        = later.Stages[i].ItemCount        - earlier.Stages[i].ItemCount;
+        result.Stages[i].TimedItemCount   = later.Stages[i].TimedItemCount   - earlier.Stages[i].TimedItemCount;
+        result.Stages[i].TimedCallCount   = later.Stages[i].TimedCallCount   - earlier.Stages[i].TimedCallCount;
+        result.Stages[i].TimedNanoseconds = later.Stages[i].TimedNanoseconds - earlier.Stages[i].TimedNanoseconds;
+    }
+
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        result.Counts[i] = later.Counts[i] - earlier.Counts[i];
+
+    return result;
+}
+
+double GetStageSeconds(const StageStats & stageStats)
+{
+    if (stageStats.TimedItemCount == 0)
+        return 0.0;
+
+    // Each timed call also includes about one clock read, which matters for stages taking tens of nanoseconds per call
+    const double timedNanoseconds = std::max(
+        0.0,
+        static_cast<double>(stageStats.TimedNanoseconds) - GetClockReadNanoseconds()*stageStats.TimedCallCount
+    );
+
+    return timedNanoseconds/stageStats.TimedItemCount*stageStats.ItemCount/1.0e9;
+}
+
+double GetStatCount(const StatsSnapshot & stats, const StatCounter counter)
+{
+    const StageStats & intersectionStats = stats.Stages[static_cast<int>(StatStage::Intersection)];
+
+    if (intersectionStats.TimedItemCount == 0)
+        return 0.0;
+
+    return static_cast<double>(stats.Counts[static_cast<int>(counter)])/intersectionStats.TimedItemCount*intersectionStats.ItemCount;
+}
+
+double GetMraysPerSecond(const StatsSnapshot & stats, const double seconds)
+{
+    // Every traced ray, primary or secondary, goes through intersection exactly once
+    return static_cast<double>(stats.Stages[static_cast<int>(StatStage::Intersection)].ItemCount)/seconds/1.0e6;
+}
+
+std::string DescribeStats(const StatsSnapshot & stats, const double seconds)
+{
+    std::ostringstream description;
+
+    description.precision(3);
+    description << "Traced " << GetMraysPerSecond(stats, seconds) << " Mrays/s, time per stage (summed over threads):";
+
+    for (int i = 0; i < STAT_STAGE_COUNT; i++)
+    {
+        description
+            << (i > 0 ? "," : "") << " " << STAT_STAGE_NAMES[i]
+            << " " << GetStageSeconds(stats.Stages[i])*1000.0 << " ms"
+            << " (" << stats.Stages[i].ItemCount/1.0e6 << " M)";
+    }
+
+    description << ";";
+
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        description << (i > 0 ? "," : "") << " " << GetStatCount(stats, static_cast<StatCounter>(i))/1.0e6 << " M " << STAT_COUNTER_NAMES[i];
+
+    return description.str();
+}
+
+std::uint64_t GetPeakResidentSetBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS memoryCounters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+        return 0;
+
+    return static_cast<std::uint64_t>(memoryCounters.PeakWorkingSetSize);
+#elif defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Bytes on macOS, kibibytes elsewhere
+#if defined(__APPLE__)
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss)*1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+//
+// Service
+//
+
+static void RegisterCurrentThreadStats()
+{
+    // Constructed on first use by each thread, and destroyed when it exits
+    thread_local ThreadStatsRegistration registration;
+
+    ThreadStatsRegistry & registry = GetThreadStatsRegistry();
+
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    registry.RunningThreadStats.push_back(&currentThreadStats);
+    isCurrentThreadStatsRegistered = true;
+}
+
+ThreadStatsRegistration::~ThreadStatsRegistration()
+{
+    ThreadStatsRegistry & registry = GetThreadStatsRegistry();
+
+    // Items of untimed calls since the last timed one would otherwise be lost with the thread
+    for (ThreadStats::Stage & stage : currentThreadStats.Stages)
+    {
+        AddToStat(stage.ItemCount, stage.PendingItemCount);
+        stage.PendingItemCount = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    AddThreadStats(registry.FinishedThreadStats, currentThreadStats);
+
+    registry.RunningThreadStats.erase(
+        std::remove(registry.RunningThreadStats.begin(), registry.RunningThreadStats.end(), &currentThreadStats),
+        registry.RunningThreadStats.end()
+    );
+}
+
+static ThreadStatsRegistry & GetThreadStatsRegistry()
+{
+    static ThreadStatsRegistry registry;
+
+    return registry;
+}
+
+static void AddThreadStats(StatsSnapshot & stats, const ThreadStats & threadStats)
+{
+    for (int i = 0; i < STAT_STAGE_COUNT; i++)
+    {
+        const ThreadStats::Stage & threadStage = threadStats.Stages[i];
+        StageStats &               stage       = stats.Stages[i];
+
+        stage.ItemCount        += threadStage.ItemCount.load(std::memory_order_relaxed);
+        stage.TimedItemCount   += threadStage.TimedItemCount.load(std::memory_order_relaxed);
+        stage.TimedCallCount   += threadStage.TimedCallCount.load(std::memory_order_relaxed);
+        stage.TimedNanoseconds += threadStage.TimedNanoseconds.load(std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        stats.Counts[i] += threadStats.Counts[i].load(std::memory_order_relaxed);
+}
+
+static double GetClockReadNanoseconds()
+{
+    static const double CLOCK_READ_NANOSECONDS = []() {
+        auto minReadTime = std::chrono::steady_clock::duration::max();
+        for (int i = 0; i < CLOCK_READ_CALIBRATION_COUNT; i++)
+        {
+            const auto startTime = std::chrono::steady_clock::now();
+
+            minReadTime = std::min(minReadTime, std::chrono::steady_clock::now() - startTime);
+        }
+
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(minReadTime).count());
+    }();
+
+    return CLOCK_READ_NANOSECONDS;
+}
+
+} // namespace rtwe
@@ -0,0 +1,243 @@
+#ifndef RTWE_STATS_H
+#define RTWE_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+#ifdef RTWE_ENABLE_STATS
+constexpr bool ARE_STATS_ENABLED = true;
+#else // RTWE_ENABLE_STATS
+constexpr bool ARE_STATS_ENABLED = false;
+#endif // RTWE_ENABLE_STATS
+
+// Reading the clock costs about as much as scattering a ray, so only calls covering one item in this many get timed
+constexpr std::uint64_t STAT_TIMED_ITEM_INTERVAL = 256;
+
+//
+// Interface types
+//
+
+enum class StatStage
+{
+    CameraRays,
+    Intersection,
+    LambertianScattering,
+    MetallicScattering,
+    RefractiveScattering,
+    MissShading,
+    Resolve
+};
+
+constexpr int STAT_STAGE_COUNT = 7;
+
+// Only counted during timed intersection calls, and scaled up to all of them like stage times;
+// primitive tests are counted by the loops which make them rather than in each primitive, which would cost several percent
+enum class StatCounter
+{
+    BvhNodeTests,
+    BoundedPrimitiveTests,
+    UnboundedPrimitiveTests
+};
+
+constexpr int STAT_COUNTER_COUNT = 3;
+
+struct StageStats final
+{
+    std::uint64_t ItemCount; // Rays or pixels processed, several per call for packets and tiles
+    std::uint64_t TimedItemCount;
+    std::uint64_t TimedCallCount;
+    std::uint64_t TimedNanoseconds;
+};
+
+/**
+ * @brief Sums of statistics of all threads since start, so that the difference of two snapshots covers the time between them.
+ */
+struct StatsSnapshot final
+{
+    std::array<StageStats, STAT_STAGE_COUNT>      Stages;
+    std::array<std::uint64_t, STAT_COUNTER_COUNT> Counts;
+};
+
+//
+// Service types
+//
+
+/**
+ * @brief Statistics of one thread, only ever written by that thread.
+ *
+ * Relaxed atomics compile to plain loads and stores, yet let TakeStatsSnapshot() read them from another thread.
+ */
+struct ThreadStats final
+{
+    struct Stage final
+    {
+        std::atomic<std::uint64_t> ItemCount; // Only added to by timed calls, so up to STAT_TIMED_ITEM_INTERVAL items behind
+        std::atomic<std::uint64_t> TimedItemCount;
+        std::atomic<std::uint64_t> TimedCallCount;
+        std::atomic<std::uint64_t> TimedNanoseconds;
+
+        // Items of the calls since the last timed one, which only the owning thread accesses,
+        // so that untimed calls add to it in place rather than through an atomic load and store
+        std::uint64_t PendingItemCount;
+    };
+
+    std::array<Stage, STAT_STAGE_COUNT>                        Stages;
+    std::array<std::atomic<std::uint64_t>, STAT_COUNTER_COUNT> Counts;
+};
+
+// Accessed directly, as even a pointer check per call would make stages taking tens of nanoseconds measurably slower
+inline thread_local ThreadStats currentThreadStats{};
+
+//
+// ScopedStageTimer
+//
+
+/**
+ * @brief Counts items processed by a call of a stage, timing about one call per STAT_TIMED_ITEM_INTERVAL items.
+ *
+ * Stage time is estimated from the time per item of the timed calls. Compiles to nothing unless RTWE_ENABLE_STATS is defined.
+ */
+class ScopedStageTimer final
+{
+public: // Construction
+
+    inline explicit ScopedStageTimer(const StatStage stage, const std::uint64_t itemCount = 1);
+
+    inline ~ScopedStageTimer();
+
+public: // Interface
+
+    /**
+     * @brief Whether this call is one of the sampled ones, during which counters should be updated.
+     */
+    inline bool IsTimed() const;
+
+public: // Deleted
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer(ScopedStageTimer&&)      = delete;
+
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(ScopedStageTimer&&)      = delete;
+
+private: // Service
+
+    // Kept out of line, so that untimed calls, the vast majority, only inline a few instructions
+
+    void startTiming(ThreadStats::Stage & stageStats, const std::uint64_t itemCount);
+
+    void finishTiming();
+
+private: // Members
+
+    ThreadStats::Stage *                  m_pTimedStage; // nullptr unless this call is timed
+    std::uint64_t                         m_ItemCount;
+    std::chrono::steady_clock::time_point m_StartTime;
+};
+
+//
+// Utilities
+//
+
+inline void CountStat(const StatCounter counter, const std::uint64_t count = 1);
+
+StatsSnapshot TakeStatsSnapshot();
+
+/**
+ * @brief Statistics accumulated after earlier and up to later.
+ */
+StatsSnapshot SubtractStats(const StatsSnapshot & later, const StatsSnapshot & earlier);
+
+/**
+ * @brief Estimated time spent in a stage, summed over all threads, excluding the cost of timing itself.
+ */
+double GetStageSeconds(const StageStats & stageStats);
+
+/**
+ * @brief Estimated total of a counter, from the counts of timed intersection calls.
+ */
+double GetStatCount(const StatsSnapshot & stats, const StatCounter counter);
+
+double GetMraysPerSecond(const StatsSnapshot & stats, const double seconds);
+
+/**
+ * @brief Single line summary of rays traced and each stage's share of time, for logging.
+ */
+std::string DescribeStats(const StatsSnapshot & stats, const double seconds);
+
+/**
+ * @brief Largest amount of physical memory the process has used so far, available whether statistics are enabled or not.
+ *
+ * @return 0 if the platform doesn't report it.
+ */
+std::uint64_t GetPeakResidentSetBytes();
+
+//
+// Service
+//
+
+inline void AddToStat(std::atomic<std::uint64_t> & stat, const std::uint64_t value)
+{
+    // Only the owning thread writes, so there's no need for a locked read-modify-write
+    stat.store(stat.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+//
+// Construction
+//
+
+inline ScopedStageTimer::ScopedStageTimer(const StatStage stage, const std::uint64_t itemCount):
+    m_pTimedStage(nullptr)
+{
+    if constexpr (ARE_STATS_ENABLED)
+    {
+        ThreadStats::Stage & stageStats = currentThreadStats.Stages[static_cast<int>(stage)];
+
+        stageStats.PendingItemCount += itemCount;
+
+        if (stageStats.PendingItemCount >= STAT_TIMED_ITEM_INTERVAL)
+            startTiming(stageStats, itemCount);
+    }
+}
+
+inline ScopedStageTimer::~ScopedStageTimer()
+{
+    if constexpr (ARE_STATS_ENABLED)
+    {
+        if (m_pTimedStage != nullptr)
+            finishTiming();
+    }
+}
+
+//
+// Interface
+//
+
+inline bool ScopedStageTimer::IsTimed() const
+{
+    return ARE_STATS_ENABLED && m_pTimedStage != nullptr;
+}
+
+//
+// Utilities
+//
+
+inline void CountStat(const StatCounter counter, const std::uint64_t count)
+{
+    if constexpr (ARE_STATS_ENABLED)
+        AddToStat(currentThreadStats.Counts[static_cast<int>(counter)], count);
+}
+
+} // namespace rtwe
+
+#endif // RTWE_STATS_H
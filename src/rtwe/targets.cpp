@@ -1,10 +1,47 @@
 #include "targets.h"
 
+#include <algorithm>
+
 #include "tracing.h"
+#include "BoundingBox.h"
+#include "constants.h"
 
 namespace rtwe
 {
 
+//
+// IRayTarget
+//
+
+MaskPacket IRayTarget::TryHitPacket(
+    const RayPacket & packet,
+    const float       minRayParam,
+    FloatPacket &     maxRayParams
+) const
+{
+    MaskPacket result = MaskPacket::Constant(false);
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        if (const std::optional<RayHit> rayHit = TryHit(packet.GetRay(i), minRayParam, maxRayParams[i]))
+        {
+            maxRayParams[i] = rayHit->RayParam;
+            result[i]       = true;
+        }
+    }
+
+    return result;
+}
+
+std::optional<MotionBoundingBox> IRayTarget::TryGetMotionBoundingBox(const float /*startTime*/, const float /*endTime*/) const
+{
+    return std::nullopt;
+}
+
+//
+//
+//
+
 //
 // CompositeRayTarget
 //
@@ -48,6 +85,21 @@ std::optional<RayHit> CompositeRayTarget::TryHit(
     return result;
 }
 
+std::optional<BoundingBox> CompositeRayTarget::TryGetBoundingBox() const
+{
+    BoundingBox result;
+    for (const std::shared_ptr<IRayTarget> & target : m_Targets)
+    {
+        const std::optional<BoundingBox> targetBoundingBox = target->TryGetBoundingBox();
+        if (!targetBoundingBox.has_value())
+            return std::nullopt;
+
+        result.Expand(*targetBoundingBox);
+    }
+
+    return result;
+}
+
 //
 //
 //
@@ -88,6 +140,11 @@ std::optional<RayHit> SkyboxGradientRayTarget::TryHit(
     return rayHit;
 }
 
+std::optional<BoundingBox> SkyboxGradientRayTarget::TryGetBoundingBox() const
+{
+    return std::nullopt;
+}
+
 //
 //
 //
@@ -117,6 +174,139 @@ std::optional<RayHit> SphereRayTarget::TryHit(
     return rayHit;
 }
 
+MaskPacket SphereRayTarget::TryHitPacket(
+    const RayPacket & packet,
+    const float       minRayParam,
+    FloatPacket &     maxRayParams
+) const
+{
+    // Same computation as in TryRayHitSphere(), with each operation applied to the whole packet
+
+    const FloatPacket toCenterX = m_Center.x() - packet.OriginX;
+    const FloatPacket toCenterY = m_Center.y() - packet.OriginY;
+    const FloatPacket toCenterZ = m_Center.z() - packet.OriginZ;
+
+    const FloatPacket a = packet.DirectionX.square() + packet.DirectionY.square() + packet.DirectionZ.square();
+    const FloatPacket b = 2.0f*(packet.DirectionX*toCenterX + packet.DirectionY*toCenterY + packet.DirectionZ*toCenterZ);
+    const FloatPacket c = toCenterX.square() + toCenterY.square() + toCenterZ.square() - m_Radius*m_Radius;
+
+    const FloatPacket discriminant = b.square() - 4.0f*a*c;
+    const FloatPacket rayParams    = (b - discriminant.max(0.0f).sqrt())/(2.0f*a);
+
+    const MaskPacket result = (discriminant >= 0.0f) && (rayParams >= minRayParam) && (rayParams <= maxRayParams);
+
+    maxRayParams = result.select(rayParams, maxRayParams);
+
+    return result;
+}
+
+std::optional<BoundingBox> SphereRayTarget::TryGetBoundingBox() const
+{
+    const Vector3 extent = Vector3::Constant(m_Radius);
+
+    return BoundingBox(m_Center - extent, m_Center + extent);
+}
+
+//
+//
+//
+
+//
+// MovingSphereRayTarget
+//
+
+//
+// Construction
+//
+
+MovingSphereRayTarget::MovingSphereRayTarget(std::vector<Vector3> centers, const float radius):
+    m_Centers(std::move(centers)),
+    m_Radius (radius)
+{
+    assert(!m_Centers.empty());
+}
+
+//
+// Interface
+//
+
+Vector3 MovingSphereRayTarget::GetCenter(const float time) const
+{
+    const size_t segmentCount = m_Centers.size() - 1;
+    if (segmentCount == 0)
+        return m_Centers.front();
+
+    const float  segmentPosition = std::clamp(time, 0.0f, 1.0f)*static_cast<float>(segmentCount);
+    const size_t segmentIndex    = std::min(static_cast<size_t>(segmentPosition), segmentCount - 1);
+    const float  fraction        = segmentPosition - static_cast<float>(segmentIndex);
+
+    return m_Centers[segmentIndex] + fraction*(m_Centers[segmentIndex + 1] - m_Centers[segmentIndex]);
+}
+
+//
+// IRayTarget
+//
+
+std::optional<RayHit> MovingSphereRayTarget::TryHit(
+    const Ray & ray,
+    const float minRayParam,
+    const float maxRayParam
+) const
+{
+    std::optional<RayHit> rayHit = TryRayHitSphere(ray, GetCenter(ray.Time), m_Radius);
+
+    if (!rayHit.has_value() || rayHit->RayParam < minRayParam || rayHit->RayParam > maxRayParam)
+        return std::nullopt;
+
+    return rayHit;
+}
+
+std::optional<BoundingBox> MovingSphereRayTarget::TryGetBoundingBox() const
+{
+    // The center moves along straight lines between keyframes, so it stays within their bounds
+    BoundingBox centerBounds;
+    for (const Vector3 & center : m_Centers)
+        centerBounds.Expand(center);
+
+    const Vector3 extent = Vector3::Constant(m_Radius);
+
+    return BoundingBox(centerBounds.Min - extent, centerBounds.Max + extent);
+}
+
+std::optional<MotionBoundingBox> MovingSphereRayTarget::TryGetMotionBoundingBox(const float startTime, const float endTime) const
+{
+    assert(startTime <= endTime);
+
+    const Vector3 startCenter = GetCenter(startTime);
+    const Vector3 endCenter   = GetCenter(endTime);
+
+    // Keyframes within the part may stray from the line between its ends (e.g. at the top of a hop), which widens the bounds
+    // at both ends by as much; containing each keyframe is enough, as motion between keyframes is linear like the bounds'
+    Vector3 minOffset = Vector3::Zero();
+    Vector3 maxOffset = Vector3::Zero();
+
+    const size_t segmentCount = m_Centers.size() - 1;
+    for (size_t i = 1; i < segmentCount; i++)
+    {
+        const float keyframeTime = static_cast<float>(i)/static_cast<float>(segmentCount);
+        if (keyframeTime <= startTime || keyframeTime >= endTime)
+            continue;
+
+        const float   fraction = (keyframeTime - startTime)/(endTime - startTime);
+        const Vector3 offset   = m_Centers[i] - (startCenter + fraction*(endCenter - startCenter));
+
+        minOffset = minOffset.cwiseMin(offset);
+        maxOffset = maxOffset.cwiseMax(offset);
+    }
+
+    const Vector3 extent = Vector3::Constant(m_Radius);
+
+    return MotionBoundingBox{
+        BoundingBox(startCenter + minOffset - extent, startCenter + maxOffset + extent),
+        BoundingBox(endCenter   + minOffset - extent, endCenter   + maxOffset + extent)
+    };
+}
+
 //
 //
 //
@@ -154,6 +344,36 @@ std::optional<RayHit> PlaneRayTarget::TryHit(
     return rayHit;
 }
 
+MaskPacket PlaneRayTarget::TryHitPacket(
+    const RayPacket & packet,
+    const float       minRayParam,
+    FloatPacket &     maxRayParams
+) const
+{
+    // Same computation as in TryRayHitPlane(), with each operation applied to the whole packet
+
+    const FloatPacket denominator =
+        packet.DirectionX*m_Normal.x() + packet.DirectionY*m_Normal.y() + packet.DirectionZ*m_Normal.z();
+
+    const FloatPacket numerator =
+        (m_Point.x() - packet.OriginX)*m_Normal.x() +
+        (m_Point.y() - packet.OriginY)*m_Normal.y() +
+        (m_Point.z() - packet.OriginZ)*m_Normal.z();
+
+    const FloatPacket rayParams = numerator/denominator;
+
+    const MaskPacket result = (denominator.abs() >= EPSILON) && (rayParams >= minRayParam) && (rayParams <= maxRayParams);
+
+    maxRayParams = result.select(rayParams, maxRayParams);
+
+    return result;
+}
+
+std::optional<BoundingBox> PlaneRayTarget::TryGetBoundingBox() const
+{
+    return std::nullopt;
+}
+
 //
 //
 //
@@ -1,12 +1,14 @@
 #ifndef RTWE_TARGETS_H
 #define RTWE_TARGETS_H
 
+#include <cassert>
 #include <optional>
 #include <memory>
 #include <vector>
 
 #include "types.h"
 #include "Color.h"
+#include "RayPacket.h"
 
 namespace rtwe
 {
@@ -17,6 +19,8 @@ namespace rtwe
 
 struct Ray;
 struct RayHit;
+struct BoundingBox;
+struct MotionBoundingBox;
 
 //
 // IRayTarget
@@ -31,6 +35,34 @@ struct IRayTarget
         const float minRayParam,
         const float maxRayParam
     ) const = 0;
+
+    /**
+     * @brief Intersects all rays of a packet with the target, narrowing maxRayParams for rays which hit it closer.
+     *
+     * The default implementation falls back to TryHit() for each ray.
+     *
+     * @return Mask of rays, for which a closer hit was found.
+     */
+    virtual MaskPacket TryHitPacket(
+        const RayPacket & packet,
+        const float       minRayParam,
+        FloatPacket &     maxRayParams
+    ) const;
+
+    /**
+     * @return Bounds of the target or nothing, if the target is unbounded (e.g. a plane).
+     *         Bounds of a moving target contain it over the whole shutter interval.
+     */
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const = 0;
+
+    /**
+     * @brief Tighter bounds of a moving target, which follow it over the given part of the shutter interval.
+     *
+     * The default implementation is for targets which don't move.
+     *
+     * @return Bounds at the start and the end of the part, or nothing if the target doesn't move or is unbounded.
+     */
+    virtual std::optional<MotionBoundingBox> TryGetMotionBoundingBox(const float startTime, const float endTime) const;
 };
 
 //
@@ -52,6 +84,8 @@ public: // IRayTarget
         const float maxRayParam
     ) const override;
 
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const override;
+
 private: // Members
 
     std::vector<std::shared_ptr<IRayTarget>> m_Targets;
@@ -76,6 +110,8 @@ public: // IRayTarget
         const float maxRayParam
     ) const override;
 
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const override;
+
 private: // Members
 
     const Color m_BottomColor;
@@ -101,6 +137,14 @@ public: // IRayTarget
         const float maxRayParam
     ) const override;
 
+    virtual MaskPacket TryHitPacket(
+        const RayPacket & packet,
+        const float       minRayParam,
+        FloatPacket &     maxRayParams
+    ) const override;
+
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const override;
+
 private:
 
     const Vector3 m_Point;
@@ -118,6 +162,65 @@ public: // Construction
 
     SphereRayTarget(Vector3 center, const float radius);
 
+public: // Interface
+
+    inline const Vector3 & GetCenter() const;
+
+    inline void SetCenter(Vector3 center);
+
+    inline float GetRadius() const;
+
+public: // IRayTarget
+
+    virtual std::optional<RayHit> TryHit(
+        const Ray & ray,
+        const float minRayParam,
+        const float maxRayParam
+    ) const override;
+
+    virtual MaskPacket TryHitPacket(
+        const RayPacket & packet,
+        const float       minRayParam,
+        FloatPacket &     maxRayParams
+    ) const override;
+
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const override;
+
+private: // Members
+
+    Vector3     m_Center;
+    const float m_Radius;
+};
+
+//
+// MovingSphereRayTarget
+//
+
+/**
+ * @brief Sphere whose center moves linearly between keyframes, spread evenly over the shutter interval.
+ *
+ * Two centers make for linear motion; more of them for a path following curved or changing motion, e.g. of an animation.
+ */
+class MovingSphereRayTarget final:
+    public IRayTarget
+{
+public: // Construction
+
+    MovingSphereRayTarget(std::vector<Vector3> centers, const float radius);
+
+public: // Interface
+
+    Vector3 GetCenter(const float time) const;
+
+    inline const std::vector<Vector3> & GetCenters() const;
+
+    /**
+     * @param centers Keyframes of the center; a single one for a sphere which stays put during the interval.
+     */
+    inline void SetCenters(std::vector<Vector3> centers);
+
+    inline float GetRadius() const;
+
 public: // IRayTarget
 
     virtual std::optional<RayHit> TryHit(
@@ -126,12 +229,64 @@ public: // IRayTarget
         const float maxRayParam
     ) const override;
 
+    virtual std::optional<BoundingBox> TryGetBoundingBox() const override;
+
+    virtual std::optional<MotionBoundingBox> TryGetMotionBoundingBox(const float startTime, const float endTime) const override;
+
 private: // Members
 
-    const Vector3 m_Center;
-    const float   m_Radius;
+    std::vector<Vector3> m_Centers;
+    const float          m_Radius;
 };
 
+//
+// SphereRayTarget
+//
+
+//
+// Interface
+//
+
+inline const Vector3 & SphereRayTarget::GetCenter() const
+{
+    return m_Center;
+}
+
+inline void SphereRayTarget::SetCenter(Vector3 center)
+{
+    m_Center = std::move(center);
+}
+
+inline float SphereRayTarget::GetRadius() const
+{
+    return m_Radius;
+}
+
+//
+// MovingSphereRayTarget
+//
+
+//
+// Interface
+//
+
+inline const std::vector<Vector3> & MovingSphereRayTarget::GetCenters() const
+{
+    return m_Centers;
+}
+
+inline void MovingSphereRayTarget::SetCenters(std::vector<Vector3> centers)
+{
+    assert(!centers.empty());
+
+    m_Centers = std::move(centers);
+}
+
+inline float MovingSphereRayTarget::GetRadius() const
+{
+    return m_Radius;
+}
+
 }
 
 #endif // RTWE_TARGETS_H
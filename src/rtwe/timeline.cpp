@@ -0,0 +1,305 @@
+#include "timeline.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace rtwe
+{
+
+//
+// Constants
+//
+
+// Per thread, about 2.5 MiB, allocated on its first event unless one of a finished thread is free
+constexpr std::uint64_t TIMELINE_EVENT_CAPACITY = 1 << 16; // Must be a power of 2
+
+constexpr int TIMELINE_PROCESS_ID = 1;
+
+//
+// Service types
+//
+
+namespace
+{
+
+/**
+ * @brief Ring buffer of events of one thread, written by that thread only, without locking.
+ *
+ * Owned by the registry rather than the thread, so that events of threads which have exited can still be saved.
+ */
+struct ThreadTimeline final
+{
+    std::unique_ptr<TimelineEvent[]> Events;
+    std::atomic<std::uint64_t>       RecordedEventCount;
+    const char *                     ThreadName; // nullptr if unnamed
+    int                              ThreadId;
+    bool                             IsThreadFinished;
+};
+
+/**
+ * @brief Timelines of threads which have recorded events, along with event buffers freed by finished threads.
+ *
+ * A finished thread's buffer is reused by the next new thread once its events are saved or discarded,
+ * so that short-lived threads don't each keep a buffer of their own for the rest of the process.
+ */
+struct TimelineRegistry final
+{
+    std::mutex                                    Mutex;
+    std::vector<std::unique_ptr<ThreadTimeline>>  ThreadTimelines;
+    std::vector<std::unique_ptr<TimelineEvent[]>> FreeEventBuffers;
+    int                                           LastThreadId = 0;
+
+    // Written before capturing starts, and only read while capturing
+    std::chrono::steady_clock::time_point CaptureStartTime;
+};
+
+/**
+ * @brief Marks the timeline of its thread as finished when the thread exits.
+ */
+struct ThreadTimelineRegistration final
+{
+    ~ThreadTimelineRegistration();
+};
+
+} // anonymous namespace
+
+// Created on the first event each thread records
+static thread_local ThreadTimeline * pCurrentThreadTimeline = nullptr;
+
+static thread_local const char * currentThreadName = nullptr;
+
+//
+// Service
+//
+
+static TimelineRegistry & GetTimelineRegistry();
+
+static ThreadTimeline & GetCurrentThreadTimeline();
+
+/**
+ * @brief Frees timelines of finished threads, whose events are of no more use, for new threads to reuse their buffers.
+ *
+ * Must be called with the registry locked.
+ */
+static void FreeFinishedThreadTimelines(TimelineRegistry & registry);
+
+//
+// Utilities
+//
+
+void StartTimelineCapture()
+{
+    TimelineRegistry & registry = GetTimelineRegistry();
+
+    {
+        const std::lock_guard<std::mutex> lock(registry.Mutex);
+
+        // Events of finished threads are discarded along with all others
+        FreeFinishedThreadTimelines(registry);
+
+        for (const std::unique_ptr<ThreadTimeline> & pThreadTimeline : registry.ThreadTimelines)
+            pThreadTimeline->RecordedEventCount.store(0, std::memory_order_relaxed);
+
+        registry.CaptureStartTime = std::chrono::steady_clock::now();
+    }
+
+    // Releases the start time to threads which see the capture running
+    isTimelineCapturing.store(true, std::memory_order_release);
+}
+
+void StopTimelineCapture()
+{
+    isTimelineCapturing.store(false, std::memory_order_relaxed);
+}
+
+void NameTimelineThread(const char * const name)
+{
+    currentThreadName = name;
+
+    if (pCurrentThreadTimeline == nullptr)
+        return;
+
+    const std::lock_guard<std::mutex> lock(GetTimelineRegistry().Mutex);
+
+    pCurrentThreadTimeline->ThreadName = name;
+}
+
+bool SaveTimeline(const std::string & path)
+{
+    assert(!isTimelineCapturing.load(std::memory_order_relaxed) && "capture must be stopped before saving");
+
+    TimelineRegistry & registry = GetTimelineRegistry();
+
+    const std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    nlohmann::json traceEvents = nlohmann::json::array();
+
+    for (const std::unique_ptr<ThreadTimeline> & pThreadTimeline : registry.ThreadTimelines)
+    {
+        const ThreadTimeline & threadTimeline = *pThreadTimeline;
+
+        traceEvents.push_back({
+            {"name", "thread_name"},
+            {"ph",   "M"},
+            {"pid",  TIMELINE_PROCESS_ID},
+            {"tid",  threadTimeline.ThreadId},
+            {"args", {{"name", threadTimeline.ThreadName != nullptr
+                ? std::string(threadTimeline.ThreadName)
+                : "thread " + std::to_string(threadTimeline.ThreadId)}}}
+        });
+
+        const std::uint64_t recordedEventCount = threadTimeline.RecordedEventCount.load(std::memory_order_acquire);
+        const std::uint64_t firstEventIndex    = recordedEventCount > TIMELINE_EVENT_CAPACITY
+            ? recordedEventCount - TIMELINE_EVENT_CAPACITY
+            : 0;
+
+        for (std::uint64_t i = firstEventIndex; i < recordedEventCount; i++)
+        {
+            const TimelineEvent & event = threadTimeline.Events[i & (TIMELINE_EVENT_CAPACITY - 1)];
+
+            // Complete events, with times in microseconds
+            nlohmann::json traceEvent{
+                {"name", event.Name},
+                {"cat",  "rtwe"},
+                {"ph",   "X"},
+                {"pid",  TIMELINE_PROCESS_ID},
+                {"tid",  threadTimeline.ThreadId},
+                {"ts",   static_cast<double>(event.StartNanoseconds)/1000.0},
+                {"dur",  static_cast<double>(event.DurationNanoseconds)/1000.0}
+            };
+
+            if (event.ArgumentName != nullptr)
+                traceEvent["args"] = {{event.ArgumentName, event.Argument}};
+
+            traceEvents.push_back(std::move(traceEvent));
+        }
+    }
+
+    std::ofstream file(path);
+    file << nlohmann::json{{"traceEvents", std::move(traceEvents)}, {"displayTimeUnit", "ms"}};
+
+    if (!file)
+        return false;
+
+    FreeFinishedThreadTimelines(registry);
+
+    return true;
+}
+
+//
+// Service
+//
+
+void RecordTimelineEvent(const TimelineEvent & event)
+{
+    ThreadTimeline & threadTimeline = GetCurrentThreadTimeline();
+
+    // Only this thread writes, and SaveTimeline() only reads once capturing has stopped
+    const std::uint64_t recordedEventCount = threadTimeline.RecordedEventCount.load(std::memory_order_relaxed);
+
+    threadTimeline.Events[recordedEventCount & (TIMELINE_EVENT_CAPACITY - 1)] = event;
+    threadTimeline.RecordedEventCount.store(recordedEventCount + 1, std::memory_order_release);
+}
+
+std::uint64_t GetTimelineNanoseconds(const std::chrono::steady_clock::time_point time)
+{
+    const std::chrono::steady_clock::time_point captureStartTime = GetTimelineRegistry().CaptureStartTime;
+
+    // Events started before a capture are clamped to its start
+    if (time <= captureStartTime)
+        return 0;
+
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - captureStartTime).count());
+}
+
+static TimelineRegistry & GetTimelineRegistry()
+{
+    static TimelineRegistry registry;
+
+    return registry;
+}
+
+static ThreadTimeline & GetCurrentThreadTimeline()
+{
+    if (pCurrentThreadTimeline != nullptr)
+        return *pCurrentThreadTimeline;
+
+    TimelineRegistry & registry = GetTimelineRegistry();
+
+    const std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    // Constructed on first use by each thread, and destroyed when it exits
+    thread_local ThreadTimelineRegistration registration;
+
+    auto pThreadTimeline = std::make_unique<ThreadTimeline>();
+
+    if (!registry.FreeEventBuffers.empty())
+    {
+        pThreadTimeline->Events = std::move(registry.FreeEventBuffers.back());
+        registry.FreeEventBuffers.pop_back();
+    }
+    else
+    {
+        pThreadTimeline->Events = std::make_unique<TimelineEvent[]>(TIMELINE_EVENT_CAPACITY);
+    }
+
+    pThreadTimeline->RecordedEventCount.store(0, std::memory_order_relaxed);
+    pThreadTimeline->ThreadName       = currentThreadName;
+    pThreadTimeline->ThreadId         = ++registry.LastThreadId;
+    pThreadTimeline->IsThreadFinished = false;
+
+    pCurrentThreadTimeline = pThreadTimeline.get();
+    registry.ThreadTimelines.push_back(std::move(pThreadTimeline));
+
+    return *pCurrentThreadTimeline;
+}
+
+static void FreeFinishedThreadTimelines(TimelineRegistry & registry)
+{
+    std::vector<std::unique_ptr<ThreadTimeline>> & threadTimelines = registry.ThreadTimelines;
+
+    for (std::unique_ptr<ThreadTimeline> & pThreadTimeline : threadTimelines)
+    {
+        if (pThreadTimeline->IsThreadFinished)
+        {
+            registry.FreeEventBuffers.push_back(std::move(pThreadTimeline->Events));
+            pThreadTimeline.reset();
+        }
+    }
+
+    threadTimelines.erase(std::remove(threadTimelines.begin(), threadTimelines.end(), nullptr), threadTimelines.end());
+}
+
+ThreadTimelineRegistration::~ThreadTimelineRegistration()
+{
+    TimelineRegistry & registry = GetTimelineRegistry();
+
+    const std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    pCurrentThreadTimeline->IsThreadFinished = true;
+
+    // Without any events to save, the buffer can be reused right away; others wait until their events are saved
+    if (pCurrentThreadTimeline->RecordedEventCount.load(std::memory_order_relaxed) == 0)
+    {
+        std::vector<std::unique_ptr<ThreadTimeline>> & threadTimelines = registry.ThreadTimelines;
+
+        const auto threadTimelineIt = std::find_if(
+            threadTimelines.begin(),
+            threadTimelines.end(),
+            [](const std::unique_ptr<ThreadTimeline> & pThreadTimeline) { return pThreadTimeline.get() == pCurrentThreadTimeline; }
+        );
+
+        registry.FreeEventBuffers.push_back(std::move((*threadTimelineIt)->Events));
+        threadTimelines.erase(threadTimelineIt);
+    }
+
+    pCurrentThreadTimeline = nullptr;
+}
+
+} // namespace rtwe
@@ -0,0 +1,148 @@
+#ifndef RTWE_TIMELINE_H
+#define RTWE_TIMELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace rtwe
+{
+
+//
+// Service types
+//
+
+struct TimelineEvent final
+{
+    const char *  Name;         // Must be a string literal, or otherwise outlive the capture
+    const char *  ArgumentName; // nullptr if the event has no argument
+    std::int64_t  Argument;
+    std::uint64_t StartNanoseconds;
+    std::uint64_t DurationNanoseconds;
+};
+
+// Only read in the constructor of ScopedTimelineEvent, so that nothing but this flag is touched while not capturing
+inline std::atomic<bool> isTimelineCapturing(false);
+
+//
+// ScopedTimelineEvent
+//
+
+/**
+ * @brief Records the time its scope took as an event of the current thread's timeline, if a capture is running.
+ *
+ * Meant for coarse events (passes, tiles, BVH builds), not for anything done per ray or per pixel.
+ */
+class ScopedTimelineEvent final
+{
+public: // Construction
+
+    inline explicit ScopedTimelineEvent(const char * const name);
+
+    inline ScopedTimelineEvent(const char * const name, const char * const argumentName, const std::int64_t argument);
+
+    inline ~ScopedTimelineEvent();
+
+public: // Deleted
+
+    ScopedTimelineEvent(const ScopedTimelineEvent&) = delete;
+    ScopedTimelineEvent(ScopedTimelineEvent&&)      = delete;
+
+    ScopedTimelineEvent& operator=(const ScopedTimelineEvent&) = delete;
+    ScopedTimelineEvent& operator=(ScopedTimelineEvent&&)      = delete;
+
+private: // Members
+
+    const char *                          m_Name; // nullptr unless recording
+    const char *                          m_ArgumentName;
+    std::int64_t                          m_Argument;
+    std::chrono::steady_clock::time_point m_StartTime;
+};
+
+//
+// Utilities
+//
+
+/**
+ * @brief Starts recording events of all threads, discarding those of any previous capture.
+ *
+ * Each thread keeps a fixed number of its most recent events, overwriting older ones, so captures can run indefinitely.
+ * Must not be called while events are being recorded.
+ */
+void StartTimelineCapture();
+
+void StopTimelineCapture();
+
+/**
+ * @brief Names the current thread in saved timelines; threads without a name are shown by number.
+ *
+ * @param name Must be a string literal, or otherwise outlive the capture.
+ */
+void NameTimelineThread(const char * const name);
+
+/**
+ * @brief Saves events of the last capture in Chrome trace event format, which can be opened in Perfetto or chrome://tracing.
+ *
+ * Must only be called once the capture has been stopped and no scoped events are left open, e.g. after rendering has stopped.
+ * Events of threads which have exited are only saved once, after which their buffers go to new threads.
+ *
+ * @return Whether the file was written.
+ */
+bool SaveTimeline(const std::string & path);
+
+//
+// Service
+//
+
+void RecordTimelineEvent(const TimelineEvent & event);
+
+/**
+ * @brief Nanoseconds since the start of the capture.
+ */
+std::uint64_t GetTimelineNanoseconds(const std::chrono::steady_clock::time_point time);
+
+//
+// Construction
+//
+
+inline ScopedTimelineEvent::ScopedTimelineEvent(const char * const name):
+    ScopedTimelineEvent(name, nullptr, 0)
+{
+    // Empty
+}
+
+inline ScopedTimelineEvent::ScopedTimelineEvent(const char * const name, const char * const argumentName, const std::int64_t argument):
+    m_Name        (nullptr),
+    m_ArgumentName(argumentName),
+    m_Argument    (argument)
+{
+    // Acquires the capture start time along with the flag
+    if (!isTimelineCapturing.load(std::memory_order_acquire))
+        return;
+
+    m_Name      = name;
+    m_StartTime = std::chrono::steady_clock::now();
+}
+
+inline ScopedTimelineEvent::~ScopedTimelineEvent()
+{
+    if (m_Name == nullptr)
+        return;
+
+    const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+    const std::uint64_t startNanoseconds = GetTimelineNanoseconds(m_StartTime);
+
+    RecordTimelineEvent(TimelineEvent{
+        m_Name,
+        m_ArgumentName,
+        m_Argument,
+        startNanoseconds,
+        GetTimelineNanoseconds(endTime) - startNanoseconds
+    });
+}
+
+} // namespace rtwe
+
+#endif // RTWE_TIMELINE_H
@@ -1,11 +1,14 @@
 #include "tracing.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <boost/log/trivial.hpp>
 
 #include "constants.h"
 #include "math_utils.h"
 #include "targets.h"
+#include "Scene.h"
 
 namespace rtwe
 {
@@ -14,37 +17,72 @@ namespace rtwe
 // Constants
 //
 
-constexpr int MAX_RAY_TRACE_DEPTH = 8;
+// Phong exponent + 1 per inverse squared fuzziness, matching the median angle between mirror and fuzzed reflections
+constexpr float FUZZ_PHONG_EXPONENT_SCALE = 3.7f;
 
 //
-// Service types
+// Utilities
 //
 
-namespace
+static inline Color TraceRayImpl(
+    const Scene &           scene,
+    const Ray &             ray,
+    const RayMissFunction & rayMissFunction,
+    SampleStream &          samples,
+    const int               depth
+);
+
+static inline Color ShadeRayHit(
+    const Scene &                  scene,
+    const Ray &                    ray,
+    const std::optional<BodyHit> & closestBodyHit,
+    const RayMissFunction &        rayMissFunction,
+    SampleStream &                 samples,
+    const int                      depth
+);
+
+Color TraceRay(const Scene & scene, const Ray & ray, const RayMissFunction & rayMissFunction, SampleStream & samples)
 {
+    return TraceRayImpl(scene, ray, rayMissFunction, samples, 0);
+}
 
-struct ScatteredRay
+std::array<Color, RAY_PACKET_SIZE> TraceRayPacket(
+    const Scene &                               scene,
+    const RayPacket &                           packet,
+    const RayMissFunction &                     rayMissFunction,
+    std::array<SampleStream, RAY_PACKET_SIZE> & samples
+)
 {
-    Ray   Ray;
-    Color Attenuation;
-};
+    std::array<Color, RAY_PACKET_SIZE> result;
 
-} // anonymous namespace
+    if (scene.IsEmpty())
+    {
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+            result[i] = ShadeRayMiss(rayMissFunction, packet.GetRay(i));
 
-//
-// Utilities
-//
+        return result;
+    }
 
-static inline Color TraceRayImpl(
-    const std::vector<Body> & bodies,
-    const Ray &               ray,
-    const RayMissFunction &   rayMissFunction,
-    const int                 depth
-);
+    const RayPacketHits hits = scene.TryHitPacket(packet, RAYTRACE_MIN_RAY_PARAM, INFINITY);
 
-Color TraceRay(const std::vector<Body> & bodies, const Ray & ray, const RayMissFunction & rayMissFunction)
-{
-    return TraceRayImpl(bodies, ray, rayMissFunction, 0);
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        const Ray ray = packet.GetRay(i);
+
+        std::optional<BodyHit> closestBodyHit;
+        if (hits.BodyIndices[i] >= 0)
+        {
+            closestBodyHit = scene.TryHitBody(hits.BodyIndices[i], ray, RAYTRACE_MIN_RAY_PARAM, INFINITY);
+
+            // Packet and single-ray intersection code may disagree on grazing hits; trust the latter
+            if (!closestBodyHit.has_value())
+                closestBodyHit = scene.TryHit(ray, RAYTRACE_MIN_RAY_PARAM, INFINITY);
+        }
+
+        result[i] = ShadeRayHit(scene, ray, closestBodyHit, rayMissFunction, samples[i], 0);
+    }
+
+    return result;
 }
 
 Color GetVerticalGradientColor(const Ray & ray, const Color & bottomColor, const Color & topColor)
@@ -56,6 +94,20 @@ Color GetVerticalGradientColor(const Ray & ray, const Color & bottomColor, const
     );
 }
 
+ScatterType SelectScatterType(const Material & material, SampleStream & samples)
+{
+    const float scatterFuncsWeightSum = 1.0f + material.Transparency;
+
+    float randomValue = samples.GetNextValue()*scatterFuncsWeightSum;
+
+    if ((randomValue -= material.Reflectivity) < 0.0f)
+        return ScatterType::Metallic;
+    else if ((randomValue -= material.Transparency) < 0.0f)
+        return ScatterType::Refractive;
+    else
+        return ScatterType::Lambertian;
+}
+
 static inline std::optional<float> TryRayHitSphereImpl(const Ray & ray, const Vector3 & sphereCenter, const float sphereRadius);
 
 std::optional<RayHit> TryRayHitSphere(const Ray & ray, const Vector3 & sphereCenter, const float sphereRadius)
@@ -94,34 +146,76 @@ std::optional<RayHit> TryRayHitPlane(const Ray & ray, const Vector3 & planePoint
 // Service
 //
 
-static inline Vector3 GetRandomPointInUnitSphere()
+/**
+ * @brief Phong exponent which spreads reflections about as much as the original fuzz, an offset within a sphere of radius fuzziness.
+ */
+static inline float GetFuzzPhongExponent(const float fuzziness)
 {
-    while (true)
-    {
-        const Vector3 candidatePoint = Vector3::Random();
-        if (candidatePoint.squaredNorm() < 1.0f)
-            return candidatePoint;
-    }
+    assert(fuzziness > 0.0f);
+
+    return FUZZ_PHONG_EXPONENT_SCALE/(fuzziness*fuzziness) - 1.0f;
 }
 
-static inline std::optional<ScatteredRay> TryScatterLambertian(
-    const Ray &      /*ray*/,
+std::optional<ScatteredRay> TryScatterLambertian(
+    const Ray &      ray,
     const RayHit &   rayHit,
-    const Material & material
+    const Material & material,
+    SampleStream &   samples
 )
 {
-    const Vector3 scatterTarget = rayHit.Hitpoint + rayHit.RawNormal.normalized() + GetRandomPointInUnitSphere();
+    const float value0 = samples.GetNextValue();
+    const float value1 = samples.GetNextValue();
 
     return ScatteredRay{
-        Ray(rayHit.Hitpoint, scatterTarget - rayHit.Hitpoint),
+        Ray(rayHit.Hitpoint, SampleCosineHemisphere(rayHit.RawNormal.normalized(), value0, value1), ray.Time),
         material.Albedo
     };
 }
 
-static inline std::optional<ScatteredRay> TryScatterMetallic(
+std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> TryScatterLambertianPacket(
+    const std::array<const Ray *, RAY_PACKET_SIZE> &      rays,
+    const std::array<const RayHit *, RAY_PACKET_SIZE> &   rayHits,
+    const std::array<const Material *, RAY_PACKET_SIZE> & materials,
+    const std::array<SampleStream *, RAY_PACKET_SIZE> &   samples
+)
+{
+    Vector3Packet normals;
+    FloatPacket   values0;
+    FloatPacket   values1;
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        const Vector3 normal = rayHits[i]->RawNormal.normalized();
+
+        normals.X[i] = normal.x();
+        normals.Y[i] = normal.y();
+        normals.Z[i] = normal.z();
+
+        values0[i] = samples[i]->GetNextValue();
+        values1[i] = samples[i]->GetNextValue();
+    }
+
+    const Vector3Packet scatterDirections = SampleCosineHemispheres(normals, values0, values1);
+
+    std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> result;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        const Vector3 scatterDirection(scatterDirections.X[i], scatterDirections.Y[i], scatterDirections.Z[i]);
+
+        result[i] = ScatteredRay{
+            Ray(rayHits[i]->Hitpoint, scatterDirection, rays[i]->Time),
+            materials[i]->Albedo
+        };
+    }
+
+    return result;
+}
+
+std::optional<ScatteredRay> TryScatterMetallic(
     const Ray &      ray,
     const RayHit &   rayHit,
-    const Material & material
+    const Material & material,
+    SampleStream &   samples
 )
 {
     const Vector3 incident = ray.Direction.normalized();
@@ -133,25 +227,89 @@ static inline std::optional<ScatteredRay> TryScatterMetallic(
     if (isAlmostEqual(material.Smoothness, 1.0f))
     {
         return ScatteredRay{
-            Ray(rayHit.Hitpoint, rawScatterDirection),
+            Ray(rayHit.Hitpoint, rawScatterDirection, ray.Time),
             material.Albedo
         };
     }
 
-    const float   fuzziness        = 1.0f - material.Smoothness;
-    const Vector3 fuzzOffset       = fuzziness*GetRandomPointInUnitSphere();
-    const Vector3 scatterDirection = rawScatterDirection + fuzzOffset;
+    const float value0 = samples.GetNextValue();
+    const float value1 = samples.GetNextValue();
+
+    const Vector3 scatterDirection = SamplePhongLobe(
+        rawScatterDirection,
+        GetFuzzPhongExponent(1.0f - material.Smoothness),
+        value0,
+        value1
+    );
 
     const bool isScatterBelowSurface = scatterDirection.dot(normal) <= 0.0f;
     if (isScatterBelowSurface)
         return std::nullopt;
 
     return ScatteredRay{
-        Ray(rayHit.Hitpoint, scatterDirection.normalized()),
+        Ray(rayHit.Hitpoint, scatterDirection, ray.Time),
         material.Albedo
     };
 }
 
+std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> TryScatterMetallicPacket(
+    const std::array<const Ray *, RAY_PACKET_SIZE> &      rays,
+    const std::array<const RayHit *, RAY_PACKET_SIZE> &   rayHits,
+    const std::array<const Material *, RAY_PACKET_SIZE> & materials,
+    const std::array<SampleStream *, RAY_PACKET_SIZE> &   samples
+)
+{
+    std::array<Vector3, RAY_PACKET_SIZE> normals;
+    std::array<bool, RAY_PACKET_SIZE>    areSmooth;
+
+    Vector3Packet rawScatterDirections;
+    FloatPacket   exponents;
+    FloatPacket   values0;
+    FloatPacket   values1;
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        const Vector3 incident = rays[i]->Direction.normalized();
+
+        normals[i] = rayHits[i]->RawNormal.normalized();
+
+        const Vector3 rawScatterDirection = incident - 2 * incident.dot(normals[i]) * normals[i];
+
+        rawScatterDirections.X[i] = rawScatterDirection.x();
+        rawScatterDirections.Y[i] = rawScatterDirection.y();
+        rawScatterDirections.Z[i] = rawScatterDirection.z();
+
+        assert(materials[i]->Smoothness >= 0.0f && materials[i]->Smoothness <= 1.0f);
+        areSmooth[i] = isAlmostEqual(materials[i]->Smoothness, 1.0f);
+
+        // Smooth lanes consume no sample values, like TryScatterMetallic(), and their lobe is ignored
+        exponents[i] = areSmooth[i] ? 0.0f : GetFuzzPhongExponent(1.0f - materials[i]->Smoothness);
+        values0[i]   = areSmooth[i] ? 0.5f : samples[i]->GetNextValue();
+        values1[i]   = areSmooth[i] ? 0.5f : samples[i]->GetNextValue();
+    }
+
+    const Vector3Packet scatterDirections = SamplePhongLobes(rawScatterDirections, exponents, values0, values1);
+
+    std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> result;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        const Vector3 scatterDirection = areSmooth[i]
+            ? Vector3(rawScatterDirections.X[i], rawScatterDirections.Y[i], rawScatterDirections.Z[i])
+            : Vector3(scatterDirections.X[i], scatterDirections.Y[i], scatterDirections.Z[i]);
+
+        const bool isScatterBelowSurface = !areSmooth[i] && scatterDirection.dot(normals[i]) <= 0.0f;
+        if (isScatterBelowSurface)
+            continue;
+
+        result[i] = ScatteredRay{
+            Ray(rayHits[i]->Hitpoint, scatterDirection, rays[i]->Time),
+            materials[i]->Albedo
+        };
+    }
+
+    return result;
+}
+
 /**
  * @brief Calculates reflection probability for dielectrics using Schlick's approximation.
  * 
@@ -177,15 +335,16 @@ static inline float GetSchlickReflectivity(
     return minReflectivity + (1.0f - minReflectivity)*std::pow(1.0f - cosTheta, 5.0f);
 }
 
-static inline std::optional<ScatteredRay> TryScatterRefractive(
+std::optional<ScatteredRay> TryScatterRefractive(
     const Ray &      ray,
     const RayHit &   rayHit,
-    const Material & material
+    const Material & material,
+    SampleStream &   samples
 )
 {
     const Vector3 incident      = ray.Direction.normalized(); // TODO: See if this is the same before and after determining doesRayExitNoraml
     const Vector3 surfaceNormal = rayHit.RawNormal.normalized(); // TODO: don't confuse with outward normal
-    const float   dotProduct    = incident.dot(surfaceNormal);
+    const float   dotProduct    = std::clamp(incident.dot(surfaceNormal), -1.0f, 1.0f); // Can be off by an ulp at normal incidence
 
     const bool doesRayExitBody = (dotProduct > 0.0f);
 
@@ -203,64 +362,72 @@ static inline std::optional<ScatteredRay> TryScatterRefractive(
     if (!canRefract)
     {
         // If unable to refract, reflect the ray
-        return TryScatterMetallic(ray, rayHit, material);
+        return TryScatterMetallic(ray, rayHit, material, samples);
     }
 
     const float reflectionProbability = GetSchlickReflectivity(
-        doesRayExitBody ? refractiveRatio*incident.dot(surfaceNormal) : -incident.dot(surfaceNormal),
-        doesRayExitBody ? material.RefractiveIndex                    : ENVIRONMENT_REFRACTIVE_INDEX,
-        doesRayExitBody ? ENVIRONMENT_REFRACTIVE_INDEX                : material.RefractiveIndex
+        doesRayExitBody ? refractiveRatio*dotProduct   : -dotProduct,
+        doesRayExitBody ? material.RefractiveIndex     : ENVIRONMENT_REFRACTIVE_INDEX,
+        doesRayExitBody ? ENVIRONMENT_REFRACTIVE_INDEX : material.RefractiveIndex
     );
 
-    if (GetRandomValue() < reflectionProbability)
+    if (samples.GetNextValue() < reflectionProbability)
     {
         // Reflect the ray
-        return TryScatterMetallic(ray, rayHit, material);
+        return TryScatterMetallic(ray, rayHit, material, samples);
     }
 
     const Vector3 refractDirection = refractiveRatio * (incident - outwardNormal*dotProduct) - outwardNormal*std::sqrt(discriminant);
 
     return ScatteredRay{
-        Ray(rayHit.Hitpoint, refractDirection),
+        Ray(rayHit.Hitpoint, refractDirection, ray.Time),
         Color::WHITE
     };
 }
 
-static inline float GetRayHitSqrDistance(const Vector3 rayOrigin, const std::optional<RayHit> & rayHit)
-{
-    return rayHit.has_value()
-        ? (rayHit->Hitpoint - rayOrigin).squaredNorm()
-        : INFINITY;
-}
-
 using ScatterFunc = std::optional<ScatteredRay> (*) (
     const Ray &      ray,
     const RayHit &   rayHit,
-    const Material & material
+    const Material & material,
+    SampleStream &   samples
 );
 
 static inline Color GetScatteredRayColor(
-    const ScatterFunc         scatterFunc,
-    const std::vector<Body> & bodies,
-    const Ray &               ray,
-    const RayMissFunction &   rayMissFunction,
-    const int                 depth,
-    const RayHit &            rayHit,
-    const Material &          material
+    const ScatterType       scatterType,
+    const Scene &           scene,
+    const Ray &             ray,
+    const RayMissFunction & rayMissFunction,
+    SampleStream &          samples,
+    const int               depth,
+    const RayHit &          rayHit,
+    const Material &        material
 )
 {
-    const std::optional<ScatteredRay> scatteredRay = scatterFunc(
-        ray,
-        rayHit,
-        material
-    );
+    static const std::array<ScatterFunc, SCATTER_TYPE_COUNT> SCATTER_FUNCS{
+        TryScatterMetallic,
+        TryScatterRefractive,
+        TryScatterLambertian
+    };
+
+    std::optional<ScatteredRay> scatteredRay;
+    {
+        const ScopedStageTimer timer(GetScatterStatStage(scatterType));
+
+        scatteredRay = SCATTER_FUNCS[static_cast<size_t>(scatterType)](
+            ray,
+            rayHit,
+            material,
+            samples
+        );
+    }
 
     if (scatteredRay.has_value())
     {
         const Color scatteredRayColor = TraceRayImpl(
-            bodies,
+            scene,
             scatteredRay->Ray,
             rayMissFunction,
+            samples,
             depth + 1
         );
 
@@ -276,65 +443,50 @@ static inline Color GetScatteredRayColor(
 }
 
 static inline Color TraceRayImpl(
-    const std::vector<Body> & bodies,
-    const Ray &               ray,
-    const RayMissFunction &   rayMissFunction,
-    const int                 depth
+    const Scene &           scene,
+    const Ray &             ray,
+    const RayMissFunction & rayMissFunction,
+    SampleStream &          samples,
+    const int               depth
 )
 {
-    if (bodies.empty() || depth >= MAX_RAY_TRACE_DEPTH)
-        return rayMissFunction(ray);
+    if (scene.IsEmpty() || depth >= MAX_RAY_TRACE_DEPTH)
+        return ShadeRayMiss(rayMissFunction, ray);
 
-    // TODO: Optimize; add opportunity for early exit if there's no posibility to hit something closer (see CompositeRayTarget)
-
-    std::vector<std::optional<RayHit>> rayHits(bodies.size());
-
-    std::transform(
-        bodies.cbegin(),
-        bodies.cend(),
-        rayHits.begin(),
-        [&ray](const Body & body) {
-            return body.RayTarget->TryHit(ray, RAYTRACE_MIN_RAY_PARAM, INFINITY);
-        }
+    return ShadeRayHit(
+        scene,
+        ray,
+        scene.TryHit(ray, RAYTRACE_MIN_RAY_PARAM, INFINITY),
+        rayMissFunction,
+        samples,
+        depth
     );
+}
 
-    const auto closestRayHitIt = std::min_element(
-        rayHits.cbegin(),
-        rayHits.cend(),
-        [&ray](const std::optional<RayHit> & rayHit0, const std::optional<RayHit> & rayHit1) {
-            return GetRayHitSqrDistance(ray.Origin, rayHit0) < GetRayHitSqrDistance(ray.Origin, rayHit1);
-        }
-    );
-    assert(closestRayHitIt != rayHits.cend());
+static inline Color ShadeRayHit(
+    const Scene &                  scene,
+    const Ray &                    ray,
+    const std::optional<BodyHit> & closestBodyHit,
+    const RayMissFunction &        rayMissFunction,
+    SampleStream &                 samples,
+    const int                      depth
+)
+{
+    if (!closestBodyHit.has_value())
+        return ShadeRayMiss(rayMissFunction, ray);
 
-    if (!closestRayHitIt->has_value())
-        return rayMissFunction(ray);
+    samples.StartBounce(depth);
 
-    const size_t     closestRayHitIndex  = closestRayHitIt - rayHits.cbegin();
-    const size_t     closestBodyIndex    = closestRayHitIndex;
-    const RayHit &   closestRayHit       = closestRayHitIt->value();
-    const Body &     closestBody         = bodies[closestBodyIndex];
+    const RayHit &   closestRayHit       = closestBodyHit->Hit;
+    const Body &     closestBody         = scene.GetBodies()[closestBodyHit->BodyIndex];
     const Material & closestBodyMaterial = closestBody.Material;
 
-    // Select scattering function via roulette-wheel, using Reflectivity, (1.0 - Reflectivity), and Transparency as weights.
-
-    const float scatterFuncsWeightSum = 1.0f + closestBodyMaterial.Transparency;
-    ScatterFunc selectedScatterFunc   = nullptr;
-
-    float randomValue = GetRandomValue()*scatterFuncsWeightSum;
-
-    if ((randomValue -= closestBodyMaterial.Reflectivity) < 0.0f)
-        selectedScatterFunc = TryScatterMetallic;
-    else if ((randomValue -= closestBodyMaterial.Transparency) < 0.0f)
-        selectedScatterFunc = TryScatterRefractive;
-    else
-        selectedScatterFunc = TryScatterLambertian;
-
     return GetScatteredRayColor(
-        selectedScatterFunc,
-        bodies,
+        SelectScatterType(closestBodyMaterial, samples),
+        scene,
         ray,
         rayMissFunction,
+        samples,
         depth,
         closestRayHit,
         closestBodyMaterial
@@ -1,6 +1,8 @@
 #ifndef RTWE_TRACING_H
 #define RTWE_TRACING_H
 
+#include <array>
+#include <cassert>
 #include <memory>
 #include <functional>
 #include <optional>
@@ -8,6 +10,9 @@
 #include "types.h"
 #include "Color.h"
 #include "Ray.h"
+#include "RayPacket.h"
+#include "sampling.h"
+#include "stats.h"
 
 namespace rtwe
 {
@@ -17,6 +22,7 @@ namespace rtwe
 //
 
 struct IRayTarget;
+class Scene;
 
 //
 // Interface types
@@ -44,18 +50,92 @@ struct RayHit final
     Vector3 RawNormal;
 };
 
+struct BodyHit final
+{
+    RayHit Hit;
+    size_t BodyIndex;
+};
+
+struct ScatteredRay final
+{
+    Ray   Ray;
+    Color Attenuation;
+};
+
+enum class ScatterType
+{
+    Metallic,
+    Refractive,
+    Lambertian
+};
+
+constexpr int SCATTER_TYPE_COUNT = 3;
+
 using RayMissFunction = std::function<Color(Ray)>;
 
 //
 // Utilities
 //
 
-Color TraceRay(const std::vector<Body> & bodies, const Ray & ray, const RayMissFunction & rayMissFunction);
-
-inline Color TraceRayWithDefaultColor(const std::vector<Body> & bodies, const Ray & ray, const Color & defaultColor);
+/**
+ * @param samples Provides values for all random decisions along the path, starting with the first bounce.
+ */
+Color TraceRay(const Scene & scene, const Ray & ray, const RayMissFunction & rayMissFunction, SampleStream & samples);
+
+/**
+ * @brief Traces a packet of coherent rays (e.g. primary rays of neighboring pixels).
+ *
+ * Closest hits are found for the whole packet at once, while the following bounces are traced ray by ray.
+ */
+std::array<Color, RAY_PACKET_SIZE> TraceRayPacket(
+    const Scene &                               scene,
+    const RayPacket &                           packet,
+    const RayMissFunction &                     rayMissFunction,
+    std::array<SampleStream, RAY_PACKET_SIZE> & samples
+);
+
+inline Color TraceRayWithDefaultColor(const Scene & scene, const Ray & ray, const Color & defaultColor, SampleStream & samples);
+
+/**
+ * @brief Color of a ray which escaped the scene, timed as the miss shading stage.
+ */
+inline Color ShadeRayMiss(const RayMissFunction & rayMissFunction, const Ray & ray);
 
 Color GetVerticalGradientColor(const Ray & ray, const Color & bottomColor, const Color & topColor);
 
+/**
+ * @brief Selects scattering function via roulette-wheel, using Reflectivity, (1.0 - Reflectivity), and Transparency as weights.
+ */
+ScatterType SelectScatterType(const Material & material, SampleStream & samples);
+
+inline StatStage GetScatterStatStage(const ScatterType scatterType);
+
+std::optional<ScatteredRay> TryScatterLambertian(const Ray & ray, const RayHit & rayHit, const Material & material, SampleStream & samples);
+
+std::optional<ScatteredRay> TryScatterMetallic(const Ray & ray, const RayHit & rayHit, const Material & material, SampleStream & samples);
+
+/**
+ * @brief Same as TryScatterLambertian() for each ray of a packet, with scatter directions computed for the whole packet at once.
+ */
+std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> TryScatterLambertianPacket(
+    const std::array<const Ray *, RAY_PACKET_SIZE> &      rays,
+    const std::array<const RayHit *, RAY_PACKET_SIZE> &   rayHits,
+    const std::array<const Material *, RAY_PACKET_SIZE> & materials,
+    const std::array<SampleStream *, RAY_PACKET_SIZE> &   samples
+);
+
+/**
+ * @brief Same as TryScatterMetallic() for each ray of a packet, with scatter directions computed for the whole packet at once.
+ */
+std::array<std::optional<ScatteredRay>, RAY_PACKET_SIZE> TryScatterMetallicPacket(
+    const std::array<const Ray *, RAY_PACKET_SIZE> &      rays,
+    const std::array<const RayHit *, RAY_PACKET_SIZE> &   rayHits,
+    const std::array<const Material *, RAY_PACKET_SIZE> & materials,
+    const std::array<SampleStream *, RAY_PACKET_SIZE> &   samples
+);
+
+std::optional<ScatteredRay> TryScatterRefractive(const Ray & ray, const RayHit & rayHit, const Material & material, SampleStream & samples);
+
 std::optional<RayHit> TryRayHitSphere(const Ray & ray, const Vector3 & sphereCenter, const float sphereRadius);
 
 std::optional<RayHit> TryRayHitPlane(const Ray & ray, const Vector3 & planePoint, const Vector3 & planeNormal);
@@ -64,13 +144,36 @@ std::optional<RayHit> TryRayHitPlane(const Ray & ray, const Vector3 & planePoint
 // Utilities
 //
 
-inline Color TraceRayWithDefaultColor(const std::vector<Body> & bodies, const Ray & ray, const Color & defaultColor)
+inline Color TraceRayWithDefaultColor(const Scene & scene, const Ray & ray, const Color & defaultColor, SampleStream & samples)
 {
     const auto getDefaultColor = [&defaultColor](const Ray & /*ray*/) {
         return defaultColor;
     };
 
-    return TraceRay(bodies, ray, getDefaultColor);
+    return TraceRay(scene, ray, getDefaultColor, samples);
+}
+
+inline Color ShadeRayMiss(const RayMissFunction & rayMissFunction, const Ray & ray)
+{
+    const ScopedStageTimer timer(StatStage::MissShading);
+
+    return rayMissFunction(ray);
+}
+
+inline StatStage GetScatterStatStage(const ScatterType scatterType)
+{
+    switch (scatterType)
+    {
+    case ScatterType::Metallic:
+        return StatStage::MetallicScattering;
+    case ScatterType::Refractive:
+        return StatStage::RefractiveScattering;
+    case ScatterType::Lambertian:
+        return StatStage::LambertianScattering;
+    }
+
+    assert(false && "unknown scatter type");
+    return StatStage::LambertianScattering;
 }
 
 }